@@ -37,7 +37,7 @@ DEFINE_MTYPE(BGPD, AS_STR, "BGP aspath str");
 
 DEFINE_MTYPE(BGPD, BGP_TABLE, "BGP table");
 DEFINE_MTYPE(BGPD, BGP_NODE, "BGP node");
-DEFINE_MTYPE(BGPD, BGP_ROUTE, "BGP route");
+DEFINE_MTYPE_SLAB(BGPD, BGP_ROUTE, "BGP route");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA, "BGP ancillary route info");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_EVPN, "BGP extra info for EVPN");
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA_FS, "BGP extra info for flowspec");
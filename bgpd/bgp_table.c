@@ -117,15 +117,17 @@ static void bgp_node_destroy(route_table_delegate_t *delegate,
 		node->info = NULL;
 	}
 
-	XFREE(MTYPE_ROUTE_NODE, node);
+	route_node_arena_destroy(delegate, table, node);
 }
 
 /*
  * Function vector to customize the behavior of the route table
  * library for BGP route tables.
  */
-route_table_delegate_t bgp_table_delegate = { .create_node = route_node_create,
-					      .destroy_node = bgp_node_destroy };
+route_table_delegate_t bgp_table_delegate = {
+	.create_node = route_node_arena_create,
+	.destroy_node = bgp_node_destroy,
+};
 
 /*
  * bgp_table_init
@@ -1547,7 +1547,7 @@ static int update_subgroup_copy_packets(struct update_subgroup *dest,
 
 	count = 0;
 	while (pkt && pkt->buffer) {
-		bpacket_queue_add(SUBGRP_PKTQ(dest), stream_dup(pkt->buffer),
+		bpacket_queue_add(SUBGRP_PKTQ(dest), stream_clone(pkt->buffer),
 				  &pkt->arr);
 		count++;
 		pkt = bpacket_next(pkt);
@@ -337,7 +337,8 @@ struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 	struct peer *peer;
 	struct bgp_filter *filter;
 
-	s = stream_dup(pkt->buffer);
+	/* shares the data until a nexthop is rewritten below */
+	s = stream_clone(pkt->buffer);
 	peer = PAF_PEER(paf);
 
 	vec = &pkt->arr.entries[BGP_ATTR_VEC_NH];
@@ -155,6 +155,9 @@ void isis_delete_adj(void *arg)
 
 	hook_call(isis_adj_state_change_hook, adj);
 
+	/* Deferred TI-LFA computations still point at this adjacency. */
+	isis_tilfa_cancel(adj->circuit->area, IS_LEVEL_1_AND_2);
+
 	XFREE(MTYPE_ISIS_ADJACENCY_INFO, adj->area_addresses);
 	XFREE(MTYPE_ISIS_ADJACENCY_INFO, adj->ipv4_addresses);
 	XFREE(MTYPE_ISIS_ADJACENCY_INFO, adj->ll_ipv6_addrs);
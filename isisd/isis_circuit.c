@@ -951,7 +951,7 @@ void isis_circuit_print_json(struct isis_circuit *circuit,
 	int level;
 	json_object *iface_json, *ipv4_addr_json, *ipv6_link_json,
 		*ipv6_non_link_json, *hold_json, *lan_prio_json, *levels_json,
-		*level_json;
+		*level_json, *tx_queue_json;
 	char buf_prx[INET6_BUFSIZ];
 	char buf[255];
 
@@ -1050,6 +1050,30 @@ void isis_circuit_print_json(struct isis_circuit *circuit,
 			json_object_array_add(levels_json, level_json);
 		}
 
+		if (circuit->tx_queue) {
+			struct isis_tx_queue_stats stats;
+
+			isis_tx_queue_stats_get(circuit->tx_queue, &stats);
+			tx_queue_json = json_object_new_object();
+			json_object_object_add(iface_json, "lsp-tx-queue",
+					       tx_queue_json);
+			json_object_int_add(
+				tx_queue_json, "depth",
+				isis_tx_queue_len(circuit->tx_queue));
+			json_object_int_add(tx_queue_json, "max-depth",
+					    stats.depth_max);
+			json_object_int_add(tx_queue_json, "retransmissions",
+					    stats.retransmits);
+			json_object_int_add(tx_queue_json, "bursts",
+					    stats.bursts);
+			json_object_int_add(tx_queue_json, "lsps-sent",
+					    stats.lsps_sent);
+			json_object_int_add(tx_queue_json, "max-burst",
+					    stats.burst_max);
+			json_object_int_add(tx_queue_json, "failed-bursts",
+					    stats.batch_errors);
+		}
+
 		if (listcount(circuit->ip_addrs) > 0) {
 			ipv4_addr_json = json_object_new_object();
 			json_object_object_add(iface_json, "ip-prefix",
@@ -1185,6 +1209,21 @@ void isis_circuit_print_vty(struct isis_circuit *circuit, struct vty *vty,
 				vty_out(vty, "\n");
 			}
 		}
+		if (circuit->tx_queue) {
+			struct isis_tx_queue_stats stats;
+
+			isis_tx_queue_stats_get(circuit->tx_queue, &stats);
+			vty_out(vty,
+				"    LSP TX queue: %lu LSPs (max %lu), %" PRIu64
+				" retransmissions\n",
+				isis_tx_queue_len(circuit->tx_queue),
+				stats.depth_max, stats.retransmits);
+			vty_out(vty,
+				"    LSP TX bursts: %" PRIu64 ", LSPs sent: %" PRIu64
+				", largest burst: %u, failed bursts: %" PRIu64 "\n",
+				stats.bursts, stats.lsps_sent, stats.burst_max,
+				stats.batch_errors);
+		}
 		if (listcount(circuit->ip_addrs) > 0) {
 			vty_out(vty, "    IP Prefix(es):\n");
 			for (ALL_LIST_ELEMENTS_RO(circuit->ip_addrs, node,
@@ -24,6 +24,7 @@
 DECLARE_HOOK(isis_if_new_hook, (struct interface *ifp), (ifp));
 
 struct isis_lsp;
+struct isis_tx_pdu;
 
 struct password {
 	struct password *next;
@@ -96,6 +97,9 @@ struct isis_circuit {
 	int (*rx)(struct isis_circuit *circuit, uint8_t *ssnpa);
 	struct stream *rcv_stream; /* Stream for receiving */
 	int (*tx)(struct isis_circuit *circuit, int level);
+	/* optional, several PDUs at once; *sent tells how many went out */
+	int (*tx_batch)(struct isis_circuit *circuit, struct isis_tx_pdu *pdus,
+			unsigned int count, unsigned int *sent);
 	struct stream *snd_stream; /* Stream for sending */
 	int idx;		   /* idx in S[RM|SN] flags */
 #define CIRCUIT_T_UNKNOWN    0
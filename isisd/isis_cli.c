@@ -919,6 +919,50 @@ void cli_show_isis_lsp_mtu(struct vty *vty, const struct lyd_node *dnode,
 	vty_out(vty, " lsp-mtu %s\n", yang_dnode_get_string(dnode, NULL));
 }
 
+/*
+ * XPath: /frr-isisd:isis/instance/lsp/tx-pacing
+ */
+DEFPY_YANG(area_lsp_tx_pacing, area_lsp_tx_pacing_cmd,
+	   "lsp-tx-pacing burst (1-1024)$burst interval (0-1000)$interval",
+	   "Configure the pacing of LSP transmission on each interface\n"
+	   "Maximum number of LSPs sent at once\n"
+	   "Number of LSPs\n"
+	   "Time between two bursts\n"
+	   "Time in milliseconds\n")
+{
+	nb_cli_enqueue_change(vty, "./lsp/tx-pacing/burst", NB_OP_MODIFY,
+			      burst_str);
+	nb_cli_enqueue_change(vty, "./lsp/tx-pacing/interval", NB_OP_MODIFY,
+			      interval_str);
+
+	return nb_cli_apply_changes(vty, NULL);
+}
+
+DEFPY_YANG(no_area_lsp_tx_pacing, no_area_lsp_tx_pacing_cmd,
+	   "no lsp-tx-pacing [burst (1-1024) interval (0-1000)]",
+	   NO_STR
+	   "Configure the pacing of LSP transmission on each interface\n"
+	   "Maximum number of LSPs sent at once\n"
+	   "Number of LSPs\n"
+	   "Time between two bursts\n"
+	   "Time in milliseconds\n")
+{
+	nb_cli_enqueue_change(vty, "./lsp/tx-pacing/burst", NB_OP_MODIFY,
+			      NULL);
+	nb_cli_enqueue_change(vty, "./lsp/tx-pacing/interval", NB_OP_MODIFY,
+			      NULL);
+
+	return nb_cli_apply_changes(vty, NULL);
+}
+
+void cli_show_isis_lsp_tx_pacing(struct vty *vty, const struct lyd_node *dnode,
+				 bool show_defaults)
+{
+	vty_out(vty, " lsp-tx-pacing burst %s interval %s\n",
+		yang_dnode_get_string(dnode, "burst"),
+		yang_dnode_get_string(dnode, "interval"));
+}
+
 /*
  * XPath: /frr-isisd:isis/instance/advertise-passive-only
  */
@@ -3996,6 +4040,8 @@ void isis_cli_init(void)
 	install_element(ISIS_NODE, &no_lsp_timers_cmd);
 	install_element(ISIS_NODE, &area_lsp_mtu_cmd);
 	install_element(ISIS_NODE, &no_area_lsp_mtu_cmd);
+	install_element(ISIS_NODE, &area_lsp_tx_pacing_cmd);
+	install_element(ISIS_NODE, &no_area_lsp_tx_pacing_cmd);
 	install_element(ISIS_NODE, &advertise_passive_only_cmd);
 
 	install_element(ISIS_NODE, &spf_interval_cmd);
@@ -9,6 +9,7 @@
 #include "linklist.h"
 #include "log.h"
 #include "memory.h"
+#include "jhash.h"
 #include "vrf.h"
 #include "table.h"
 #include "srcdest_table.h"
@@ -26,6 +27,7 @@
 #include "isis_mt.h"
 #include "isis_tlvs.h"
 #include "isis_spf_private.h"
+#include "isis_sr.h"
 #include "isis_zebra.h"
 #include "isis_errors.h"
 
@@ -33,6 +35,7 @@ DEFINE_MTYPE_STATIC(ISISD, ISIS_SPF_NODE, "ISIS SPF Node");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_LFA_TIEBREAKER, "ISIS LFA Tiebreaker");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_LFA_EXCL_IFACE, "ISIS LFA Excluded Interface");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_RLFA, "ISIS Remote LFA");
+DEFINE_MTYPE_STATIC(ISISD, ISIS_TILFA_CACHE, "ISIS TI-LFA cache");
 DEFINE_MTYPE(ISISD, ISIS_NEXTHOP_LABELS, "ISIS nexthop MPLS labels");
 
 static inline int isis_spf_node_compare(const struct isis_spf_node *a,
@@ -2251,21 +2254,502 @@ void isis_lfa_compute(struct isis_area *area, struct isis_circuit *circuit,
 	}
 }
 
+/* --- TI-LFA repair path cache ------------------------------------------- */
+
+/*
+ * TI-LFA runs one post-convergence SPF per protected resource every time the
+ * SPF runs, and most SPF runs are caused by LSP refreshes that change
+ * nothing.  The repair paths of each resource are kept and replayed for as
+ * long as the LSDB contents and the local state they were computed from stay
+ * the same.  Any change makes all of them suspect, since a post-convergence
+ * path can cross any node of the area; those are then computed again by
+ * isis_tilfa_run_cb(), once the primary routes are installed.
+ *
+ * Each resource only protects what the ones computed before it did not, so
+ * entries are only replayed as a prefix of the list: everything after the
+ * first miss is computed again.
+ */
+struct tilfa_cache_route {
+	struct prefix_pair p;
+	enum spf_prefix_priority priority;
+	struct isis_route_info *rinfo;
+};
+
+struct tilfa_cache_adj_sid {
+	uint8_t id[ISIS_SYS_ID_LEN + 1];
+	struct list *nexthops;
+};
+
+struct tilfa_cache_entry {
+	/* The protected resource. */
+	enum lfa_protection_type type;
+	uint8_t adjacency[ISIS_SYS_ID_LEN + 1];
+
+	/* Backup routes and backup Adj-SIDs computed for it. */
+	struct list *routes;
+	struct list *adj_sids;
+};
+
+static void tilfa_cache_route_free(void *arg)
+{
+	struct tilfa_cache_route *route = arg;
+
+	isis_route_info_free(route->rinfo);
+	XFREE(MTYPE_ISIS_TILFA_CACHE, route);
+}
+
+static void tilfa_cache_adj_sid_free(void *arg)
+{
+	struct tilfa_cache_adj_sid *sid = arg;
+
+	sid->nexthops->del = (void (*)(void *))isis_nexthop_delete;
+	list_delete(&sid->nexthops);
+	XFREE(MTYPE_ISIS_TILFA_CACHE, sid);
+}
+
+static struct tilfa_cache_entry *
+tilfa_cache_entry_new(const struct lfa_protected_resource *resource)
+{
+	struct tilfa_cache_entry *entry;
+
+	entry = XCALLOC(MTYPE_ISIS_TILFA_CACHE, sizeof(*entry));
+	entry->type = resource->type;
+	memcpy(entry->adjacency, resource->adjacency, sizeof(entry->adjacency));
+	entry->routes = list_new();
+	entry->routes->del = tilfa_cache_route_free;
+	entry->adj_sids = list_new();
+	entry->adj_sids->del = tilfa_cache_adj_sid_free;
+
+	return entry;
+}
+
+static void tilfa_cache_entry_free(void *arg)
+{
+	struct tilfa_cache_entry *entry = arg;
+
+	list_delete(&entry->routes);
+	list_delete(&entry->adj_sids);
+	XFREE(MTYPE_ISIS_TILFA_CACHE, entry);
+}
+
+/*
+ * Digest of the LSDB contents: everything the SPF looks at, but not the
+ * sequence number, lifetime, checksum or authentication of the LSPs, which
+ * change on every refresh.
+ */
+static uint64_t tilfa_lsdb_digest(struct lspdb_head *lspdb)
+{
+	struct isis_lsp *lsp;
+	uint32_t hash1 = 0, hash2 = 0x6b43a9b5;
+
+	frr_each (lspdb, lspdb, lsp) {
+		const uint8_t *data;
+		size_t offset = ISIS_FIXED_HDR_LEN + ISIS_LSP_HDR_LEN;
+		size_t len;
+		uint32_t state;
+
+		state = lsp->hdr.lsp_bits;
+		state |= (lsp->hdr.rem_lifetime == 0) << 8;
+		state |= (lsp->hdr.seqno == 0) << 9;
+		hash1 = jhash(lsp->hdr.lsp_id, sizeof(lsp->hdr.lsp_id), hash1);
+		hash1 = jhash_1word(state, hash1);
+		hash2 = jhash(lsp->hdr.lsp_id, sizeof(lsp->hdr.lsp_id), hash2);
+		hash2 = jhash_1word(state, hash2);
+
+		if (!lsp->pdu)
+			continue;
+
+		data = STREAM_DATA(lsp->pdu);
+		len = stream_get_endp(lsp->pdu);
+		while (offset + 2 <= len) {
+			size_t tlv_size = 2 + data[offset + 1];
+
+			if (tlv_size > len - offset)
+				tlv_size = len - offset;
+			if (data[offset] != ISIS_TLV_AUTH) {
+				hash1 = jhash(data + offset, tlv_size, hash1);
+				hash2 = jhash(data + offset, tlv_size, hash2);
+			}
+			offset += tlv_size;
+		}
+	}
+
+	return ((uint64_t)hash1 << 32) | hash2;
+}
+
+/* Digest of the local state TI-LFA depends on, besides the LSDB. */
+static uint32_t tilfa_local_digest(struct isis_area *area, int level)
+{
+	struct isis_adjacency *adj;
+	struct listnode *node;
+	uint32_t hash;
+
+	hash = jhash_3words(area->srdb.enabled,
+			    area->lfa_load_sharing[level - 1],
+			    area->lfa_priority_limit[level - 1],
+			    area->spf_prefix_priorities_gen);
+	for (int i = 0; i < SPF_PREFIX_PRIO_MAX; i++) {
+		struct spf_prefix_priority_acl *ppa;
+
+		ppa = &area->spf_prefix_priorities[i];
+		hash = jhash(&ppa->list_v4, sizeof(ppa->list_v4), hash);
+		hash = jhash(&ppa->list_v6, sizeof(ppa->list_v6), hash);
+	}
+
+	for (ALL_LIST_ELEMENTS_RO(area->adjacency_list, node, adj)) {
+		struct isis_circuit *circuit = adj->circuit;
+		ifindex_t ifindex;
+
+		ifindex = circuit->interface ? circuit->interface->ifindex : 0;
+		hash = jhash(adj->sysid, sizeof(adj->sysid), hash);
+		hash = jhash_3words(adj->adj_state, adj->adj_usage, adj->flaps,
+				    hash);
+		hash = jhash_3words(ifindex, circuit->ip_router,
+				    circuit->ipv6_router, hash);
+		hash = jhash(adj->ipv4_addresses,
+			     adj->ipv4_address_count
+				     * sizeof(*adj->ipv4_addresses),
+			     hash);
+		hash = jhash(adj->ll_ipv6_addrs,
+			     adj->ll_ipv6_count * sizeof(*adj->ll_ipv6_addrs),
+			     hash);
+		hash = jhash(adj->mt_set, adj->mt_count * sizeof(*adj->mt_set),
+			     hash);
+	}
+
+	return hash;
+}
+
+/* Start a new run: drop the entries if they are stale. */
+static void tilfa_cache_start(struct isis_spftree *spftree)
+{
+	struct isis_area *area = spftree->area;
+	struct isis_spftree *other;
+	struct listnode *node;
+	uint64_t lsdb_digest;
+	uint32_t local_digest;
+
+	if (!spftree->lfa.tilfa.entries) {
+		spftree->lfa.tilfa.entries = list_new();
+		spftree->lfa.tilfa.entries->del = tilfa_cache_entry_free;
+		spftree->lfa.tilfa.pending = list_new();
+		spftree->lfa.tilfa.pending->del = tilfa_cache_entry_free;
+	}
+
+	lsdb_digest = tilfa_lsdb_digest(spftree->lspdb);
+	local_digest = tilfa_local_digest(area, spftree->level);
+	if (lsdb_digest != spftree->lfa.tilfa.lsdb_digest
+	    || local_digest != spftree->lfa.tilfa.local_digest) {
+		list_delete_all_node(spftree->lfa.tilfa.entries);
+		spftree->lfa.tilfa.lsdb_digest = lsdb_digest;
+		spftree->lfa.tilfa.local_digest = local_digest;
+	}
+	spftree->lfa.tilfa.next = listhead(spftree->lfa.tilfa.entries);
+
+	/*
+	 * Backup Adj-SIDs are shared by the SPTs of an address family, and
+	 * each SPT only adds those that earlier ones did not: once an earlier
+	 * SPT has resources left to compute, so does this one.
+	 */
+	for (ALL_LIST_ELEMENTS_RO(area->tilfa_pending, node, other)) {
+		if (other->level == spftree->level
+		    && other->family == spftree->family)
+			spftree->lfa.tilfa.next = NULL;
+	}
+}
+
+static struct tilfa_cache_entry *
+tilfa_cache_lookup(struct isis_spftree *spftree,
+		   const struct lfa_protected_resource *resource)
+{
+	struct list *entries = spftree->lfa.tilfa.entries;
+	struct listnode *node = spftree->lfa.tilfa.next;
+	struct tilfa_cache_entry *entry;
+
+	if (!node)
+		return NULL;
+
+	entry = listgetdata(node);
+	if (entry->type == resource->type
+	    && !memcmp(entry->adjacency, resource->adjacency,
+		       sizeof(entry->adjacency))) {
+		spftree->lfa.tilfa.next = listnextnode(node);
+		return entry;
+	}
+
+	/* Drop this entry and all that follow. */
+	while (node) {
+		struct listnode *next = listnextnode(node);
+
+		tilfa_cache_entry_free(listgetdata(node));
+		list_delete_node(entries, node);
+		node = next;
+	}
+	spftree->lfa.tilfa.next = NULL;
+
+	return NULL;
+}
+
+static void tilfa_cache_replay(struct isis_spftree *spftree,
+			       struct tilfa_cache_entry *entry)
+{
+	struct isis_area *area = spftree->area;
+	struct tilfa_cache_route *route;
+	struct tilfa_cache_adj_sid *sid;
+	struct listnode *node;
+
+	for (ALL_LIST_ELEMENTS_RO(entry->routes, node, route)) {
+		struct route_node *rn;
+
+		rn = srcdest_rnode_lookup(spftree->route_table_backup,
+					  &route->p.dest, &route->p.src);
+		if (rn) {
+			route_unlock_node(rn);
+			continue;
+		}
+
+		isis_route_restore(&route->p.dest, &route->p.src, route->rinfo,
+				   area, spftree->route_table_backup);
+		spftree->lfa.protection_counters.tilfa[route->priority] += 1;
+	}
+
+	for (ALL_LIST_ELEMENTS_RO(entry->adj_sids, node, sid)) {
+		struct isis_adjacency *adj;
+
+		adj = isis_adj_find(area, spftree->level, sid->id);
+		if (!adj
+		    || isis_sr_adj_sid_find(adj, spftree->family,
+					    ISIS_SR_ADJ_BACKUP))
+			continue;
+
+		sr_adj_sid_add_backup(adj, spftree->family, sid->nexthops);
+	}
+}
+
+/**
+ * Save a backup route created by the post-convergence SPT, if its
+ * TI-LFA repair paths are being cached.
+ *
+ * @param spftree_pc	The post-convergence SPF tree
+ * @param vertex	The protected IP vertex
+ * @param rinfo		The backup route
+ */
+void isis_tilfa_cache_route(struct isis_spftree *spftree_pc,
+			    struct isis_vertex *vertex,
+			    struct isis_route_info *rinfo)
+{
+	struct tilfa_cache_entry *entry;
+	struct tilfa_cache_route *route;
+
+	entry = spftree_pc->lfa.old.spftree->lfa.tilfa.fill;
+	if (!entry || !rinfo)
+		return;
+
+	route = XCALLOC(MTYPE_ISIS_TILFA_CACHE, sizeof(*route));
+	route->p = vertex->N.ip.p;
+	route->priority = vertex->N.ip.priority;
+	route->rinfo = isis_route_info_dup(rinfo);
+	listnode_add(entry->routes, route);
+}
+
+/**
+ * Save a backup Adj-SID created by the post-convergence SPT, if its
+ * TI-LFA repair paths are being cached.
+ *
+ * @param spftree_pc	The post-convergence SPF tree
+ * @param vertex	The protected IS vertex
+ * @param adj		The adjacency the backup Adj-SID was added to
+ */
+void isis_tilfa_cache_adj_sid(struct isis_spftree *spftree_pc,
+			      struct isis_vertex *vertex,
+			      struct isis_adjacency *adj)
+{
+	struct tilfa_cache_entry *entry;
+	struct tilfa_cache_adj_sid *sid;
+	struct sr_adjacency *sra;
+
+	entry = spftree_pc->lfa.old.spftree->lfa.tilfa.fill;
+	if (!entry)
+		return;
+
+	sra = isis_sr_adj_sid_find(adj, spftree_pc->family,
+				   ISIS_SR_ADJ_BACKUP);
+	if (!sra || !sra->backup_nexthops)
+		return;
+
+	sid = XCALLOC(MTYPE_ISIS_TILFA_CACHE, sizeof(*sid));
+	memcpy(sid->id, vertex->N.id, sizeof(sid->id));
+	sid->nexthops = isis_nexthop_list_dup(sra->backup_nexthops);
+	listnode_add(entry->adj_sids, sid);
+}
+
+static void tilfa_compute_entry(struct isis_area *area,
+				struct isis_spftree *spftree,
+				struct isis_spftree *spftree_reverse,
+				struct tilfa_cache_entry *entry)
+{
+	struct lfa_protected_resource resource = {};
+	struct isis_spftree *spftree_pc;
+
+	resource.type = entry->type;
+	memcpy(resource.adjacency, entry->adjacency,
+	       sizeof(resource.adjacency));
+
+	spftree->lfa.tilfa.fill = entry;
+	spftree_pc = isis_tilfa_compute(area, spftree, spftree_reverse,
+					&resource);
+	spftree->lfa.tilfa.fill = NULL;
+	isis_spftree_del(spftree_pc);
+
+	listnode_add(spftree->lfa.tilfa.entries, entry);
+}
+
+static void tilfa_run_pending(struct isis_area *area,
+			      struct isis_spftree *spftree)
+{
+	struct isis_spftree *spftree_reverse;
+	struct tilfa_cache_entry *entry;
+	struct listnode *node;
+
+	spftree_reverse = spftree->lfa.tilfa.spftree_reverse;
+	spftree->lfa.tilfa.spftree_reverse = NULL;
+	if (!spftree_reverse) {
+		spftree_reverse = isis_spf_reverse_run(spftree);
+		isis_spf_run_neighbors(spftree);
+	}
+
+	while ((node = listhead(spftree->lfa.tilfa.pending))) {
+		entry = listgetdata(node);
+		list_delete_node(spftree->lfa.tilfa.pending, node);
+		tilfa_compute_entry(area, spftree, spftree_reverse, entry);
+	}
+
+	isis_spftree_del(spftree_reverse);
+
+	/*
+	 * Something changed since the SPF run, which is going to run again.
+	 * Until then, don't keep what was computed from mixed inputs.
+	 */
+	if (tilfa_lsdb_digest(spftree->lspdb) != spftree->lfa.tilfa.lsdb_digest
+	    || tilfa_local_digest(area, spftree->level)
+		       != spftree->lfa.tilfa.local_digest)
+		list_delete_all_node(spftree->lfa.tilfa.entries);
+}
+
+static void isis_tilfa_run_cb(struct event *thread)
+{
+	struct isis_area *area = EVENT_ARG(thread);
+	struct isis_spftree *spftree;
+	struct listnode *node;
+
+	if (IS_DEBUG_LFA)
+		zlog_debug("ISIS-LFA: computing TI-LFAs left for %u SPT(s)",
+			   listcount(area->tilfa_pending));
+
+	while ((node = listhead(area->tilfa_pending))) {
+		spftree = listgetdata(node);
+		list_delete_node(area->tilfa_pending, node);
+		tilfa_run_pending(area, spftree);
+	}
+
+	isis_area_verify_routes(area);
+}
+
+static void tilfa_pending_clear(struct isis_spftree *spftree)
+{
+	if (spftree->lfa.tilfa.pending)
+		list_delete_all_node(spftree->lfa.tilfa.pending);
+	if (spftree->lfa.tilfa.spftree_reverse)
+		isis_spftree_del(spftree->lfa.tilfa.spftree_reverse);
+	spftree->lfa.tilfa.spftree_reverse = NULL;
+}
+
+/**
+ * Give up the TI-LFA repair paths left to compute, as the SPTs they depend
+ * on are about to change.
+ *
+ * @param area		IS-IS area
+ * @param level		IS-IS level(s)
+ */
+void isis_tilfa_cancel(struct isis_area *area, int level)
+{
+	struct isis_spftree *spftree;
+	struct listnode *node, *nnode;
+
+	if (!area->tilfa_pending)
+		return;
+
+	for (ALL_LIST_ELEMENTS(area->tilfa_pending, node, nnode, spftree)) {
+		if (!(spftree->level & level))
+			continue;
+
+		tilfa_pending_clear(spftree);
+		list_delete_node(area->tilfa_pending, node);
+	}
+
+	if (list_isempty(area->tilfa_pending))
+		EVENT_OFF(area->t_tilfa_update);
+}
+
+/**
+ * Release the TI-LFA repair paths kept for the given SPT.
+ *
+ * @param spftree	IS-IS SPF tree
+ */
+void isis_tilfa_cache_clear(struct isis_spftree *spftree)
+{
+	struct isis_area *area = spftree->area;
+
+	tilfa_pending_clear(spftree);
+	if (area && area->tilfa_pending)
+		listnode_delete(area->tilfa_pending, spftree);
+	if (spftree->lfa.tilfa.pending)
+		list_delete(&spftree->lfa.tilfa.pending);
+	if (spftree->lfa.tilfa.entries)
+		list_delete(&spftree->lfa.tilfa.entries);
+}
+
+static void isis_spf_run_tilfa_resource(struct isis_area *area,
+					struct isis_spftree *spftree,
+					struct isis_spftree *spftree_reverse,
+					struct lfa_protected_resource *resource)
+{
+	struct isis_spftree *spftree_pc;
+	struct tilfa_cache_entry *entry;
+
+	/* No cache: compute right away. */
+	if (!spftree->lfa.tilfa.entries) {
+		assert(spftree_reverse);
+		spftree_pc = isis_tilfa_compute(area, spftree, spftree_reverse,
+						resource);
+		isis_spftree_del(spftree_pc);
+		return;
+	}
+
+	entry = tilfa_cache_lookup(spftree, resource);
+	if (entry) {
+		if (IS_DEBUG_LFA)
+			zlog_debug("ISIS-LFA: reusing TI-LFAs for %s",
+				   lfa_protected_resource2str(resource));
+		tilfa_cache_replay(spftree, entry);
+		return;
+	}
+
+	listnode_add(spftree->lfa.tilfa.pending,
+		     tilfa_cache_entry_new(resource));
+}
+
 static void isis_spf_run_tilfa(struct isis_area *area,
 			       struct isis_circuit *circuit,
 			       struct isis_spftree *spftree,
 			       struct isis_spftree *spftree_reverse,
 			       struct lfa_protected_resource *resource)
 {
-	struct isis_spftree *spftree_pc_link;
-	struct isis_spftree *spftree_pc_node;
-
 	/* Compute node protecting repair paths first (if necessary). */
 	if (circuit->tilfa_node_protection[spftree->level - 1]) {
 		resource->type = LFA_NODE_PROTECTION;
-		spftree_pc_node = isis_tilfa_compute(area, spftree,
-						     spftree_reverse, resource);
-		isis_spftree_del(spftree_pc_node);
+		isis_spf_run_tilfa_resource(area, spftree, spftree_reverse,
+					    resource);
 
 		/* don't do link protection unless link-fallback is configured
 		 */
@@ -2275,9 +2759,7 @@ static void isis_spf_run_tilfa(struct isis_area *area,
 
 	/* Compute link protecting repair paths. */
 	resource->type = LFA_LINK_PROTECTION;
-	spftree_pc_link =
-		isis_tilfa_compute(area, spftree, spftree_reverse, resource);
-	isis_spftree_del(spftree_pc_link);
+	isis_spf_run_tilfa_resource(area, spftree, spftree_reverse, resource);
 }
 
 /**
@@ -2293,13 +2775,22 @@ void isis_spf_run_lfa(struct isis_area *area, struct isis_spftree *spftree)
 	struct listnode *node;
 	int level = spftree->level;
 
-	/* Run reverse SPF locally. */
-	if (area->rlfa_protected_links[level - 1] > 0
-	    || area->tilfa_protected_links[level - 1] > 0)
-		spftree_reverse = isis_spf_reverse_run(spftree);
+	/*
+	 * TI-LFA alone only needs these for the resources it can't take from
+	 * the cache, and isis_tilfa_run_cb() runs them if so.
+	 */
+	if (area->lfa_protected_links[level - 1] > 0) {
+		/* Run reverse SPF locally. */
+		if (area->rlfa_protected_links[level - 1] > 0
+		    || area->tilfa_protected_links[level - 1] > 0)
+			spftree_reverse = isis_spf_reverse_run(spftree);
+
+		/* Run forward SPF on all adjacent routers. */
+		isis_spf_run_neighbors(spftree);
+	}
 
-	/* Run forward SPF on all adjacent routers. */
-	isis_spf_run_neighbors(spftree);
+	if (area->tilfa_protected_links[level - 1] > 0)
+		tilfa_cache_start(spftree);
 
 	/* Check which interfaces are protected. */
 	for (ALL_LIST_ELEMENTS_RO(area->circuit_list, node, circuit)) {
@@ -2361,12 +2852,24 @@ void isis_spf_run_lfa(struct isis_area *area, struct isis_spftree *spftree)
 			}
 		} else if (circuit->tilfa_protection[level - 1]) {
 			/* Run TI-LFA. */
-			assert(spftree_reverse);
 			isis_spf_run_tilfa(area, circuit, spftree,
 					   spftree_reverse, &resource);
 		}
 	}
 
+	/* Compute the TI-LFAs not found in the cache after route install. */
+	if (spftree->lfa.tilfa.pending
+	    && !list_isempty(spftree->lfa.tilfa.pending)) {
+		if (IS_DEBUG_LFA)
+			zlog_debug("ISIS-LFA: %u TI-LFA resource(s) to compute",
+				   listcount(spftree->lfa.tilfa.pending));
+		spftree->lfa.tilfa.spftree_reverse = spftree_reverse;
+		listnode_add(area->tilfa_pending, spftree);
+		event_add_event(master, isis_tilfa_run_cb, area, 0,
+				&area->t_tilfa_update);
+		return;
+	}
+
 	if (spftree_reverse)
 		isis_spftree_del(spftree_reverse);
 }
@@ -117,6 +117,8 @@ struct lfa_protected_resource {
 
 /* Forward declaration(s). */
 struct isis_vertex;
+struct isis_route_info;
+struct tilfa_cache_entry;
 
 /* Prototypes. */
 void isis_spf_node_list_init(struct isis_spf_nodes *nodes);
@@ -168,5 +170,13 @@ struct isis_spftree *
 isis_tilfa_compute(struct isis_area *area, struct isis_spftree *spftree,
 		   struct isis_spftree *spftree_reverse,
 		   struct lfa_protected_resource *protected_resource);
+void isis_tilfa_cache_route(struct isis_spftree *spftree_pc,
+			    struct isis_vertex *vertex,
+			    struct isis_route_info *rinfo);
+void isis_tilfa_cache_adj_sid(struct isis_spftree *spftree_pc,
+			      struct isis_vertex *vertex,
+			      struct isis_adjacency *adj);
+void isis_tilfa_cancel(struct isis_area *area, int level);
+void isis_tilfa_cache_clear(struct isis_spftree *spftree);
 
 #endif /* _FRR_ISIS_LFA_H */
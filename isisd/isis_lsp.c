@@ -95,6 +95,7 @@ static void lsp_clear_data(struct isis_lsp *lsp)
 	if (!lsp)
 		return;
 
+	isis_spf_lsp_views_free(lsp);
 	isis_free_tlvs(lsp->tlvs);
 	lsp->tlvs = NULL;
 }
@@ -17,6 +17,7 @@
 PREDECL_RBTREE_UNIQ(lspdb);
 
 struct isis;
+struct isis_spf_lsp_view;
 /* Structure for isis_lsp, this structure will only support the fixed
  * System ID (Currently 6) (atleast for now). In order to support more
  * We will have to split the header into two parts, and for readability
@@ -40,6 +41,8 @@ struct isis_lsp {
 	int age_out;
 	struct isis_area *area;
 	struct isis_tlvs *tlvs;
+	/* tlvs pre-parsed for SPF, per topology */
+	struct isis_spf_lsp_view *spf_views;
 
 	time_t flooding_time;
 	struct list *flooding_neighbors[TX_LSP_CIRCUIT_SCOPED + 1];
@@ -29,6 +29,7 @@
 #include "routemap.h"
 #include "affinitymap.h"
 #include "libagentx.h"
+#include "taskpool.h"
 
 #include "isisd/isis_affinitymap.h"
 #include "isisd/isis_constants.h"
@@ -81,8 +82,10 @@ struct zebra_privs_t isisd_privs = {
 	.cap_num_i = 0};
 
 /* isisd options */
+#define OPTION_SPF_THREADS 2000
 static const struct option longopts[] = {
 	{"int_num", required_argument, NULL, 'I'},
+	{"spf-threads", required_argument, NULL, OPTION_SPF_THREADS},
 	{0}};
 
 /* Master of threads. */
@@ -269,6 +272,7 @@ int main(int argc, char **argv, char **envp)
 {
 	int opt;
 	int instance = 1;
+	int spf_threads = 0;
 
 #ifdef FABRICD
 	frr_preinit(&fabricd_di, argc, argv);
@@ -277,7 +281,8 @@ int main(int argc, char **argv, char **envp)
 #endif
 	frr_opt_add(
 		"I:", longopts,
-		"  -I, --int_num      Set instance number (label-manager)\n");
+		"  -I, --int_num      Set instance number (label-manager)\n"
+		"      --spf-threads  Number of pthreads for SPF runs\n");
 
 	/* Command line argument treatment. */
 	while (1) {
@@ -295,6 +300,11 @@ int main(int argc, char **argv, char **envp)
 				zlog_err("Instance %i out of range (1..%u)",
 					 instance, (unsigned short)-1);
 			break;
+		case OPTION_SPF_THREADS:
+			spf_threads = atoi(optarg);
+			if (spf_threads < 0)
+				frr_help_exit(1);
+			break;
 		default:
 			frr_help_exit(1);
 		}
@@ -351,6 +361,11 @@ int main(int argc, char **argv, char **envp)
 	fabricd_init();
 
 	frr_config_fork();
+
+	/* pthreads do not survive daemonizing, see frr_config_fork() */
+	if (spf_threads)
+		im->spf_pool = taskpool_new("isis_spf", spf_threads);
+
 	frr_run(master);
 
 	/* Not reached. */
@@ -31,8 +31,13 @@
 #include "isisd/isis_adjacency.h"
 #include "isisd/isis_dynhn.h"
 
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
 /* staticly assigned vars for printing purposes */
-static char sys_hostname[ISO_SYSID_STRLEN];
+/* per pthread, SPF runs print from the pool's too */
+static thread_local char sys_hostname[ISO_SYSID_STRLEN];
 struct in_addr new_prefix;
 /* len of xxYxxMxWxdxxhxxmxxs + place for #0 termination */
 char datestring[20];
@@ -123,6 +123,24 @@ const struct frr_yang_module_info frr_isisd_info = {
 				.modify = isis_instance_lsp_mtu_modify,
 			},
 		},
+		{
+			.xpath = "/frr-isisd:isis/instance/lsp/tx-pacing",
+			.cbs = {
+				.cli_show = cli_show_isis_lsp_tx_pacing,
+			},
+		},
+		{
+			.xpath = "/frr-isisd:isis/instance/lsp/tx-pacing/burst",
+			.cbs = {
+				.modify = isis_instance_lsp_tx_pacing_burst_modify,
+			},
+		},
+		{
+			.xpath = "/frr-isisd:isis/instance/lsp/tx-pacing/interval",
+			.cbs = {
+				.modify = isis_instance_lsp_tx_pacing_interval_modify,
+			},
+		},
 		{
 			.xpath = "/frr-isisd:isis/instance/advertise-passive-only",
 			.cbs = {
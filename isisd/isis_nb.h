@@ -32,6 +32,9 @@ int isis_instance_purge_originator_modify(struct nb_cb_modify_args *args);
 int isis_instance_admin_group_send_zero_modify(struct nb_cb_modify_args *args);
 int isis_instance_asla_legacy_flag_modify(struct nb_cb_modify_args *args);
 int isis_instance_lsp_mtu_modify(struct nb_cb_modify_args *args);
+int isis_instance_lsp_tx_pacing_burst_modify(struct nb_cb_modify_args *args);
+int isis_instance_lsp_tx_pacing_interval_modify(
+	struct nb_cb_modify_args *args);
 int isis_instance_advertise_passive_only_modify(struct nb_cb_modify_args *args);
 int isis_instance_lsp_refresh_interval_level_1_modify(
 	struct nb_cb_modify_args *args);
@@ -578,6 +581,8 @@ void cli_show_isis_lsp_timers(struct vty *vty, const struct lyd_node *dnode,
 			      bool show_defaults);
 void cli_show_isis_lsp_mtu(struct vty *vty, const struct lyd_node *dnode,
 			   bool show_defaults);
+void cli_show_isis_lsp_tx_pacing(struct vty *vty, const struct lyd_node *dnode,
+				 bool show_defaults);
 void cli_show_advertise_passive_only(struct vty *vty,
 				     const struct lyd_node *dnode,
 				     bool show_defaults);
@@ -514,6 +514,38 @@ int isis_instance_lsp_mtu_modify(struct nb_cb_modify_args *args)
 	return NB_OK;
 }
 
+/*
+ * XPath: /frr-isisd:isis/instance/lsp/tx-pacing/burst
+ */
+int isis_instance_lsp_tx_pacing_burst_modify(struct nb_cb_modify_args *args)
+{
+	struct isis_area *area;
+
+	if (args->event != NB_EV_APPLY)
+		return NB_OK;
+
+	area = nb_running_get_entry(args->dnode, NULL, true);
+	area->lsp_tx_burst = yang_dnode_get_uint16(args->dnode, NULL);
+
+	return NB_OK;
+}
+
+/*
+ * XPath: /frr-isisd:isis/instance/lsp/tx-pacing/interval
+ */
+int isis_instance_lsp_tx_pacing_interval_modify(struct nb_cb_modify_args *args)
+{
+	struct isis_area *area;
+
+	if (args->event != NB_EV_APPLY)
+		return NB_OK;
+
+	area = nb_running_get_entry(args->dnode, NULL, true);
+	area->lsp_tx_interval = yang_dnode_get_uint16(args->dnode, NULL);
+
+	return NB_OK;
+}
+
 /*
  * XPath: /frr-isisd:isis/instance/advertise-passive-only
  */
@@ -20,5 +20,10 @@ int isis_recv_pdu_bcast(struct isis_circuit *circuit, uint8_t *ssnpa);
 int isis_recv_pdu_p2p(struct isis_circuit *circuit, uint8_t *ssnpa);
 int isis_send_pdu_bcast(struct isis_circuit *circuit, int level);
 int isis_send_pdu_p2p(struct isis_circuit *circuit, int level);
+int isis_send_pdus_bcast(struct isis_circuit *circuit,
+			 struct isis_tx_pdu *pdus, unsigned int count,
+			 unsigned int *sent);
+int isis_send_pdus_p2p(struct isis_circuit *circuit, struct isis_tx_pdu *pdus,
+		       unsigned int count, unsigned int *sent);
 
 #endif /* _ZEBRA_ISIS_NETWORK_H */
@@ -938,7 +938,7 @@ static int process_lsp(uint8_t pdu_type, struct isis_circuit *circuit,
 	/* Checksum sanity check - FIXME: move to correct place */
 	/* 12 = sysid+pdu+remtime */
 	if (iso_csum_verify(STREAM_DATA(circuit->rcv_stream) + 12,
-			    hdr.pdu_len - 12, hdr.checksum, 12)) {
+			    hdr.pdu_len - 12, hdr.checksum)) {
 		zlog_debug(
 			"ISIS-Upd (%s): LSP %pLS invalid LSP checksum 0x%04hx",
 			circuit->area->area_tag, hdr.lsp_id, hdr.checksum);
@@ -2566,6 +2566,12 @@ void send_lsp(struct isis_circuit *circuit, struct isis_lsp *lsp,
 
 	clear_srm = 0;
 	pdu_counter_count(circuit->area->pdu_tx_counters, pdu_type);
+	/* Sent with the rest of the TX queue's burst, which then also
+	 * takes care of the SRM flag. */
+	if (isis_tx_queue_batch_add(circuit->tx_queue, circuit->snd_stream,
+				    lsp))
+		return;
+
 	retval = circuit->tx(circuit, lsp->level);
 	if (retval != ISIS_OK) {
 		flog_err(EC_ISIS_PACKET,
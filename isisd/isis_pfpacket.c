@@ -20,6 +20,7 @@
 #include "if.h"
 #include "lib_errors.h"
 #include "vrf.h"
+#include "frrsendmmsg.h"
 
 #include "isisd/isis_constants.h"
 #include "isisd/isis_common.h"
@@ -29,6 +30,7 @@
 #include "isisd/isis_constants.h"
 #include "isisd/isis_circuit.h"
 #include "isisd/isis_network.h"
+#include "isisd/isis_tx_queue.h"
 
 #include "privs.h"
 
@@ -201,9 +203,11 @@ int isis_sock_init(struct isis_circuit *circuit)
 	/* Assign Rx and Tx callbacks are based on real if type */
 		if (if_is_broadcast(circuit->interface)) {
 			circuit->tx = isis_send_pdu_bcast;
+			circuit->tx_batch = isis_send_pdus_bcast;
 			circuit->rx = isis_recv_pdu_bcast;
 		} else if (if_is_pointopoint(circuit->interface)) {
 			circuit->tx = isis_send_pdu_p2p;
+			circuit->tx_batch = isis_send_pdus_p2p;
 			circuit->rx = isis_recv_pdu_p2p;
 		} else {
 			zlog_warn("%s: unknown circuit type", __func__);
@@ -337,11 +341,54 @@ int isis_recv_pdu_p2p(struct isis_circuit *circuit, uint8_t *ssnpa)
 	return ISIS_OK;
 }
 
+static const uint8_t llc_header[LLC_LEN] = { 0xFE, 0xFE, 0x03 };
+
+static void isis_sockaddr_bcast(struct isis_circuit *circuit, int level,
+				size_t frame_size, struct sockaddr_ll *sa)
+{
+	memset(sa, 0, sizeof(*sa));
+	sa->sll_family = AF_PACKET;
+	sa->sll_protocol = htons(isis_ethertype(frame_size));
+	sa->sll_ifindex = circuit->interface->ifindex;
+	sa->sll_halen = ETH_ALEN;
+	/* RFC5309 section 4.1 recommends ALL_ISS */
+	if (circuit->circ_type == CIRCUIT_T_P2P)
+		memcpy(&sa->sll_addr, ALL_ISS, ETH_ALEN);
+	else if (level == 1)
+		memcpy(&sa->sll_addr, ALL_L1_ISS, ETH_ALEN);
+	else
+		memcpy(&sa->sll_addr, ALL_L2_ISS, ETH_ALEN);
+}
+
+static void isis_sockaddr_p2p(struct isis_circuit *circuit, int level,
+			      struct sockaddr_ll *sa)
+{
+	memset(sa, 0, sizeof(*sa));
+	sa->sll_family = AF_PACKET;
+	sa->sll_ifindex = circuit->interface->ifindex;
+	sa->sll_halen = ETH_ALEN;
+	if (level == 1)
+		memcpy(&sa->sll_addr, ALL_L1_ISS, ETH_ALEN);
+	else
+		memcpy(&sa->sll_addr, ALL_L2_ISS, ETH_ALEN);
+
+	/* lets try correcting the protocol */
+	sa->sll_protocol = htons(0x00FE);
+}
+
+static int isis_send_error(struct isis_circuit *circuit)
+{
+	zlog_warn("IS-IS pfpacket: could not transmit packet on %s: %s",
+		  circuit->interface->name, safe_strerror(errno));
+	if (ERRNO_IO_RETRY(errno))
+		return ISIS_WARNING;
+	return ISIS_ERROR;
+}
+
 int isis_send_pdu_bcast(struct isis_circuit *circuit, int level)
 {
 	struct msghdr msg;
 	struct iovec iov[2];
-	char temp_buff[LLC_LEN];
 
 	/* we need to do the LLC in here because of P2P circuits, which will
 	 * not need it
@@ -349,44 +396,24 @@ int isis_send_pdu_bcast(struct isis_circuit *circuit, int level)
 	struct sockaddr_ll sa;
 
 	stream_set_getp(circuit->snd_stream, 0);
-	memset(&sa, 0, sizeof(sa));
-	sa.sll_family = AF_PACKET;
-
-	size_t frame_size = stream_get_endp(circuit->snd_stream) + LLC_LEN;
-	sa.sll_protocol = htons(isis_ethertype(frame_size));
-	sa.sll_ifindex = circuit->interface->ifindex;
-	sa.sll_halen = ETH_ALEN;
-	/* RFC5309 section 4.1 recommends ALL_ISS */
-	if (circuit->circ_type == CIRCUIT_T_P2P)
-		memcpy(&sa.sll_addr, ALL_ISS, ETH_ALEN);
-	else if (level == 1)
-		memcpy(&sa.sll_addr, ALL_L1_ISS, ETH_ALEN);
-	else
-		memcpy(&sa.sll_addr, ALL_L2_ISS, ETH_ALEN);
+	isis_sockaddr_bcast(circuit, level,
+			    stream_get_endp(circuit->snd_stream) + LLC_LEN,
+			    &sa);
 
 	/* on a broadcast circuit */
 	/* first we put the LLC in */
-	temp_buff[0] = 0xFE;
-	temp_buff[1] = 0xFE;
-	temp_buff[2] = 0x03;
-
 	memset(&msg, 0, sizeof(msg));
 	msg.msg_name = &sa;
 	msg.msg_namelen = sizeof(struct sockaddr_ll);
 	msg.msg_iov = iov;
 	msg.msg_iovlen = 2;
-	iov[0].iov_base = temp_buff;
+	iov[0].iov_base = (void *)llc_header;
 	iov[0].iov_len = LLC_LEN;
 	iov[1].iov_base = circuit->snd_stream->data;
 	iov[1].iov_len = stream_get_endp(circuit->snd_stream);
 
-	if (sendmsg(circuit->fd, &msg, 0) < 0) {
-		zlog_warn("IS-IS pfpacket: could not transmit packet on %s: %s",
-			  circuit->interface->name, safe_strerror(errno));
-		if (ERRNO_IO_RETRY(errno))
-			return ISIS_WARNING;
-		return ISIS_ERROR;
-	}
+	if (sendmsg(circuit->fd, &msg, 0) < 0)
+		return isis_send_error(circuit);
 	return ISIS_OK;
 }
 
@@ -396,29 +423,84 @@ int isis_send_pdu_p2p(struct isis_circuit *circuit, int level)
 	ssize_t rv;
 
 	stream_set_getp(circuit->snd_stream, 0);
-	memset(&sa, 0, sizeof(sa));
-	sa.sll_family = AF_PACKET;
-	sa.sll_ifindex = circuit->interface->ifindex;
-	sa.sll_halen = ETH_ALEN;
-	if (level == 1)
-		memcpy(&sa.sll_addr, ALL_L1_ISS, ETH_ALEN);
-	else
-		memcpy(&sa.sll_addr, ALL_L2_ISS, ETH_ALEN);
-
+	isis_sockaddr_p2p(circuit, level, &sa);
 
-	/* lets try correcting the protocol */
-	sa.sll_protocol = htons(0x00FE);
 	rv = sendto(circuit->fd, circuit->snd_stream->data,
 		    stream_get_endp(circuit->snd_stream), 0,
 		    (struct sockaddr *)&sa, sizeof(struct sockaddr_ll));
-	if (rv < 0) {
-		zlog_warn("IS-IS pfpacket: could not transmit packet on %s: %s",
-			  circuit->interface->name, safe_strerror(errno));
-		if (ERRNO_IO_RETRY(errno))
-			return ISIS_WARNING;
-		return ISIS_ERROR;
+	if (rv < 0)
+		return isis_send_error(circuit);
+	return ISIS_OK;
+}
+
+/*
+ * The LSP TX queue's bursts, in as few sendmmsg() calls as possible.  On
+ * error, *sent tells how many PDUs made it out before the failing one.
+ */
+#define ISIS_TX_MMSG 32
+
+static int isis_send_pdus(struct isis_circuit *circuit,
+			  struct isis_tx_pdu *pdus, unsigned int count,
+			  unsigned int *sent, bool bcast)
+{
+	struct mmsghdr mmh[ISIS_TX_MMSG];
+	struct iovec iov[ISIS_TX_MMSG][2];
+	struct sockaddr_ll sa[ISIS_TX_MMSG];
+	unsigned int i, n, pos = 0;
+	int rv;
+
+	while (pos < count) {
+		n = MIN(count - pos, ISIS_TX_MMSG);
+		memset(mmh, 0, n * sizeof(mmh[0]));
+
+		for (i = 0; i < n; i++) {
+			struct stream *s = pdus[pos + i].s;
+			struct msghdr *msg = &mmh[i].msg_hdr;
+
+			msg->msg_name = &sa[i];
+			msg->msg_namelen = sizeof(struct sockaddr_ll);
+			msg->msg_iov = iov[i];
+			if (bcast) {
+				isis_sockaddr_bcast(circuit, pdus[pos + i].level,
+						    stream_get_endp(s) + LLC_LEN,
+						    &sa[i]);
+				iov[i][0].iov_base = (void *)llc_header;
+				iov[i][0].iov_len = LLC_LEN;
+				iov[i][1].iov_base = s->data;
+				iov[i][1].iov_len = stream_get_endp(s);
+				msg->msg_iovlen = 2;
+			} else {
+				isis_sockaddr_p2p(circuit, pdus[pos + i].level,
+						  &sa[i]);
+				iov[i][0].iov_base = s->data;
+				iov[i][0].iov_len = stream_get_endp(s);
+				msg->msg_iovlen = 1;
+			}
+		}
+
+		rv = sendmmsg(circuit->fd, mmh, n, 0);
+		if (rv <= 0) {
+			*sent = pos;
+			return isis_send_error(circuit);
+		}
+		pos += rv;
 	}
+
+	*sent = pos;
 	return ISIS_OK;
 }
 
+int isis_send_pdus_bcast(struct isis_circuit *circuit,
+			 struct isis_tx_pdu *pdus, unsigned int count,
+			 unsigned int *sent)
+{
+	return isis_send_pdus(circuit, pdus, count, sent, true);
+}
+
+int isis_send_pdus_p2p(struct isis_circuit *circuit, struct isis_tx_pdu *pdus,
+		       unsigned int count, unsigned int *sent)
+{
+	return isis_send_pdus(circuit, pdus, count, sent, false);
+}
+
 #endif /* ISIS_METHOD == ISIS_METHOD_PFPACKET */
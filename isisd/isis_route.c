@@ -104,7 +104,7 @@ void isis_nexthop_delete(struct isis_nexthop *nexthop)
 	XFREE(MTYPE_ISIS_NEXTHOP, nexthop);
 }
 
-static struct list *isis_nexthop_list_dup(const struct list *orig)
+struct list *isis_nexthop_list_dup(const struct list *orig)
 {
 	struct list *copy;
 	struct listnode *node;
@@ -440,21 +440,44 @@ static int isis_route_info_same(struct isis_route_info *new,
 	return 1;
 }
 
-struct isis_route_info *
-isis_route_create(struct prefix *prefix, struct prefix_ipv6 *src_p,
-		  uint32_t cost, uint32_t depth, struct isis_sr_psid_info *sr,
-		  struct list *adjacencies, bool allow_ecmp,
-		  struct isis_area *area, struct route_table *table)
+/*
+ * Copy a route built by isis_route_create(), nexthops and label stacks
+ * included.  Used to keep TI-LFA backup routes across SPF runs.
+ */
+struct isis_route_info *isis_route_info_dup(const struct isis_route_info *orig)
+{
+	struct isis_route_info *rinfo;
+
+	rinfo = XCALLOC(MTYPE_ISIS_ROUTE_INFO, sizeof(struct isis_route_info));
+	rinfo->cost = orig->cost;
+	rinfo->depth = orig->depth;
+	rinfo->nexthops = isis_nexthop_list_dup(orig->nexthops);
+	for (int i = 0; i < SR_ALGORITHM_COUNT; i++) {
+		if (orig->sr_algo[i].nexthops != orig->nexthops)
+			continue;
+
+		rinfo->sr_algo[i] = orig->sr_algo[i];
+		rinfo->sr_algo[i].nexthops = rinfo->nexthops;
+		rinfo->sr_algo[i].nexthops_backup = NULL;
+	}
+
+	return rinfo;
+}
+
+void isis_route_info_free(struct isis_route_info *rinfo)
+{
+	isis_route_info_delete(rinfo);
+}
+
+static struct isis_route_info *
+isis_route_add(struct prefix *prefix, struct prefix_ipv6 *src_p,
+	       struct isis_route_info *rinfo_new, struct isis_area *area,
+	       struct route_table *table)
 {
 	struct route_node *route_node;
-	struct isis_route_info *rinfo_new, *rinfo_old, *route_info = NULL;
+	struct isis_route_info *rinfo_old, *route_info = NULL;
 	char change_buf[64];
 
-	if (!table)
-		return NULL;
-
-	rinfo_new = isis_route_info_new(prefix, src_p, cost, depth, sr,
-					adjacencies, allow_ecmp);
 	route_node = srcdest_rnode_get(table, prefix, src_p);
 
 	rinfo_old = route_node->info;
@@ -502,6 +525,34 @@ isis_route_create(struct prefix *prefix, struct prefix_ipv6 *src_p,
 	return route_info;
 }
 
+struct isis_route_info *
+isis_route_create(struct prefix *prefix, struct prefix_ipv6 *src_p,
+		  uint32_t cost, uint32_t depth, struct isis_sr_psid_info *sr,
+		  struct list *adjacencies, bool allow_ecmp,
+		  struct isis_area *area, struct route_table *table)
+{
+	struct isis_route_info *rinfo_new;
+
+	if (!table)
+		return NULL;
+
+	rinfo_new = isis_route_info_new(prefix, src_p, cost, depth, sr,
+					adjacencies, allow_ecmp);
+
+	return isis_route_add(prefix, src_p, rinfo_new, area, table);
+}
+
+/* Install a copy of a route previously saved with isis_route_info_dup(). */
+struct isis_route_info *isis_route_restore(struct prefix *prefix,
+					   struct prefix_ipv6 *src_p,
+					   const struct isis_route_info *saved,
+					   struct isis_area *area,
+					   struct route_table *table)
+{
+	return isis_route_add(prefix, src_p, isis_route_info_dup(saved), area,
+			      table);
+}
+
 void isis_route_delete(struct isis_area *area, struct route_node *rode,
 		       struct route_table *table)
 {
@@ -46,6 +46,7 @@ DECLARE_HOOK(isis_route_update_hook,
 	     (area, prefix, route_info));
 
 void isis_nexthop_delete(struct isis_nexthop *nexthop);
+struct list *isis_nexthop_list_dup(const struct list *orig);
 void adjinfo2nexthop(int family, struct list *nexthops,
 		     struct isis_adjacency *adj, struct isis_sr_psid_info *sr,
 		     struct mpls_label_stack *label_stack);
@@ -56,6 +57,13 @@ isis_route_create(struct prefix *prefix, struct prefix_ipv6 *src_p,
 		  struct isis_area *area, struct route_table *table);
 void isis_route_delete(struct isis_area *area, struct route_node *rode,
 		       struct route_table *table);
+struct isis_route_info *isis_route_info_dup(const struct isis_route_info *orig);
+void isis_route_info_free(struct isis_route_info *rinfo);
+struct isis_route_info *isis_route_restore(struct prefix *prefix,
+					   struct prefix_ipv6 *src_p,
+					   const struct isis_route_info *saved,
+					   struct isis_area *area,
+					   struct route_table *table);
 
 /* Walk the given table and install new routes to zebra and remove old ones.
  * route status is tracked using ISIS_ROUTE_FLAG_ACTIVE */
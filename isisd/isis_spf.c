@@ -23,6 +23,7 @@
 #include "if.h"
 #include "hash.h"
 #include "table.h"
+#include "taskpool.h"
 #include "spf_backoff.h"
 #include "srcdest_table.h"
 #include "vrf.h"
@@ -54,6 +55,7 @@ DEFINE_MTYPE_STATIC(ISISD, ISIS_SPF_RUN,    "ISIS SPF Run Info");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_SPF_ADJ,    "ISIS SPF Adjacency");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_VERTEX,     "ISIS vertex");
 DEFINE_MTYPE_STATIC(ISISD, ISIS_VERTEX_ADJ, "ISIS SPF Vertex Adjacency");
+DEFINE_MTYPE_STATIC(ISISD, ISIS_SPF_LSP_VIEW, "ISIS SPF LSP view");
 
 static void spf_adj_list_parse_lsp(struct isis_spftree *spftree,
 				   struct list *adj_list, struct isis_lsp *lsp,
@@ -381,6 +383,7 @@ static void _isis_spftree_del(struct isis_spftree *spftree)
 	void *info, *backup_info;
 
 	hash_clean_and_free(&spftree->prefix_sids, NULL);
+	isis_tilfa_cache_clear(spftree);
 	isis_zebra_rlfa_unregister_all(spftree);
 	isis_rlfa_list_clear(spftree);
 	list_delete(&spftree->lfa.remote.pc_spftrees);
@@ -827,6 +830,271 @@ static void process_N(struct isis_spftree *spftree, enum vertextype vtype,
 	return;
 }
 
+/*
+ * SPF reads the reachability TLVs of every LSP it settles, on every run,
+ * though most LSPs don't change from one run to the next.  What it needs
+ * from them is instead parsed once per LSP and topology into flat arrays,
+ * which stay with the LSP until its TLVs go away (lsp_clear_data()) or its
+ * sequence number changes.
+ *
+ * Views are built when SPF first needs them, which has to be on the main
+ * pthread: when the trees of a level are calculated in parallel, they are
+ * built for the whole LSDB before the trees are submitted, so the pool's
+ * pthreads only ever find them.
+ */
+struct isis_spf_lsp_reach {
+	uint8_t id[ISIS_SYS_ID_LEN + 1];
+	uint32_t metric;
+	/* NULL for old-style neighbors */
+	struct isis_extended_reach *er;
+};
+
+struct isis_spf_lsp_prefix {
+	union {
+		struct prefix_ipv4 p4;
+		struct prefix_ipv6 p6;
+	} prefix;
+	uint32_t metric;
+	enum vertextype vtype;
+	/* SRv6 locators only: also in an IPv6 Reachability TLV */
+	bool in_ipv6_reach;
+	struct isis_subtlvs *subtlvs;
+};
+
+struct isis_spf_lsp_view {
+	struct isis_spf_lsp_view *next;
+	uint16_t mtid;
+	uint32_t seqno;
+
+	/* old-style entries first, in both */
+	struct isis_spf_lsp_reach *reach;
+	unsigned int reach_count, reach_old;
+	struct isis_spf_lsp_prefix *ip4;
+	unsigned int ip4_count, ip4_old;
+
+	struct isis_spf_lsp_prefix *ip6;
+	unsigned int ip6_count;
+	struct isis_spf_lsp_prefix *loc;
+	unsigned int loc_count;
+};
+
+static inline struct isis_item *items_head(struct isis_item_list *items)
+{
+	return items ? items->head : NULL;
+}
+
+static inline unsigned int items_count(struct isis_item_list *items)
+{
+	return items ? items->count : 0;
+}
+
+static struct isis_spf_lsp_view *spf_lsp_view_build(struct isis_lsp *lsp,
+						    uint16_t mtid)
+{
+	bool pseudo_lsp = LSP_PSEUDO_ID(lsp->hdr.lsp_id);
+	struct isis_tlvs *tlvs = lsp->tlvs;
+	struct isis_item_list *te_neighs, *ipv4_reachs = NULL;
+	struct isis_item_list *ipv6_reachs = NULL, *srv6_locators = NULL;
+	struct isis_item_list *oldstyle_ip[2] = {};
+	struct isis_spf_lsp_view *view;
+	struct isis_item *i;
+	unsigned int reach_old = 0, ip4_old = 0, n;
+	size_t size;
+
+	if (pseudo_lsp || mtid == ISIS_MT_IPV4_UNICAST) {
+		reach_old = tlvs->oldstyle_reach.count;
+		te_neighs = &tlvs->extended_reach;
+	} else
+		te_neighs = isis_lookup_mt_items(&tlvs->mt_reach, mtid);
+
+	if (!pseudo_lsp) {
+		if (mtid == ISIS_MT_IPV4_UNICAST) {
+			oldstyle_ip[0] = &tlvs->oldstyle_ip_reach;
+			oldstyle_ip[1] = &tlvs->oldstyle_ip_reach_ext;
+			ip4_old = oldstyle_ip[0]->count + oldstyle_ip[1]->count;
+			ipv4_reachs = &tlvs->extended_ip_reach;
+			ipv6_reachs = &tlvs->ipv6_reach;
+		} else {
+			ipv4_reachs = isis_lookup_mt_items(&tlvs->mt_ip_reach,
+							   mtid);
+			ipv6_reachs = isis_lookup_mt_items(&tlvs->mt_ipv6_reach,
+							   mtid);
+		}
+		srv6_locators = isis_lookup_mt_items(&tlvs->srv6_locator, mtid);
+	}
+
+	/* One allocation, the arrays follow the view. */
+	size = sizeof(*view);
+	size += (reach_old + items_count(te_neighs)) *
+		sizeof(struct isis_spf_lsp_reach);
+	size += (ip4_old + items_count(ipv4_reachs) +
+		 items_count(ipv6_reachs) + items_count(srv6_locators)) *
+		sizeof(struct isis_spf_lsp_prefix);
+	view = XCALLOC(MTYPE_ISIS_SPF_LSP_VIEW, size);
+	view->mtid = mtid;
+	view->seqno = lsp->hdr.seqno;
+
+	view->reach = (struct isis_spf_lsp_reach *)(view + 1);
+	n = 0;
+	if (reach_old)
+		for (i = tlvs->oldstyle_reach.head; i; i = i->next) {
+			struct isis_oldstyle_reach *r =
+				(struct isis_oldstyle_reach *)i;
+
+			memcpy(view->reach[n].id, r->id, sizeof(r->id));
+			view->reach[n++].metric = r->metric;
+		}
+	view->reach_old = n;
+	for (i = items_head(te_neighs); i; i = i->next) {
+		struct isis_extended_reach *er =
+			(struct isis_extended_reach *)i;
+
+		memcpy(view->reach[n].id, er->id, sizeof(er->id));
+		view->reach[n].metric = er->metric;
+		view->reach[n++].er = er;
+	}
+	view->reach_count = n;
+
+	view->ip4 = (struct isis_spf_lsp_prefix *)(view->reach + n);
+	n = 0;
+	for (unsigned int j = 0; j < array_size(oldstyle_ip); j++) {
+		for (i = items_head(oldstyle_ip[j]); i; i = i->next) {
+			struct isis_oldstyle_ip_reach *r =
+				(struct isis_oldstyle_ip_reach *)i;
+
+			view->ip4[n].prefix.p4 = r->prefix;
+			view->ip4[n].metric = r->metric;
+			view->ip4[n++].vtype = j ? VTYPE_IPREACH_EXTERNAL
+						 : VTYPE_IPREACH_INTERNAL;
+		}
+	}
+	view->ip4_old = n;
+	for (i = items_head(ipv4_reachs); i; i = i->next) {
+		struct isis_extended_ip_reach *r =
+			(struct isis_extended_ip_reach *)i;
+
+		view->ip4[n].prefix.p4 = r->prefix;
+		view->ip4[n].metric = r->metric;
+		view->ip4[n].vtype = VTYPE_IPREACH_TE;
+		view->ip4[n++].subtlvs = r->subtlvs;
+	}
+	view->ip4_count = n;
+
+	view->ip6 = view->ip4 + n;
+	n = 0;
+	for (i = items_head(ipv6_reachs); i; i = i->next) {
+		struct isis_ipv6_reach *r = (struct isis_ipv6_reach *)i;
+
+		view->ip6[n].prefix.p6 = r->prefix;
+		view->ip6[n].metric = r->metric;
+		view->ip6[n].vtype = r->external ? VTYPE_IP6REACH_EXTERNAL
+						 : VTYPE_IP6REACH_INTERNAL;
+		view->ip6[n++].subtlvs = r->subtlvs;
+	}
+	view->ip6_count = n;
+
+	view->loc = view->ip6 + n;
+	n = 0;
+	for (i = items_head(srv6_locators); i; i = i->next) {
+		struct isis_srv6_locator_tlv *loc =
+			(struct isis_srv6_locator_tlv *)i;
+
+		if (loc->algorithm != SR_ALGORITHM_SPF)
+			continue;
+
+		view->loc[n].prefix.p6 = loc->prefix;
+		view->loc[n].metric = loc->metric;
+		view->loc[n].vtype = VTYPE_IP6REACH_INTERNAL;
+		/*
+		 * An SRv6 Locator can be received in both a Prefix
+		 * Reachability TLV and an SRv6 Locator TLV (as per RFC 9352
+		 * section #5).
+		 */
+		for (unsigned int j = 0; j < view->ip6_count; j++)
+			if (prefix_same((struct prefix *)&view->ip6[j].prefix,
+					(struct prefix *)&loc->prefix))
+				view->loc[n].in_ipv6_reach = true;
+		n++;
+	}
+	view->loc_count = n;
+
+	return view;
+}
+
+static struct isis_spf_lsp_view *spf_lsp_view(struct isis_lsp *lsp,
+					      uint16_t mtid)
+{
+	struct isis_spf_lsp_view **viewp, *view;
+
+	for (viewp = &lsp->spf_views; (view = *viewp); viewp = &view->next) {
+		if (view->mtid != mtid)
+			continue;
+		if (view->seqno == lsp->hdr.seqno)
+			return view;
+
+		*viewp = view->next;
+		XFREE(MTYPE_ISIS_SPF_LSP_VIEW, view);
+		break;
+	}
+
+	view = spf_lsp_view_build(lsp, mtid);
+	view->next = lsp->spf_views;
+	lsp->spf_views = view;
+
+	return view;
+}
+
+static void spf_lsp_views_prepare(struct lspdb_head *lspdb, uint16_t mtid)
+{
+	struct isis_lsp *lsp;
+
+	frr_each (lspdb, lspdb, lsp)
+		if (lsp->tlvs && lsp->hdr.seqno)
+			spf_lsp_view(lsp, mtid);
+}
+
+void isis_spf_lsp_views_free(struct isis_lsp *lsp)
+{
+	struct isis_spf_lsp_view *view;
+
+	while ((view = lsp->spf_views)) {
+		lsp->spf_views = view->next;
+		XFREE(MTYPE_ISIS_SPF_LSP_VIEW, view);
+	}
+}
+
+/*
+ * The Prefix-SID to use for a prefix, if any.  Only the first one for the
+ * tree's algorithm is used, since we only support the SPF algorithm for
+ * now.
+ */
+static struct isis_prefix_sid *
+spf_prefix_sid_find(struct isis_spftree *spftree, struct isis_lsp *lsp,
+		    struct isis_subtlvs *subtlvs)
+{
+	if (!subtlvs)
+		return NULL;
+
+	for (struct isis_item *i = subtlvs->prefix_sids.head; i; i = i->next) {
+		struct isis_prefix_sid *psid = (struct isis_prefix_sid *)i;
+
+		if (psid->algorithm != spftree->algorithm)
+			continue;
+
+#ifndef FABRICD
+		if (flex_algo_id_valid(spftree->algorithm) &&
+		    (!sr_algorithm_participated(lsp, spftree->algorithm) ||
+		     !isis_flex_algo_elected_supported(spftree->algorithm,
+						       spftree->area)))
+			continue;
+#endif /* ifndef FABRICD */
+
+		return psid;
+	}
+
+	return NULL;
+}
+
 /*
  * C.2.6 Step 1
  */
@@ -842,7 +1110,11 @@ static int isis_spf_process_lsp(struct isis_spftree *spftree,
 	static const uint8_t null_sysid[ISIS_SYS_ID_LEN];
 	struct isis_mt_router_info *mt_router_info = NULL;
 	struct prefix_pair ip_info;
-	bool has_valid_psid;
+	struct isis_spf_lsp_view *view;
+	struct isis_spf_lsp_reach *reach;
+	struct isis_spf_lsp_prefix *pr;
+	struct isis_prefix_sid *psid;
+	unsigned int n;
 	bool loc_is_in_ipv6_reach = false;
 
 	if (isis_lfa_excise_node_check(spftree, lsp->hdr.lsp_id)) {
@@ -888,57 +1160,46 @@ lspfragloop:
 			   print_sys_hostname(lsp->hdr.lsp_id));
 #endif /* EXTREME_DEBUG */
 
+	view = spf_lsp_view(lsp, spftree->mtid);
+
 	if (no_overload) {
 		if ((pseudo_lsp || spftree->mtid == ISIS_MT_IPV4_UNICAST)
-		    && spftree->area->oldmetric) {
-			struct isis_oldstyle_reach *r;
-			for (r = (struct isis_oldstyle_reach *)
-					 lsp->tlvs->oldstyle_reach.head;
-			     r; r = r->next) {
-				if (fabricd)
-					continue;
+		    && spftree->area->oldmetric && !fabricd) {
+			for (n = 0; n < view->reach_old; n++) {
+				reach = &view->reach[n];
 
 				/* C.2.6 a) */
 				/* Two way connectivity */
-				if (!LSP_PSEUDO_ID(r->id)
-				    && !memcmp(r->id, root_sysid,
+				if (!LSP_PSEUDO_ID(reach->id)
+				    && !memcmp(reach->id, root_sysid,
 					       ISIS_SYS_ID_LEN))
 					continue;
 				if (!pseudo_lsp
-				    && !memcmp(r->id, null_sysid,
+				    && !memcmp(reach->id, null_sysid,
 					       ISIS_SYS_ID_LEN))
 					continue;
-				dist = cost + r->metric;
+				dist = cost + reach->metric;
 				process_N(spftree,
-					  LSP_PSEUDO_ID(r->id)
+					  LSP_PSEUDO_ID(reach->id)
 						  ? VTYPE_PSEUDO_IS
 						  : VTYPE_NONPSEUDO_IS,
-					  (void *)r->id, dist, depth + 1, NULL,
-					  parent);
+					  (void *)reach->id, dist, depth + 1,
+					  NULL, parent);
 			}
 		}
 
 		if (spftree->area->newmetric) {
-			struct isis_item_list *te_neighs = NULL;
-			if (pseudo_lsp || spftree->mtid == ISIS_MT_IPV4_UNICAST)
-				te_neighs = &lsp->tlvs->extended_reach;
-			else
-				te_neighs = isis_lookup_mt_items(
-					&lsp->tlvs->mt_reach, spftree->mtid);
-
-			struct isis_extended_reach *er;
-			for (er = te_neighs ? (struct isis_extended_reach *)
-						      te_neighs->head
-					    : NULL;
-			     er; er = er->next) {
+			for (n = view->reach_old; n < view->reach_count; n++) {
+				reach = &view->reach[n];
+
 				/* C.2.6 a) */
 				/* Two way connectivity */
-				if (!LSP_PSEUDO_ID(er->id)
-				    && !memcmp(er->id, root_sysid,
+				if (!LSP_PSEUDO_ID(reach->id)
+				    && !memcmp(reach->id, root_sysid,
 					       ISIS_SYS_ID_LEN))
 					continue;
 				if (!pseudo_lsp
-				    && !memcmp(er->id, null_sysid,
+				    && !memcmp(reach->id, null_sysid,
 					       ISIS_SYS_ID_LEN))
 					continue;
 #ifndef FABRICD
@@ -946,8 +1207,8 @@ lspfragloop:
 				if (flex_algo_id_valid(spftree->algorithm) &&
 				    (!sr_algorithm_participated(
 					     lsp, spftree->algorithm) ||
-				     isis_flex_algo_constraint_drop(spftree,
-								    lsp, er)))
+				     isis_flex_algo_constraint_drop(
+					     spftree, lsp, reach->er)))
 					continue;
 #endif /* ifndef FABRICD */
 
@@ -955,13 +1216,13 @@ lspfragloop:
 				       + (CHECK_FLAG(spftree->flags,
 						     F_SPFTREE_HOPCOUNT_METRIC)
 						  ? 1
-						  : er->metric);
+						  : reach->metric);
 				process_N(spftree,
-					  LSP_PSEUDO_ID(er->id)
+					  LSP_PSEUDO_ID(reach->id)
 						  ? VTYPE_PSEUDO_TE_IS
 						  : VTYPE_NONPSEUDO_TE_IS,
-					  (void *)er->id, dist, depth + 1, NULL,
-					  parent);
+					  (void *)reach->id, dist, depth + 1,
+					  NULL, parent);
 			}
 		}
 	}
@@ -969,27 +1230,16 @@ lspfragloop:
 	if (!fabricd && !pseudo_lsp && spftree->family == AF_INET
 	    && spftree->mtid == ISIS_MT_IPV4_UNICAST
 	    && spftree->area->oldmetric) {
-		struct isis_item_list *reachs[] = {
-			&lsp->tlvs->oldstyle_ip_reach,
-			&lsp->tlvs->oldstyle_ip_reach_ext};
-
-		for (unsigned int i = 0; i < array_size(reachs); i++) {
-			vtype = i ? VTYPE_IPREACH_EXTERNAL
-				  : VTYPE_IPREACH_INTERNAL;
-
-			memset(&ip_info, 0, sizeof(ip_info));
-			ip_info.dest.family = AF_INET;
+		memset(&ip_info, 0, sizeof(ip_info));
+		ip_info.dest.family = AF_INET;
 
-			struct isis_oldstyle_ip_reach *r;
-			for (r = (struct isis_oldstyle_ip_reach *)reachs[i]
-					 ->head;
-			     r; r = r->next) {
-				dist = cost + r->metric;
-				ip_info.dest.u.prefix4 = r->prefix.prefix;
-				ip_info.dest.prefixlen = r->prefix.prefixlen;
-				process_N(spftree, vtype, &ip_info,
-					  dist, depth + 1, NULL, parent);
-			}
+		for (n = 0; n < view->ip4_old; n++) {
+			pr = &view->ip4[n];
+			dist = cost + pr->metric;
+			ip_info.dest.u.prefix4 = pr->prefix.p4.prefix;
+			ip_info.dest.prefixlen = pr->prefix.p4.prefixlen;
+			process_N(spftree, pr->vtype, &ip_info, dist,
+				  depth + 1, NULL, parent);
 		}
 	}
 
@@ -998,189 +1248,79 @@ lspfragloop:
 		goto end;
 
 	if (!pseudo_lsp && spftree->family == AF_INET) {
-		struct isis_item_list *ipv4_reachs;
-		if (spftree->mtid == ISIS_MT_IPV4_UNICAST)
-			ipv4_reachs = &lsp->tlvs->extended_ip_reach;
-		else
-			ipv4_reachs = isis_lookup_mt_items(
-				&lsp->tlvs->mt_ip_reach, spftree->mtid);
-
 		memset(&ip_info, 0, sizeof(ip_info));
 		ip_info.dest.family = AF_INET;
 
-		struct isis_extended_ip_reach *r;
-		for (r = ipv4_reachs
-				 ? (struct isis_extended_ip_reach *)
-					   ipv4_reachs->head
-				 : NULL;
-		     r; r = r->next) {
-			dist = cost + r->metric;
-			ip_info.dest.u.prefix4 = r->prefix.prefix;
-			ip_info.dest.prefixlen = r->prefix.prefixlen;
+		for (n = view->ip4_old; n < view->ip4_count; n++) {
+			pr = &view->ip4[n];
+			dist = cost + pr->metric;
+			ip_info.dest.u.prefix4 = pr->prefix.p4.prefix;
+			ip_info.dest.prefixlen = pr->prefix.p4.prefixlen;
 
 			/* Parse list of Prefix-SID subTLVs if SR is enabled */
-			has_valid_psid = false;
-			if (spftree->area->srdb.enabled && r->subtlvs) {
-				for (struct isis_item *i =
-					     r->subtlvs->prefix_sids.head;
-				     i; i = i->next) {
-					struct isis_prefix_sid *psid =
-						(struct isis_prefix_sid *)i;
-
-					if (psid->algorithm !=
-					    spftree->algorithm)
-						continue;
-
-#ifndef FABRICD
-					if (flex_algo_id_valid(
-						    spftree->algorithm) &&
-					    (!sr_algorithm_participated(
-						     lsp, spftree->algorithm) ||
-					     !isis_flex_algo_elected_supported(
-						     spftree->algorithm,
-						     spftree->area)))
-						continue;
-#endif /* ifndef FABRICD */
-
-					has_valid_psid = true;
-					process_N(spftree, VTYPE_IPREACH_TE,
-						  &ip_info, dist, depth + 1,
-						  psid, parent);
-					/*
-					 * Stop the Prefix-SID iteration since
-					 * we only support the SPF algorithm for
-					 * now.
-					 */
-					break;
-				}
-			}
-			if (!has_valid_psid)
-				process_N(spftree, VTYPE_IPREACH_TE, &ip_info,
-					  dist, depth + 1, NULL, parent);
+			if (spftree->area->srdb.enabled)
+				psid = spf_prefix_sid_find(spftree, lsp,
+							   pr->subtlvs);
+			else
+				psid = NULL;
+			process_N(spftree, VTYPE_IPREACH_TE, &ip_info, dist,
+				  depth + 1, psid, parent);
 		}
 	}
 
 	if (!pseudo_lsp && spftree->family == AF_INET6) {
-		struct isis_item_list *ipv6_reachs;
-		if (spftree->mtid == ISIS_MT_IPV4_UNICAST)
-			ipv6_reachs = &lsp->tlvs->ipv6_reach;
-		else
-			ipv6_reachs = isis_lookup_mt_items(
-				&lsp->tlvs->mt_ipv6_reach, spftree->mtid);
-
-		struct isis_ipv6_reach *r;
-		for (r = ipv6_reachs
-				 ? (struct isis_ipv6_reach *)ipv6_reachs->head
-				 : NULL;
-		     r; r = r->next) {
-			dist = cost + r->metric;
-			vtype = r->external ? VTYPE_IP6REACH_EXTERNAL
-					    : VTYPE_IP6REACH_INTERNAL;
+		for (n = 0; n < view->ip6_count; n++) {
+			pr = &view->ip6[n];
+			dist = cost + pr->metric;
 			memset(&ip_info, 0, sizeof(ip_info));
 			ip_info.dest.family = AF_INET6;
-			ip_info.dest.u.prefix6 = r->prefix.prefix;
-			ip_info.dest.prefixlen = r->prefix.prefixlen;
+			ip_info.dest.u.prefix6 = pr->prefix.p6.prefix;
+			ip_info.dest.prefixlen = pr->prefix.p6.prefixlen;
 
-			if (spftree->area->srdb.enabled && r->subtlvs &&
-			    r->subtlvs->source_prefix &&
-			    r->subtlvs->source_prefix->prefixlen) {
+			if (spftree->area->srdb.enabled && pr->subtlvs &&
+			    pr->subtlvs->source_prefix &&
+			    pr->subtlvs->source_prefix->prefixlen) {
 				if (spftree->tree_id != SPFTREE_DSTSRC) {
 					char buff[VID2STR_BUFFER];
 					zlog_warn("Ignoring dest-src route %s in non dest-src topology",
 						srcdest2str(
 							&ip_info.dest,
-							r->subtlvs->source_prefix,
+							pr->subtlvs->source_prefix,
 							buff, sizeof(buff)
 						)
 					);
 					continue;
 				}
-				ip_info.src = *r->subtlvs->source_prefix;
+				ip_info.src = *pr->subtlvs->source_prefix;
 			}
 
 			/* Parse list of Prefix-SID subTLVs */
-			has_valid_psid = false;
-			if (r->subtlvs) {
-				for (struct isis_item *i =
-					     r->subtlvs->prefix_sids.head;
-				     i; i = i->next) {
-					struct isis_prefix_sid *psid =
-						(struct isis_prefix_sid *)i;
-
-					if (psid->algorithm !=
-					    spftree->algorithm)
-						continue;
-
-#ifndef FABRICD
-					if (flex_algo_id_valid(
-						    spftree->algorithm) &&
-					    (!sr_algorithm_participated(
-						     lsp, spftree->algorithm) ||
-					     !isis_flex_algo_elected_supported(
-						     spftree->algorithm,
-						     spftree->area)))
-						continue;
-#endif /* ifndef FABRICD */
-
-					has_valid_psid = true;
-					process_N(spftree, vtype, &ip_info,
-						  dist, depth + 1, psid,
-						  parent);
-					/*
-					 * Stop the Prefix-SID iteration since
-					 * we only support the SPF algorithm for
-					 * now.
-					 */
-					break;
-				}
-			}
-			if (!has_valid_psid)
-				process_N(spftree, vtype, &ip_info, dist,
-					  depth + 1, NULL, parent);
+			psid = spf_prefix_sid_find(spftree, lsp,
+						   pr->subtlvs);
+			process_N(spftree, pr->vtype, &ip_info, dist,
+				  depth + 1, psid, parent);
 		}
 
 		/* Process SRv6 Locator TLVs */
-
-		struct isis_item_list *srv6_locators = isis_lookup_mt_items(
-			&lsp->tlvs->srv6_locator, spftree->mtid);
-
-		struct isis_srv6_locator_tlv *loc;
-		for (loc = srv6_locators ? (struct isis_srv6_locator_tlv *)
-						   srv6_locators->head
-					 : NULL;
-		     loc; loc = loc->next) {
-
-			if (loc->algorithm != SR_ALGORITHM_SPF)
-				continue;
-
-			dist = cost + loc->metric;
-			vtype = VTYPE_IP6REACH_INTERNAL;
+		for (n = 0; n < view->loc_count; n++) {
+			pr = &view->loc[n];
+			dist = cost + pr->metric;
 			memset(&ip_info, 0, sizeof(ip_info));
 			ip_info.dest.family = AF_INET6;
-			ip_info.dest.u.prefix6 = loc->prefix.prefix;
-			ip_info.dest.prefixlen = loc->prefix.prefixlen;
-
-			/* An SRv6 Locator can be received in both a Prefix
-			Reachability TLV and an SRv6 Locator TLV (as per RFC
-			9352 section #5). We go through the Prefix Reachability
-			TLVs and check if the SRv6 Locator is present in some of
-			them. If we find the SRv6 Locator in some Prefix
+			ip_info.dest.u.prefix6 = pr->prefix.p6.prefix;
+			ip_info.dest.prefixlen = pr->prefix.p6.prefixlen;
+
+			/* If we find the SRv6 Locator in some Prefix
 			Reachbility TLV then it means that we have already
 			processed it before and we can skip it. */
-			for (r = ipv6_reachs ? (struct isis_ipv6_reach *)
-						       ipv6_reachs->head
-					     : NULL;
-			     r; r = r->next) {
-				if (prefix_same((struct prefix *)&r->prefix,
-						(struct prefix *)&loc->prefix))
-					loc_is_in_ipv6_reach = true;
-			}
+			if (pr->in_ipv6_reach)
+				loc_is_in_ipv6_reach = true;
 
 			/* SRv6 locator not present in Prefix Reachability TLV,
 			 * let's process it */
 			if (!loc_is_in_ipv6_reach)
-				process_N(spftree, vtype, &ip_info, dist,
-					  depth + 1, NULL, parent);
+				process_N(spftree, pr->vtype, &ip_info,
+					  dist, depth + 1, NULL, parent);
 		}
 	}
 
@@ -1519,54 +1659,43 @@ static void spf_adj_list_parse_lsp(struct isis_spftree *spftree,
 	bool pseudo_lsp = LSP_PSEUDO_ID(lsp->hdr.lsp_id);
 	struct isis_lsp *frag;
 	struct listnode *node;
-	struct isis_item *head;
-	struct isis_item_list *te_neighs;
+	struct isis_spf_lsp_view *view;
+	struct isis_spf_lsp_reach *reach;
+	unsigned int n;
 
 	if (lsp->hdr.seqno == 0 || lsp->hdr.rem_lifetime == 0)
 		return;
 
 	/* Parse LSP. */
 	if (lsp->tlvs) {
-		if (pseudo_lsp || spftree->mtid == ISIS_MT_IPV4_UNICAST) {
-			head = lsp->tlvs->oldstyle_reach.head;
-			for (struct isis_oldstyle_reach *reach =
-				     (struct isis_oldstyle_reach *)head;
-			     reach; reach = reach->next) {
-				spf_adj_list_parse_tlv(
-					spftree, adj_list, reach->id,
-					pseudo_nodeid, pseudo_metric,
-					reach->metric, true, NULL);
+		view = spf_lsp_view(lsp, spftree->mtid);
+		for (n = 0; n < view->reach_count; n++) {
+			reach = &view->reach[n];
+			if (!reach->er) {
+				spf_adj_list_parse_tlv(spftree, adj_list,
+						       reach->id, pseudo_nodeid,
+						       pseudo_metric,
+						       reach->metric, true,
+						       NULL);
+				continue;
 			}
-		}
-
-		if (pseudo_lsp || spftree->mtid == ISIS_MT_IPV4_UNICAST)
-			te_neighs = &lsp->tlvs->extended_reach;
-		else
-			te_neighs = isis_get_mt_items(&lsp->tlvs->mt_reach,
-						      spftree->mtid);
-		if (te_neighs) {
-			head = te_neighs->head;
-			for (struct isis_extended_reach *reach =
-				     (struct isis_extended_reach *)head;
-			     reach; reach = reach->next) {
 #ifndef FABRICD
-				/*
-				 * cutting out adjacency by flex-algo link
-				 * affinity attribute
-				 */
-				if (flex_algo_id_valid(spftree->algorithm) &&
-				    (!sr_algorithm_participated(
-					     lsp, spftree->algorithm) ||
-				     isis_flex_algo_constraint_drop(
-					     spftree, lsp, reach)))
-					continue;
+			/*
+			 * cutting out adjacency by flex-algo link
+			 * affinity attribute
+			 */
+			if (flex_algo_id_valid(spftree->algorithm) &&
+			    (!sr_algorithm_participated(lsp,
+							spftree->algorithm) ||
+			     isis_flex_algo_constraint_drop(spftree, lsp,
+							    reach->er)))
+				continue;
 #endif /* ifndef FABRICD */
 
-				spf_adj_list_parse_tlv(
-					spftree, adj_list, reach->id,
-					pseudo_nodeid, pseudo_metric,
-					reach->metric, false, reach->subtlvs);
-			}
+			spf_adj_list_parse_tlv(spftree, adj_list, reach->id,
+					       pseudo_nodeid, pseudo_metric,
+					       reach->metric, false,
+					       reach->er->subtlvs);
 		}
 	}
 
@@ -1694,9 +1823,11 @@ static void spf_path_process(struct isis_spftree *spftree,
 				return;
 
 			adj = isis_adj_find(area, level, vertex->N.id);
-			if (adj)
+			if (adj) {
 				sr_adj_sid_add_single(adj, spftree->family,
 						      true, vertex->Adj_N);
+				isis_tilfa_cache_adj_sid(spftree, vertex, adj);
+			}
 		} else if (IS_DEBUG_SPF_EVENTS)
 			zlog_debug(
 				"ISIS-SPF: no adjacencies, do not install backup Adj-SID for %s depth %d dist %d",
@@ -1769,15 +1900,15 @@ static void spf_path_process(struct isis_spftree *spftree,
 				break;
 			}
 
-#ifdef EXTREME_DEBUG
-			struct isis_route_info *ri =
-#endif /* EXTREME_DEBUG */
-				isis_route_create(&vertex->N.ip.p.dest,
-						  &vertex->N.ip.p.src,
-						  vertex->d_N, vertex->depth,
-						  &vertex->N.ip.sr,
-						  vertex->Adj_N, allow_ecmp,
-						  area, route_table);
+			struct isis_route_info *ri;
+
+			ri = isis_route_create(&vertex->N.ip.p.dest,
+					       &vertex->N.ip.p.src, vertex->d_N,
+					       vertex->depth, &vertex->N.ip.sr,
+					       vertex->Adj_N, allow_ecmp, area,
+					       route_table);
+			if (spftree->type == SPF_TYPE_TI_LFA)
+				isis_tilfa_cache_route(spftree, vertex, ri);
 
 #ifdef EXTREME_DEBUG
 			zlog_debug(
@@ -1888,12 +2019,27 @@ struct isis_spftree *isis_run_hopcount_spf(struct isis_area *area,
 	return spftree;
 }
 
-void isis_run_spf(struct isis_spftree *spftree)
-{
+/*
+ * isis_run_spf() in three parts, so that the trees of a level can be
+ * calculated in parallel, see isis_run_spf_trees().  Only the middle part,
+ * Dijkstra itself, runs on the pool's pthreads: it reads the LSDB and the
+ * adjacencies and writes nothing but the tree and its routing table.  The
+ * other two schedule LSP regeneration, talk to zebra and keep statistics,
+ * so they stay on the main pthread.
+ */
+struct isis_spf_job {
+	struct isis_spftree *spftree;
 	struct isis_lsp *root_lsp;
-	struct isis_vertex *root_vertex;
 	struct timeval time_start;
-	struct timeval time_end;
+	struct taskpool_future *future;
+	bool begun;
+};
+
+/* Returns false if there is nothing to calculate from. */
+static bool isis_run_spf_begin(struct isis_spf_job *job)
+{
+	struct isis_spftree *spftree = job->spftree;
+	struct isis_lsp *root_lsp;
 	struct isis_mt_router_info *mt_router_info;
 	uint16_t mtid = 0;
 #ifndef FABRICD
@@ -1901,13 +2047,13 @@ void isis_run_spf(struct isis_spftree *spftree)
 #endif /* ifndef FABRICD */
 
 	/* Get time that can't roll backwards. */
-	monotime(&time_start);
+	monotime(&job->time_start);
 
 	root_lsp = isis_root_system_lsp(spftree->lspdb, spftree->sysid);
 	if (root_lsp == NULL) {
 		zlog_err("ISIS-SPF: could not find own l%d LSP!",
 			 spftree->level);
-		return;
+		return false;
 	}
 
 	/* Get Multi-Topology ID. */
@@ -1950,7 +2096,7 @@ void isis_run_spf(struct isis_spftree *spftree)
 			/* actual state is inconsistent with local LSP */
 			lsp_regenerate_schedule(spftree->area,
 						spftree->area->is_type, 0);
-			goto out;
+			return true;
 		}
 		if (!flex_algo_enabled) {
 			if (!CHECK_FLAG(spftree->flags, F_SPFTREE_DISABLED)) {
@@ -1960,7 +2106,7 @@ void isis_run_spf(struct isis_spftree *spftree)
 							spftree->area->is_type,
 							0);
 			}
-			goto out;
+			return true;
 		}
 	}
 #endif /* ifndef FABRICD */
@@ -1969,11 +2115,26 @@ void isis_run_spf(struct isis_spftree *spftree)
 	 * C.2.5 Step 0
 	 */
 	init_spt(spftree, mtid);
+	job->root_lsp = root_lsp;
+
+	return true;
+}
+
+static void isis_run_spf_work(void *arg)
+{
+	struct isis_spf_job *job = arg;
+	struct isis_spftree *spftree = job->spftree;
+	struct isis_vertex *root_vertex;
+
+	if (!job->root_lsp)
+		return;
+
 	/*              a) */
 	root_vertex = isis_spf_add_root(spftree);
 	/*              b) */
-	isis_spf_build_adj_list(spftree, root_lsp);
-	isis_spf_preload_tent(spftree, spftree->sysid, root_lsp, root_vertex);
+	isis_spf_build_adj_list(spftree, job->root_lsp);
+	isis_spf_preload_tent(spftree, spftree->sysid, job->root_lsp,
+			      root_vertex);
 
 	/*
 	 * C.2.7 Step 2
@@ -1985,39 +2146,116 @@ void isis_run_spf(struct isis_spftree *spftree)
 	}
 
 	isis_spf_loop(spftree, spftree->sysid);
+}
 
+static void isis_run_spf_end(struct isis_spf_job *job)
+{
+	struct isis_spftree *spftree = job->spftree;
+	struct timeval time_end;
 
 #ifndef FABRICD
 	/* flex-algo */
-	if (CHECK_FLAG(spftree->flags, F_SPFTREE_DISABLED)) {
+	if (job->root_lsp && CHECK_FLAG(spftree->flags, F_SPFTREE_DISABLED)) {
 		UNSET_FLAG(spftree->flags, F_SPFTREE_DISABLED);
 		lsp_regenerate_schedule(spftree->area, spftree->area->is_type,
 					0);
 	}
-
-out:
 #endif /* ifndef FABRICD */
+
 	spftree->runcount++;
 	spftree->last_run_timestamp = time(NULL);
 	spftree->last_run_monotime = monotime(&time_end);
 	spftree->last_run_duration =
-		((time_end.tv_sec - time_start.tv_sec) * 1000000)
-		+ (time_end.tv_usec - time_start.tv_usec);
+		((time_end.tv_sec - job->time_start.tv_sec) * 1000000)
+		+ (time_end.tv_usec - job->time_start.tv_usec);
 }
 
-static void isis_run_spf_with_protection(struct isis_area *area,
-					 struct isis_spftree *spftree)
+void isis_run_spf(struct isis_spftree *spftree)
 {
-	/* Run forward SPF locally. */
-	memcpy(spftree->sysid, area->isis->sysid, ISIS_SYS_ID_LEN);
-	isis_run_spf(spftree);
+	struct isis_spf_job job = { .spftree = spftree };
 
+	if (!isis_run_spf_begin(&job))
+		return;
+
+	isis_run_spf_work(&job);
+	isis_run_spf_end(&job);
+}
+
+static void isis_run_spf_protection(struct isis_area *area,
+				    struct isis_spftree *spftree)
+{
 	/* Run LFA protection if configured. */
 	if (area->lfa_protected_links[spftree->level - 1] > 0
 	    || area->tilfa_protected_links[spftree->level - 1] > 0)
 		isis_spf_run_lfa(area, spftree);
 }
 
+/*
+ * Run forward SPF locally for the trees, then LFA protection for each.
+ * With a pool configured for them (--spf-threads), the forward trees are
+ * calculated in parallel; the main pthread waits for them, so the LSDB and
+ * adjacencies stay as they are meanwhile.  Protection calculates more trees
+ * from each forward tree's results and stays on the main pthread, in the
+ * same order as without a pool.
+ */
+void isis_run_spf_trees(struct isis_area *area, struct isis_spftree **trees,
+			unsigned int count)
+{
+	struct isis_spf_job *jobs;
+	unsigned int i;
+
+	if (!im->spf_pool || count < 2) {
+		for (i = 0; i < count; i++) {
+			memcpy(trees[i]->sysid, area->isis->sysid,
+			       ISIS_SYS_ID_LEN);
+			isis_run_spf(trees[i]);
+			isis_run_spf_protection(area, trees[i]);
+		}
+		return;
+	}
+
+	jobs = XCALLOC(MTYPE_TMP, count * sizeof(*jobs));
+
+	for (i = 0; i < count; i++) {
+		memcpy(trees[i]->sysid, area->isis->sysid, ISIS_SYS_ID_LEN);
+		jobs[i].spftree = trees[i];
+		jobs[i].begun = isis_run_spf_begin(&jobs[i]);
+	}
+
+	/* The pool's pthreads only find LSP views, never build them. */
+	for (i = 0; i < count; i++) {
+		unsigned int j;
+
+		if (!jobs[i].root_lsp)
+			continue;
+		for (j = 0; j < i; j++)
+			if (jobs[j].root_lsp &&
+			    jobs[j].spftree->lspdb == trees[i]->lspdb &&
+			    jobs[j].spftree->mtid == trees[i]->mtid)
+				break;
+		if (j == i)
+			spf_lsp_views_prepare(trees[i]->lspdb, trees[i]->mtid);
+	}
+
+	for (i = 0; i < count; i++)
+		if (jobs[i].root_lsp)
+			jobs[i].future = taskpool_submit(im->spf_pool,
+							 isis_run_spf_work,
+							 &jobs[i]);
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].future)
+			taskpool_future_wait(jobs[i].future);
+		if (jobs[i].begun)
+			isis_run_spf_end(&jobs[i]);
+	}
+
+	XFREE(MTYPE_TMP, jobs);
+
+	for (i = 0; i < count; i++)
+		isis_run_spf_protection(area, trees[i]);
+}
+
 void isis_spf_verify_routes(struct isis_area *area, struct isis_spftree **trees,
 			    int tree)
 {
@@ -2066,7 +2304,8 @@ static void isis_run_spf_cb(struct event *thread)
 	struct isis_spf_run *run = EVENT_ARG(thread);
 	struct isis_area *area = run->area;
 	int level = run->level;
-	int have_run = 0;
+	struct isis_spftree **trees;
+	unsigned int count = 0;
 	struct listnode *node;
 	struct isis_circuit *circuit;
 #ifndef FABRICD
@@ -2083,6 +2322,7 @@ static void isis_run_spf_cb(struct event *thread)
 		return;
 	}
 
+	isis_tilfa_cancel(area, level);
 	isis_area_delete_backup_adj_sids(area, level);
 	isis_area_invalidate_routes(area, level);
 
@@ -2090,39 +2330,40 @@ static void isis_run_spf_cb(struct event *thread)
 		zlog_debug("ISIS-SPF (%s) L%d SPF needed, periodic SPF",
 			   area->area_tag, level);
 
+	/* IPv4 and IPv6, each with their flex-algos, and dst-src */
+#ifndef FABRICD
+	count = listcount(area->flex_algos->flex_algos);
+#endif /* ifndef FABRICD */
+	trees = XCALLOC(MTYPE_TMP, (2 * (count + 1) + 1) * sizeof(*trees));
+	count = 0;
+
 	if (area->ip_circuits) {
-		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_IPV4][level - 1]);
+		trees[count++] = area->spftree[SPFTREE_IPV4][level - 1];
 #ifndef FABRICD
 		for (ALL_LIST_ELEMENTS_RO(area->flex_algos->flex_algos, node,
 					  fa)) {
 			data = fa->data;
-			isis_run_spf_with_protection(
-				area, data->spftree[SPFTREE_IPV4][level - 1]);
+			trees[count++] = data->spftree[SPFTREE_IPV4][level - 1];
 		}
 #endif /* ifndef FABRICD */
-		have_run = 1;
 	}
 	if (area->ipv6_circuits) {
-		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_IPV6][level - 1]);
+		trees[count++] = area->spftree[SPFTREE_IPV6][level - 1];
 #ifndef FABRICD
 		for (ALL_LIST_ELEMENTS_RO(area->flex_algos->flex_algos, node,
 					  fa)) {
 			data = fa->data;
-			isis_run_spf_with_protection(
-				area, data->spftree[SPFTREE_IPV6][level - 1]);
+			trees[count++] = data->spftree[SPFTREE_IPV6][level - 1];
 		}
 #endif /* ifndef FABRICD */
-		have_run = 1;
-	}
-	if (area->ipv6_circuits && isis_area_ipv6_dstsrc_enabled(area)) {
-		isis_run_spf_with_protection(
-			area, area->spftree[SPFTREE_DSTSRC][level - 1]);
-		have_run = 1;
 	}
+	if (area->ipv6_circuits && isis_area_ipv6_dstsrc_enabled(area))
+		trees[count++] = area->spftree[SPFTREE_DSTSRC][level - 1];
+
+	isis_run_spf_trees(area, trees, count);
+	XFREE(MTYPE_TMP, trees);
 
-	if (have_run)
+	if (count)
 		area->spf_run_count[level]++;
 
 	isis_area_verify_routes(area);
@@ -70,6 +70,9 @@ void isis_spf_print(struct isis_spftree *spftree, struct vty *vty);
 void isis_spf_print_json(struct isis_spftree *spftree,
 			 struct json_object *json);
 void isis_run_spf(struct isis_spftree *spftree);
+void isis_run_spf_trees(struct isis_area *area, struct isis_spftree **trees,
+			unsigned int count);
+void isis_spf_lsp_views_free(struct isis_lsp *lsp);
 struct isis_spftree *isis_run_hopcount_spf(struct isis_area *area,
 					   uint8_t *sysid,
 					   struct isis_spftree *spftree);
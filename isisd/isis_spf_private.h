@@ -348,6 +348,26 @@ struct isis_spftree {
 			uint32_t ecmp[SPF_PREFIX_PRIO_MAX];
 			uint32_t total[SPF_PREFIX_PRIO_MAX];
 		} protection_counters;
+
+		/* TI-LFA repair paths kept across runs (see isis_lfa.c). */
+		struct {
+			/* Per protected resource, in computation order. */
+			struct list *entries;
+
+			/* Next entry to replay (NULL after the first miss). */
+			struct listnode *next;
+
+			/* What the entries were computed from. */
+			uint64_t lsdb_digest;
+			uint32_t local_digest;
+
+			/* Protected resources left for isis_tilfa_run_cb(). */
+			struct list *pending;
+			struct isis_spftree *spftree_reverse;
+
+			/* Post-convergence SPT: the entry being filled in. */
+			struct tilfa_cache_entry *fill;
+		} tilfa;
 	} lfa;
 	uint8_t algorithm;
 	uint8_t flags;
@@ -674,15 +674,16 @@ static bool sr_adj_same_subnet_ipv6(struct in6_addr *ipv6,
 /* --- Segment Routing Adjacency-SID management functions ------------------- */
 
 /**
- * Add new local Adjacency-SID.
+ * Allocate and advertise a new local Adjacency-SID.
  *
  * @param adj	   IS-IS Adjacency
  * @param family   Inet Family (IPv4 or IPv6)
  * @param backup   True to initialize backup Adjacency SID
- * @param nexthops List of backup nexthops (for backup Adj-SIDs only)
+ *
+ * @return	   The new Adjacency-SID, not yet sent to zebra, or NULL
  */
-void sr_adj_sid_add_single(struct isis_adjacency *adj, int family, bool backup,
-			   struct list *nexthops)
+static struct sr_adjacency *sr_adj_sid_new(struct isis_adjacency *adj,
+					   int family, bool backup)
 {
 	struct isis_circuit *circuit = adj->circuit;
 	struct isis_area *area = circuit->area;
@@ -700,19 +701,19 @@ void sr_adj_sid_add_single(struct isis_adjacency *adj, int family, bool backup,
 	switch (family) {
 	case AF_INET:
 		if (!circuit->ip_router || !adj->ipv4_address_count)
-			return;
+			return NULL;
 
 		if (!sr_adj_same_subnet_ipv4(adj->ipv4_addresses[0], circuit))
-			return;
+			return NULL;
 
 		nexthop.ipv4 = adj->ipv4_addresses[0];
 		break;
 	case AF_INET6:
 		if (!circuit->ipv6_router || !adj->ll_ipv6_count)
-			return;
+			return NULL;
 
 		if (!sr_adj_same_subnet_ipv6(&adj->ll_ipv6_addrs[0], circuit))
-			return;
+			return NULL;
 
 		nexthop.ipv6 = adj->ll_ipv6_addrs[0];
 		break;
@@ -732,7 +733,7 @@ void sr_adj_sid_add_single(struct isis_adjacency *adj, int family, bool backup,
 	/* Get a label from the SRLB for this Adjacency */
 	input_label = sr_local_block_request_label(&area->srdb.srlb);
 	if (input_label == MPLS_INVALID_LABEL)
-		return;
+		return NULL;
 
 	if (circuit->ext == NULL)
 		circuit->ext = isis_alloc_ext_subtlvs();
@@ -743,21 +744,6 @@ void sr_adj_sid_add_single(struct isis_adjacency *adj, int family, bool backup,
 	sra->nexthop.family = family;
 	sra->nexthop.address = nexthop;
 
-	if (backup && nexthops) {
-		struct isis_vertex_adj *vadj;
-		struct listnode *node;
-
-		sra->backup_nexthops = list_new();
-		for (ALL_LIST_ELEMENTS_RO(nexthops, node, vadj)) {
-			struct isis_adjacency *adj = vadj->sadj->adj;
-			struct mpls_label_stack *label_stack;
-
-			label_stack = vadj->label_stack;
-			adjinfo2nexthop(family, sra->backup_nexthops, adj, NULL,
-					label_stack);
-		}
-	}
-
 	switch (circuit->circ_type) {
 	/* LAN Adjacency-SID for Broadcast interface section #2.2.2 */
 	case CIRCUIT_T_BROADCAST:
@@ -792,6 +778,62 @@ void sr_adj_sid_add_single(struct isis_adjacency *adj, int family, bool backup,
 	listnode_add(area->srdb.adj_sids, sra);
 	listnode_add(adj->adj_sids, sra);
 
+	return sra;
+}
+
+/**
+ * Add new local Adjacency-SID.
+ *
+ * @param adj	   IS-IS Adjacency
+ * @param family   Inet Family (IPv4 or IPv6)
+ * @param backup   True to initialize backup Adjacency SID
+ * @param nexthops List of backup nexthops (for backup Adj-SIDs only)
+ */
+void sr_adj_sid_add_single(struct isis_adjacency *adj, int family, bool backup,
+			   struct list *nexthops)
+{
+	struct sr_adjacency *sra;
+
+	sra = sr_adj_sid_new(adj, family, backup);
+	if (!sra)
+		return;
+
+	if (backup && nexthops) {
+		struct isis_vertex_adj *vadj;
+		struct listnode *node;
+
+		sra->backup_nexthops = list_new();
+		for (ALL_LIST_ELEMENTS_RO(nexthops, node, vadj)) {
+			struct isis_adjacency *adj = vadj->sadj->adj;
+			struct mpls_label_stack *label_stack;
+
+			label_stack = vadj->label_stack;
+			adjinfo2nexthop(family, sra->backup_nexthops, adj, NULL,
+					label_stack);
+		}
+	}
+
+	isis_zebra_send_adjacency_sid(ZEBRA_MPLS_LABELS_ADD, sra);
+}
+
+/**
+ * Add new local backup Adjacency-SID from a copy of its backup nexthops.
+ *
+ * @param adj	   IS-IS Adjacency
+ * @param family   Inet Family (IPv4 or IPv6)
+ * @param nexthops List of backup nexthops (struct isis_nexthop)
+ */
+void sr_adj_sid_add_backup(struct isis_adjacency *adj, int family,
+			   const struct list *nexthops)
+{
+	struct sr_adjacency *sra;
+
+	sra = sr_adj_sid_new(adj, family, true);
+	if (!sra)
+		return;
+
+	sra->backup_nexthops = isis_nexthop_list_dup(nexthops);
+
 	isis_zebra_send_adjacency_sid(ZEBRA_MPLS_LABELS_ADD, sra);
 }
 
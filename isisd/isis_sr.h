@@ -218,6 +218,8 @@ extern void isis_sr_prefix_cfg2subtlv(const struct sr_prefix_cfg *pcfg,
 				      struct isis_prefix_sid *psid);
 extern void sr_adj_sid_add_single(struct isis_adjacency *adj, int family,
 				  bool backup, struct list *nexthops);
+extern void sr_adj_sid_add_backup(struct isis_adjacency *adj, int family,
+				  const struct list *nexthops);
 extern struct sr_adjacency *isis_sr_adj_sid_find(struct isis_adjacency *adj,
 						 int family,
 						 enum sr_adj_type type);
@@ -10,6 +10,8 @@
 
 #include "hash.h"
 #include "jhash.h"
+#include "stream.h"
+#include "typesafe.h"
 
 #include "isisd/isisd.h"
 #include "isisd/isis_flags.h"
@@ -17,15 +19,45 @@
 #include "isisd/isis_lsp.h"
 #include "isisd/isis_misc.h"
 #include "isisd/isis_tx_queue.h"
+#include "isisd/isis_errors.h"
 
 DEFINE_MTYPE_STATIC(ISISD, TX_QUEUE, "ISIS TX Queue");
 DEFINE_MTYPE_STATIC(ISISD, TX_QUEUE_ENTRY, "ISIS TX Queue Entry");
 
+/*
+ * LSPs due for (re)transmission wait on the queue's due list, and are sent
+ * in bursts of up to lsp_tx_burst LSPs, lsp_tx_interval msec apart, by a
+ * single event per circuit.  Circuits that can send several PDUs with one
+ * syscall (circuit->tx_batch) get each burst's PDUs collected and sent at
+ * the end of the burst.
+ *
+ * The entries of a batched burst are then dealt with like send_lsp() does
+ * for a single PDU: on broadcast circuits, the ones that went out are
+ * removed.  After a temporary failure (e.g. a full socket buffer), the
+ * LSPs not sent go back to the head of the due list, and the next burst
+ * waits at least TX_QUEUE_BACKOFF_MSEC; after a permanent one, the LSP
+ * that failed is removed from the queue.
+ */
+#define TX_QUEUE_BACKOFF_MSEC 100
+
+PREDECL_DLIST(tx_queue_due);
+
 struct isis_tx_queue {
 	struct isis_circuit *circuit;
 	void (*send_event)(struct isis_circuit *circuit,
 			   struct isis_lsp *, enum isis_tx_type);
 	struct hash *hash;
+
+	struct tx_queue_due_head due;
+	struct event *send;
+
+	/* PDUs of the burst being sent, if batching */
+	bool batching;
+	struct isis_tx_pdu *batch;
+	unsigned int batch_count;
+	unsigned int batch_size;
+
+	struct isis_tx_queue_stats stats;
 };
 
 struct isis_tx_queue_entry {
@@ -34,8 +66,12 @@ struct isis_tx_queue_entry {
 	bool is_retry;
 	struct event *retry;
 	struct isis_tx_queue *queue;
+	struct tx_queue_due_item due_item;
+	bool due;
 };
 
+DECLARE_DLIST(tx_queue_due, struct isis_tx_queue_entry, due_item);
+
 static unsigned tx_queue_hash_key(const void *p)
 {
 	const struct isis_tx_queue_entry *e = p;
@@ -72,6 +108,7 @@ struct isis_tx_queue *isis_tx_queue_new(
 	rv->send_event = send_event;
 
 	rv->hash = hash_create(tx_queue_hash_key, tx_queue_hash_cmp, NULL);
+	tx_queue_due_init(&rv->due);
 	return rv;
 }
 
@@ -80,13 +117,23 @@ static void tx_queue_element_free(void *element)
 	struct isis_tx_queue_entry *e = element;
 
 	EVENT_OFF(e->retry);
+	if (e->due)
+		tx_queue_due_del(&e->queue->due, e);
 
 	XFREE(MTYPE_TX_QUEUE_ENTRY, e);
 }
 
 void isis_tx_queue_free(struct isis_tx_queue *queue)
 {
+	unsigned int i;
+
+	EVENT_OFF(queue->send);
 	hash_clean_and_free(&queue->hash, tx_queue_element_free);
+	tx_queue_due_fini(&queue->due);
+
+	for (i = 0; i < queue->batch_size; i++)
+		stream_free(queue->batch[i].s);
+	XFREE(MTYPE_TX_QUEUE, queue->batch);
 	XFREE(MTYPE_TX_QUEUE, queue);
 }
 
@@ -100,20 +147,166 @@ static struct isis_tx_queue_entry *tx_queue_find(struct isis_tx_queue *queue,
 	return hash_lookup(queue->hash, &e);
 }
 
-static void tx_queue_send_event(struct event *thread)
+static void tx_queue_send_event(struct event *thread);
+
+static void tx_queue_schedule(struct isis_tx_queue *queue, long msec)
+{
+	if (msec)
+		event_add_timer_msec(master, tx_queue_send_event, queue, msec,
+				     &queue->send);
+	else
+		event_add_event(master, tx_queue_send_event, queue, 0,
+				&queue->send);
+}
+
+static void tx_queue_make_due(struct isis_tx_queue_entry *e)
+{
+	if (!e->due) {
+		tx_queue_due_add_tail(&e->queue->due, e);
+		e->due = true;
+	}
+
+	/* no-op if a burst is already scheduled */
+	tx_queue_schedule(e->queue, 0);
+}
+
+static void tx_queue_retry_event(struct event *thread)
 {
 	struct isis_tx_queue_entry *e = EVENT_ARG(thread);
-	struct isis_tx_queue *queue = e->queue;
 
-	event_add_timer(master, tx_queue_send_event, e, 5, &e->retry);
+	tx_queue_make_due(e);
+}
 
-	if (e->is_retry)
-		queue->circuit->area->lsp_rxmt_count++;
-	else
-		e->is_retry = true;
+static void tx_queue_entry_del(struct isis_tx_queue *queue,
+			       struct isis_tx_queue_entry *e)
+{
+	hash_release(queue->hash, e);
+	tx_queue_element_free(e);
+}
+
+/* Send the burst's PDUs, return false if it has to be retried later. */
+static bool tx_queue_batch_flush(struct isis_tx_queue *queue)
+{
+	struct isis_circuit *circuit = queue->circuit;
+	struct isis_tx_queue_entry *e;
+	unsigned int i, sent = 0;
+	int rv;
+
+	if (!queue->batch_count)
+		return true;
+
+	rv = circuit->tx_batch(circuit, queue->batch, queue->batch_count,
+			       &sent);
+	if (rv != ISIS_OK) {
+		flog_err(EC_ISIS_PACKET,
+			 "ISIS-Upd (%s): Send of %u of %u LSPs on %s failed %s",
+			 circuit->area->area_tag, queue->batch_count - sent,
+			 queue->batch_count, circuit->interface->name,
+			 (rv == ISIS_WARNING) ? "temporarily" : "permanently");
+		queue->stats.batch_errors++;
+	}
+
+	/* Backwards, so that requeued LSPs keep their order */
+	for (i = queue->batch_count; i-- > 0;) {
+		e = tx_queue_find(queue, queue->batch[i].lsp);
+		if (!e)
+			continue;
+
+		if (i < sent) {
+			/* On P2P circuits, wait for the neighbor's ack */
+			if (circuit->circ_type == CIRCUIT_T_BROADCAST)
+				tx_queue_entry_del(queue, e);
+		} else if (i == sent && rv != ISIS_WARNING) {
+			tx_queue_entry_del(queue, e);
+		} else if (!e->due) {
+			EVENT_OFF(e->retry);
+			tx_queue_due_add_head(&queue->due, e);
+			e->due = true;
+		}
+	}
 
-	queue->send_event(queue->circuit, e->lsp, e->type);
-	/* Don't access e here anymore, send_event might have destroyed it */
+	queue->batch_count = 0;
+	return rv != ISIS_WARNING;
+}
+
+bool isis_tx_queue_batch_add(struct isis_tx_queue *queue, struct stream *pdu,
+			     struct isis_lsp *lsp)
+{
+	struct isis_tx_pdu *tx_pdu;
+
+	if (!queue || !queue->batching ||
+	    queue->batch_count == queue->batch_size)
+		return false;
+
+	tx_pdu = &queue->batch[queue->batch_count++];
+	if (tx_pdu->s && stream_get_size(tx_pdu->s) < stream_get_endp(pdu)) {
+		stream_free(tx_pdu->s);
+		tx_pdu->s = NULL;
+	}
+	if (!tx_pdu->s)
+		tx_pdu->s = stream_new(stream_get_size(pdu));
+
+	stream_copy(tx_pdu->s, pdu);
+	tx_pdu->level = lsp->level;
+	tx_pdu->lsp = lsp;
+
+	return true;
+}
+
+static void tx_queue_send_event(struct event *thread)
+{
+	struct isis_tx_queue *queue = EVENT_ARG(thread);
+	struct isis_circuit *circuit = queue->circuit;
+	struct isis_area *area = circuit->area;
+	struct isis_tx_queue_entry *e;
+	unsigned int count = 0;
+	long interval = area->lsp_tx_interval;
+
+	if (circuit->tx_batch) {
+		if (queue->batch_size < area->lsp_tx_burst) {
+			queue->batch = XREALLOC(MTYPE_TX_QUEUE, queue->batch,
+						area->lsp_tx_burst *
+							sizeof(*queue->batch));
+			memset(queue->batch + queue->batch_size, 0,
+			       (area->lsp_tx_burst - queue->batch_size) *
+				       sizeof(*queue->batch));
+			queue->batch_size = area->lsp_tx_burst;
+		}
+		queue->batching = true;
+	}
+
+	while (count < area->lsp_tx_burst &&
+	       (e = tx_queue_due_pop(&queue->due))) {
+		e->due = false;
+		event_add_timer(master, tx_queue_retry_event, e, 5, &e->retry);
+
+		if (e->is_retry) {
+			area->lsp_rxmt_count++;
+			queue->stats.retransmits++;
+		} else
+			e->is_retry = true;
+
+		count++;
+		queue->send_event(circuit, e->lsp, e->type);
+		/* Don't access e here anymore, send_event might have
+		 * destroyed it */
+	}
+
+	if (queue->batching) {
+		if (!tx_queue_batch_flush(queue))
+			interval = MAX(interval, TX_QUEUE_BACKOFF_MSEC);
+		queue->batching = false;
+	}
+
+	if (count) {
+		queue->stats.bursts++;
+		queue->stats.lsps_sent += count;
+		if (count > queue->stats.burst_max)
+			queue->stats.burst_max = count;
+	}
+
+	if (tx_queue_due_count(&queue->due))
+		tx_queue_schedule(queue, interval);
 }
 
 void _isis_tx_queue_add(struct isis_tx_queue *queue,
@@ -143,14 +336,16 @@ void _isis_tx_queue_add(struct isis_tx_queue *queue,
 		struct isis_tx_queue_entry *inserted;
 		inserted = hash_get(queue->hash, e, hash_alloc_intern);
 		assert(inserted == e);
+
+		if (hashcount(queue->hash) > queue->stats.depth_max)
+			queue->stats.depth_max = hashcount(queue->hash);
 	}
 
 	e->type = type;
 
 	EVENT_OFF(e->retry);
-	event_add_event(master, tx_queue_send_event, e, 0, &e->retry);
-
 	e->is_retry = false;
+	tx_queue_make_due(e);
 }
 
 void _isis_tx_queue_del(struct isis_tx_queue *queue, struct isis_lsp *lsp,
@@ -169,10 +364,7 @@ void _isis_tx_queue_del(struct isis_tx_queue *queue, struct isis_lsp *lsp,
 			   func, file, line);
 	}
 
-	EVENT_OFF(e->retry);
-
-	hash_release(queue->hash, e);
-	XFREE(MTYPE_TX_QUEUE_ENTRY, e);
+	tx_queue_entry_del(queue, e);
 }
 
 unsigned long isis_tx_queue_len(struct isis_tx_queue *queue)
@@ -183,6 +375,12 @@ unsigned long isis_tx_queue_len(struct isis_tx_queue *queue)
 	return hashcount(queue->hash);
 }
 
+void isis_tx_queue_stats_get(struct isis_tx_queue *queue,
+			     struct isis_tx_queue_stats *stats)
+{
+	*stats = queue->stats;
+}
+
 void isis_tx_queue_clean(struct isis_tx_queue *queue)
 {
 	hash_clean(queue->hash, tx_queue_element_free);
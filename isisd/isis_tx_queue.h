@@ -16,6 +16,22 @@ enum isis_tx_type {
 
 struct isis_tx_queue;
 
+/* A PDU of a burst, for circuit->tx_batch() */
+struct isis_tx_pdu {
+	struct stream *s;
+	int level;
+	struct isis_lsp *lsp;
+};
+
+struct isis_tx_queue_stats {
+	unsigned long depth_max;
+	uint64_t bursts;
+	uint64_t lsps_sent;
+	unsigned int burst_max;
+	uint64_t retransmits;
+	uint64_t batch_errors;
+};
+
 struct isis_tx_queue *isis_tx_queue_new(
 		struct isis_circuit *circuit,
 		void(*send_event)(struct isis_circuit *circuit,
@@ -38,6 +54,17 @@ void _isis_tx_queue_del(struct isis_tx_queue *queue, struct isis_lsp *lsp,
 			const char *func, const char *file, int line);
 
 unsigned long isis_tx_queue_len(struct isis_tx_queue *queue);
+void isis_tx_queue_stats_get(struct isis_tx_queue *queue,
+			     struct isis_tx_queue_stats *stats);
+
+/*
+ * While the queue sends a burst on a circuit that supports it, queue the
+ * LSP's PDU to be sent with the rest of the burst and return true; the
+ * queue then keeps or removes the LSP's entry once it knows whether the
+ * PDU went out.  Otherwise, the caller has to send it.
+ */
+bool isis_tx_queue_batch_add(struct isis_tx_queue *queue, struct stream *pdu,
+			     struct isis_lsp *lsp);
 
 void isis_tx_queue_clean(struct isis_tx_queue *queue);
 
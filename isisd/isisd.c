@@ -20,6 +20,7 @@
 #include "hash.h"
 #include "filter.h"
 #include "plist.h"
+#include "taskpool.h"
 #include "stream.h"
 #include "prefix.h"
 #include "table.h"
@@ -179,6 +180,7 @@ void isis_master_init(struct event_loop *master)
 void isis_master_terminate(void)
 {
 	list_delete(&im->isis);
+	taskpool_free(&im->spf_pool);
 }
 
 struct isis *isis_new(const char *vrf_name)
@@ -334,6 +336,7 @@ struct isis_area *isis_area_create(const char *area_tag, const char *vrf_name)
 
 	area->circuit_list = list_new();
 	area->adjacency_list = list_new();
+	area->tilfa_pending = list_new();
 	area->area_addrs = list_new();
 	area->area_addrs->del = isis_area_address_delete;
 
@@ -375,6 +378,10 @@ struct isis_area *isis_area_create(const char *area_tag, const char *vrf_name)
 	area->lsp_frag_threshold = 90; /* not currently configurable */
 	area->lsp_mtu =
 		yang_get_default_uint16("/frr-isisd:isis/instance/lsp/mtu");
+	area->lsp_tx_burst = yang_get_default_uint16(
+		"/frr-isisd:isis/instance/lsp/tx-pacing/burst");
+	area->lsp_tx_interval = yang_get_default_uint16(
+		"/frr-isisd:isis/instance/lsp/tx-pacing/interval");
 	area->lfa_load_sharing[0] = yang_get_default_bool(
 		"/frr-isisd:isis/instance/fast-reroute/level-1/lfa/load-sharing");
 	area->lfa_load_sharing[1] = yang_get_default_bool(
@@ -398,6 +405,8 @@ struct isis_area *isis_area_create(const char *area_tag, const char *vrf_name)
 	area->newmetric = 1;
 	area->lsp_frag_threshold = 90;
 	area->lsp_mtu = DEFAULT_LSP_MTU;
+	area->lsp_tx_burst = DEFAULT_LSP_TX_BURST;
+	area->lsp_tx_interval = 0;
 	area->lfa_load_sharing[0] = true;
 	area->lfa_load_sharing[1] = true;
 	area->attached_bit_send = true;
@@ -560,6 +569,7 @@ void isis_area_destroy(struct isis_area *area)
 	isis_mpls_te_term(area);
 
 	spftree_area_del(area);
+	list_delete(&area->tilfa_pending);
 
 	if (area->spf_timer[0])
 		isis_spf_timer_free(EVENT_ARG(area->spf_timer[0]));
@@ -599,6 +609,7 @@ void isis_area_destroy(struct isis_area *area)
 	EVENT_OFF(area->t_lsp_refresh[0]);
 	EVENT_OFF(area->t_lsp_refresh[1]);
 	EVENT_OFF(area->t_rlfa_rib_update);
+	EVENT_OFF(area->t_tilfa_update);
 
 	event_cancel_event(master, area);
 
@@ -799,6 +810,7 @@ void isis_filter_update(struct access_list *access)
 				ppa->list_v6 =
 					access_list_lookup(AFI_IP6, ppa->name);
 			}
+			area->spf_prefix_priorities_gen++;
 			lsp_regenerate_schedule(area, area->is_type, 0);
 		}
 	}
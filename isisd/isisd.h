@@ -75,6 +75,8 @@ struct isis_master {
 	/* ISIS thread master. */
 	struct event_loop *master;
 	uint8_t options;
+	/* Worker pthreads for SPF runs, see --spf-threads. */
+	struct taskpool *spf_pool;
 };
 #define F_ISIS_UNIT_TEST 0x01
 
@@ -128,6 +130,9 @@ struct isis_area {
 	struct isis_spftree *spftree[SPFTREE_COUNT][ISIS_LEVELS];
 #define DEFAULT_LSP_MTU 1497
 	unsigned int lsp_mtu;      /* Size of LSPs to generate */
+#define DEFAULT_LSP_TX_BURST 32
+	uint16_t lsp_tx_burst;	   /* LSPs sent at once per circuit */
+	uint16_t lsp_tx_interval;  /* msec between bursts */
 	struct list *circuit_list; /* IS-IS circuits */
 	struct list *adjacency_list; /* IS-IS adjacencies */
 	struct flags flags;
@@ -136,6 +141,7 @@ struct isis_area {
 	struct event *t_overload_on_startup_timer;
 	struct timeval last_lsp_refresh_event[ISIS_LEVELS];
 	struct event *t_rlfa_rib_update;
+	struct event *t_tilfa_update;
 	/* t_lsp_refresh is used in two ways:
 	 * a) regular refresh of LSPs
 	 * b) (possibly throttled) updates to LSPs
@@ -216,6 +222,7 @@ struct isis_area {
 	/* SPF prefix priorities. */
 	struct spf_prefix_priority_acl
 		spf_prefix_priorities[SPF_PREFIX_PRIO_MAX];
+	uint32_t spf_prefix_priorities_gen; /* bumped on ACL updates */
 	/* Fast Re-Route information. */
 	size_t lfa_protected_links[ISIS_LEVELS];
 	size_t lfa_load_sharing[ISIS_LEVELS];
@@ -225,6 +232,8 @@ struct isis_area {
 	struct prefix_list *rlfa_plist[ISIS_LEVELS];
 	size_t rlfa_protected_links[ISIS_LEVELS];
 	size_t tilfa_protected_links[ISIS_LEVELS];
+	/* SPTs with TI-LFA repair paths left to compute. */
+	struct list *tilfa_pending;
 	/* MPLS LDP-IGP Sync */
 	struct ldp_sync_info_cmd ldp_sync_cmd;
 #ifndef FABRICD
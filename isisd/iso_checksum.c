@@ -30,11 +30,13 @@
  * Verifies that the checksum is correct.
  * Return 0 on correct and 1 on invalid checksum.
  * Based on Annex C.4 of ISO/IEC 8473
+ *
+ * csum is the checksum as found in the buffer; the buffer is checked in
+ * place, in a single pass and without modifying it.
  */
 
-int iso_csum_verify(uint8_t *buffer, int len, uint16_t csum, int offset)
+int iso_csum_verify(uint8_t *buffer, int len, uint16_t csum)
 {
-	uint16_t checksum;
 	uint32_t c0;
 	uint32_t c1;
 
@@ -53,8 +55,8 @@ int iso_csum_verify(uint8_t *buffer, int len, uint16_t csum, int offset)
 	if (c0 == 0 || c1 == 0)
 		return 1;
 
-	checksum = fletcher_checksum(buffer, len, offset);
-	if (checksum == htons(csum))
+	/* both sums come out as 0 over a correctly checksummed buffer */
+	if (fletcher_checksum(buffer, len, FLETCHER_CHECKSUM_VALIDATE) == 0)
 		return 0;
 	return 1;
 }
@@ -10,6 +10,6 @@
 #ifndef _ZEBRA_ISO_CSUM_H
 #define _ZEBRA_ISO_CSUM_H
 
-int iso_csum_verify(uint8_t *buffer, int len, uint16_t csum, int offset);
+int iso_csum_verify(uint8_t *buffer, int len, uint16_t csum);
 
 #endif /* _ZEBRA_ISO_CSUM_H */
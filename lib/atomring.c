@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Bounded lock-free pointer ring.
+ * Copyright (C) 2026  FRRouting
+ *
+ * This is the well-known bounded MPMC queue design by Dmitry Vyukov: every
+ * slot has a sequence number telling whether it is ready to be written (seq
+ * == position) or read (seq == position + 1) for the current lap around the
+ * ring.  Producers claim a position by advancing 'head', consumers by
+ * advancing 'tail'; the sequence number store publishes the slot.
+ */
+#include <zebra.h>
+
+#include "atomring.h"
+#include "frratomic.h"
+#include "memory.h"
+
+DEFINE_MTYPE_STATIC(LIB, ATOMRING, "Lock-free pointer ring");
+
+struct atomring_slot {
+	atomic_size_t seq;
+	void *item;
+};
+
+struct atomring {
+	size_t mask;
+
+	/* producer and consumer positions, on separate cache lines so the
+	 * two sides don't bounce a line between them on every operation.
+	 */
+	atomic_size_t head __attribute__((aligned(64)));
+	atomic_size_t tail __attribute__((aligned(64)));
+
+	struct atomring_slot *slots __attribute__((aligned(64)));
+};
+
+struct atomring *atomring_new(size_t size)
+{
+	struct atomring *ring;
+	size_t i, slots = 2;
+
+	while (slots < size)
+		slots <<= 1;
+
+	ring = XCALLOC(MTYPE_ATOMRING, sizeof(*ring));
+	ring->slots = XCALLOC(MTYPE_ATOMRING, slots * sizeof(ring->slots[0]));
+	ring->mask = slots - 1;
+
+	for (i = 0; i < slots; i++)
+		atomic_store_explicit(&ring->slots[i].seq, i,
+				      memory_order_relaxed);
+	atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+	atomic_store_explicit(&ring->tail, 0, memory_order_release);
+
+	return ring;
+}
+
+void atomring_del(struct atomring *ring)
+{
+	XFREE(MTYPE_ATOMRING, ring->slots);
+	XFREE(MTYPE_ATOMRING, ring);
+}
+
+size_t atomring_size(const struct atomring *ring)
+{
+	return ring->mask + 1;
+}
+
+size_t atomring_count(const struct atomring *ring)
+{
+	size_t tail, head;
+
+	tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+	/* both loads race with updates; clamp to something sensible */
+	if ((ssize_t)(head - tail) < 0)
+		return 0;
+	return MIN(head - tail, ring->mask + 1);
+}
+
+bool atomring_push(struct atomring *ring, void *item)
+{
+	struct atomring_slot *slot;
+	size_t pos, seq;
+	ssize_t diff;
+
+	assert(item);
+
+	pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	for (;;) {
+		slot = &ring->slots[pos & ring->mask];
+		seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		diff = (ssize_t)(seq - pos);
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(
+				    &ring->head, &pos, pos + 1,
+				    memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			/* slot still holds an item from the previous lap */
+			return false;
+		} else
+			pos = atomic_load_explicit(&ring->head,
+						   memory_order_relaxed);
+	}
+
+	slot->item = item;
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+	return true;
+}
+
+void *atomring_pop(struct atomring *ring)
+{
+	struct atomring_slot *slot;
+	size_t pos, seq;
+	ssize_t diff;
+	void *item;
+
+	pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	for (;;) {
+		slot = &ring->slots[pos & ring->mask];
+		seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		diff = (ssize_t)(seq - (pos + 1));
+
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(
+				    &ring->tail, &pos, pos + 1,
+				    memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			/* slot not written yet in this lap: empty */
+			return NULL;
+		} else
+			pos = atomic_load_explicit(&ring->tail,
+						   memory_order_relaxed);
+	}
+
+	item = slot->item;
+	atomic_store_explicit(&slot->seq, pos + ring->mask + 1,
+			      memory_order_release);
+	return item;
+}
+
+size_t atomring_pop_bulk(struct atomring *ring, void **items, size_t max)
+{
+	size_t n;
+
+	for (n = 0; n < max; n++) {
+		items[n] = atomring_pop(ring);
+		if (!items[n])
+			break;
+	}
+	return n;
+}
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Bounded lock-free pointer ring.
+ * Copyright (C) 2026  FRRouting
+ */
+#ifndef _FRR_ATOMRING_H_
+#define _FRR_ATOMRING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-size FIFO of pointers that can be used without locks by any number
+ * of producer and consumer pthreads (each slot carries a sequence number,
+ * so producers and consumers only contend on the head/tail index they
+ * advance).  The common uses are SPSC or MPSC hand-off queues between
+ * pthreads, e.g. passing work items to and from a worker thread.
+ *
+ * The ring never blocks and never grows: atomring_push() fails when the
+ * ring is full, and the caller has to provide its own overflow handling.
+ * NULL cannot be stored in the ring.
+ */
+struct atomring;
+
+/*
+ * Creates a new ring.
+ *
+ * @param size	number of slots; rounded up to a power of 2
+ * @return the newly created ring
+ */
+struct atomring *atomring_new(size_t size);
+
+/*
+ * Deletes a ring.  Items still in the ring are not touched; the caller
+ * must have drained it (or otherwise taken care of them.)
+ */
+void atomring_del(struct atomring *ring);
+
+/*
+ * Number of slots in the ring.
+ */
+size_t atomring_size(const struct atomring *ring);
+
+/*
+ * Approximate number of items in the ring.  Exact if no other pthread is
+ * modifying the ring concurrently.
+ */
+size_t atomring_count(const struct atomring *ring);
+
+/*
+ * Append an item to the ring.
+ *
+ * @return true on success, false if the ring is full
+ */
+bool atomring_push(struct atomring *ring, void *item);
+
+/*
+ * Remove the oldest item from the ring.
+ *
+ * @return the item, or NULL if the ring is empty
+ */
+void *atomring_pop(struct atomring *ring);
+
+/*
+ * Remove up to @max items from the ring, oldest first, into @items.
+ *
+ * @return number of items stored in @items
+ */
+size_t atomring_pop_bulk(struct atomring *ring, void **items, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_ATOMRING_H_ */
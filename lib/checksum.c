@@ -11,18 +11,288 @@
 #include <zebra.h>
 #include "checksum.h"
 
-#define add_carry(dst, add)                                                    \
-	do {                                                                   \
-		typeof(dst) _add = (add);                                      \
-		dst += _add;                                                   \
-		if (dst < _add)                                                \
-			dst++;                                                 \
-	} while (0)
+/*
+ * The byte loops are done by one of several kernels, the best one the CPU
+ * supports is picked at startup.  in_sum adds up the 16-bit words of an
+ * even-length buffer without folding carries, fletcher_sum continues the
+ * two Fletcher sums (mod 255) over a buffer.
+ */
+struct checksum_ops {
+	uint64_t (*in_sum)(const uint8_t *ptr, size_t len);
+	void (*fletcher_sum)(const uint8_t *ptr, size_t len, uint32_t *c0,
+			     uint32_t *c1);
+};
+
+/* Fletcher Checksum -- Refer to RFC1008. */
+#define MODX                 4102U   /* 5802 should be fine */
+
+static uint64_t in_sum_scalar(const uint8_t *ptr, size_t len)
+{
+	const uint8_t *end = ptr + len;
+	uint64_t sum = 0;
+	uint32_t w32[2];
+	uint16_t w16;
+
+	/* 32-bit words are congruent to the sum of their 16-bit halves
+	 * modulo 0xffff, so they can go into the sum as they are.  memcpy
+	 * since buffers need not be aligned.
+	 */
+	while (ptr + 8 <= end) {
+		memcpy(w32, ptr, sizeof(w32));
+		sum += w32[0];
+		sum += w32[1];
+		ptr += 8;
+	}
+
+	while (ptr + 2 <= end) {
+		memcpy(&w16, ptr, sizeof(w16));
+		sum += w16;
+		ptr += 2;
+	}
+	return sum;
+}
+
+static void fletcher_sum_scalar(const uint8_t *ptr, size_t len, uint32_t *c0p,
+				uint32_t *c1p)
+{
+	uint32_t c0 = *c0p, c1 = *c1p;
+	size_t partial_len, i;
+
+	while (len != 0) {
+		partial_len = MIN(len, MODX);
+
+		for (i = 0; i < partial_len; i++) {
+			c0 = c0 + *(ptr++);
+			c1 += c0;
+		}
+
+		c0 = c0 % 255;
+		c1 = c1 % 255;
+
+		len -= partial_len;
+	}
+
+	*c0p = c0;
+	*c1p = c1;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+#define CHECKSUM_X86
+
+/*
+ * Fletcher sums are taken over blocks of this many bytes, a multiple of the
+ * vector size, before reducing them; c1 grows by up to
+ * 255 * n * (n + 1) / 2 + 254 * n over a block of n bytes, which has to fit
+ * in 32 bits.
+ */
+#define FLETCHER_VEC_BLOCK 5760U
+
+static inline uint32_t hsum_epi32(__m128i v)
+{
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+
+static inline uint64_t hsum_epi64(__m128i v)
+{
+	v = _mm_add_epi64(v, _mm_unpackhi_epi64(v, v));
+	return _mm_cvtsi128_si64(v);
+}
+
+/* SSE2 is part of x86-64, these need no runtime check */
+static uint64_t in_sum_sse2(const uint8_t *ptr, size_t len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i acc0 = zero, acc1 = zero, v;
+
+	/* 32-bit words into 64-bit lanes, as in in_sum_scalar() */
+	for (; len >= 16; len -= 16, ptr += 16) {
+		v = _mm_loadu_si128((const __m128i *)ptr);
+		acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, zero));
+		acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, zero));
+	}
+
+	return hsum_epi64(_mm_add_epi64(acc0, acc1)) + in_sum_scalar(ptr, len);
+}
+
+/*
+ * For a block of n bytes a[0..n-1], c0 grows by the sum of a[i] and c1 by
+ * n * c0 plus the sum of (n - i) * a[i].  The weighted sum is split into
+ * the weights within each vector, and 16 times the sum of all preceding
+ * vectors for each vector, which "prev" accumulates.
+ */
+static void fletcher_sum_sse2(const uint8_t *ptr, size_t len, uint32_t *c0p,
+			      uint32_t *c1p)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i w_lo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+	const __m128i w_hi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+	uint32_t c0 = *c0p, c1 = *c1p;
+	__m128i s0, s1, prev, v;
+	size_t n, i;
+
+	while (len >= 16) {
+		n = MIN(len, FLETCHER_VEC_BLOCK) & ~(size_t)15;
+		s0 = s1 = prev = zero;
+
+		for (i = 0; i < n; i += 16) {
+			v = _mm_loadu_si128((const __m128i *)(ptr + i));
+			prev = _mm_add_epi32(prev, s0);
+			s0 = _mm_add_epi32(s0, _mm_sad_epu8(v, zero));
+			s1 = _mm_add_epi32(
+				s1, _mm_madd_epi16(_mm_unpacklo_epi8(v, zero),
+						   w_lo));
+			s1 = _mm_add_epi32(
+				s1, _mm_madd_epi16(_mm_unpackhi_epi8(v, zero),
+						   w_hi));
+		}
+		s1 = _mm_add_epi32(s1, _mm_slli_epi32(prev, 4));
+
+		c1 = (c1 + n * c0 + hsum_epi32(s1)) % 255;
+		c0 = (c0 + hsum_epi32(s0)) % 255;
+		ptr += n;
+		len -= n;
+	}
+
+	*c0p = c0;
+	*c1p = c1;
+	fletcher_sum_scalar(ptr, len, c0p, c1p);
+}
+
+__attribute__((target("avx2"))) static uint64_t in_sum_avx2(const uint8_t *ptr,
+							     size_t len)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i acc0 = zero, acc1 = zero, v;
+	uint64_t sum;
+
+	for (; len >= 32; len -= 32, ptr += 32) {
+		v = _mm256_loadu_si256((const __m256i *)ptr);
+		acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+		acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+	}
+
+	acc0 = _mm256_add_epi64(acc0, acc1);
+	sum = hsum_epi64(_mm_add_epi64(_mm256_castsi256_si128(acc0),
+				       _mm256_extracti128_si256(acc0, 1)));
+
+	/* legacy SSE code runs slowly while the upper halves are in use */
+	_mm256_zeroupper();
+	return sum + in_sum_scalar(ptr, len);
+}
+
+/* as fletcher_sum_sse2(), with the byte weights done by maddubs */
+__attribute__((target("avx2"))) static void
+fletcher_sum_avx2(const uint8_t *ptr, size_t len, uint32_t *c0p, uint32_t *c1p)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i ones = _mm256_set1_epi16(1);
+	const __m256i w = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24,
+					   23, 22, 21, 20, 19, 18, 17, 16, 15,
+					   14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4,
+					   3, 2, 1);
+	uint32_t c0 = *c0p, c1 = *c1p;
+	__m256i s0, s1, prev, v;
+	__m128i s0x, s1x;
+	size_t n, i;
+
+	while (len >= 32) {
+		n = MIN(len, FLETCHER_VEC_BLOCK) & ~(size_t)31;
+		s0 = s1 = prev = zero;
+
+		for (i = 0; i < n; i += 32) {
+			v = _mm256_loadu_si256((const __m256i *)(ptr + i));
+			prev = _mm256_add_epi32(prev, s0);
+			s0 = _mm256_add_epi32(s0, _mm256_sad_epu8(v, zero));
+			s1 = _mm256_add_epi32(
+				s1, _mm256_madd_epi16(_mm256_maddubs_epi16(v, w),
+						      ones));
+		}
+		s1 = _mm256_add_epi32(s1, _mm256_slli_epi32(prev, 5));
+
+		s0x = _mm_add_epi32(_mm256_castsi256_si128(s0),
+				    _mm256_extracti128_si256(s0, 1));
+		s1x = _mm_add_epi32(_mm256_castsi256_si128(s1),
+				    _mm256_extracti128_si256(s1, 1));
+		c1 = (c1 + n * c0 + hsum_epi32(s1x)) % 255;
+		c0 = (c0 + hsum_epi32(s0x)) % 255;
+		ptr += n;
+		len -= n;
+	}
+
+	_mm256_zeroupper();
+	*c0p = c0;
+	*c1p = c1;
+	fletcher_sum_scalar(ptr, len, c0p, c1p);
+}
+#endif /* __x86_64__ && __GNUC__ */
+
+static const struct checksum_ops checksum_impls[CHECKSUM_IMPL_MAX] = {
+	[CHECKSUM_IMPL_SCALAR] = {
+		.in_sum = in_sum_scalar,
+		.fletcher_sum = fletcher_sum_scalar,
+	},
+#ifdef CHECKSUM_X86
+	[CHECKSUM_IMPL_SSE2] = {
+		.in_sum = in_sum_sse2,
+		.fletcher_sum = fletcher_sum_sse2,
+	},
+	[CHECKSUM_IMPL_AVX2] = {
+		.in_sum = in_sum_avx2,
+		.fletcher_sum = fletcher_sum_avx2,
+	},
+#endif
+};
+
+static const struct checksum_ops *checksum_ops =
+	&checksum_impls[CHECKSUM_IMPL_SCALAR];
+
+static bool checksum_impl_supported(enum checksum_impl impl)
+{
+	if (impl >= CHECKSUM_IMPL_MAX || !checksum_impls[impl].in_sum)
+		return false;
+#ifdef CHECKSUM_X86
+	if (impl == CHECKSUM_IMPL_AVX2)
+		return __builtin_cpu_supports("avx2");
+#endif
+	return true;
+}
+
+bool checksum_impl_set(enum checksum_impl impl)
+{
+	if (!checksum_impl_supported(impl))
+		return false;
+
+	checksum_ops = &checksum_impls[impl];
+	return true;
+}
+
+enum checksum_impl checksum_impl_get(void)
+{
+	return checksum_ops - checksum_impls;
+}
+
+static void checksum_impl_init(void) __attribute__((_CONSTRUCTOR(500)));
+static void checksum_impl_init(void)
+{
+	enum checksum_impl impl = CHECKSUM_IMPL_MAX;
+
+#ifdef CHECKSUM_X86
+	/* may run before libgcc's own constructor */
+	__builtin_cpu_init();
+#endif
+	while (impl-- > CHECKSUM_IMPL_SCALAR)
+		if (checksum_impl_set(impl))
+			break;
+}
 
 uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 {
 	const struct iovec *iov_end;
-	uint32_t sum = 0;
+	uint64_t sum = 0;
 
 	union {
 		uint8_t bytes[2];
@@ -31,13 +301,15 @@ uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 	bool have_oddbyte = false;
 
 	/*
-	 * Our algorithm is simple, using a 32-bit accumulator (sum),
+	 * Our algorithm is simple, using a 64-bit accumulator (sum),
 	 * we add sequential 16-bit words to it, and at the end, fold back
-	 * all the carry bits from the top 16 bits into the lower 16 bits.
+	 * all the carry bits from the top bits into the lower 16 bits.
+	 * The accumulator is wide enough that it never overflows.
 	 */
 
 	for (iov_end = iov + iov_len; iov < iov_end; iov++) {
 		const uint8_t *ptr, *end;
+		size_t len;
 
 		ptr = (const uint8_t *)iov->iov_base;
 		end = ptr + iov->iov_len;
@@ -48,19 +320,12 @@ uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 			have_oddbyte = false;
 			wordbuf.bytes[1] = *ptr++;
 
-			add_carry(sum, wordbuf.word);
-		}
-
-		while (ptr + 8 <= end) {
-			add_carry(sum, *(const uint32_t *)(ptr + 0));
-			add_carry(sum, *(const uint32_t *)(ptr + 4));
-			ptr += 8;
+			sum += wordbuf.word;
 		}
 
-		while (ptr + 2 <= end) {
-			add_carry(sum, *(const uint16_t *)ptr);
-			ptr += 2;
-		}
+		len = (end - ptr) & ~(size_t)1;
+		sum += checksum_ops->in_sum(ptr, len);
+		ptr += len;
 
 		if (ptr + 1 <= end) {
 			wordbuf.bytes[0] = *ptr++;
@@ -71,21 +336,20 @@ uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 	/* mop up an odd byte, if necessary */
 	if (have_oddbyte) {
 		wordbuf.bytes[1] = 0;
-		add_carry(sum, wordbuf.word);
+		sum += wordbuf.word;
 	}
 
 	/*
-	 * Add back carry outs from top 16 bits to low 16 bits.
+	 * Add back carry outs from top bits to low 16 bits.
 	 */
 
+	sum = (sum >> 32) + (sum & 0xffffffff);
+	sum = (sum >> 32) + (sum & 0xffffffff);
 	sum = (sum >> 16) + (sum & 0xffff); /* add high-16 to low-16 */
-	sum += (sum >> 16);		    /* add carry */
+	sum = (sum >> 16) + (sum & 0xffff); /* add carry */
 	return ~sum;
 }
 
-/* Fletcher Checksum -- Refer to RFC1008. */
-#define MODX                 4102U   /* 5802 should be fine */
-
 /* To be consistent, offset is 0-based index, rather than the 1-based
    index required in the specification ISO 8473, Annex C.1 */
 /* calling with offset == FLETCHER_CHECKSUM_VALIDATE will validate the checksum
@@ -93,38 +357,20 @@ uint16_t in_cksumv(const struct iovec *iov, size_t iov_len)
 uint16_t fletcher_checksum(uint8_t *buffer, const size_t len,
 			   const uint16_t offset)
 {
-	uint8_t *p;
-	int x, y, c0, c1;
+	int x, y;
+	uint32_t c0 = 0, c1 = 0;
 	uint16_t checksum = 0;
-	uint16_t *csum;
-	size_t partial_len, i, left = len;
 
 	if (offset != FLETCHER_CHECKSUM_VALIDATE)
 	/* Zero the csum in the packet. */
 	{
 		assert(offset
 		       < (len - 1)); /* account for two bytes of checksum */
-		csum = (uint16_t *)(buffer + offset);
-		*(csum) = 0;
+		buffer[offset] = 0;
+		buffer[offset + 1] = 0;
 	}
 
-	p = buffer;
-	c0 = 0;
-	c1 = 0;
-
-	while (left != 0) {
-		partial_len = MIN(left, MODX);
-
-		for (i = 0; i < partial_len; i++) {
-			c0 = c0 + *(p++);
-			c1 += c0;
-		}
-
-		c0 = c0 % 255;
-		c1 = c1 % 255;
-
-		left -= partial_len;
-	}
+	checksum_ops->fletcher_sum(buffer, len, &c0, &c1);
 
 	/* The cast is important, to ensure the mod is taken as a signed value.
 	 */
@@ -132,7 +378,7 @@ uint16_t fletcher_checksum(uint8_t *buffer, const size_t len,
 
 	if (x <= 0)
 		x += 255;
-	y = 510 - c0 - x;
+	y = 510 - (int)c0 - x;
 	if (y > 255)
 		y -= 255;
 
@@ -69,6 +69,22 @@ static inline uint16_t in_cksum_with_ph6(const struct ipv6_ph *ph,
 extern uint16_t fletcher_checksum(uint8_t *, const size_t len,
 				  const uint16_t offset);
 
+/*
+ * Both checksums use SIMD kernels where the CPU has them, the best one is
+ * picked at startup.  checksum_impl_set() overrides that, for tests and
+ * benchmarks; it returns false if the CPU can't run the given kernel.
+ */
+enum checksum_impl {
+	CHECKSUM_IMPL_SCALAR = 0,
+	CHECKSUM_IMPL_SSE2,
+	CHECKSUM_IMPL_AVX2,
+
+	CHECKSUM_IMPL_MAX,
+};
+
+extern bool checksum_impl_set(enum checksum_impl impl);
+extern enum checksum_impl checksum_impl_get(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -9,6 +9,9 @@
 
 #include <signal.h>
 #include <sys/resource.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #include "frrevent.h"
 #include "memory.h"
@@ -24,6 +27,7 @@
 #include "lib_errors.h"
 #include "libfrr_trace.h"
 #include "libfrr.h"
+#include "json.h"
 
 DEFINE_MTYPE_STATIC(LIB, THREAD, "Thread");
 DEFINE_MTYPE_STATIC(LIB, EVENT_MASTER, "Thread master");
@@ -57,6 +61,187 @@ static int event_timer_cmp(const struct event *a, const struct event *b)
 
 DECLARE_HEAP(event_timer_list, struct event, timeritem, event_timer_cmp);
 
+/*
+ * Hierarchical timing wheel for long timers.
+ *
+ * Adding and canceling a timer in the heap is O(log n), which adds up in
+ * daemons with tens of thousands of timers that are constantly restarted
+ * (peer keepalives, LSA refreshes, ...). Timers at least
+ * EVENT_WHEEL_MIN_MSEC away can instead go to a timing wheel where both
+ * are O(1).
+ *
+ * Time is counted in milliseconds. Level L has EVENT_WHEEL_SLOTS slots
+ * covering 64^L ms each; a timer sits at the level of the highest base-64
+ * digit in which its expiry differs from the wheel's current time. When
+ * time reaches the start of its slot, the timer is moved down a level, or
+ * expired if due. Timers are rounded up to the millisecond, so they never
+ * fire early.
+ */
+#define EVENT_WHEEL_BITS 6
+#define EVENT_WHEEL_SLOTS (1 << EVENT_WHEEL_BITS)
+#define EVENT_WHEEL_LEVELS 6
+/* Shorter timers stay in the heap, which is precise to the microsecond. */
+#define EVENT_WHEEL_MIN_MSEC 1000
+
+DECLARE_DLIST(event_wheel_list, struct event, wheelitem);
+
+struct event_wheel {
+	/* time (ms) up to which timers have been expired */
+	uint64_t now;
+	/* start (ms) of the first occupied slot or earlier, or UINT64_MAX */
+	uint64_t next;
+	size_t count;
+
+	uint64_t occupied[EVENT_WHEEL_LEVELS];
+	struct event_wheel_list_head slots[EVENT_WHEEL_LEVELS]
+					  [EVENT_WHEEL_SLOTS];
+};
+
+static bool event_wheel_default;
+
+void event_timer_wheel_set(bool enable)
+{
+	event_wheel_default = enable;
+}
+
+static inline uint64_t event_wheel_msec(const struct timeval *tv, bool up)
+{
+	return (uint64_t)tv->tv_sec * 1000 +
+	       (tv->tv_usec + (up ? 999 : 0)) / 1000;
+}
+
+static struct event_wheel *event_wheel_new(void)
+{
+	struct event_wheel *w;
+	struct timeval now;
+	int l, s;
+
+	w = XCALLOC(MTYPE_EVENT_MASTER, sizeof(*w));
+	monotime(&now);
+	w->now = event_wheel_msec(&now, false);
+	w->next = UINT64_MAX;
+	for (l = 0; l < EVENT_WHEEL_LEVELS; l++)
+		for (s = 0; s < EVENT_WHEEL_SLOTS; s++)
+			event_wheel_list_init(&w->slots[l][s]);
+
+	return w;
+}
+
+static void event_wheel_free(struct event_wheel *w)
+{
+	int l, s;
+
+	for (l = 0; l < EVENT_WHEEL_LEVELS; l++)
+		for (s = 0; s < EVENT_WHEEL_SLOTS; s++)
+			event_wheel_list_fini(&w->slots[l][s]);
+
+	XFREE(MTYPE_EVENT_MASTER, w);
+}
+
+/* Put a timer in its slot; expiry must be after the wheel's time. */
+static bool event_wheel_insert(struct event_wheel *w, struct event *thread,
+			       uint64_t expiry)
+{
+	unsigned int level, slot;
+
+	level = (63 - __builtin_clzll(expiry ^ w->now)) / EVENT_WHEEL_BITS;
+	if (level >= EVENT_WHEEL_LEVELS)
+		return false;
+
+	slot = (expiry >> (level * EVENT_WHEEL_BITS)) & (EVENT_WHEEL_SLOTS - 1);
+	event_wheel_list_add_tail(&w->slots[level][slot], thread);
+	w->occupied[level] |= 1ULL << slot;
+	thread->wheel_pos = level * EVENT_WHEEL_SLOTS + slot + 1;
+
+	return true;
+}
+
+/*
+ * Add a timer to the wheel if it is long enough, and tell whether it is
+ * now the first one.
+ */
+static bool event_wheel_add(struct event_wheel *w, struct event *thread,
+			    const struct timeval *time_relative, bool *first)
+{
+	uint64_t expiry, start;
+	unsigned int level;
+
+	if (time_relative->tv_sec * 1000 + time_relative->tv_usec / 1000 <
+	    EVENT_WHEEL_MIN_MSEC)
+		return false;
+
+	expiry = event_wheel_msec(&thread->u.sands, true);
+	if (expiry <= w->now || !event_wheel_insert(w, thread, expiry))
+		return false;
+
+	/*
+	 * The wheel needs attention when time reaches the start of the
+	 * timer's slot, not its expiry: advancing past the start without
+	 * emptying the slot would leave the timer behind.
+	 */
+	level = (thread->wheel_pos - 1) / EVENT_WHEEL_SLOTS;
+	start = expiry & ~((1ULL << (level * EVENT_WHEEL_BITS)) - 1);
+
+	w->count++;
+	*first = start < w->next;
+	if (*first)
+		w->next = start;
+
+	return true;
+}
+
+static void event_wheel_del(struct event_wheel *w, struct event *thread)
+{
+	unsigned int level, slot;
+	struct event_wheel_list_head *head;
+
+	level = (thread->wheel_pos - 1) / EVENT_WHEEL_SLOTS;
+	slot = (thread->wheel_pos - 1) % EVENT_WHEEL_SLOTS;
+	head = &w->slots[level][slot];
+
+	event_wheel_list_del(head, thread);
+	if (event_wheel_list_count(head) == 0)
+		w->occupied[level] &= ~(1ULL << slot);
+	thread->wheel_pos = 0;
+	if (--w->count == 0)
+		w->next = UINT64_MAX;
+}
+
+/* Start of the next occupied slot, UINT64_MAX if the wheel is empty. */
+static uint64_t event_wheel_next(const struct event_wheel *w)
+{
+	uint64_t next = UINT64_MAX, mask, start;
+	unsigned int level, shift, digit;
+
+	for (level = 0; level < EVENT_WHEEL_LEVELS; level++) {
+		shift = level * EVENT_WHEEL_BITS;
+		digit = (w->now >> shift) & (EVENT_WHEEL_SLOTS - 1);
+
+		/* Occupied slots are always ahead of the current one. */
+		mask = w->occupied[level] & ~((2ULL << digit) - 1);
+		if (!mask)
+			continue;
+
+		start = (w->now >> (shift + EVENT_WHEEL_BITS))
+			<< (shift + EVENT_WHEEL_BITS);
+		start |= (uint64_t)__builtin_ctzll(mask) << shift;
+		if (start < next)
+			next = start;
+	}
+
+	return next;
+}
+
+/* Remove a timer from whichever store it is in. */
+static void event_timer_del(struct event_loop *m, struct event *thread)
+{
+	if (thread->wheel_pos)
+		event_wheel_del(m->wheel, thread);
+	else
+		event_timer_list_del(&m->timer, thread);
+}
+
+
 #define AWAKEN(m)                                                              \
 	do {                                                                   \
 		const unsigned char wakebyte = 0x01;                           \
@@ -116,6 +301,26 @@ static void cpu_records_free(struct cpu_event_history **p)
 	XFREE(MTYPE_EVENT_STATS, *p);
 }
 
+static inline void event_histogram_add(struct event_histogram *h,
+				       unsigned long usec)
+{
+	unsigned int b = usec ? 64 - __builtin_clzll(usec) : 0;
+
+	if (b >= EVENT_HIST_BUCKETS)
+		b = EVENT_HIST_BUCKETS - 1;
+	atomic_fetch_add_explicit(&h->bucket[b], 1, memory_order_relaxed);
+}
+
+static inline void event_histogram_add_since(struct event_histogram *h,
+					     const struct timeval *now,
+					     const struct timeval *since)
+{
+	if (timercmp(now, since, >))
+		event_histogram_add(h, timeval_elapsed(*now, *since));
+	else
+		event_histogram_add(h, 0);
+}
+
 static void vty_out_cpu_event_history(struct vty *vty,
 				      struct cpu_event_history *a)
 {
@@ -370,44 +575,394 @@ DEFPY (service_walltime_warning,
 	return CMD_SUCCESS;
 }
 
+/*
+ * I/O backends.
+ *
+ * poll() gets the whole set of fds on every wakeup, which is simple and
+ * portable but makes each loop iteration O(number of fds). epoll keeps the
+ * set in the kernel and only reports the active fds.
+ *
+ * Tasks are one-shot while epoll registrations are persistent, so the
+ * epoll backend tracks the events wanted for each fd separately from what
+ * the kernel has been told, and only pushes the difference right before
+ * waiting. Once all of an fd's tasks have run or been cancelled, the fd
+ * may be closed and its number reused before it is scheduled again, so
+ * the registration is then re-checked with one EPOLL_CTL_MOD (falling back
+ * to EPOLL_CTL_ADD for a new file) even if the events wanted are the same.
+ */
+static enum event_backend event_backend_default = EVENT_BACKEND_POLL;
+
+const char *event_backend_name(enum event_backend backend)
+{
+	switch (backend) {
+	case EVENT_BACKEND_POLL:
+		return "poll";
+	case EVENT_BACKEND_EPOLL:
+		return "epoll";
+	}
+
+	return "unknown";
+}
+
+bool event_backend_set(const char *name)
+{
+	if (strcmp(name, "poll") == 0)
+		event_backend_default = EVENT_BACKEND_POLL;
+#ifdef HAVE_EPOLL
+	else if (strcmp(name, "epoll") == 0)
+		event_backend_default = EVENT_BACKEND_EPOLL;
+#endif
+	else
+		return false;
+
+	return true;
+}
+
+/* Maximum number of ready fds handled per wakeup. */
+#define EVENT_EPOLL_MAX_EVENTS 256
+
+struct event_epoll_fd {
+	/* position in event_epoll->fds, valid if want != 0 */
+	nfds_t idx;
+	/* POLLIN/POLLOUT tasks scheduled */
+	short want;
+	/* POLLIN/POLLOUT registered with the kernel */
+	short reg;
+	/* queued in event_epoll->dirty */
+	bool dirty;
+	/* all tasks were gone since the last sync, reg may be stale */
+	bool recheck;
+	/* epoll refused this fd (e.g. regular file), always ready */
+	bool always;
+};
+
+struct event_epoll {
+	int epfd;
+
+	/* per fd state, indexed by fd */
+	struct event_epoll_fd *fdstate;
+
+	/* fds with tasks scheduled */
+	int *fds;
+	nfds_t count;
+
+	/* fds whose kernel registration is out of date */
+	int *dirty;
+	nfds_t dirtycount;
+
+	/* number of fds flagged always ready */
+	nfds_t nalways;
+
+	/* fds reported by the last wait */
+	struct pollfd ready[EVENT_EPOLL_MAX_EVENTS];
+};
+
+static void event_epoll_mark(struct event_epoll *ep, int fd)
+{
+	struct event_epoll_fd *ef = &ep->fdstate[fd];
+
+	if (ef->dirty)
+		return;
+
+	ef->dirty = true;
+	ep->dirty[ep->dirtycount++] = fd;
+}
+
+static void event_epoll_add(struct event_epoll *ep, int fd, short events)
+{
+	struct event_epoll_fd *ef = &ep->fdstate[fd];
+
+	if (ef->want == 0) {
+		ef->idx = ep->count;
+		ep->fds[ep->count++] = fd;
+	}
+
+	ef->want |= events;
+	event_epoll_mark(ep, fd);
+}
+
+static bool event_epoll_del(struct event_epoll *ep, int fd, short events)
+{
+	struct event_epoll_fd *ef = &ep->fdstate[fd];
+	int last;
+
+	if (ef->want == 0)
+		return false;
+
+	ef->want &= ~events;
+	if (ef->want == 0) {
+		ef->recheck = true;
+
+		last = ep->fds[--ep->count];
+		ep->fds[ef->idx] = last;
+		ep->fdstate[last].idx = ef->idx;
+
+		if (ef->always) {
+			ef->always = false;
+			ep->nalways--;
+		}
+	}
+
+	event_epoll_mark(ep, fd);
+	return true;
+}
+
+#ifdef HAVE_EPOLL
+static struct event_epoll *event_epoll_new(struct event_loop *m)
+{
+	struct event_epoll *ep;
+	struct epoll_event ev = {};
+	int epfd;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd == -1) {
+		flog_err(EC_LIB_SYSTEM_CALL, "epoll_create1() error: %s",
+			 safe_strerror(errno));
+		return NULL;
+	}
+
+	/* The pipe poker is always watched. */
+	ev.events = EPOLLIN;
+	ev.data.fd = m->io_pipe[0];
+	if (epoll_ctl(epfd, EPOLL_CTL_ADD, m->io_pipe[0], &ev) == -1) {
+		flog_err(EC_LIB_SYSTEM_CALL, "epoll_ctl() error: %s",
+			 safe_strerror(errno));
+		close(epfd);
+		return NULL;
+	}
+
+	ep = XCALLOC(MTYPE_EVENT_MASTER, sizeof(*ep));
+	ep->epfd = epfd;
+	ep->fdstate = XCALLOC(MTYPE_EVENT_POLL,
+			      sizeof(*ep->fdstate) * m->fd_limit);
+	ep->fds = XCALLOC(MTYPE_EVENT_POLL, sizeof(*ep->fds) * m->fd_limit);
+	ep->dirty = XCALLOC(MTYPE_EVENT_POLL, sizeof(*ep->dirty) * m->fd_limit);
+
+	return ep;
+}
+
+static int event_epoll_ctl(int epfd, int op, int fd, struct epoll_event *ev)
+{
+	if (epoll_ctl(epfd, op, fd, ev) == 0)
+		return 0;
+
+	/* The fd was closed, and maybe reused, while registered. */
+	if (op == EPOLL_CTL_ADD && errno == EEXIST)
+		op = EPOLL_CTL_MOD;
+	else if (op == EPOLL_CTL_MOD && errno == ENOENT)
+		op = EPOLL_CTL_ADD;
+	else if (op == EPOLL_CTL_DEL && (errno == ENOENT || errno == EBADF))
+		return 0;
+	else
+		return errno;
+
+	if (epoll_ctl(epfd, op, fd, ev) == 0)
+		return 0;
+
+	return errno;
+}
+
+/* Push pending registration changes to the kernel. */
+static void event_epoll_sync(struct event_epoll *ep)
+{
+	struct epoll_event ev = {};
+	struct event_epoll_fd *ef;
+	nfds_t i;
+	int fd, op, rv;
+	bool recheck;
+
+	/* event_epoll_del() below may append, hence the re-evaluation */
+	for (i = 0; i < ep->dirtycount; i++) {
+		fd = ep->dirty[i];
+		ef = &ep->fdstate[fd];
+		ef->dirty = false;
+
+		recheck = ef->recheck && ef->want != 0;
+		ef->recheck = false;
+
+		if ((ef->want == ef->reg && !recheck) || ef->always)
+			continue;
+
+		if (ef->want == 0)
+			op = EPOLL_CTL_DEL;
+		else if (ef->reg == 0)
+			op = EPOLL_CTL_ADD;
+		else
+			op = EPOLL_CTL_MOD;
+
+		ev.events = 0;
+		if (ef->want & POLLIN)
+			ev.events |= EPOLLIN;
+		if (ef->want & POLLOUT)
+			ev.events |= EPOLLOUT;
+		ev.data.fd = fd;
+
+		rv = event_epoll_ctl(ep->epfd, op, fd, &ev);
+		if (rv == 0) {
+			ef->reg = ef->want;
+			continue;
+		}
+
+		ef->reg = 0;
+
+		/* poll() reports files epoll can't watch as always ready. */
+		if (rv == EPERM) {
+			ef->always = true;
+			ep->nalways++;
+			continue;
+		}
+
+		/* Drop invalid fds like poll() does on POLLNVAL. */
+		if (rv != EBADF)
+			flog_err(EC_LIB_SYSTEM_CALL,
+				 "epoll_ctl() error for fd %d: %s", fd,
+				 safe_strerror(rv));
+		event_epoll_del(ep, fd, ef->want);
+	}
+
+	ep->dirtycount = 0;
+}
+
+/*
+ * Wait for I/O, the return value and signal handling are the same as
+ * ppoll(). Only the ready array is touched: this runs without the
+ * event_loop mutex.
+ */
+static int event_epoll_wait(struct event_loop *m, int timeout,
+			    const sigset_t *sigmask)
+{
+	struct event_epoll *ep = m->handler.epoll;
+	struct epoll_event events[EVENT_EPOLL_MAX_EVENTS];
+	unsigned char trash[64];
+	int num, i, n = 0;
+
+	/* Always ready fds are handled right away. */
+	if (ep->nalways)
+		timeout = 0;
+
+	num = epoll_pwait(ep->epfd, events, array_size(events), timeout,
+			  sigmask);
+	if (num <= 0)
+		return num;
+
+	for (i = 0; i < num; i++) {
+		if (events[i].data.fd == m->io_pipe[0]) {
+			while (read(m->io_pipe[0], &trash, sizeof(trash)) > 0)
+				;
+			continue;
+		}
+
+		ep->ready[n].fd = events[i].data.fd;
+		ep->ready[n].revents = 0;
+		if (events[i].events & EPOLLIN)
+			ep->ready[n].revents |= POLLIN;
+		if (events[i].events & EPOLLOUT)
+			ep->ready[n].revents |= POLLOUT;
+		if (events[i].events & EPOLLHUP)
+			ep->ready[n].revents |= POLLHUP;
+		if (events[i].events & EPOLLERR)
+			ep->ready[n].revents |= POLLERR;
+		n++;
+	}
+
+	return n;
+}
+#else
+static struct event_epoll *event_epoll_new(struct event_loop *m)
+{
+	return NULL;
+}
+
+static void event_epoll_sync(struct event_epoll *ep)
+{
+}
+
+static int event_epoll_wait(struct event_loop *m, int timeout,
+			    const sigset_t *sigmask)
+{
+	errno = ENOSYS;
+	return -1;
+}
+#endif /* HAVE_EPOLL */
+
+static void event_epoll_free(struct event_epoll *ep)
+{
+	close(ep->epfd);
+	XFREE(MTYPE_EVENT_POLL, ep->fdstate);
+	XFREE(MTYPE_EVENT_POLL, ep->fds);
+	XFREE(MTYPE_EVENT_POLL, ep->dirty);
+	XFREE(MTYPE_EVENT_MASTER, ep);
+}
+
+/* Number of fds with I/O tasks scheduled. */
+static nfds_t event_io_count(struct event_loop *m)
+{
+	if (m->handler.epoll)
+		return m->handler.epoll->count;
+
+	return m->handler.pfdcount;
+}
+
+static void show_event_poll_fd(struct vty *vty, struct event_loop *m, int fd,
+			       short events)
+{
+	struct event *thread;
+
+	if (events & POLLIN) {
+		thread = m->read[fd];
+
+		if (!thread)
+			vty_out(vty, "ERROR ");
+		else
+			vty_out(vty, "%s ", thread->xref->funcname);
+	} else
+		vty_out(vty, " ");
+
+	if (events & POLLOUT) {
+		thread = m->write[fd];
+
+		if (!thread)
+			vty_out(vty, "ERROR\n");
+		else
+			vty_out(vty, "%s\n", thread->xref->funcname);
+	} else
+		vty_out(vty, "\n");
+}
+
 static void show_event_poll_helper(struct vty *vty, struct event_loop *m)
 {
 	const char *name = m->name ? m->name : "main";
 	char underline[strlen(name) + 1];
-	struct event *thread;
+	struct event_epoll *ep = m->handler.epoll;
 	uint32_t i;
+	int fd;
 
 	memset(underline, '-', sizeof(underline));
 	underline[sizeof(underline) - 1] = '\0';
 
 	vty_out(vty, "\nShowing poll FD's for %s\n", name);
 	vty_out(vty, "----------------------%s\n", underline);
-	vty_out(vty, "Count: %u/%d\n", (uint32_t)m->handler.pfdcount,
+	vty_out(vty, "Backend: %s\n", event_backend_name(m->handler.backend));
+	vty_out(vty, "Count: %u/%d\n", (uint32_t)event_io_count(m),
 		m->fd_limit);
+
+	if (ep) {
+		for (i = 0; i < ep->count; i++) {
+			fd = ep->fds[i];
+			vty_out(vty, "\t%6d fd:%6d events:%2d registered:%2d\t\t",
+				i, fd, ep->fdstate[fd].want,
+				ep->fdstate[fd].reg);
+			show_event_poll_fd(vty, m, fd, ep->fdstate[fd].want);
+		}
+		return;
+	}
+
 	for (i = 0; i < m->handler.pfdcount; i++) {
 		vty_out(vty, "\t%6d fd:%6d events:%2d revents:%2d\t\t", i,
 			m->handler.pfds[i].fd, m->handler.pfds[i].events,
 			m->handler.pfds[i].revents);
-
-		if (m->handler.pfds[i].events & POLLIN) {
-			thread = m->read[m->handler.pfds[i].fd];
-
-			if (!thread)
-				vty_out(vty, "ERROR ");
-			else
-				vty_out(vty, "%s ", thread->xref->funcname);
-		} else
-			vty_out(vty, " ");
-
-		if (m->handler.pfds[i].events & POLLOUT) {
-			thread = m->write[m->handler.pfds[i].fd];
-
-			if (!thread)
-				vty_out(vty, "ERROR\n");
-			else
-				vty_out(vty, "%s\n", thread->xref->funcname);
-		} else
-			vty_out(vty, "\n");
+		show_event_poll_fd(vty, m, m->handler.pfds[i].fd,
+				   m->handler.pfds[i].events);
 	}
 }
 
@@ -470,6 +1025,7 @@ static void show_event_timers_helper(struct vty *vty, struct event_loop *m)
 	const char *name = m->name ? m->name : "main";
 	char underline[strlen(name) + 1];
 	struct event *thread;
+	int level, slot;
 
 	memset(underline, '-', sizeof(underline));
 	underline[sizeof(underline) - 1] = '\0';
@@ -480,6 +1036,16 @@ static void show_event_timers_helper(struct vty *vty, struct event_loop *m)
 	frr_each (event_timer_list, &m->timer, thread) {
 		vty_out(vty, "  %-50s%pTH\n", thread->hist->funcname, thread);
 	}
+
+	if (!m->wheel)
+		return;
+
+	for (level = 0; level < EVENT_WHEEL_LEVELS; level++)
+		for (slot = 0; slot < EVENT_WHEEL_SLOTS; slot++)
+			frr_each (event_wheel_list, &m->wheel->slots[level][slot],
+				  thread)
+				vty_out(vty, "  %-50s%pTH\n",
+					thread->hist->funcname, thread);
 }
 
 DEFPY_NOSH (show_event_timers,
@@ -500,6 +1066,213 @@ DEFPY_NOSH (show_event_timers,
 	return CMD_SUCCESS;
 }
 
+static const char *const event_hist_names[] = { "run", "delay", "late" };
+
+static void event_hist_snapshot(const struct cpu_event_history *a,
+				size_t snap[][EVENT_HIST_BUCKETS])
+{
+	const struct event_histogram *h[] = { &a->run, &a->delay, &a->late };
+	size_t i, j;
+
+	for (i = 0; i < array_size(h); i++)
+		for (j = 0; j < EVENT_HIST_BUCKETS; j++)
+			snap[i][j] = atomic_load_explicit(&h[i]->bucket[j],
+							  memory_order_relaxed);
+}
+
+static unsigned long event_hist_lower(unsigned int b)
+{
+	return b ? 1UL << (b - 1) : 0;
+}
+
+/* Upper bound (usec) of the bucket holding the given percentile. */
+static const char *event_hist_pct(const size_t *b, unsigned int pct,
+				  char *buf, size_t len)
+{
+	size_t total = 0, sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < EVENT_HIST_BUCKETS; i++)
+		total += b[i];
+	if (!total)
+		return "-";
+
+	for (i = 0; i < EVENT_HIST_BUCKETS - 1; i++) {
+		sum += b[i];
+		if (sum * 100 >= total * pct)
+			break;
+	}
+	if (i == EVENT_HIST_BUCKETS - 1)
+		return "inf";
+
+	snprintf(buf, len, "%lu", 1UL << i);
+	return buf;
+}
+
+static void event_hist_print(struct vty *vty, struct event_loop *m)
+{
+	static const unsigned int pcts[] = { 50, 99, 100 };
+	size_t snap[array_size(event_hist_names)][EVENT_HIST_BUCKETS];
+	const char *name = m->name ? m->name : "main";
+	char underline[strlen(name) + 1];
+	struct cpu_event_history *rec;
+	char buf[16];
+	size_t i, j, calls;
+
+	memset(underline, '-', sizeof(underline));
+	underline[sizeof(underline) - 1] = '\0';
+
+	vty_out(vty, "\nShowing latency histograms for pthread %s\n", name);
+	vty_out(vty, "---------------------------------------%s\n",
+		underline);
+	vty_out(vty, "%10s%24s%24s%24s\n", "", "Run (usec):",
+		"Delay (usec):", "Late (usec):");
+	vty_out(vty, "   Invoked");
+	for (i = 0; i < array_size(event_hist_names); i++)
+		vty_out(vty, "     p50     p99     max");
+	vty_out(vty, "  Event\n");
+
+	frr_each (cpu_records, m->cpu_records, rec) {
+		event_hist_snapshot(rec, snap);
+		calls = 0;
+		for (j = 0; j < EVENT_HIST_BUCKETS; j++)
+			calls += snap[0][j];
+		if (!calls)
+			continue;
+
+		vty_out(vty, "%10zu", calls);
+		for (i = 0; i < array_size(event_hist_names); i++)
+			for (j = 0; j < array_size(pcts); j++)
+				vty_out(vty, " %7s",
+					event_hist_pct(snap[i], pcts[j], buf,
+						       sizeof(buf)));
+		vty_out(vty, "  %s\n", rec->funcname);
+	}
+}
+
+/* One line per bucket, "pthread;event;metric;bucket count". */
+static void event_hist_print_folded(struct vty *vty, struct event_loop *m)
+{
+	size_t snap[array_size(event_hist_names)][EVENT_HIST_BUCKETS];
+	const char *name = m->name ? m->name : "main";
+	struct cpu_event_history *rec;
+	size_t i, j;
+
+	frr_each (cpu_records, m->cpu_records, rec) {
+		event_hist_snapshot(rec, snap);
+		for (i = 0; i < array_size(event_hist_names); i++)
+			for (j = 0; j < EVENT_HIST_BUCKETS; j++)
+				if (snap[i][j])
+					vty_out(vty, "%s;%s;%s;%luus %zu\n",
+						name, rec->funcname,
+						event_hist_names[i],
+						event_hist_lower(j),
+						snap[i][j]);
+	}
+}
+
+static void event_hist_json(struct json_object *json, struct event_loop *m)
+{
+	size_t snap[array_size(event_hist_names)][EVENT_HIST_BUCKETS];
+	struct json_object *json_loop, *json_event, *json_hist;
+	struct cpu_event_history *rec;
+	char key[24];
+	size_t i, j;
+
+	json_loop = json_object_new_object();
+	json_object_object_add(json, m->name ? m->name : "main", json_loop);
+
+	frr_each (cpu_records, m->cpu_records, rec) {
+		event_hist_snapshot(rec, snap);
+
+		json_event = json_object_new_object();
+		json_object_object_add(json_loop, rec->funcname, json_event);
+		for (i = 0; i < array_size(event_hist_names); i++) {
+			json_hist = json_object_new_object();
+			json_object_object_add(json_event, event_hist_names[i],
+					       json_hist);
+			for (j = 0; j < EVENT_HIST_BUCKETS; j++) {
+				if (!snap[i][j])
+					continue;
+				snprintf(key, sizeof(key), "%lu",
+					 event_hist_lower(j));
+				json_object_int_add(json_hist, key, snap[i][j]);
+			}
+		}
+	}
+}
+
+DEFPY_NOSH (show_event_histogram,
+            show_event_histogram_cmd,
+            "show event histogram [<folded$folded|json$uj>]",
+            SHOW_STR
+            "Event information\n"
+            "Event latency histograms\n"
+            "Folded stack format, for flame graph tools\n"
+            JSON_STR)
+{
+	struct json_object *json = NULL;
+	struct listnode *node;
+	struct event_loop *m;
+
+	if (uj)
+		json = json_object_new_object();
+
+	frr_with_mutex (&masters_mtx) {
+		for (ALL_LIST_ELEMENTS_RO(masters, node, m)) {
+			frr_with_mutex (&m->mtx) {
+				if (json)
+					event_hist_json(json, m);
+				else if (folded)
+					event_hist_print_folded(vty, m);
+				else
+					event_hist_print(vty, m);
+			}
+		}
+	}
+
+	if (json)
+		return vty_json(vty, json);
+
+	return CMD_SUCCESS;
+}
+
+DEFPY (clear_event_histogram,
+       clear_event_histogram_cmd,
+       "clear event histogram",
+       "Clear stored data in all pthreads\n"
+       "Event information\n"
+       "Event latency histograms\n")
+{
+	struct cpu_event_history *rec;
+	struct listnode *node;
+	struct event_loop *m;
+	size_t i;
+
+	frr_with_mutex (&masters_mtx) {
+		for (ALL_LIST_ELEMENTS_RO(masters, node, m)) {
+			frr_with_mutex (&m->mtx) {
+				frr_each (cpu_records, m->cpu_records, rec) {
+					for (i = 0; i < EVENT_HIST_BUCKETS;
+					     i++) {
+						atomic_store_explicit(
+							&rec->run.bucket[i], 0,
+							memory_order_relaxed);
+						atomic_store_explicit(
+							&rec->delay.bucket[i],
+							0, memory_order_relaxed);
+						atomic_store_explicit(
+							&rec->late.bucket[i], 0,
+							memory_order_relaxed);
+					}
+				}
+			}
+		}
+	}
+
+	return CMD_SUCCESS;
+}
+
 void event_cmd_init(void)
 {
 	install_element(VIEW_NODE, &show_event_cpu_cmd);
@@ -512,6 +1285,8 @@ void event_cmd_init(void)
 	install_element(CONFIG_NODE, &service_walltime_warning_cmd);
 
 	install_element(VIEW_NODE, &show_event_timers_cmd);
+	install_element(VIEW_NODE, &show_event_histogram_cmd);
+	install_element(ENABLE_NODE, &clear_event_histogram_cmd);
 }
 /* CLI end ------------------------------------------------------------------ */
 
@@ -578,6 +1353,8 @@ struct event_loop *event_master_create(const char *name)
 	event_list_init(&rv->ready);
 	event_list_init(&rv->unuse);
 	event_timer_list_init(&rv->timer);
+	if (event_wheel_default)
+		rv->wheel = event_wheel_new();
 
 	/* Initialize event_fetch() settings */
 	rv->spin = true;
@@ -594,13 +1371,24 @@ struct event_loop *event_master_create(const char *name)
 	set_nonblocking(rv->io_pipe[0]);
 	set_nonblocking(rv->io_pipe[1]);
 
-	/* Initialize data structures for poll() */
-	rv->handler.pfdsize = rv->fd_limit;
-	rv->handler.pfdcount = 0;
-	rv->handler.pfds = XCALLOC(MTYPE_EVENT_MASTER,
-				   sizeof(struct pollfd) * rv->handler.pfdsize);
-	rv->handler.copy = XCALLOC(MTYPE_EVENT_MASTER,
-				   sizeof(struct pollfd) * rv->handler.pfdsize);
+	/* Initialize I/O backend, falling back to poll() */
+	if (event_backend_default == EVENT_BACKEND_EPOLL)
+		rv->handler.epoll = event_epoll_new(rv);
+
+	if (rv->handler.epoll)
+		rv->handler.backend = EVENT_BACKEND_EPOLL;
+	else {
+		/* Initialize data structures for poll() */
+		rv->handler.backend = EVENT_BACKEND_POLL;
+		rv->handler.pfdsize = rv->fd_limit;
+		rv->handler.pfdcount = 0;
+		rv->handler.pfds = XCALLOC(MTYPE_EVENT_MASTER,
+					   sizeof(struct pollfd) *
+						   rv->handler.pfdsize);
+		rv->handler.copy = XCALLOC(MTYPE_EVENT_MASTER,
+					   sizeof(struct pollfd) *
+						   rv->handler.pfdsize);
+	}
 
 	/* add to list of threadmasters */
 	frr_with_mutex (&masters_mtx) {
@@ -685,6 +1473,16 @@ void event_master_free(struct event_loop *m)
 	thread_array_free(m, m->write);
 	while ((t = event_timer_list_pop(&m->timer)))
 		thread_free(m, t);
+	if (m->wheel) {
+		int level, slot;
+
+		for (level = 0; level < EVENT_WHEEL_LEVELS; level++)
+			for (slot = 0; slot < EVENT_WHEEL_SLOTS; slot++)
+				while ((t = event_wheel_list_pop(
+						&m->wheel->slots[level][slot])))
+					thread_free(m, t);
+		event_wheel_free(m->wheel);
+	}
 	thread_list_free(m, &m->event);
 	thread_list_free(m, &m->ready);
 	thread_list_free(m, &m->unuse);
@@ -700,6 +1498,8 @@ void event_master_free(struct event_loop *m)
 	cpu_records_fini(m->cpu_records);
 
 	XFREE(MTYPE_EVENT_MASTER, m->name);
+	if (m->handler.epoll)
+		event_epoll_free(m->handler.epoll);
 	XFREE(MTYPE_EVENT_MASTER, m->handler.pfds);
 	XFREE(MTYPE_EVENT_MASTER, m->handler.copy);
 	XFREE(MTYPE_EVENT_MASTER, m);
@@ -856,12 +1656,6 @@ static int fd_poll(struct event_loop *m, const struct timeval *timer_wait,
 	rcu_read_unlock();
 	rcu_assert_read_unlocked();
 
-	/* add poll pipe poker */
-	assert(count + 1 < m->handler.pfdsize);
-	m->handler.copy[count].fd = m->io_pipe[0];
-	m->handler.copy[count].events = POLLIN;
-	m->handler.copy[count].revents = 0x00;
-
 	/* We need to deal with a signal-handling race here: we
 	 * don't want to miss a crucial signal, such as SIGTERM or SIGINT,
 	 * that may arrive just before we enter poll(). We will block the
@@ -885,6 +1679,18 @@ static int fd_poll(struct event_loop *m, const struct timeval *timer_wait,
 		pthread_sigmask(SIG_SETMASK, NULL, &origsigs);
 	}
 
+	if (m->handler.epoll) {
+		num = event_epoll_wait(m, timeout, &origsigs);
+		pthread_sigmask(SIG_SETMASK, &origsigs, NULL);
+		goto done;
+	}
+
+	/* add poll pipe poker */
+	assert(count + 1 < m->handler.pfdsize);
+	m->handler.copy[count].fd = m->io_pipe[0];
+	m->handler.copy[count].events = POLLIN;
+	m->handler.copy[count].revents = 0x00;
+
 #if defined(HAVE_PPOLL)
 	struct timespec ts, *tsp;
 
@@ -908,7 +1714,8 @@ done:
 	if (num < 0 && errno == EINTR)
 		*eintr_p = true;
 
-	if (num > 0 && m->handler.copy[count].revents != 0 && num--)
+	if (num > 0 && !m->handler.epoll &&
+	    m->handler.copy[count].revents != 0 && num--)
 		while (read(m->io_pipe[0], &trash, sizeof(trash)) > 0)
 			;
 
@@ -944,6 +1751,17 @@ void _event_add_read_write(const struct xref_eventsched *xref,
 		if (t_ptr && *t_ptr)
 			break;
 
+		if (m->handler.epoll) {
+			thread_array = (dir == EVENT_READ) ? m->read : m->write;
+#ifdef DEV_BUILD
+			if (thread_array[fd])
+				assert(!"Thread already scheduled for file descriptor");
+#endif
+			event_epoll_add(m->handler.epoll, fd,
+					dir == EVENT_READ ? POLLIN : POLLOUT);
+			goto add_thread;
+		}
+
 		/* default to a new pollfd */
 		nfds_t queuepos = m->handler.pfdcount;
 
@@ -983,8 +1801,6 @@ void _event_add_read_write(const struct xref_eventsched *xref,
 		/* make sure we have room for this fd + pipe poker fd */
 		assert(queuepos + 1 < m->handler.pfdsize);
 
-		thread = thread_get(m, dir, func, arg, xref);
-
 		m->handler.pfds[queuepos].fd = fd;
 		m->handler.pfds[queuepos].events |=
 			(dir == EVENT_READ ? POLLIN : POLLOUT);
@@ -992,6 +1808,9 @@ void _event_add_read_write(const struct xref_eventsched *xref,
 		if (queuepos == m->handler.pfdcount)
 			m->handler.pfdcount++;
 
+add_thread:
+		thread = thread_get(m, dir, func, arg, xref);
+
 		if (thread) {
 			frr_with_mutex (&thread->mtx) {
 				thread->u.fd = fd;
@@ -1016,6 +1835,7 @@ static void _event_add_timer_timeval(const struct xref_eventsched *xref,
 {
 	struct event *thread;
 	struct timeval t;
+	bool first;
 
 	assert(m != NULL);
 
@@ -1038,7 +1858,13 @@ static void _event_add_timer_timeval(const struct xref_eventsched *xref,
 
 		frr_with_mutex (&thread->mtx) {
 			thread->u.sands = t;
-			event_timer_list_add(&m->timer, thread);
+			if (!m->wheel ||
+			    !event_wheel_add(m->wheel, thread, time_relative,
+					     &first)) {
+				event_timer_list_add(&m->timer, thread);
+				first = (event_timer_list_first(&m->timer) ==
+					 thread);
+			}
 			if (t_ptr) {
 				*t_ptr = thread;
 				thread->ref = t_ptr;
@@ -1049,7 +1875,7 @@ static void _event_add_timer_timeval(const struct xref_eventsched *xref,
 		 * might change the time we'll wait for, give the pthread
 		 * a chance to re-compute.
 		 */
-		if (event_timer_list_first(&m->timer) == thread)
+		if (first)
 			AWAKEN(m);
 	}
 #define ONEYEAR2SEC (60 * 60 * 24 * 365)
@@ -1120,6 +1946,7 @@ void _event_add_event(const struct xref_eventsched *xref, struct event_loop *m,
 		thread = thread_get(m, EVENT_EVENT, func, arg, xref);
 		frr_with_mutex (&thread->mtx) {
 			thread->u.val = val;
+			monotime(&thread->ready);
 			event_list_add_tail(&m->event, thread);
 		}
 
@@ -1159,8 +1986,10 @@ static void event_cancel_rw(struct event_loop *master, int fd, short state,
 	/* Cancel POLLHUP too just in case some bozo set it */
 	state |= POLLHUP;
 
-	/* Some callers know the index of the pfd already */
-	if (idx_hint >= 0) {
+	if (master->handler.epoll)
+		found = event_epoll_del(master->handler.epoll, fd, state);
+	else if (idx_hint >= 0) {
+		/* Some callers know the index of the pfd already */
 		i = idx_hint;
 		found = true;
 	} else {
@@ -1180,6 +2009,9 @@ static void event_cancel_rw(struct event_loop *master, int fd, short state,
 		return;
 	}
 
+	if (master->handler.epoll)
+		return;
+
 	/* NOT out event. */
 	master->handler.pfds[i].events &= ~(state);
 
@@ -1212,6 +2044,40 @@ static void event_cancel_rw(struct event_loop *master, int fd, short state,
 	}
 }
 
+/* Cancel I/O tasks matching an argument, epoll flavor. */
+static void event_epoll_cancel_arg(struct event_loop *master, void *arg)
+{
+	struct event_epoll *ep = master->handler.epoll;
+	struct event *t;
+	nfds_t i;
+	int fd;
+
+	for (i = 0; i < ep->count;) {
+		fd = ep->fds[i];
+
+		if (ep->fdstate[fd].want & POLLIN)
+			t = master->read[fd];
+		else
+			t = master->write[fd];
+
+		if (!t || t->arg != arg) {
+			i++;
+			continue;
+		}
+
+		/* This moves another fd to position 'i' */
+		event_cancel_rw(master, fd, ep->fdstate[fd].want, -1);
+
+		master->read[fd] = NULL;
+		master->write[fd] = NULL;
+
+		if (t->ref)
+			*t->ref = NULL;
+
+		thread_add_unuse(master, t);
+	}
+}
+
 /*
  * Process task cancellation given a task argument: iterate through the
  * various lists of tasks, looking for any that match the argument.
@@ -1252,6 +2118,9 @@ static void cancel_arg_helper(struct event_loop *master,
 		return;
 
 	/* Check the io tasks */
+	if (master->handler.epoll)
+		event_epoll_cancel_arg(master, cr->eventobj);
+
 	for (i = 0; i < master->handler.pfdcount;) {
 		pfd = master->handler.pfds + i;
 
@@ -1307,6 +2176,27 @@ static void cancel_arg_helper(struct event_loop *master,
 
 		t = t_next;
 	}
+
+	if (!master->wheel)
+		return;
+
+	for (int level = 0; level < EVENT_WHEEL_LEVELS; level++) {
+		for (int slot = 0; slot < EVENT_WHEEL_SLOTS; slot++) {
+			if (!(master->wheel->occupied[level] & (1ULL << slot)))
+				continue;
+
+			frr_each_safe (event_wheel_list,
+				       &master->wheel->slots[level][slot], t) {
+				if (t->arg != cr->eventobj)
+					continue;
+
+				event_wheel_del(master->wheel, t);
+				if (t->ref)
+					*t->ref = NULL;
+				thread_add_unuse(master, t);
+			}
+		}
+	}
 }
 
 /**
@@ -1361,7 +2251,7 @@ static void do_event_cancel(struct event_loop *master)
 			thread_array = master->write;
 			break;
 		case EVENT_TIMER:
-			event_timer_list_del(&master->timer, thread);
+			event_timer_del(master, thread);
 			break;
 		case EVENT_EVENT:
 			list = &master->event;
@@ -1547,13 +2437,23 @@ void event_cancel_async(struct event_loop *master, struct event **thread,
 }
 /* ------------------------------------------------------------------------- */
 
-static struct timeval *thread_timer_wait(struct event_timer_list_head *timers,
+static struct timeval *thread_timer_wait(struct event_loop *m,
 					 struct timeval *timer_val)
 {
-	if (!event_timer_list_count(timers))
-		return NULL;
+	struct event *next_timer = event_timer_list_first(&m->timer);
+	struct timeval next;
 
-	struct event *next_timer = event_timer_list_first(timers);
+	if (m->wheel && m->wheel->count) {
+		next.tv_sec = m->wheel->next / 1000;
+		next.tv_usec = (m->wheel->next % 1000) * 1000;
+		if (!next_timer || timercmp(&next, &next_timer->u.sands, <)) {
+			monotime_until(&next, timer_val);
+			return timer_val;
+		}
+	}
+
+	if (!next_timer)
+		return NULL;
 
 	monotime_until(&next_timer->u.sands, timer_val);
 	return timer_val;
@@ -1567,11 +2467,36 @@ static struct event *thread_run(struct event_loop *m, struct event *thread,
 	return fetch;
 }
 
-static int thread_process_io_helper(struct event_loop *m, struct event *thread,
-				    short state, short actual_state, int pos)
+/* Move an I/O task whose fd is ready to the ready list. */
+static int thread_io_ready(struct event_loop *m, struct event *thread, int fd,
+			   short actual_state)
 {
 	struct event **thread_array;
 
+	if (!thread) {
+		if ((actual_state & (POLLHUP|POLLIN)) != POLLHUP)
+			flog_err(EC_LIB_NO_THREAD,
+				 "Attempting to process an I/O event but for fd: %d(%d) no thread to handle this!",
+				 fd, actual_state);
+		return 0;
+	}
+
+	if (thread->type == EVENT_READ)
+		thread_array = m->read;
+	else
+		thread_array = m->write;
+
+	thread_array[thread->u.fd] = NULL;
+	thread->ready = m->last_poll;
+	event_list_add_tail(&m->ready, thread);
+	thread->type = EVENT_READY;
+
+	return 1;
+}
+
+static int thread_process_io_helper(struct event_loop *m, struct event *thread,
+				    short state, short actual_state, int pos)
+{
 	/*
 	 * poll() clears the .events field, but the pollfd array we
 	 * pass to poll() is a copy of the one used to schedule threads.
@@ -1591,24 +2516,8 @@ static int thread_process_io_helper(struct event_loop *m, struct event *thread,
 	if (m->handler.pfds[pos].events == 0)
 		m->handler.pfds[pos].fd = -1;
 
-	if (!thread) {
-		if ((actual_state & (POLLHUP|POLLIN)) != POLLHUP)
-			flog_err(EC_LIB_NO_THREAD,
-				 "Attempting to process an I/O event but for fd: %d(%d) no thread to handle this!",
-				 m->handler.pfds[pos].fd, actual_state);
-		return 0;
-	}
-
-	if (thread->type == EVENT_READ)
-		thread_array = m->read;
-	else
-		thread_array = m->write;
-
-	thread_array[thread->u.fd] = NULL;
-	event_list_add_tail(&m->ready, thread);
-	thread->type = EVENT_READY;
-
-	return 1;
+	return thread_io_ready(m, thread, m->handler.pfds[pos].fd,
+			       actual_state);
 }
 
 static inline void thread_process_io_inner_loop(struct event_loop *m,
@@ -1693,11 +2602,143 @@ static void thread_process_io(struct event_loop *m, unsigned int num)
 	m->last_read++;
 }
 
+/* Process I/O events reported by epoll, see thread_process_io(). */
+static void event_epoll_process(struct event_loop *m, int num)
+{
+	struct event_epoll *ep = m->handler.epoll;
+	struct event_epoll_fd *ef;
+	short revents;
+	nfds_t i;
+	int fd;
+
+	for (i = 0; i < (nfds_t)num; i++) {
+		fd = ep->ready[i].fd;
+		revents = ep->ready[i].revents;
+		ef = &ep->fdstate[fd];
+
+		/*
+		 * Tasks may have been canceled while we were waiting; the
+		 * registration is then dropped by the next sync.
+		 */
+		if ((revents & (POLLIN | POLLHUP | POLLERR)) &&
+		    (ef->want & POLLIN)) {
+			event_epoll_del(ep, fd, POLLIN);
+			thread_io_ready(m, m->read[fd], fd, revents);
+		}
+		if ((revents & POLLOUT) && (ef->want & POLLOUT)) {
+			event_epoll_del(ep, fd, POLLOUT);
+			thread_io_ready(m, m->write[fd], fd, revents);
+		}
+	}
+
+	/* Always ready fds: run all their tasks, which drops them. */
+	for (i = 0; ep->nalways && i < ep->count;) {
+		fd = ep->fds[i];
+		ef = &ep->fdstate[fd];
+		if (!ef->always) {
+			i++;
+			continue;
+		}
+
+		if (ef->want & POLLIN) {
+			event_epoll_del(ep, fd, POLLIN);
+			thread_io_ready(m, m->read[fd], fd, POLLIN);
+		}
+		if (ef->want & POLLOUT) {
+			event_epoll_del(ep, fd, POLLOUT);
+			thread_io_ready(m, m->write[fd], fd, POLLOUT);
+		}
+	}
+}
+
+/* Move a timer that has popped to the ready list. */
+static void thread_timer_ready(struct event_loop *m, struct event *thread,
+			       struct timeval *timenow, bool *displayed)
+{
+	struct timeval prev = thread->u.sands;
+
+	prev.tv_sec += 4;
+	/*
+	 * If the timer would have popped 4 seconds in the
+	 * past then we are in a situation where we are
+	 * really getting behind on handling of events.
+	 * Let's log it and do the right thing with it.
+	 */
+	if (timercmp(timenow, &prev, >)) {
+		atomic_fetch_add_explicit(&thread->hist->total_starv_warn, 1,
+					  memory_order_seq_cst);
+		if (!*displayed && !thread->ignore_timer_late) {
+			flog_warn(
+				EC_LIB_STARVE_THREAD,
+				"Thread Starvation: %pTHD was scheduled to pop greater than 4s ago",
+				thread);
+			*displayed = true;
+		}
+	}
+
+	thread->type = EVENT_READY;
+	thread->ready = *timenow;
+	event_list_add_tail(&m->ready, thread);
+}
+
+/* Advance the timing wheel to the current time, expiring timers. */
+static unsigned int event_wheel_expire(struct event_loop *m,
+				       struct timeval *timenow, bool *displayed)
+{
+	struct event_wheel *w = m->wheel;
+	uint64_t target = event_wheel_msec(timenow, false);
+	struct event_wheel_list_head *head;
+	struct event *thread;
+	unsigned int ready = 0;
+	uint64_t expiry;
+	int level, slot;
+
+	if (target < w->next) {
+		w->now = MAX(w->now, target);
+		return 0;
+	}
+
+	while (w->now < target) {
+		/* Skip ahead to the next slot with timers. */
+		w->now = MIN(event_wheel_next(w), target);
+
+		/* Empty the slots starting now, top level first. */
+		for (level = EVENT_WHEEL_LEVELS - 1; level >= 0; level--) {
+			if (w->now & ((1ULL << (level * EVENT_WHEEL_BITS)) - 1))
+				continue;
+
+			slot = (w->now >> (level * EVENT_WHEEL_BITS)) &
+			       (EVENT_WHEEL_SLOTS - 1);
+			if (!(w->occupied[level] & (1ULL << slot)))
+				continue;
+
+			w->occupied[level] &= ~(1ULL << slot);
+			head = &w->slots[level][slot];
+			while ((thread = event_wheel_list_pop(head))) {
+				expiry = event_wheel_msec(&thread->u.sands,
+							  true);
+				if (expiry > w->now) {
+					event_wheel_insert(w, thread, expiry);
+					continue;
+				}
+
+				thread->wheel_pos = 0;
+				w->count--;
+				thread_timer_ready(m, thread, timenow,
+						   displayed);
+				ready++;
+			}
+		}
+	}
+
+	w->next = event_wheel_next(w);
+	return ready;
+}
+
 /* Add all timers that have popped to the ready list. */
 static unsigned int thread_process_timers(struct event_loop *m,
 					  struct timeval *timenow)
 {
-	struct timeval prev = *timenow;
 	bool displayed = false;
 	struct event *thread;
 	unsigned int ready = 0;
@@ -1705,33 +2746,15 @@ static unsigned int thread_process_timers(struct event_loop *m,
 	while ((thread = event_timer_list_first(&m->timer))) {
 		if (timercmp(timenow, &thread->u.sands, <))
 			break;
-		prev = thread->u.sands;
-		prev.tv_sec += 4;
-		/*
-		 * If the timer would have popped 4 seconds in the
-		 * past then we are in a situation where we are
-		 * really getting behind on handling of events.
-		 * Let's log it and do the right thing with it.
-		 */
-		if (timercmp(timenow, &prev, >)) {
-			atomic_fetch_add_explicit(
-				&thread->hist->total_starv_warn, 1,
-				memory_order_seq_cst);
-			if (!displayed && !thread->ignore_timer_late) {
-				flog_warn(
-					EC_LIB_STARVE_THREAD,
-					"Thread Starvation: %pTHD was scheduled to pop greater than 4s ago",
-					thread);
-				displayed = true;
-			}
-		}
 
 		event_timer_list_pop(&m->timer);
-		thread->type = EVENT_READY;
-		event_list_add_tail(&m->ready, thread);
+		thread_timer_ready(m, thread, timenow, &displayed);
 		ready++;
 	}
 
+	if (m->wheel)
+		ready += event_wheel_expire(m, timenow, &displayed);
+
 	return ready;
 }
 
@@ -1812,13 +2835,13 @@ struct event *event_fetch(struct event_loop *m, struct event *fetch)
 		 * once per loop to avoid starvation by events
 		 */
 		if (!event_list_count(&m->ready))
-			tw = thread_timer_wait(&m->timer, &tv);
+			tw = thread_timer_wait(m, &tv);
 
 		if (event_list_count(&m->ready) ||
 		    (tw && !timercmp(tw, &zerotime, >)))
 			tw = &zerotime;
 
-		if (!tw && m->handler.pfdcount == 0) { /* die */
+		if (!tw && event_io_count(m) == 0) { /* die */
 			pthread_mutex_unlock(&m->mtx);
 			fetch = NULL;
 			break;
@@ -1826,11 +2849,16 @@ struct event *event_fetch(struct event_loop *m, struct event *fetch)
 
 		/*
 		 * Copy pollfd array + # active pollfds in it. Not necessary to
-		 * copy the array size as this is fixed.
+		 * copy the array size as this is fixed. epoll only needs the
+		 * changes since the last wait.
 		 */
-		m->handler.copycount = m->handler.pfdcount;
-		memcpy(m->handler.copy, m->handler.pfds,
-		       m->handler.copycount * sizeof(struct pollfd));
+		if (m->handler.epoll)
+			event_epoll_sync(m->handler.epoll);
+		else {
+			m->handler.copycount = m->handler.pfdcount;
+			memcpy(m->handler.copy, m->handler.pfds,
+			       m->handler.copycount * sizeof(struct pollfd));
+		}
 
 		pthread_mutex_unlock(&m->mtx);
 		{
@@ -1857,10 +2885,13 @@ struct event *event_fetch(struct event_loop *m, struct event *fetch)
 
 		/* Post timers to ready queue. */
 		monotime(&now);
+		m->last_poll = now;
 		thread_process_timers(m, &now);
 
 		/* Post I/O to ready queue. */
-		if (num > 0)
+		if (m->handler.epoll)
+			event_epoll_process(m, num);
+		else if (num > 0)
 			thread_process_io(m, num);
 
 		pthread_mutex_unlock(&m->mtx);
@@ -2033,6 +3064,17 @@ void event_call(struct event *thread)
 	atomic_fetch_or_explicit(&thread->hist->types, 1 << thread->add_type,
 				 memory_order_seq_cst);
 
+	/* latency histograms; event_execute() has no queueing to measure */
+	event_histogram_add(&thread->hist->run, walltime);
+	if (timerisset(&thread->ready)) {
+		event_histogram_add_since(&thread->hist->delay, &before.real,
+					  &thread->ready);
+		if (thread->add_type == EVENT_TIMER)
+			event_histogram_add_since(&thread->hist->late,
+						  &thread->ready,
+						  &thread->u.sands);
+	}
+
 	if (suppress_warnings)
 		return;
 
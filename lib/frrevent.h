@@ -42,8 +42,26 @@ struct rusage_t {
 
 PREDECL_LIST(event_list);
 PREDECL_HEAP(event_timer_list);
+PREDECL_DLIST(event_wheel_list);
+
+/* I/O notification mechanism used by an event loop. */
+enum event_backend {
+	/* poll()/ppoll() on the whole set of fds, portable */
+	EVENT_BACKEND_POLL = 0,
+	/* Linux epoll, cost proportional to the active fds only */
+	EVENT_BACKEND_EPOLL,
+};
+
+struct event_epoll;
+struct event_wheel;
 
 struct fd_handler {
+	/* backend in use, the fields below are only used by poll() */
+	enum event_backend backend;
+	/* epoll state, if EVENT_BACKEND_EPOLL */
+	struct event_epoll *epoll;
+
+
 	/* number of pfd that fit in the allocated space of pfds. This is a
 	 * constant and is the same for both pfds and copy.
 	 */
@@ -77,6 +95,8 @@ struct event_loop {
 	struct event **read;
 	struct event **write;
 	struct event_timer_list_head timer;
+	/* long timers, if enabled; see event_timer_wheel_set() */
+	struct event_wheel *wheel;
 	struct event_list_head event, ready, unuse;
 	struct list *cancel_req;
 	bool canceled;
@@ -95,6 +115,7 @@ struct event_loop {
 
 	bool ready_run_loop;
 	RUSAGE_T last_getrusage;
+	struct timeval last_poll; /* when poll() last returned */
 };
 
 /* Event types. */
@@ -113,7 +134,10 @@ struct event {
 	enum event_types type;	   /* event type */
 	enum event_types add_type; /* event type */
 	struct event_list_item eventitem;
-	struct event_timer_list_item timeritem;
+	union {
+		struct event_timer_list_item timeritem;
+		struct event_wheel_list_item wheelitem;
+	};
 	struct event **ref;	      /* external reference (if given) */
 	struct event_loop *master;    /* pointer to the struct event_loop */
 	void (*func)(struct event *e); /* event function */
@@ -124,17 +148,29 @@ struct event {
 		struct timeval sands; /* rest of time sands value. */
 	} u;
 	struct timeval real;
+	struct timeval ready;		    /* when it became runnable */
 	struct cpu_event_history *hist;	    /* cache pointer to cpu_history */
 	unsigned long yield;		    /* yield time in microseconds */
 	const struct xref_eventsched *xref; /* origin location */
 	pthread_mutex_t mtx;		    /* mutex for thread.c functions */
 	bool ignore_timer_late;
+	uint16_t wheel_pos;		    /* timer wheel slot + 1, or 0 */
 };
 
 #ifdef _FRR_ATTRIBUTE_PRINTFRR
 #pragma FRR printfrr_ext "%pTH"(struct event *)
 #endif
 
+/*
+ * Latency histogram with log2 buckets: bucket 0 counts values of 0us,
+ * bucket n values in [2^(n-1), 2^n) us, and the last one everything longer.
+ */
+#define EVENT_HIST_BUCKETS 24
+
+struct event_histogram {
+	atomic_size_t bucket[EVENT_HIST_BUCKETS];
+};
+
 struct cpu_event_history {
 	struct cpu_records_item item;
 
@@ -150,6 +186,13 @@ struct cpu_event_history {
 	struct time_stats cpu;
 	atomic_uint_fast32_t types;
 	const char *funcname;
+
+	/* time spent running */
+	struct event_histogram run;
+	/* time from becoming runnable until running */
+	struct event_histogram delay;
+	/* timers only: time from expiry until becoming runnable */
+	struct event_histogram late;
 };
 
 /* Struct timeval's tv_usec one second value.  */
@@ -224,6 +267,11 @@ static inline unsigned long timeval_elapsed(struct timeval a, struct timeval b)
 
 /* Prototypes. */
 extern struct event_loop *event_master_create(const char *name);
+/* Backend used by event loops created from now on, false if unsupported */
+extern bool event_backend_set(const char *name);
+extern const char *event_backend_name(enum event_backend backend);
+/* Keep long timers of event loops created from now on in a timing wheel */
+extern void event_timer_wheel_set(bool enable);
 void event_master_set_name(struct event_loop *master, const char *name);
 extern void event_master_free(struct event_loop *m);
 
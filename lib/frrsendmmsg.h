@@ -21,7 +21,7 @@ struct mmsghdr {
 static inline int sendmmsg(int fd, struct mmsghdr *mmh, unsigned int len,
 			   int flags)
 {
-	int rv = sendmsg(fd, &mmh->msg_hdr, 0);
+	int rv = sendmsg(fd, &mmh->msg_hdr, flags);
 
 	return rv > 0 ? 1 : rv;
 }
@@ -85,13 +85,16 @@ static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 #endif
 			);
 	} else {
-		if (mt->n_max != 0) {
+		struct memtype_stats stats;
+
+		qmem_stats(mt, &stats);
+		if (stats.n_max != 0) {
 			char size[32];
-			snprintf(size, sizeof(size), "%6zu", mt->size);
+			snprintf(size, sizeof(size), "%6zu", stats.size);
 #ifdef HAVE_MALLOC_USABLE_SIZE
 #define TSTR " %9zu"
-#define TARG , mt->total
-#define TARG2 , mt->max_size
+#define TARG , stats.total
+#define TARG2 , stats.max_size
 #else
 #define TSTR ""
 #define TARG
@@ -99,13 +102,13 @@ static int qmem_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 #endif
 			vty_out(vty, "%-30s: %8zu %-8s"TSTR" %8zu"TSTR"\n",
 				mt->name,
-				mt->n_alloc,
-				mt->size == 0 ? ""
-					      : mt->size == SIZE_VAR
-							? "variable"
-							: size
+				stats.n_alloc,
+				stats.size == 0 ? ""
+						: stats.size == SIZE_VAR
+							  ? "variable"
+							  : size
 				TARG,
-				mt->n_max
+				stats.n_max
 				TARG2);
 		}
 	}
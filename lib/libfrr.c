@@ -100,6 +100,9 @@ static void opt_extend(const struct optspec *os)
 #define OPTION_LOGGING   1007
 #define OPTION_LIMIT_FDS 1008
 #define OPTION_SCRIPTDIR 1009
+#define OPTION_EVENT_BACKEND 1010
+#define OPTION_TIMER_WHEEL 1011
+#define OPTION_MEMORY_SLAB 1012
 
 static const struct option lo_always[] = {
 	{ "help", no_argument, NULL, 'h' },
@@ -117,6 +120,9 @@ static const struct option lo_always[] = {
 	{ "log-level", required_argument, NULL, OPTION_LOGLEVEL },
 	{ "command-log-always", no_argument, NULL, OPTION_LOGGING },
 	{ "limit-fds", required_argument, NULL, OPTION_LIMIT_FDS },
+	{ "event-backend", required_argument, NULL, OPTION_EVENT_BACKEND },
+	{ "timer-wheel", no_argument, NULL, OPTION_TIMER_WHEEL },
+	{ "memory-slab", no_argument, NULL, OPTION_MEMORY_SLAB },
 	{ NULL }
 };
 static const struct optspec os_always = {
@@ -134,7 +140,10 @@ static const struct optspec os_always = {
 	"      --scriptdir    Override scripts directory\n"
 	"      --log          Set Logging to stdout, syslog, or file:<name>\n"
 	"      --log-level    Set Logging Level to use, debug, info, warn, etc\n"
-	"      --limit-fds    Limit number of fds supported\n",
+	"      --limit-fds    Limit number of fds supported\n"
+	"      --event-backend  Set I/O event mechanism (poll, epoll)\n"
+	"      --timer-wheel  Keep long timers in a timing wheel\n"
+	"      --memory-slab  Allocate small fixed-size objects from slabs\n",
 	lo_always
 };
 
@@ -635,6 +644,24 @@ static int frr_opt(int opt)
 	case OPTION_LIMIT_FDS:
 		di->limit_fds = strtoul(optarg, &err, 0);
 		break;
+	case OPTION_EVENT_BACKEND:
+		if (!event_backend_set(optarg)) {
+			fprintf(stderr,
+				"unknown or unsupported event backend \"%s\"\n",
+				optarg);
+			errors++;
+		}
+		break;
+	case OPTION_TIMER_WHEEL:
+		event_timer_wheel_set(true);
+		break;
+	case OPTION_MEMORY_SLAB:
+		if (!qmem_slab_enable()) {
+			fprintf(stderr,
+				"slab allocator not supported on this platform\n");
+			errors++;
+		}
+		break;
 	default:
 		return 1;
 	}
@@ -1258,6 +1285,8 @@ void frr_fini(void)
 	/* signal_init -> nothing needed */
 	event_master_free(master);
 	master = NULL;
+	/* writer pthread must be gone before rcu_shutdown() */
+	zlog_set_deferred(false);
 	zlog_tls_buffer_fini();
 
 	if (0) {
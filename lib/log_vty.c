@@ -823,6 +823,17 @@ DEFPY (log_immediate_mode,
 	return CMD_SUCCESS;
 }
 
+DEFPY (log_deferred_formatting,
+       log_deferred_formatting_cmd,
+       "[no] log deferred-formatting",
+       NO_STR
+       "Logging control\n"
+       "Format debug and informational messages on a background pthread\n")
+{
+	zlog_set_deferred(!no);
+	return CMD_SUCCESS;
+}
+
 void log_config_write(struct vty *vty)
 {
 	bool show_cmdline_hint = false;
@@ -904,6 +915,8 @@ void log_config_write(struct vty *vty)
 		vty_out(vty, "no log unique-id\n");
 	if (zlog_get_immediate_mode())
 		vty_out(vty, "log immediate-mode\n");
+	if (zlog_get_deferred())
+		vty_out(vty, "log deferred-formatting\n");
 
 	if (logmsgs_with_persist_bt) {
 		struct xrefdata *xrd;
@@ -991,6 +1004,7 @@ void log_cmd_init(void)
 	install_element(CONFIG_NODE, &config_log_filterfile_cmd);
 	install_element(CONFIG_NODE, &no_config_log_filterfile_cmd);
 	install_element(CONFIG_NODE, &log_immediate_mode_cmd);
+	install_element(CONFIG_NODE, &log_deferred_formatting_cmd);
 
 	install_element(ENABLE_NODE, &debug_uid_backtrace_cmd);
 	install_element(CONFIG_NODE, &debug_uid_backtrace_cmd);
@@ -0,0 +1,356 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Read-optimized longest prefix match index for IPv4.
+ */
+
+#include <zebra.h>
+
+#include "lpm.h"
+#include "frratomic.h"
+#include "frrcu.h"
+#include "memory.h"
+#include "table.h"
+
+DEFINE_MTYPE_STATIC(LIB, LPM_INDEX, "LPM index");
+DEFINE_MTYPE_STATIC(LIB, LPM_LEVEL, "LPM index level");
+DEFINE_MTYPE_STATIC(LIB, LPM_LEAF, "LPM index leaf");
+
+#define LPM_STRIDE 8
+#define LPM_SLOTS  (1 << LPM_STRIDE)
+#define LPM_DEPTH  (IPV4_MAX_BITLEN / LPM_STRIDE)
+
+/* slots hold either a leaf pointer (or NULL), or a level pointer | LPM_CHILD */
+#define LPM_CHILD ((uintptr_t)1)
+
+struct lpm_leaf {
+	struct rcu_head rcu;
+	uint8_t prefixlen;
+	void *value;
+};
+
+struct lpm_level {
+	struct rcu_head rcu;
+
+	/* writer side: shortest prefix in this level or below, and whether
+	 * any slot is empty, so updates can skip levels they don't affect
+	 */
+	uint8_t minlen;
+	bool empty;
+
+	atomic_uintptr_t slot[LPM_SLOTS];
+};
+
+struct lpm_index {
+	struct lpm_level root;
+
+	/* writer side: the prefixes themselves, info is the lpm_leaf */
+	struct route_table *prefixes;
+	unsigned long count;
+};
+
+static inline struct lpm_level *lpm_child(uintptr_t entry)
+{
+	return (entry & LPM_CHILD) ? (struct lpm_level *)(entry & ~LPM_CHILD)
+				   : NULL;
+}
+
+static inline uintptr_t lpm_load(const atomic_uintptr_t *slot)
+{
+	/* pairs with the release stores below, so readers see the contents
+	 * of a level or leaf before its pointer
+	 */
+	return atomic_load_explicit(slot, memory_order_acquire);
+}
+
+static inline void lpm_store(atomic_uintptr_t *slot, uintptr_t entry)
+{
+	atomic_store_explicit(slot, entry, memory_order_release);
+}
+
+struct lpm_index *lpm_index_new(void)
+{
+	struct lpm_index *idx;
+
+	idx = XCALLOC(MTYPE_LPM_INDEX, sizeof(*idx));
+	idx->prefixes = route_table_init();
+	return idx;
+}
+
+static void lpm_level_free(struct lpm_level *level)
+{
+	struct lpm_level *child;
+	unsigned int i;
+
+	for (i = 0; i < LPM_SLOTS; i++) {
+		child = lpm_child(lpm_load(&level->slot[i]));
+		if (child) {
+			lpm_level_free(child);
+			rcu_free(MTYPE_LPM_LEVEL, child, rcu);
+		}
+	}
+}
+
+void lpm_index_free(struct lpm_index **idxp)
+{
+	struct lpm_index *idx = *idxp;
+	struct route_node *rn;
+	struct lpm_leaf *leaf;
+
+	if (!idx)
+		return;
+
+	lpm_level_free(&idx->root);
+
+	for (rn = route_top(idx->prefixes); rn; rn = route_next(rn)) {
+		leaf = rn->info;
+		if (!leaf)
+			continue;
+		rn->info = NULL;
+		route_unlock_node(rn);
+		rcu_free(MTYPE_LPM_LEAF, leaf, rcu);
+	}
+	route_table_finish(idx->prefixes);
+
+	/* concurrent lookups may still be looking at the root */
+	rcu_free(MTYPE_LPM_INDEX, idx, root.rcu);
+	*idxp = NULL;
+}
+
+static void lpm_level_update(struct lpm_level *level)
+{
+	const struct lpm_leaf *leaf;
+	struct lpm_level *child;
+	uintptr_t entry;
+	unsigned int i;
+
+	level->minlen = UINT8_MAX;
+	level->empty = false;
+
+	for (i = 0; i < LPM_SLOTS; i++) {
+		entry = lpm_load(&level->slot[i]);
+		child = lpm_child(entry);
+		leaf = (const struct lpm_leaf *)entry;
+
+		if (child) {
+			level->minlen = MIN(level->minlen, child->minlen);
+			level->empty |= child->empty;
+		} else if (leaf)
+			level->minlen = MIN(level->minlen, leaf->prefixlen);
+		else
+			level->empty = true;
+	}
+}
+
+static bool lpm_level_skip(const struct lpm_level *level,
+			   const struct lpm_leaf *old,
+			   const struct lpm_leaf *new)
+{
+	if (old)
+		return level->minlen > old->prefixlen;
+	return !level->empty && level->minlen > new->prefixlen;
+}
+
+/*
+ * Put new into the slots, and all levels below them, that hold old - or,
+ * if old is NULL, that hold nothing or a prefix no longer than new's.
+ */
+static void lpm_fill(atomic_uintptr_t *slot, unsigned int n,
+		     const struct lpm_leaf *old, struct lpm_leaf *new)
+{
+	const struct lpm_leaf *cur;
+	struct lpm_level *child;
+	uintptr_t entry;
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		entry = lpm_load(&slot[i]);
+		child = lpm_child(entry);
+		if (child) {
+			if (!lpm_level_skip(child, old, new)) {
+				lpm_fill(child->slot, LPM_SLOTS, old, new);
+				lpm_level_update(child);
+			}
+			continue;
+		}
+
+		cur = (const struct lpm_leaf *)entry;
+		if (old ? cur == old
+			: (!cur || cur->prefixlen <= new->prefixlen))
+			lpm_store(&slot[i], (uintptr_t)new);
+	}
+}
+
+/* Replace levels that have become uniform by a single slot, bottom-up. */
+static void lpm_collapse(atomic_uintptr_t **path, struct lpm_level **levels,
+			 unsigned int depth)
+{
+	struct lpm_level *level;
+	uintptr_t entry;
+	unsigned int i;
+
+	while (depth--) {
+		level = levels[depth];
+		entry = lpm_load(&level->slot[0]);
+		if (lpm_child(entry))
+			return;
+		for (i = 1; i < LPM_SLOTS; i++)
+			if (lpm_load(&level->slot[i]) != entry)
+				return;
+
+		lpm_store(path[depth], entry);
+		rcu_free(MTYPE_LPM_LEVEL, level, rcu);
+	}
+}
+
+/*
+ * Find the slots at the prefix's depth, creating levels on the way if
+ * create is set.  path/levels record the slots and levels passed through
+ * below the root.  Returns NULL if the levels don't exist.
+ */
+static atomic_uintptr_t *lpm_slots(struct lpm_index *idx,
+				   const struct prefix *p, bool create,
+				   unsigned int *n, atomic_uintptr_t **path,
+				   struct lpm_level **levels,
+				   unsigned int *depth)
+{
+	const uint8_t *addr = (const uint8_t *)&p->u.prefix4;
+	unsigned int target = p->prefixlen ? (p->prefixlen - 1) / LPM_STRIDE
+					   : 0;
+	struct lpm_level *level = &idx->root, *child;
+	atomic_uintptr_t *slot;
+	uintptr_t entry;
+	unsigned int d, i;
+
+	for (d = 0; d < target; d++) {
+		slot = &level->slot[addr[d]];
+		entry = lpm_load(slot);
+		child = lpm_child(entry);
+		if (!child) {
+			if (!create)
+				return NULL;
+
+			/* push the covering prefix down into the new level */
+			child = XCALLOC(MTYPE_LPM_LEVEL, sizeof(*child));
+			for (i = 0; i < LPM_SLOTS; i++)
+				atomic_store_explicit(&child->slot[i], entry,
+						      memory_order_relaxed);
+			lpm_level_update(child);
+			lpm_store(slot, (uintptr_t)child | LPM_CHILD);
+		}
+		path[d] = slot;
+		levels[d] = child;
+		level = child;
+	}
+	*depth = target;
+
+	*n = 1U << ((target + 1) * LPM_STRIDE - p->prefixlen);
+	return &level->slot[addr[target] & ~(*n - 1)];
+}
+
+void lpm_index_set(struct lpm_index *idx, const struct prefix *p,
+		   void *value)
+{
+	atomic_uintptr_t *path[LPM_DEPTH], *slot;
+	struct lpm_level *levels[LPM_DEPTH];
+	struct lpm_leaf *leaf, *old;
+	struct prefix pm;
+	struct route_node *rn;
+	unsigned int n, depth;
+
+	assert(p->family == AF_INET && value);
+
+	prefix_copy(&pm, p);
+	apply_mask(&pm);
+
+	rn = route_node_get(idx->prefixes, &pm);
+	old = rn->info;
+	if (old)
+		route_unlock_node(rn);
+	else
+		idx->count++;
+
+	leaf = XCALLOC(MTYPE_LPM_LEAF, sizeof(*leaf));
+	leaf->prefixlen = pm.prefixlen;
+	leaf->value = value;
+	rn->info = leaf;
+
+	slot = lpm_slots(idx, &pm, true, &n, path, levels, &depth);
+	lpm_fill(slot, n, NULL, leaf);
+	while (depth--)
+		lpm_level_update(levels[depth]);
+
+	if (old)
+		rcu_free(MTYPE_LPM_LEAF, old, rcu);
+}
+
+void lpm_index_unset(struct lpm_index *idx, const struct prefix *p)
+{
+	atomic_uintptr_t *path[LPM_DEPTH], *slot;
+	struct lpm_level *levels[LPM_DEPTH];
+	struct lpm_leaf *old, *cover = NULL;
+	struct route_node *rn, *up;
+	struct prefix pm;
+	unsigned int n, depth, i;
+
+	assert(p->family == AF_INET);
+
+	prefix_copy(&pm, p);
+	apply_mask(&pm);
+
+	rn = route_node_lookup(idx->prefixes, &pm);
+	if (!rn)
+		return;
+	route_unlock_node(rn);
+
+	old = rn->info;
+	if (!old)
+		return;
+
+	/* slots that held this prefix go to the next shorter one */
+	for (up = rn->parent; up; up = up->parent)
+		if (up->info) {
+			cover = up->info;
+			break;
+		}
+
+	rn->info = NULL;
+	route_unlock_node(rn);
+	idx->count--;
+
+	slot = lpm_slots(idx, &pm, false, &n, path, levels, &depth);
+	if (slot) {
+		lpm_fill(slot, n, old, cover);
+		for (i = depth; i--;)
+			lpm_level_update(levels[i]);
+		lpm_collapse(path, levels, depth);
+	}
+
+	rcu_free(MTYPE_LPM_LEAF, old, rcu);
+}
+
+unsigned long lpm_index_count(const struct lpm_index *idx)
+{
+	return idx->count;
+}
+
+void *lpm_index_match_ipv4(const struct lpm_index *idx,
+			   const struct in_addr *addr)
+{
+	const uint8_t *bytes = (const uint8_t *)addr;
+	const struct lpm_level *level = &idx->root;
+	const struct lpm_leaf *leaf;
+	uintptr_t entry;
+	unsigned int d = 0;
+
+	rcu_assert_read_locked();
+
+	while (true) {
+		entry = lpm_load(&level->slot[bytes[d++]]);
+		if (!(entry & LPM_CHILD))
+			break;
+		level = (const struct lpm_level *)(entry & ~LPM_CHILD);
+	}
+
+	leaf = (const struct lpm_leaf *)entry;
+	return leaf ? leaf->value : NULL;
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Read-optimized longest prefix match index for IPv4.
+ */
+
+#ifndef _FRR_LPM_H
+#define _FRR_LPM_H
+
+#include "prefix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * An lpm_index maps IPv4 prefixes to opaque values, like a route_table
+ * with only route_node_match(), but laid out for lookups: a multibit trie
+ * with 8-bit strides and prefixes expanded into every slot they cover, so
+ * a lookup is at most four dependent loads instead of a walk down the
+ * radix tree.
+ *
+ * The index is meant to be kept next to a route_table, by the code that
+ * owns the table: call lpm_index_set() when a prefix becomes a match
+ * candidate and lpm_index_unset() when it stops being one.  Updates must
+ * come from one pthread at a time.  Lookups may run concurrently on any
+ * pthread holding the RCU read lock, without any further locking; a
+ * lookup racing an update returns either the old or the new result.
+ * The values themselves are not protected, they must stay valid for as
+ * long as readers might use them.
+ *
+ * Each populated /16 costs a 2kB slot array, so expect the index to take
+ * about as much memory as the table it mirrors.
+ */
+struct lpm_index;
+
+extern struct lpm_index *lpm_index_new(void);
+extern void lpm_index_free(struct lpm_index **idxp);
+
+/* Add a prefix, or change its value.  value must not be NULL. */
+extern void lpm_index_set(struct lpm_index *idx, const struct prefix *p,
+			  void *value);
+extern void lpm_index_unset(struct lpm_index *idx, const struct prefix *p);
+
+/* Number of prefixes in the index. */
+extern unsigned long lpm_index_count(const struct lpm_index *idx);
+
+/* Value of the longest prefix covering addr, or NULL.  Needs RCU. */
+extern void *lpm_index_match_ipv4(const struct lpm_index *idx,
+				  const struct in_addr *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_LPM_H */
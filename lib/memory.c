@@ -15,6 +15,7 @@
 #ifdef HAVE_MALLOC_MALLOC_H
 #include <malloc/malloc.h>
 #endif
+#include <sys/mman.h>
 
 #include "memory.h"
 #include "log.h"
@@ -28,6 +29,30 @@ DEFINE_MTYPE(LIB, TMP, "Temporary memory");
 DEFINE_MTYPE(LIB, TMP_TTABLE, "Temporary memory for TTABLE");
 DEFINE_MTYPE(LIB, BITFIELD, "Bitfield memory");
 
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+static inline void mt_count_size(struct memtype *mt, size_t size)
+{
+	size_t oldsize;
+
+	oldsize = atomic_load_explicit(&mt->size, memory_order_relaxed);
+	if (oldsize == 0)
+		oldsize = atomic_exchange_explicit(&mt->size, size,
+						   memory_order_relaxed);
+	if (oldsize != 0 && oldsize != size && oldsize != SIZE_VAR)
+		atomic_store_explicit(&mt->size, SIZE_VAR,
+				      memory_order_relaxed);
+}
+
 static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 {
 	size_t current;
@@ -44,13 +69,7 @@ static inline void mt_count_alloc(struct memtype *mt, size_t size, void *ptr)
 						      memory_order_relaxed,
 						      memory_order_relaxed);
 
-	oldsize = atomic_load_explicit(&mt->size, memory_order_relaxed);
-	if (oldsize == 0)
-		oldsize = atomic_exchange_explicit(&mt->size, size,
-						   memory_order_relaxed);
-	if (oldsize != 0 && oldsize != size && oldsize != SIZE_VAR)
-		atomic_store_explicit(&mt->size, SIZE_VAR,
-				      memory_order_relaxed);
+	mt_count_size(mt, size);
 
 #ifdef HAVE_MALLOC_USABLE_SIZE
 	size_t mallocsz = malloc_usable_size(ptr);
@@ -96,18 +115,432 @@ static inline void *mt_checkalloc(struct memtype *mt, void *ptr, size_t size)
 	return ptr;
 }
 
+/*
+ * Slab allocator for DEFINE_MTYPE_SLAB memtypes
+ *
+ * Off unless qmem_slab_enable() is called.  A large range of address space
+ * is reserved up front and made accessible in chunks; each chunk holds
+ * objects of a single memtype, all of the size first allocated for that
+ * memtype (other sizes still go to malloc).  Every pthread keeps a short
+ * free list per slab and trades batches of objects with the slab's depot,
+ * so allocating and freeing usually takes no lock and writes no shared
+ * cache line.  For the same reason the objects are counted per pthread,
+ * and the counters are only added up by qmem_stats().
+ *
+ * Chunks are never given back to the system, freed objects are reused for
+ * the same memtype.  A pointer belongs to the slab allocator if it lies in
+ * the reserved range; the chunk header tells which slab it is from.
+ */
+#if UINTPTR_MAX > 0xffffffffUL
+#define MSLAB_ARENA_SIZE	(64ULL << 30)
+#else
+#define MSLAB_ARENA_SIZE	0ULL
+#endif
+#define MSLAB_CHUNK_SIZE	(256U << 10)
+#define MSLAB_CHUNK_HDR		64U
+#define MSLAB_MAX_SIZE		1024U
+#define MSLAB_MAX		64
+#define MSLAB_BATCH		32
+#define MSLAB_CACHE_MAX		(2 * MSLAB_BATCH)
+
+struct mslab {
+	struct memtype *mt;
+	unsigned int id;
+	size_t size;
+	size_t objsize;
+
+	pthread_mutex_t mtx;
+	/* free objects handed back by pthreads, singly linked */
+	void *depot;
+	/* unused rest of the newest chunk */
+	char *carve, *carve_end;
+
+	/* objects carved from chunks, i.e. the most ever in use */
+	atomic_size_t carved;
+	/* counters of pthreads that have exited; protected by mslab_mtx */
+	size_t exited_allocs, exited_frees;
+};
+
+struct mslab_cache {
+	void *free;
+	unsigned int nfree;
+
+	/* only ever incremented, and only by the owning pthread */
+	atomic_size_t allocs, frees;
+};
+
+struct mslab_thread {
+	struct mslab_thread *next;
+	struct mslab_cache cache[MSLAB_MAX];
+};
+
+/* set up before any pthreads are started, read-only afterwards */
+static bool mslab_enabled;
+static char *mslab_arena;
+static pthread_key_t mslab_key;
+
+static atomic_size_t mslab_arena_used;
+
+/* protects the slab table and the list of pthreads */
+static pthread_mutex_t mslab_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct mslab *mslabs[MSLAB_MAX];
+static unsigned int mslab_count;
+static struct mslab_thread *mslab_threads;
+
+/* for memtypes that can't use the slab allocator; matches no size */
+static struct mslab mslab_none = { .size = SIZE_MAX };
+
+static thread_local struct mslab_thread *mslab_self;
+
+static inline bool mslab_owns(const void *ptr)
+{
+	return mslab_arena &&
+	       (uintptr_t)ptr - (uintptr_t)mslab_arena < MSLAB_ARENA_SIZE;
+}
+
+static inline struct mslab *mslab_of(const void *ptr)
+{
+	uintptr_t offset = (uintptr_t)ptr - (uintptr_t)mslab_arena;
+
+	offset &= ~(uintptr_t)(MSLAB_CHUNK_SIZE - 1);
+	return *(struct mslab **)(mslab_arena + offset);
+}
+
+static struct mslab *mslab_new(struct memtype *mt, size_t size)
+{
+	struct mslab *slab;
+
+	pthread_mutex_lock(&mslab_mtx);
+
+	slab = (struct mslab *)atomic_load_explicit(&mt->mslab,
+						    memory_order_acquire);
+	if (slab)
+		goto out;
+
+	if (size == 0 || size > MSLAB_MAX_SIZE || mslab_count == MSLAB_MAX) {
+		slab = &mslab_none;
+	} else {
+		/* lives as long as the arena, not accounted to any mtype */
+		slab = calloc(1, sizeof(*slab));
+		if (!slab)
+			memory_oom(sizeof(*slab), mt->name);
+
+		slab->mt = mt;
+		slab->id = mslab_count;
+		slab->size = size;
+		slab->objsize = (size + 15) & ~(size_t)15;
+		pthread_mutex_init(&slab->mtx, NULL);
+		mslabs[mslab_count++] = slab;
+
+		mt_count_size(mt, size);
+	}
+	atomic_store_explicit(&mt->mslab, (uintptr_t)slab,
+			      memory_order_release);
+out:
+	pthread_mutex_unlock(&mslab_mtx);
+	return slab;
+}
+
+/* The slab to allocate size bytes of mt from, if any. */
+static inline struct mslab *mslab_get(struct memtype *mt, size_t size)
+{
+	struct mslab *slab;
+
+	if (!mt->slab || !mslab_enabled)
+		return NULL;
+
+	slab = (struct mslab *)atomic_load_explicit(&mt->mslab,
+						    memory_order_acquire);
+	if (unlikely(!slab))
+		slab = mslab_new(mt, size);
+	return slab->size == size ? slab : NULL;
+}
+
+static struct mslab_thread *mslab_thread(void)
+{
+	struct mslab_thread *self = mslab_self;
+
+	if (likely(self))
+		return self;
+
+	self = calloc(1, sizeof(*self));
+	if (!self)
+		memory_oom(sizeof(*self), "slab thread cache");
+
+	pthread_mutex_lock(&mslab_mtx);
+	self->next = mslab_threads;
+	mslab_threads = self;
+	pthread_mutex_unlock(&mslab_mtx);
+
+	pthread_setspecific(mslab_key, self);
+	mslab_self = self;
+	return self;
+}
+
+/* Move the first n objects of a pthread's free list to the depot. */
+static void mslab_flush(struct mslab *slab, struct mslab_cache *cache,
+			unsigned int n)
+{
+	void *first = cache->free, *last = first;
+	unsigned int i;
+
+	for (i = 1; i < n; i++)
+		last = *(void **)last;
+	cache->free = *(void **)last;
+	cache->nfree -= n;
+
+	pthread_mutex_lock(&slab->mtx);
+	*(void **)last = slab->depot;
+	slab->depot = first;
+	pthread_mutex_unlock(&slab->mtx);
+}
+
+static bool mslab_chunk_new(struct mslab *slab)
+{
+	size_t offset;
+	char *chunk;
+
+	offset = atomic_fetch_add_explicit(&mslab_arena_used, MSLAB_CHUNK_SIZE,
+					   memory_order_relaxed);
+	if (offset >= MSLAB_ARENA_SIZE)
+		return false;
+
+	chunk = mslab_arena + offset;
+	if (mprotect(chunk, MSLAB_CHUNK_SIZE, PROT_READ | PROT_WRITE))
+		return false;
+
+	*(struct mslab **)chunk = slab;
+	slab->carve = chunk + MSLAB_CHUNK_HDR;
+	slab->carve_end = chunk + MSLAB_CHUNK_SIZE;
+	return true;
+}
+
+/* Get a batch of objects from the depot, or new ones from a chunk. */
+static bool mslab_refill(struct mslab *slab, struct mslab_cache *cache)
+{
+	unsigned int n = 0, carved = 0;
+	void *obj;
+
+	pthread_mutex_lock(&slab->mtx);
+
+	while (n < MSLAB_BATCH && slab->depot) {
+		obj = slab->depot;
+		slab->depot = *(void **)obj;
+		*(void **)obj = cache->free;
+		cache->free = obj;
+		n++;
+	}
+
+	while (n == 0 && carved < MSLAB_BATCH) {
+		if ((size_t)(slab->carve_end - slab->carve) < slab->objsize &&
+		    !mslab_chunk_new(slab))
+			break;
+
+		obj = slab->carve;
+		slab->carve += slab->objsize;
+		*(void **)obj = cache->free;
+		cache->free = obj;
+		carved++;
+	}
+	if (carved)
+		atomic_fetch_add_explicit(&slab->carved, carved,
+					  memory_order_relaxed);
+
+	pthread_mutex_unlock(&slab->mtx);
+
+	cache->nfree += n + carved;
+	return n + carved > 0;
+}
+
+static inline void mslab_inc(atomic_size_t *counter)
+{
+	atomic_store_explicit(counter,
+			      atomic_load_explicit(counter,
+						   memory_order_relaxed) + 1,
+			      memory_order_relaxed);
+}
+
+static void *mslab_alloc(struct mslab *slab)
+{
+	struct mslab_cache *cache = &mslab_thread()->cache[slab->id];
+	void *obj;
+
+	if (unlikely(!cache->free) && !mslab_refill(slab, cache))
+		/* arena exhausted */
+		return NULL;
+
+	obj = cache->free;
+	cache->free = *(void **)obj;
+	cache->nfree--;
+	mslab_inc(&cache->allocs);
+	return obj;
+}
+
+static void mslab_free(struct mslab *slab, void *obj)
+{
+	struct mslab_cache *cache = &mslab_thread()->cache[slab->id];
+
+	*(void **)obj = cache->free;
+	cache->free = obj;
+	cache->nfree++;
+	mslab_inc(&cache->frees);
+
+	if (unlikely(cache->nfree > MSLAB_CACHE_MAX))
+		mslab_flush(slab, cache, MSLAB_BATCH);
+}
+
+/* pthread_key destructor: return cached objects and keep the counters */
+static void mslab_thread_exit(void *arg)
+{
+	struct mslab_thread *self = arg, **prev;
+	struct mslab_cache *cache;
+	struct mslab *slab;
+	unsigned int i;
+
+	pthread_mutex_lock(&mslab_mtx);
+
+	for (prev = &mslab_threads; *prev != self; prev = &(*prev)->next)
+		;
+	*prev = self->next;
+
+	for (i = 0; i < mslab_count; i++) {
+		slab = mslabs[i];
+		cache = &self->cache[i];
+
+		if (cache->nfree)
+			mslab_flush(slab, cache, cache->nfree);
+		slab->exited_allocs += atomic_load_explicit(
+			&cache->allocs, memory_order_relaxed);
+		slab->exited_frees += atomic_load_explicit(
+			&cache->frees, memory_order_relaxed);
+	}
+
+	pthread_mutex_unlock(&mslab_mtx);
+
+	mslab_self = NULL;
+	free(self);
+}
+
+bool qmem_slab_enable(void)
+{
+	void *arena;
+
+	if (mslab_enabled)
+		return true;
+	if (!MSLAB_ARENA_SIZE)
+		return false;
+
+	arena = mmap(NULL, MSLAB_ARENA_SIZE, PROT_NONE,
+		     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (arena == MAP_FAILED)
+		return false;
+	if (pthread_key_create(&mslab_key, mslab_thread_exit)) {
+		munmap(arena, MSLAB_ARENA_SIZE);
+		return false;
+	}
+
+	mslab_arena = arena;
+	mslab_enabled = true;
+	return true;
+}
+
+void qmem_stats(struct memtype *mt, struct memtype_stats *stats)
+{
+	struct mslab_thread *thread;
+	struct mslab *slab;
+	size_t allocs, frees, carved;
+
+	stats->n_alloc = atomic_load_explicit(&mt->n_alloc,
+					      memory_order_relaxed);
+	stats->n_max = atomic_load_explicit(&mt->n_max, memory_order_relaxed);
+	stats->size = atomic_load_explicit(&mt->size, memory_order_relaxed);
+#ifdef HAVE_MALLOC_USABLE_SIZE
+	stats->total = atomic_load_explicit(&mt->total, memory_order_relaxed);
+	stats->max_size = atomic_load_explicit(&mt->max_size,
+					       memory_order_relaxed);
+#else
+	stats->total = 0;
+	stats->max_size = 0;
+#endif
+
+	slab = (struct mslab *)atomic_load_explicit(&mt->mslab,
+						    memory_order_acquire);
+	if (!slab || slab == &mslab_none)
+		return;
+
+	pthread_mutex_lock(&mslab_mtx);
+	allocs = slab->exited_allocs;
+	frees = slab->exited_frees;
+	for (thread = mslab_threads; thread; thread = thread->next) {
+		allocs += atomic_load_explicit(&thread->cache[slab->id].allocs,
+					       memory_order_relaxed);
+		frees += atomic_load_explicit(&thread->cache[slab->id].frees,
+					      memory_order_relaxed);
+	}
+	pthread_mutex_unlock(&mslab_mtx);
+	carved = atomic_load_explicit(&slab->carved, memory_order_relaxed);
+
+	/* other pthreads keep going while their counters are read; an object
+	 * freed on another pthread than it was allocated on may be seen freed
+	 * before it is seen allocated
+	 */
+	if (frees > allocs)
+		frees = allocs;
+
+	stats->n_alloc += allocs - frees;
+	stats->n_max += carved;
+	stats->total += (allocs - frees) * slab->objsize;
+	stats->max_size += carved * slab->objsize;
+}
+
+static inline void *mt_slaballoc(struct memtype *mt, size_t size)
+{
+	struct mslab *slab = mslab_get(mt, size);
+	void *ptr;
+
+	if (!slab)
+		return NULL;
+
+	ptr = mslab_alloc(slab);
+	if (ptr)
+		frrtrace(3, frr_libfrr, memalloc, mt, ptr, size);
+	return ptr;
+}
+
 void *qmalloc(struct memtype *mt, size_t size)
 {
+	void *ptr = mt_slaballoc(mt, size);
+
+	if (ptr)
+		return ptr;
 	return mt_checkalloc(mt, malloc(size), size);
 }
 
 void *qcalloc(struct memtype *mt, size_t size)
 {
+	void *ptr = mt_slaballoc(mt, size);
+
+	if (ptr)
+		return memset(ptr, 0, size);
 	return mt_checkalloc(mt, calloc(size, 1), size);
 }
 
 void *qrealloc(struct memtype *mt, void *ptr, size_t size)
 {
+	if (mslab_owns(ptr)) {
+		size_t oldsize = mslab_of(ptr)->size;
+		void *newptr;
+
+		if (size == oldsize)
+			return ptr;
+
+		newptr = qmalloc(mt, size);
+		if (newptr)
+			memcpy(newptr, ptr, MIN(size, oldsize));
+		qfree(mt, ptr);
+		return newptr;
+	}
+
 	if (ptr)
 		mt_count_free(mt, ptr);
 	return mt_checkalloc(mt, ptr ? realloc(ptr, size) : malloc(size), size);
@@ -120,12 +553,21 @@ void *qstrdup(struct memtype *mt, const char *str)
 
 void qcountfree(struct memtype *mt, void *ptr)
 {
+	/* slab objects can't be handed over to free() */
+	assert(!mslab_owns(ptr));
+
 	if (ptr)
 		mt_count_free(mt, ptr);
 }
 
 void qfree(struct memtype *mt, void *ptr)
 {
+	if (mslab_owns(ptr)) {
+		frrtrace(2, frr_libfrr, memfree, mt, ptr);
+		mslab_free(mslab_of(ptr), ptr);
+		return;
+	}
+
 	if (ptr)
 		mt_count_free(mt, ptr);
 	free(ptr);
@@ -179,17 +621,19 @@ static int qmem_exit_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 {
 	struct exit_dump_args *eda = arg;
 	const char *prefix = eda->daemon_name ?: "NONE";
+	struct memtype_stats stats;
 	char size[32];
 
 	if (!mt)
 		/* iterator calls mg=X, mt=NULL first */
 		return 0;
 
-	if (!mt->n_alloc)
+	qmem_stats(mt, &stats);
+	if (!stats.n_alloc)
 		return 0;
 
-	if (mt->size != SIZE_VAR)
-		snprintf(size, sizeof(size), "%10zu", mt->size);
+	if (stats.size != SIZE_VAR)
+		snprintf(size, sizeof(size), "%10zu", stats.size);
 	else
 		snprintf(size, sizeof(size), "(variably sized)");
 
@@ -205,7 +649,7 @@ static int qmem_exit_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 				   mg->name);
 			eda->last_mg = mg;
 		}
-		zlog_debug("memstats:  %-30s: %6zu * %s", mt->name, mt->n_alloc, size);
+		zlog_debug("memstats:  %-30s: %6zu * %s", mt->name, stats.n_alloc, size);
 		return 0;
 	}
 
@@ -226,13 +670,13 @@ static int qmem_exit_walker(void *arg, struct memgroup *mg, struct memtype *mt)
 	}
 
 	if (eda->do_log)
-		zlog_warn("memstats:  %-30s: %6zu * %s", mt->name, mt->n_alloc, size);
+		zlog_warn("memstats:  %-30s: %6zu * %s", mt->name, stats.n_alloc, size);
 	if (eda->do_stderr)
-		fprintf(stderr, "%s: memstats:  %-30s: %6zu * %s\n", prefix, mt->name, mt->n_alloc,
-			size);
+		fprintf(stderr, "%s: memstats:  %-30s: %6zu * %s\n", prefix, mt->name,
+			stats.n_alloc, size);
 	if (eda->fp)
-		fprintf(eda->fp, "%s: memstats:  %-30s: %6zu * %s\n", prefix, mt->name, mt->n_alloc,
-			size);
+		fprintf(eda->fp, "%s: memstats:  %-30s: %6zu * %s\n", prefix, mt->name,
+			stats.n_alloc, size);
 	return 0;
 }
 
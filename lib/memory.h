@@ -32,6 +32,21 @@ struct memtype {
 	atomic_size_t total;
 	atomic_size_t max_size;
 #endif
+
+	/* DEFINE_MTYPE_SLAB: fixed-size objects may come from the slab
+	 * allocator; mslab is set up on first allocation
+	 */
+	bool slab;
+	atomic_uintptr_t mslab;
+};
+
+/* current state of a memtype, see qmem_stats() */
+struct memtype_stats {
+	size_t n_alloc;
+	size_t n_max;
+	size_t size;
+	size_t total;
+	size_t max_size;
 };
 
 struct memgroup {
@@ -105,13 +120,14 @@ struct memgroup {
 	extern struct memtype MTYPE_##name[1]                                  \
 	/* end */
 
-#define DEFINE_MTYPE_ATTR(group, mname, attr, desc)                            \
+#define _DEFINE_MTYPE_ATTR(group, mname, attr, desc, ...)                      \
 	attr struct memtype MTYPE_##mname[1] _DATA_SECTION("mtypes") = { {     \
 		.name = desc,                                                  \
 		.next = NULL,                                                  \
 		.n_alloc = 0,                                                  \
 		.size = 0,                                                     \
 		.ref = NULL,                                                   \
+		__VA_ARGS__                                                    \
 	} };                                                                   \
 	static void _mtinit_##mname(void) __attribute__((_CONSTRUCTOR(1001))); \
 	static void _mtinit_##mname(void)                                      \
@@ -131,6 +147,10 @@ struct memgroup {
 	}                                                                      \
 	MACRO_REQUIRE_SEMICOLON() /* end */
 
+#define DEFINE_MTYPE_ATTR(group, mname, attr, desc)                            \
+	_DEFINE_MTYPE_ATTR(group, mname, attr, desc, )                         \
+	/* end */
+
 #define DEFINE_MTYPE(group, name, desc)                                        \
 	DEFINE_MTYPE_ATTR(group, name, , desc)                                 \
 	/* end */
@@ -139,6 +159,19 @@ struct memgroup {
 	DEFINE_MTYPE_ATTR(group, name, static, desc)                           \
 	/* end */
 
+/* For memtypes with many small objects of one size (route nodes, paths,
+ * nexthops), which are then served from per-thread caches when the slab
+ * allocator is enabled (qmem_slab_enable()).  Pointers must be freed with
+ * XFREE() or XREALLOC(), never with free() or XCOUNTFREE().
+ */
+#define DEFINE_MTYPE_SLAB(group, name, desc)                                   \
+	_DEFINE_MTYPE_ATTR(group, name, , desc, .slab = true)                  \
+	/* end */
+
+#define DEFINE_MTYPE_STATIC_SLAB(group, name, desc)                            \
+	_DEFINE_MTYPE_ATTR(group, name, static, desc, .slab = true)            \
+	/* end */
+
 /* clang-format on */
 
 DECLARE_MGROUP(LIB);
@@ -169,11 +202,25 @@ extern void qfree(struct memtype *mt, void *ptr) __attribute__((nonnull(1)));
 		ptr = NULL;                                                    \
 	} while (0)
 
+/* Counters for slab objects are kept per thread; this adds them up.  The
+ * fields of struct memtype itself only cover system allocator memory.
+ */
+extern void qmem_stats(struct memtype *mt, struct memtype_stats *stats);
+
 static inline size_t mtype_stats_alloc(struct memtype *mt)
 {
-	return mt->n_alloc;
+	struct memtype_stats stats;
+
+	qmem_stats(mt, &stats);
+	return stats.n_alloc;
 }
 
+/* Serve DEFINE_MTYPE_SLAB memtypes from the slab allocator from now on.
+ * Must be called before any pthreads are started; returns false if the
+ * slab allocator is not available on this platform.
+ */
+extern bool qmem_slab_enable(void);
+
 /* NB: calls are ordered by memgroup; and there is a call with mt == NULL for
  * each memgroup (so that a header can be printed, and empty memgroups show)
  *
@@ -260,6 +260,7 @@ core_handler(int signo, siginfo_t *siginfo, void *context)
 	 * So this is intentional, let's try to flush
 	 * what we can and let the crash happen.
 	 */
+	zlog_deferred_crash_flush();
 	zlog_tls_buffer_flush();
 
 	/* give the kernel a chance to generate a coredump */
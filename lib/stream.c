@@ -17,8 +17,15 @@
 #include "lib_errors.h"
 
 DEFINE_MTYPE_STATIC(LIB, STREAM, "Stream");
+DEFINE_MTYPE_STATIC(LIB, STREAM_BUF, "Stream shared data");
 DEFINE_MTYPE_STATIC(LIB, STREAM_FIFO, "Stream FIFO");
 
+/* Data shared by stream_clone()s; size is kept in each stream. */
+struct stream_buf {
+	atomic_uint refcnt;
+	unsigned char data[];
+};
+
 /* Tests whether a position is valid */
 #define GETP_VALID(S, G) ((G) <= (S)->endp)
 #define PUT_AT_VALID(S,G) GETP_VALID(S,G)
@@ -72,6 +79,13 @@ DEFINE_MTYPE_STATIC(LIB, STREAM_FIFO, "Stream FIFO");
 		STREAM_WARN_OFFSETS(S);                                        \
 	} while (0)
 
+/* Anything writing to the data must call this first */
+#define STREAM_UNSHARE(S)                                                      \
+	do {                                                                   \
+		if ((S)->shared)                                               \
+			stream_unshare(S);                                     \
+	} while (0)
+
 /* XXX: Deprecated macro: do not use */
 #define CHECK_SIZE(S, Z)                                                       \
 	do {                                                                   \
@@ -97,18 +111,83 @@ struct stream *stream_new(size_t size)
 	s->getp = s->endp = 0;
 	s->next = NULL;
 	s->size = size;
+	s->data = (unsigned char *)(s + 1);
+	s->shared = NULL;
 	return s;
 }
 
+static void stream_buf_release(struct stream_buf *buf)
+{
+	/* acq_rel: our use of the data must be done before whoever frees or
+	 * reuses it sees the count drop
+	 */
+	if (atomic_fetch_sub_explicit(&buf->refcnt, 1, memory_order_acq_rel) ==
+	    1)
+		XFREE(MTYPE_STREAM_BUF, buf);
+}
+
 /* Free it now. */
 void stream_free(struct stream *s)
 {
 	if (!s)
 		return;
 
+	if (s->shared)
+		stream_buf_release(s->shared);
 	XFREE(MTYPE_STREAM, s);
 }
 
+/*
+ * Give s private data of the given size, with the first keep bytes of the
+ * current data.
+ */
+static void stream_buf_own(struct stream *s, size_t size, size_t keep)
+{
+	struct stream_buf *buf;
+
+	buf = XMALLOC(MTYPE_STREAM_BUF, sizeof(*buf) + size);
+	atomic_store_explicit(&buf->refcnt, 1, memory_order_relaxed);
+	memcpy(buf->data, s->data, MIN(keep, size));
+
+	if (s->shared)
+		stream_buf_release(s->shared);
+	s->shared = buf;
+	s->data = buf->data;
+	s->size = size;
+}
+
+void stream_unshare(struct stream *s)
+{
+	/* acquire pairs with stream_buf_release() in the other holders */
+	if (!s->shared || atomic_load_explicit(&s->shared->refcnt,
+					       memory_order_acquire) == 1)
+		return;
+
+	stream_buf_own(s, s->size, s->endp);
+}
+
+struct stream *stream_clone(struct stream *s)
+{
+	struct stream *snew;
+
+	STREAM_VERIFY_SANE(s);
+
+	/* inline data goes away with s, move it out once */
+	if (!s->shared)
+		stream_buf_own(s, s->size, s->endp);
+
+	atomic_fetch_add_explicit(&s->shared->refcnt, 1, memory_order_relaxed);
+
+	snew = XMALLOC(MTYPE_STREAM, sizeof(struct stream));
+	snew->next = NULL;
+	snew->getp = s->getp;
+	snew->endp = s->endp;
+	snew->size = s->size;
+	snew->data = s->data;
+	snew->shared = s->shared;
+	return snew;
+}
+
 struct stream *stream_copy(struct stream *dest, const struct stream *src)
 {
 	STREAM_VERIFY_SANE(src);
@@ -119,6 +198,15 @@ struct stream *stream_copy(struct stream *dest, const struct stream *src)
 	dest->endp = src->endp;
 	dest->getp = src->getp;
 
+	if (dest->shared) {
+		if (dest->shared == src->shared)
+			return dest;
+		/* everything is overwritten, don't copy the shared data */
+		if (atomic_load_explicit(&dest->shared->refcnt,
+					 memory_order_acquire) > 1)
+			stream_buf_own(dest, dest->size, 0);
+	}
+
 	memcpy(dest->data, src->data, src->endp);
 
 	return dest;
@@ -160,9 +248,14 @@ size_t stream_resize_inplace(struct stream **sptr, size_t newsize)
 
 	STREAM_VERIFY_SANE(orig);
 
-	orig = XREALLOC(MTYPE_STREAM, orig, sizeof(struct stream) + newsize);
-
-	orig->size = newsize;
+	if (orig->shared)
+		stream_buf_own(orig, newsize, orig->endp);
+	else {
+		orig = XREALLOC(MTYPE_STREAM, orig,
+				sizeof(struct stream) + newsize);
+		orig->data = (unsigned char *)(orig + 1);
+		orig->size = newsize;
+	}
 
 	if (orig->endp > orig->size)
 		orig->endp = orig->size;
@@ -689,6 +782,7 @@ void stream_put(struct stream *s, const void *src, size_t size)
 	CHECK_SIZE(s, size);
 
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < size) {
 		STREAM_BOUND_WARN(s, "put");
@@ -707,6 +801,7 @@ void stream_put(struct stream *s, const void *src, size_t size)
 int stream_putc(struct stream *s, uint8_t c)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < sizeof(uint8_t)) {
 		STREAM_BOUND_WARN(s, "put");
@@ -721,6 +816,7 @@ int stream_putc(struct stream *s, uint8_t c)
 int stream_putw(struct stream *s, uint16_t w)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < sizeof(uint16_t)) {
 		STREAM_BOUND_WARN(s, "put");
@@ -737,6 +833,7 @@ int stream_putw(struct stream *s, uint16_t w)
 int stream_put3(struct stream *s, uint32_t l)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < 3) {
 		STREAM_BOUND_WARN(s, "put");
@@ -754,6 +851,7 @@ int stream_put3(struct stream *s, uint32_t l)
 int stream_putl(struct stream *s, uint32_t l)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < sizeof(uint32_t)) {
 		STREAM_BOUND_WARN(s, "put");
@@ -772,6 +870,7 @@ int stream_putl(struct stream *s, uint32_t l)
 int stream_putq(struct stream *s, uint64_t q)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < sizeof(uint64_t)) {
 		STREAM_BOUND_WARN(s, "put quad");
@@ -813,6 +912,7 @@ int stream_putd(struct stream *s, double d)
 int stream_putc_at(struct stream *s, size_t putp, uint8_t c)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (!PUT_AT_VALID(s, putp + sizeof(uint8_t))) {
 		STREAM_BOUND_WARN(s, "put");
@@ -827,6 +927,7 @@ int stream_putc_at(struct stream *s, size_t putp, uint8_t c)
 int stream_putw_at(struct stream *s, size_t putp, uint16_t w)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (!PUT_AT_VALID(s, putp + sizeof(uint16_t))) {
 		STREAM_BOUND_WARN(s, "put");
@@ -842,6 +943,7 @@ int stream_putw_at(struct stream *s, size_t putp, uint16_t w)
 int stream_put3_at(struct stream *s, size_t putp, uint32_t l)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (!PUT_AT_VALID(s, putp + 3)) {
 		STREAM_BOUND_WARN(s, "put");
@@ -857,6 +959,7 @@ int stream_put3_at(struct stream *s, size_t putp, uint32_t l)
 int stream_putl_at(struct stream *s, size_t putp, uint32_t l)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (!PUT_AT_VALID(s, putp + sizeof(uint32_t))) {
 		STREAM_BOUND_WARN(s, "put");
@@ -873,6 +976,7 @@ int stream_putl_at(struct stream *s, size_t putp, uint32_t l)
 int stream_putq_at(struct stream *s, size_t putp, uint64_t q)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (!PUT_AT_VALID(s, putp + sizeof(uint64_t))) {
 		STREAM_BOUND_WARN(s, "put");
@@ -894,6 +998,7 @@ int stream_putq_at(struct stream *s, size_t putp, uint64_t q)
 int stream_put_ipv4(struct stream *s, uint32_t l)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < sizeof(uint32_t)) {
 		STREAM_BOUND_WARN(s, "put");
@@ -909,6 +1014,7 @@ int stream_put_ipv4(struct stream *s, uint32_t l)
 int stream_put_in_addr(struct stream *s, const struct in_addr *addr)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < sizeof(uint32_t)) {
 		STREAM_BOUND_WARN(s, "put");
@@ -947,6 +1053,7 @@ int stream_put_in_addr_at(struct stream *s, size_t putp,
 			  const struct in_addr *addr)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (!PUT_AT_VALID(s, putp + 4)) {
 		STREAM_BOUND_WARN(s, "put");
@@ -962,6 +1069,7 @@ int stream_put_in6_addr_at(struct stream *s, size_t putp,
 			   const struct in6_addr *addr)
 {
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (!PUT_AT_VALID(s, putp + 16)) {
 		STREAM_BOUND_WARN(s, "put");
@@ -980,6 +1088,7 @@ int stream_put_prefix_addpath(struct stream *s, const struct prefix *p,
 	size_t psize_with_addpath;
 
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	psize = PSIZE(p->prefixlen);
 
@@ -1022,6 +1131,7 @@ int stream_put_labeled_prefix(struct stream *s, const struct prefix *p,
 	uint8_t *label_pnt = (uint8_t *)label;
 
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	psize = PSIZE(p->prefixlen);
 	psize_with_addpath = psize + (addpath_capable ? 4 : 0);
@@ -1054,6 +1164,7 @@ int stream_read(struct stream *s, int fd, size_t size)
 	int nbytes;
 
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < size) {
 		STREAM_BOUND_WARN(s, "put");
@@ -1073,6 +1184,7 @@ ssize_t stream_read_try(struct stream *s, int fd, size_t size)
 	ssize_t nbytes;
 
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < size) {
 		STREAM_BOUND_WARN(s, "put");
@@ -1103,6 +1215,7 @@ ssize_t stream_recvfrom(struct stream *s, int fd, size_t size, int flags,
 	ssize_t nbytes;
 
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < size) {
 		STREAM_BOUND_WARN(s, "put");
@@ -1136,6 +1249,7 @@ ssize_t stream_recvmsg(struct stream *s, int fd, struct msghdr *msgh, int flags,
 	struct iovec *iov;
 
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 	assert(msgh->msg_iovlen > 0);
 
 	if (STREAM_WRITEABLE(s) < size) {
@@ -1165,6 +1279,7 @@ size_t stream_write(struct stream *s, const void *ptr, size_t size)
 	CHECK_SIZE(s, size);
 
 	STREAM_VERIFY_SANE(s);
+	STREAM_UNSHARE(s);
 
 	if (STREAM_WRITEABLE(s) < size) {
 		STREAM_BOUND_WARN(s, "put");
@@ -1339,6 +1454,60 @@ size_t stream_fifo_count_safe(struct stream_fifo *fifo)
 	return atomic_load_explicit(&fifo->count, memory_order_acquire);
 }
 
+/* iovecs per writev() call */
+#ifdef IOV_MAX
+#define STREAM_WRITEV_MAX ((IOV_MAX >= 64) ? 64 : IOV_MAX)
+#else
+#define STREAM_WRITEV_MAX 64
+#endif
+
+ssize_t stream_fifo_writev(struct stream_fifo *fifo, int fd)
+{
+	struct iovec iov[STREAM_WRITEV_MAX];
+	struct stream *s;
+	size_t total = 0, want, len;
+	ssize_t nbytes;
+	int iovcnt;
+
+	while (fifo->head) {
+		iovcnt = 0;
+		want = 0;
+		for (s = fifo->head; s && iovcnt < STREAM_WRITEV_MAX;
+		     s = s->next) {
+			STREAM_VERIFY_SANE(s);
+			iov[iovcnt].iov_base = s->data + s->getp;
+			want += (iov[iovcnt].iov_len = STREAM_READABLE(s));
+			iovcnt++;
+		}
+
+		nbytes = writev(fd, iov, iovcnt);
+		if (nbytes < 0) {
+			if (ERRNO_IO_RETRY(errno))
+				return total ? (ssize_t)total : -2;
+			flog_err(EC_LIB_SOCKET, "%s: writev failed on fd %d: %s",
+				 __func__, fd, safe_strerror(errno));
+			return -1;
+		}
+		total += nbytes;
+
+		for (len = nbytes; iovcnt--;) {
+			s = fifo->head;
+			if (len < STREAM_READABLE(s)) {
+				s->getp += len;
+				break;
+			}
+			len -= STREAM_READABLE(s);
+			stream_free(stream_fifo_pop(fifo));
+		}
+
+		/* short write, the socket is full */
+		if ((size_t)nbytes < want)
+			break;
+	}
+
+	return total;
+}
+
 void stream_fifo_deinit(struct stream_fifo *fifo)
 {
 	stream_fifo_clean(fifo);
@@ -1362,6 +1531,7 @@ void stream_pulldown(struct stream *s)
 	}
 
 	/* Move the available data to the beginning. */
+	STREAM_UNSHARE(s);
 	memmove(s->data, &s->data[s->getp], rlen);
 	s->getp = 0;
 	s->endp = rlen;
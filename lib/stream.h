@@ -81,8 +81,20 @@ extern "C" {
  *
  * Best practice is to use stream_put (<stream *>, NULL, <size>) to zero out
  * any part of a stream which isn't otherwise written to.
+ *
+ * Copy-on-write:
+ * stream_clone() creates a stream that shares the data of another, with its
+ * own getp and endp.  The data is refcounted; the stream_put*() family (and
+ * anything else in stream.c that writes) gives a stream a private copy
+ * first if the data is still shared.  This makes sending the same message
+ * to many receivers cheap, the message is encoded once and every receiver
+ * gets a clone.  Writing to a shared stream through STREAM_DATA() or
+ * stream_pnt() bypasses this and changes every clone; call stream_unshare()
+ * before doing that on a stream that may have clones.
  */
 
+struct stream_buf;
+
 /* Stream buffer. */
 struct stream {
 	struct stream *next;
@@ -95,7 +107,10 @@ struct stream {
 	size_t getp;	       /* next get position */
 	size_t endp;	       /* last valid data position */
 	size_t size;	       /* size of data segment */
-	unsigned char data[];  /* data pointer */
+	unsigned char *data;   /* data pointer */
+
+	/* refcounted data, NULL while data is inline after the struct */
+	struct stream_buf *shared;
 };
 
 /* First in first out queue structure. */
@@ -138,6 +153,13 @@ extern struct stream *stream_copy(struct stream *dest,
 				  const struct stream *src);
 extern struct stream *stream_dup(const struct stream *s);
 
+/* Copy-on-write duplicate of s, see above.  Cheap, never copies data after
+ * the first clone of a stream.
+ */
+extern struct stream *stream_clone(struct stream *s);
+/* Make sure s's data isn't shared with another stream. */
+extern void stream_unshare(struct stream *s);
+
 extern size_t stream_resize_inplace(struct stream **sptr, size_t newsize);
 
 extern size_t stream_get_getp(const struct stream *s);
@@ -338,6 +360,27 @@ extern struct stream *stream_fifo_head_safe(struct stream_fifo *fifo);
 extern void stream_fifo_clean(struct stream_fifo *fifo);
 extern void stream_fifo_clean_safe(struct stream_fifo *fifo);
 
+/*
+ * Write the readable part of the streams on a stream_fifo to a file
+ * descriptor, with as few writev() calls as possible.  Streams that have
+ * been written completely are popped off the fifo and freed, getp is moved
+ * forward on a stream that was written partially.  Not safe against
+ * concurrent pushes; move the streams to a private fifo first.
+ *
+ * fifo
+ *    the stream_fifo to write out
+ *
+ * fd
+ *    the (usually non-blocking) file descriptor to write to
+ *
+ * Returns:
+ *    >=0: number of bytes written; the fifo is empty unless the write
+ *         would have blocked
+ *     -1: fatal error
+ *     -2: transient error, should retry later (i.e. EAGAIN or EINTR)
+ */
+extern ssize_t stream_fifo_writev(struct stream_fifo *fifo, int fd);
+
 /*
  * Retrieve number of streams on a stream_fifo.
  *
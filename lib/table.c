@@ -15,9 +15,32 @@
 #include "libfrr_trace.h"
 
 DEFINE_MTYPE_STATIC(LIB, ROUTE_TABLE, "Route table");
-DEFINE_MTYPE(LIB, ROUTE_NODE, "Route node");
+DEFINE_MTYPE_SLAB(LIB, ROUTE_NODE, "Route node");
+DEFINE_MTYPE_STATIC(LIB, ROUTE_NODE_ARENA, "Route node arena");
+
+/*
+ * Nodes of tables using the arena delegate come from blocks owned by the
+ * table.  Blocks double in size, up to ROUTE_ARENA_MAX nodes, so that
+ * small tables stay small.  Freed nodes are kept on a per-table free list
+ * and all blocks go away with the table.
+ */
+#define ROUTE_ARENA_MIN 16
+#define ROUTE_ARENA_MAX 1024
+
+struct route_node_block {
+	struct route_node_block *next;
+	unsigned int size, used;
+	struct route_node nodes[];
+};
+
+struct route_node_arena {
+	struct route_node_block *blocks;
+	/* freed nodes, chained through link[0] */
+	struct route_node *free;
+};
 
 static void route_table_free(struct route_table *);
+static void route_node_arena_free(struct route_table *table);
 
 static int route_table_hash_cmp(const struct route_node *a,
 				const struct route_node *b)
@@ -122,6 +145,7 @@ static void route_table_free(struct route_table *rt)
 
 	assert(rt->count == 0);
 
+	route_node_arena_free(rt);
 	rn_hash_node_fini(&rt->hash);
 	XFREE(MTYPE_ROUTE_TABLE, rt);
 	return;
@@ -492,6 +516,75 @@ void route_node_destroy(route_table_delegate_t *delegate,
 	XFREE(MTYPE_ROUTE_NODE, node);
 }
 
+/**
+ * route_node_arena_create
+ *
+ * Create a route node in the table's arena.
+ */
+struct route_node *route_node_arena_create(route_table_delegate_t *delegate,
+					   struct route_table *table)
+{
+	struct route_node_arena *arena = table->arena;
+	struct route_node_block *block;
+	struct route_node *node;
+	unsigned int size;
+
+	if (!arena) {
+		arena = XCALLOC(MTYPE_ROUTE_NODE_ARENA, sizeof(*arena));
+		table->arena = arena;
+	}
+
+	if (arena->free) {
+		node = arena->free;
+		arena->free = node->link[0];
+	} else {
+		block = arena->blocks;
+		if (!block || block->used == block->size) {
+			size = block ? MIN(block->size * 2, ROUTE_ARENA_MAX)
+				     : ROUTE_ARENA_MIN;
+			block = XMALLOC(MTYPE_ROUTE_NODE_ARENA,
+					sizeof(*block) +
+						size * sizeof(block->nodes[0]));
+			block->size = size;
+			block->used = 0;
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+		node = &block->nodes[block->used++];
+	}
+
+	memset(node, 0, sizeof(*node));
+	return node;
+}
+
+/**
+ * route_node_arena_destroy
+ *
+ * Return a route node to the table's arena.
+ */
+void route_node_arena_destroy(route_table_delegate_t *delegate,
+			      struct route_table *table,
+			      struct route_node *node)
+{
+	node->link[0] = table->arena->free;
+	table->arena->free = node;
+}
+
+static void route_node_arena_free(struct route_table *table)
+{
+	struct route_node_arena *arena = table->arena;
+	struct route_node_block *block;
+
+	if (!arena)
+		return;
+
+	while ((block = arena->blocks)) {
+		arena->blocks = block->next;
+		XFREE(MTYPE_ROUTE_NODE_ARENA, block);
+	}
+	XFREE(MTYPE_ROUTE_NODE_ARENA, table->arena);
+}
+
 /*
  * Default delegate.
  */
@@ -504,6 +597,16 @@ route_table_delegate_t *route_table_get_default_delegate(void)
 	return &default_delegate;
 }
 
+static route_table_delegate_t arena_delegate = {
+	.create_node = route_node_arena_create,
+	.destroy_node = route_node_arena_destroy,
+};
+
+route_table_delegate_t *route_table_get_arena_delegate(void)
+{
+	return &arena_delegate;
+}
+
 /*
  * route_table_init
  */
@@ -23,6 +23,7 @@ DECLARE_MTYPE(ROUTE_NODE);
  */
 struct route_node;
 struct route_table;
+struct route_node_arena;
 
 /*
  * route_table_delegate_t
@@ -59,6 +60,11 @@ struct route_table {
 
 	unsigned long count;
 
+	/*
+	 * Node storage for route_node_arena_create().
+	 */
+	struct route_node_arena *arena;
+
 	/*
 	 * User data.
 	 */
@@ -172,6 +178,14 @@ route_table_init_with_delegate(route_table_delegate_t *delegate);
 
 extern route_table_delegate_t *route_table_get_default_delegate(void);
 
+/*
+ * Delegate which carves nodes from blocks owned by the table instead of
+ * allocating each one separately, for large tables: less memory per node,
+ * and nodes added together (e.g. from one update) share cache lines and
+ * pages on lookups and walks.
+ */
+extern route_table_delegate_t *route_table_get_arena_delegate(void);
+
 static inline void *route_table_get_info(struct route_table *table)
 {
 	return table->info;
@@ -209,6 +223,14 @@ extern void route_node_destroy(route_table_delegate_t *delegate,
 			       struct route_table *table,
 			       struct route_node *node);
 
+/* For custom delegates that want the arena delegate's node storage. */
+extern struct route_node *
+route_node_arena_create(route_table_delegate_t *delegate,
+			struct route_table *table);
+extern void route_node_arena_destroy(route_table_delegate_t *delegate,
+				     struct route_table *table,
+				     struct route_node *node);
+
 extern struct route_node *route_table_get_next(struct route_table *table,
 					       union prefixconstptr pu);
 extern int route_table_prefix_iter_cmp(const struct prefix *p1,
@@ -0,0 +1,378 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Work-stealing task pool for CPU-bound jobs.
+ */
+
+#include <zebra.h>
+
+#include "taskpool.h"
+#include "frr_pthread.h"
+#include "frratomic.h"
+#include "frrcu.h"
+#include "memory.h"
+#include "typesafe.h"
+#include "zlog.h"
+
+DEFINE_MTYPE_STATIC(LIB, TASKPOOL, "Task pool");
+DEFINE_MTYPE_STATIC(LIB, TASKPOOL_TASK, "Task pool task");
+
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
+PREDECL_DLIST(taskpool_queue);
+
+struct taskpool_future {
+	struct taskpool_queue_item item;
+	struct taskpool *pool;
+
+	void (*work)(void *arg);
+	void *arg;
+
+	/* completion event for taskpool_run(), func is NULL otherwise */
+	const struct xref_eventsched *xref;
+	struct event_loop *loop;
+	void (*func)(struct event *);
+
+	atomic_bool done;
+};
+
+DECLARE_DLIST(taskpool_queue, struct taskpool_future, item);
+
+struct taskpool_worker {
+	struct taskpool *pool;
+	struct frr_pthread *fpt;
+
+	/* the worker takes its own tasks from the head, thieves from the tail */
+	pthread_mutex_t mtx;
+	struct taskpool_queue_head queue;
+};
+
+struct taskpool {
+	char *name;
+
+	pthread_mutex_t mtx;
+	/* tasks submitted from outside the pool; protected by mtx */
+	struct taskpool_queue_head inject;
+	bool stop;
+
+	/* idle workers wait for work_cond, taskpool_future_wait() for
+	 * done_cond; both are signalled only if someone is waiting
+	 */
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	atomic_uint_fast32_t sleepers;
+	atomic_uint_fast32_t waiters;
+
+	/* queued tasks, in all queues */
+	atomic_size_t pending;
+
+	unsigned int nworkers;
+	struct taskpool_worker *workers;
+};
+
+static thread_local struct taskpool_worker *taskpool_self;
+
+/* The calling pthread's worker, if it is one of this pool's. */
+static struct taskpool_worker *taskpool_worker(struct taskpool *pool)
+{
+	struct taskpool_worker *self = taskpool_self;
+
+	return (self && self->pool == pool) ? self : NULL;
+}
+
+static void taskpool_push(struct taskpool *pool, struct taskpool_future *f)
+{
+	struct taskpool_worker *self = taskpool_worker(pool);
+
+	atomic_fetch_add_explicit(&pool->pending, 1, memory_order_seq_cst);
+
+	if (self) {
+		frr_with_mutex (&self->mtx) {
+			taskpool_queue_add_head(&self->queue, f);
+		}
+	} else {
+		frr_with_mutex (&pool->mtx) {
+			taskpool_queue_add_tail(&pool->inject, f);
+		}
+	}
+
+	if (atomic_load_explicit(&pool->sleepers, memory_order_seq_cst)) {
+		frr_with_mutex (&pool->mtx) {
+			pthread_cond_signal(&pool->work_cond);
+		}
+	}
+}
+
+/*
+ * Find a task to run: the newest one of our own, else the oldest one
+ * submitted from outside, else the oldest one of another worker.
+ */
+static struct taskpool_future *taskpool_take(struct taskpool *pool,
+					     struct taskpool_worker *self)
+{
+	struct taskpool_future *f = NULL;
+	struct taskpool_worker *victim;
+	unsigned int i, start;
+
+	if (!atomic_load_explicit(&pool->pending, memory_order_seq_cst))
+		return NULL;
+
+	if (self) {
+		frr_with_mutex (&self->mtx) {
+			f = taskpool_queue_pop(&self->queue);
+		}
+	}
+	if (!f) {
+		frr_with_mutex (&pool->mtx) {
+			f = taskpool_queue_pop(&pool->inject);
+		}
+	}
+
+	start = self ? (unsigned int)(self - pool->workers) + 1 : 0;
+	for (i = 0; !f && i < pool->nworkers; i++) {
+		victim = &pool->workers[(start + i) % pool->nworkers];
+		if (victim == self)
+			continue;
+
+		frr_with_mutex (&victim->mtx) {
+			f = taskpool_queue_last(&victim->queue);
+			if (f)
+				taskpool_queue_del(&victim->queue, f);
+		}
+	}
+
+	if (f)
+		atomic_fetch_sub_explicit(&pool->pending, 1,
+					  memory_order_seq_cst);
+	return f;
+}
+
+static void taskpool_exec(struct taskpool *pool, struct taskpool_future *f)
+{
+	f->work(f->arg);
+
+	if (f->func) {
+		_event_add_event(f->xref, f->loop, f->func, f->arg, 0, NULL);
+		XFREE(MTYPE_TASKPOOL_TASK, f);
+		return;
+	}
+
+	/* f may be freed by its waiter as soon as this is set */
+	atomic_store_explicit(&f->done, true, memory_order_seq_cst);
+
+	if (atomic_load_explicit(&pool->waiters, memory_order_seq_cst)) {
+		frr_with_mutex (&pool->mtx) {
+			pthread_cond_broadcast(&pool->done_cond);
+		}
+	}
+}
+
+static void *taskpool_worker_run(void *arg)
+{
+	struct frr_pthread *fpt = arg;
+	struct taskpool_worker *self = fpt->data;
+	struct taskpool *pool = self->pool;
+	struct taskpool_future *f;
+	bool stop = false;
+
+	taskpool_self = self;
+
+	zlog_tls_buffer_init();
+	frr_pthread_set_name(fpt);
+	frr_pthread_notify_running(fpt);
+
+	while (!stop) {
+		f = taskpool_take(pool, self);
+		if (f) {
+			taskpool_exec(pool, f);
+			continue;
+		}
+
+		/* don't hold up RCU while idle */
+		rcu_read_unlock();
+
+		frr_with_mutex (&pool->mtx) {
+			atomic_fetch_add_explicit(&pool->sleepers, 1,
+						  memory_order_seq_cst);
+			while (!pool->stop &&
+			       !atomic_load_explicit(&pool->pending,
+						     memory_order_seq_cst))
+				pthread_cond_wait(&pool->work_cond, &pool->mtx);
+			atomic_fetch_sub_explicit(&pool->sleepers, 1,
+						  memory_order_seq_cst);
+
+			/* queued tasks are still run before stopping */
+			stop = pool->stop &&
+			       !atomic_load_explicit(&pool->pending,
+						     memory_order_seq_cst);
+		}
+
+		rcu_read_lock();
+	}
+
+	zlog_tls_buffer_fini();
+	return NULL;
+}
+
+static int taskpool_worker_stop(struct frr_pthread *fpt, void **res)
+{
+	struct taskpool_worker *self = fpt->data;
+	struct taskpool *pool = self->pool;
+
+	frr_with_mutex (&pool->mtx) {
+		pool->stop = true;
+		pthread_cond_broadcast(&pool->work_cond);
+	}
+	pthread_join(fpt->thread, res);
+	atomic_store_explicit(&fpt->running, false, memory_order_relaxed);
+
+	return 0;
+}
+
+struct taskpool *taskpool_new(const char *name, unsigned int nthreads)
+{
+	struct frr_pthread_attr attr = {
+		.start = taskpool_worker_run,
+		.stop = taskpool_worker_stop,
+	};
+	char os_name[OS_THREAD_NAMELEN];
+	struct taskpool_worker *w;
+	struct taskpool *pool;
+	unsigned int i;
+
+	if (!nthreads) {
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nthreads = ncpus > 0 ? ncpus : 1;
+	}
+
+	pool = XCALLOC(MTYPE_TASKPOOL, sizeof(*pool));
+	pool->name = XSTRDUP(MTYPE_TASKPOOL, name);
+	pthread_mutex_init(&pool->mtx, NULL);
+	pthread_cond_init(&pool->work_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+	taskpool_queue_init(&pool->inject);
+
+	pool->nworkers = nthreads;
+	pool->workers = XCALLOC(MTYPE_TASKPOOL,
+				nthreads * sizeof(*pool->workers));
+
+	for (i = 0; i < nthreads; i++) {
+		w = &pool->workers[i];
+		w->pool = pool;
+		pthread_mutex_init(&w->mtx, NULL);
+		taskpool_queue_init(&w->queue);
+
+		snprintf(os_name, sizeof(os_name), "%s%u", name, i);
+		w->fpt = frr_pthread_new(&attr, name, os_name);
+		w->fpt->data = w;
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		frr_pthread_run(pool->workers[i].fpt, NULL);
+		frr_pthread_wait_running(pool->workers[i].fpt);
+	}
+
+	return pool;
+}
+
+void taskpool_free(struct taskpool **poolp)
+{
+	struct taskpool *pool = *poolp;
+	struct taskpool_worker *w;
+	unsigned int i;
+
+	if (!pool)
+		return;
+
+	for (i = 0; i < pool->nworkers; i++) {
+		w = &pool->workers[i];
+		if (atomic_load_explicit(&w->fpt->running,
+					 memory_order_relaxed))
+			frr_pthread_stop(w->fpt, NULL);
+	}
+
+	for (i = 0; i < pool->nworkers; i++) {
+		w = &pool->workers[i];
+		frr_pthread_destroy(w->fpt);
+		taskpool_queue_fini(&w->queue);
+		pthread_mutex_destroy(&w->mtx);
+	}
+
+	taskpool_queue_fini(&pool->inject);
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->mtx);
+	XFREE(MTYPE_TASKPOOL, pool->workers);
+	XFREE(MTYPE_TASKPOOL, pool->name);
+	XFREE(MTYPE_TASKPOOL, pool);
+	*poolp = NULL;
+}
+
+unsigned int taskpool_threads(const struct taskpool *pool)
+{
+	return pool->nworkers;
+}
+
+static struct taskpool_future *taskpool_future_new(struct taskpool *pool,
+						   void (*work)(void *arg),
+						   void *arg)
+{
+	struct taskpool_future *f;
+
+	f = XCALLOC(MTYPE_TASKPOOL_TASK, sizeof(*f));
+	f->pool = pool;
+	f->work = work;
+	f->arg = arg;
+	return f;
+}
+
+struct taskpool_future *taskpool_submit(struct taskpool *pool,
+					void (*work)(void *arg), void *arg)
+{
+	struct taskpool_future *f = taskpool_future_new(pool, work, arg);
+
+	taskpool_push(pool, f);
+	return f;
+}
+
+void _taskpool_run(const struct xref_eventsched *xref, struct taskpool *pool,
+		   void (*work)(void *arg), void *arg, struct event_loop *m,
+		   void (*func)(struct event *))
+{
+	struct taskpool_future *f = taskpool_future_new(pool, work, arg);
+
+	f->xref = xref;
+	f->loop = m;
+	f->func = func;
+	taskpool_push(pool, f);
+}
+
+void taskpool_future_wait(struct taskpool_future *future)
+{
+	struct taskpool *pool = future->pool;
+	struct taskpool_worker *self = taskpool_worker(pool);
+	struct taskpool_future *f;
+
+	while (!atomic_load_explicit(&future->done, memory_order_seq_cst)) {
+		/* rather than blocking, help with whatever is queued */
+		f = taskpool_take(pool, self);
+		if (f) {
+			taskpool_exec(pool, f);
+			continue;
+		}
+
+		frr_with_mutex (&pool->mtx) {
+			atomic_fetch_add_explicit(&pool->waiters, 1,
+						  memory_order_seq_cst);
+			while (!atomic_load_explicit(&future->done,
+						     memory_order_seq_cst))
+				pthread_cond_wait(&pool->done_cond, &pool->mtx);
+			atomic_fetch_sub_explicit(&pool->waiters, 1,
+						  memory_order_seq_cst);
+		}
+	}
+
+	XFREE(MTYPE_TASKPOOL_TASK, future);
+}
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Work-stealing task pool for CPU-bound jobs.
+ */
+
+#ifndef _FRR_TASKPOOL_H
+#define _FRR_TASKPOOL_H
+
+#include "frrevent.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A task pool runs short, self-contained jobs (SPF runs, rendering large
+ * JSON output, bulk policy evaluation, ...) on a set of worker pthreads.
+ *
+ * Each worker has its own queue; tasks submitted from inside a task go to
+ * the submitting worker's queue and idle workers steal from the others, so
+ * jobs may split themselves up recursively.  Tasks run with the RCU read
+ * lock held, like event loop tasks; workers release it while idle.
+ *
+ * There are two ways to get at a task's result:
+ *
+ * - taskpool_run() schedules a callback on an event loop once the task is
+ *   done, with the same argument.  This is what daemons should use from
+ *   their event loop; the work function leaves its result in arg.
+ *
+ * - taskpool_submit() returns a future that taskpool_future_wait() blocks
+ *   on.  The waiting thread runs queued tasks while it waits, so it is safe
+ *   to submit and wait from inside a task (fork/join).
+ *
+ * Tasks cannot be cancelled; whatever arg points to must stay valid until
+ * the task is done.
+ */
+struct taskpool;
+struct taskpool_future;
+
+/*
+ * Create a task pool with the given number of worker pthreads, or one per
+ * online CPU if nthreads is 0.  Must be called after frr_pthread_init().
+ */
+extern struct taskpool *taskpool_new(const char *name, unsigned int nthreads);
+
+/*
+ * Run all queued tasks, stop the workers and free the pool.  Completion
+ * callbacks already scheduled by taskpool_run() are still delivered.
+ */
+extern void taskpool_free(struct taskpool **poolp);
+
+extern unsigned int taskpool_threads(const struct taskpool *pool);
+
+extern struct taskpool_future *taskpool_submit(struct taskpool *pool,
+					       void (*work)(void *arg),
+					       void *arg);
+
+/* Wait until the task has run and free the future. */
+extern void taskpool_future_wait(struct taskpool_future *future);
+
+/* Run work(arg) in the pool, then schedule f(arg) as an event on loop m. */
+#define taskpool_run(pool, work, arg, m, f)                                    \
+	({                                                                     \
+		static const struct xref_eventsched _xref __attribute__(       \
+			(used)) = {                                            \
+			.xref = XREF_INIT(XREFT_EVENTSCHED, NULL, __func__),   \
+			.funcname = #f,                                        \
+			.dest = NULL,                                          \
+			.event_type = EVENT_EVENT,                             \
+		};                                                             \
+		XREF_LINK(_xref.xref);                                         \
+		_taskpool_run(&_xref, pool, work, arg, m, f);                  \
+	}) /* end */
+
+extern void _taskpool_run(const struct xref_eventsched *xref,
+			  struct taskpool *pool, void (*work)(void *arg),
+			  void *arg, struct event_loop *m,
+			  void (*func)(struct event *));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_TASKPOOL_H */
@@ -56,6 +56,7 @@
 
 DEFINE_MTYPE_STATIC(LIB, LOG_MESSAGE,  "log message");
 DEFINE_MTYPE_STATIC(LIB, LOG_TLSBUF,   "log thread-local buffer");
+DEFINE_MTYPE_STATIC(LIB, LOG_DEFER,    "log deferred message ring");
 
 DEFINE_HOOK(zlog_init, (const char *progname, const char *protoname,
 			unsigned short instance, uid_t uid, gid_t gid),
@@ -104,13 +105,18 @@ struct zlog_msg {
 	va_list args;
 	const struct xref_logmsg *xref;
 
+	/* arguments for deferred messages, args is unused then */
+	const uint8_t *dargs;
+
 	char *stackbuf;
 	size_t stackbufsz;
 	char *text;
 	size_t textlen;
 	size_t hdrlen;
 
-	/* for relayed log messages ONLY (cf. zlog_recirculate_live_msg) */
+	/* for relayed log messages (cf. zlog_recirculate_live_msg) and
+	 * deferred messages, which are written by another pthread
+	 */
 	intmax_t pid, tid;
 
 	/* This is always ISO8601 with sub-second precision 9 here, it's
@@ -452,26 +458,32 @@ static void vzlog_notls(const struct xref_logmsg *xref, int prio,
 		XFREE(MTYPE_LOG_MESSAGE, msg->text);
 }
 
-static void vzlog_tls(struct zlog_tls *zlog_tls, const struct xref_logmsg *xref,
-		      int prio, const char *fmt, va_list ap)
+/* avoid further processing cost if no target wants this message */
+static bool zlog_wanted(int prio)
 {
 	struct zlog_target *zt;
-	struct zlog_msg *msg;
-	char *buf;
-	bool ignoremsg = true;
-	bool immediate = zlog_default_immediate;
+	bool wanted = false;
 
-	/* avoid further processing cost if no target wants this message */
 	rcu_read_lock();
 	frr_each (zlog_targets, &zlog_targets, zt) {
 		if (prio > zt->prio_min)
 			continue;
-		ignoremsg = false;
+		wanted = true;
 		break;
 	}
 	rcu_read_unlock();
 
-	if (ignoremsg)
+	return wanted;
+}
+
+static void vzlog_tls(struct zlog_tls *zlog_tls, const struct xref_logmsg *xref,
+		      int prio, const char *fmt, va_list ap)
+{
+	struct zlog_msg *msg;
+	char *buf;
+	bool immediate = zlog_default_immediate;
+
+	if (!zlog_wanted(prio))
 		return;
 
 	msg = &zlog_tls->msgs[zlog_tls->nmsgs];
@@ -521,6 +533,1095 @@ static void vzlog_tls(struct zlog_tls *zlog_tls, const struct xref_logmsg *xref,
 		XFREE(MTYPE_LOG_MESSAGE, msg->text);
 }
 
+/* deferred formatting
+ *
+ * If enabled, debug and informational messages aren't formatted on the
+ * pthread logging them.  The xref, format string and arguments are copied
+ * into a per-pthread ring buffer, and a background pthread formats them and
+ * hands them to the log targets.  This takes most of the printfrr() cost
+ * off busy pthreads that have a lot of debugs enabled.
+ *
+ * Plain values and %s strings are copied, as are the addresses behind %pI4
+ * and %pI6.  Other printfrr extensions and %m are formatted right away since
+ * whatever they look at may be gone by the time the message is written.
+ * Anything else (positional arguments, wide characters, messages over
+ * ZLOG_DEFER_RECMAX) takes the normal path.
+ *
+ * Messages more severe than LOG_INFO are still written synchronously, after
+ * waiting for the pthread's ring to drain.  That keeps them in order with
+ * the pthread's earlier messages and makes sure they aren't lost on a crash.
+ * Debug messages still sitting in the rings on a crash are written out by
+ * the crash handler, cf. zlog_deferred_crash_flush().
+ */
+
+#define ZLOG_DEFER_RINGSZ	(256 * 1024)
+#define ZLOG_DEFER_RECMAX	2048
+#define ZLOG_DEFER_TEXTSZ	512
+/* the writer collects messages for this long before writing them out */
+#define ZLOG_DEFER_DELAY_MS	10
+
+#define ZLOG_DALIGN(x)		(((x) + 7) & ~(size_t)7)
+
+enum zlog_darg {
+	ZLOG_DARG_NONE = 0,
+	ZLOG_DARG_INT,
+	ZLOG_DARG_LONG,
+	ZLOG_DARG_LLONG,
+	ZLOG_DARG_INTMAX,
+	ZLOG_DARG_SIZE,
+	ZLOG_DARG_PTRDIFF,
+	ZLOG_DARG_DOUBLE,
+	ZLOG_DARG_LDOUBLE,
+	ZLOG_DARG_PTR,
+	ZLOG_DARG_STRING,
+	/* printfrr extension on a small fixed-size value, which is copied */
+	ZLOG_DARG_COPY,
+	/* formatted when the message is logged, textarg is the argument */
+	ZLOG_DARG_TEXT,
+};
+
+static const struct {
+	char ext[3];
+	uint8_t size;
+} zlog_dcopy[] = {
+	{ "I4", sizeof(struct in_addr) },
+	{ "I6", sizeof(struct in6_addr) },
+};
+
+struct zlog_dspec {
+	/* '%' and one past the conversion character */
+	const char *start, *end;
+
+	enum zlog_darg arg, textarg;
+	bool wstar, pstar;
+	int prec;
+	size_t copysize;
+};
+
+/* one message in a ring, arguments follow in format string order */
+struct zlog_drec {
+	uint32_t len;
+	int prio;
+	const struct xref_logmsg *xref;
+	const char *fmt;
+	struct timespec ts;
+
+	uint8_t data[];
+};
+
+/* header for ZLOG_DARG_TEXT, followed by the text */
+struct zlog_dtext {
+	uint32_t len;
+	/* the conversion itself, the rest is padding & literal text */
+	uint16_t off_start, off_end;
+};
+
+struct zlog_dbuf {
+	uint8_t *pos, *end;
+};
+
+PREDECL_DLIST(zlog_drings);
+
+struct zlog_dring {
+	struct zlog_drings_item item;
+
+	intmax_t tid;
+	uint8_t *buf;
+
+	/* head is only written by the pthread owning the ring, tail only by
+	 * the pthread formatting the messages
+	 */
+	atomic_size_t head, tail;
+	atomic_bool dead;
+};
+
+DECLARE_DLIST(zlog_drings, struct zlog_dring, item);
+
+static pthread_mutex_t zlog_defer_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t zlog_defer_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t zlog_defer_drained = PTHREAD_COND_INITIALIZER;
+static struct zlog_drings_head zlog_drings = INIT_DLIST(zlog_drings);
+static pthread_t zlog_defer_pthread;
+static bool zlog_defer_running;
+/* zlog_set_deferred(false) is writing out what the writer left behind */
+static bool zlog_defer_stopping;
+
+static atomic_bool zlog_defer_enabled;
+
+/* what the writer is doing, to avoid waking it up for every message */
+enum zlog_defer_state {
+	ZLOG_DEFER_BUSY = 0,
+	/* waiting for messages, needs a wakeup */
+	ZLOG_DEFER_IDLE,
+	/* collecting messages, only needs a wakeup if a ring is filling up */
+	ZLOG_DEFER_DELAY,
+};
+static atomic_uint zlog_defer_state;
+
+/* ring pointer for pthreads that must not defer messages (the writer) */
+static struct zlog_dring zlog_dring_none;
+
+static struct zlog_msg zlog_defer_msgs[TLS_LOG_MAXMSG];
+static char zlog_defer_textbuf[TLS_LOG_MAXMSG][ZLOG_DEFER_TEXTSZ];
+
+static pthread_key_t zlog_defer_key;
+
+static void zlog_dring_exit(void *arg);
+static bool zlog_dring_drain(struct zlog_dring *ring);
+
+static void zlog_defer_key_init(void) __attribute__((_CONSTRUCTOR(500)));
+static void zlog_defer_key_init(void)
+{
+	pthread_key_create(&zlog_defer_key, zlog_dring_exit);
+}
+
+static bool zlog_dspec_parse(const char *fmt, struct zlog_dspec *ds)
+{
+	enum zlog_darg size = ZLOG_DARG_INT;
+	bool dot = false, ldbl = false;
+	const char *p;
+
+	memset(ds, 0, sizeof(*ds));
+	ds->start = fmt;
+	ds->prec = -1;
+
+	for (p = fmt + 1;; p++) {
+		switch (*p) {
+		case ' ':
+		case '#':
+		case '-':
+		case '+':
+		case '\'':
+		case 'h':
+			continue;
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			if (dot)
+				ds->prec = ds->prec * 10 + (*p - '0');
+			continue;
+		case '.':
+			dot = true;
+			ds->prec = 0;
+			continue;
+		case '*':
+			if (dot)
+				ds->pstar = true;
+			else
+				ds->wstar = true;
+			continue;
+		case 'l':
+			size = (size == ZLOG_DARG_LONG) ? ZLOG_DARG_LLONG
+							: ZLOG_DARG_LONG;
+			continue;
+		case 'q':
+			size = ZLOG_DARG_LLONG;
+			continue;
+		case 'j':
+			size = ZLOG_DARG_INTMAX;
+			continue;
+		case 'z':
+			size = ZLOG_DARG_SIZE;
+			continue;
+		case 't':
+			size = ZLOG_DARG_PTRDIFF;
+			continue;
+		case 'L':
+			ldbl = true;
+			continue;
+		case 'w':
+			if (p[1] == 'f')
+				p++;
+			if (p[1] == '8') {
+				size = ZLOG_DARG_INT;
+				p += 1;
+			} else if ((p[1] == '1' && p[2] == '6') ||
+				   (p[1] == '3' && p[2] == '2')) {
+				size = ZLOG_DARG_INT;
+				p += 2;
+			} else if (p[1] == '6' && p[2] == '4') {
+				size = ZLOG_DARG_LLONG;
+				p += 2;
+			} else
+				return false;
+			continue;
+		}
+		break;
+	}
+
+	ds->end = p + 1;
+
+	switch (*p) {
+	case 'd':
+	case 'i':
+		if (printfrr_ext_char(p[1])) {
+			ds->arg = ZLOG_DARG_TEXT;
+			ds->textarg = size;
+		} else
+			ds->arg = size;
+		return true;
+	case 'D':
+	case 'O':
+	case 'U':
+		ds->arg = ZLOG_DARG_LONG;
+		return true;
+	case 'b':
+	case 'B':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		ds->arg = size;
+		return true;
+	case 'c':
+		ds->arg = ZLOG_DARG_INT;
+		return size == ZLOG_DARG_INT;
+	case 'a':
+	case 'A':
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+		ds->arg = ldbl ? ZLOG_DARG_LDOUBLE : ZLOG_DARG_DOUBLE;
+		return true;
+	case 's':
+		ds->arg = ZLOG_DARG_STRING;
+		return size == ZLOG_DARG_INT;
+	case 'p':
+		if (!printfrr_ext_char(p[1])) {
+			ds->arg = ZLOG_DARG_PTR;
+			return true;
+		}
+
+		ds->arg = ZLOG_DARG_TEXT;
+		ds->textarg = ZLOG_DARG_PTR;
+
+		/* cf. zlog_dspec_rest() */
+		if (ds->end - ds->start + strcspn(ds->end, "%") > 128)
+			return true;
+		for (size_t i = 0; i < array_size(zlog_dcopy); i++)
+			if (!strncmp(p + 1, zlog_dcopy[i].ext, 2)) {
+				ds->arg = ZLOG_DARG_COPY;
+				ds->copysize = zlog_dcopy[i].size;
+			}
+		return true;
+	case 'm':
+		ds->arg = ZLOG_DARG_TEXT;
+		ds->textarg = ZLOG_DARG_NONE;
+		return true;
+	case '%':
+		ds->arg = ZLOG_DARG_NONE;
+		return true;
+	}
+	return false;
+}
+
+/* the conversion spec, with '*' replaced by the actual values */
+static bool zlog_dspec_build(const struct zlog_dspec *ds, char *out,
+			     size_t outsz, int width, int prec)
+{
+	struct fbuf fb = {
+		.buf = out,
+		.pos = out,
+		.len = outsz,
+	};
+	const char *p;
+	bool dot = false;
+	size_t need = 0;
+
+	for (p = ds->start; p < ds->end; p++) {
+		if (*p == '.') {
+			dot = true;
+			/* negative precision is the same as none */
+			if (p[1] == '*' && prec < 0) {
+				p++;
+				continue;
+			}
+		}
+		if (*p == '*')
+			need += bprintfrr(&fb, "%d", dot ? prec : width);
+		else
+			need += bputch(&fb, *p);
+	}
+	need += bputch(&fb, '\0');
+	return need <= outsz;
+}
+
+/* printfrr extensions may consume characters following them, so pass them
+ * everything up to the next conversion
+ */
+static bool zlog_dspec_rest(const struct zlog_dspec *ds, char *out,
+			    size_t outsz, int width, int prec)
+{
+	size_t speclen, rest;
+
+	if (!zlog_dspec_build(ds, out, outsz, width, prec))
+		return false;
+
+	speclen = strlen(out);
+	rest = strcspn(ds->end, "%");
+	if (speclen + rest >= outsz)
+		return false;
+	memcpy(out + speclen, ds->end, rest);
+	out[speclen + rest] = '\0';
+	return true;
+}
+
+static void *zlog_dbuf_put(struct zlog_dbuf *db, const void *data, size_t len)
+{
+	uint8_t *pos = db->pos;
+
+	if ((size_t)(db->end - pos) < ZLOG_DALIGN(len))
+		return NULL;
+	if (data)
+		memcpy(pos, data, len);
+	db->pos += ZLOG_DALIGN(len);
+	return pos;
+}
+
+static const void *zlog_dbuf_get(struct zlog_dbuf *db, void *data, size_t len)
+{
+	uint8_t *pos = db->pos;
+
+	if (data)
+		memcpy(data, pos, len);
+	db->pos += ZLOG_DALIGN(len);
+	return pos;
+}
+
+static uintmax_t zlog_darg_get(enum zlog_darg arg, va_list *ap)
+{
+	switch (arg) {
+	case ZLOG_DARG_LONG:
+		return va_arg(*ap, long);
+	case ZLOG_DARG_LLONG:
+		return va_arg(*ap, long long);
+	case ZLOG_DARG_INTMAX:
+		return va_arg(*ap, intmax_t);
+	case ZLOG_DARG_SIZE:
+		return va_arg(*ap, size_t);
+	case ZLOG_DARG_PTRDIFF:
+		return va_arg(*ap, ptrdiff_t);
+	case ZLOG_DARG_PTR:
+		return (uintptr_t)va_arg(*ap, void *);
+	default:
+		return va_arg(*ap, int);
+	}
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+/* spec was checked along with the format string it came from */
+static ssize_t zlog_darg_print(struct fbuf *fb, const char *spec,
+			       enum zlog_darg arg, uintmax_t val)
+{
+	switch (arg) {
+	case ZLOG_DARG_NONE:
+		return bprintfrr(fb, spec);
+	case ZLOG_DARG_LONG:
+		return bprintfrr(fb, spec, (long)val);
+	case ZLOG_DARG_LLONG:
+		return bprintfrr(fb, spec, (long long)val);
+	case ZLOG_DARG_INTMAX:
+		return bprintfrr(fb, spec, (intmax_t)val);
+	case ZLOG_DARG_SIZE:
+		return bprintfrr(fb, spec, (size_t)val);
+	case ZLOG_DARG_PTRDIFF:
+		return bprintfrr(fb, spec, (ptrdiff_t)val);
+	case ZLOG_DARG_PTR:
+		return bprintfrr(fb, spec, (void *)(uintptr_t)val);
+	default:
+		return bprintfrr(fb, spec, (int)val);
+	}
+}
+#pragma GCC diagnostic pop
+
+/* format a printfrr extension or %m into the record right away */
+static bool zlog_defer_text(struct zlog_dbuf *db, const struct zlog_dspec *ds,
+			    int width, int prec, va_list *ap, int saved_errno)
+{
+	struct zlog_dtext *dt;
+	struct fmt_outpos outpos = {};
+	struct fbuf fb;
+	char spec[256];
+	ssize_t len;
+	uintmax_t val = 0;
+
+	if (!zlog_dspec_rest(ds, spec, sizeof(spec), width, prec))
+		return false;
+
+	dt = zlog_dbuf_put(db, NULL, sizeof(*dt));
+	if (!dt)
+		return false;
+
+	fb.buf = fb.pos = (char *)db->pos;
+	fb.len = db->end - db->pos;
+	fb.outpos = &outpos;
+	fb.outpos_n = 1;
+	fb.outpos_i = 0;
+
+	if (ds->textarg != ZLOG_DARG_NONE)
+		val = zlog_darg_get(ds->textarg, ap);
+
+	errno = saved_errno;
+	len = zlog_darg_print(&fb, spec, ds->textarg, val);
+	if (len < 0 || !zlog_dbuf_put(db, NULL, len))
+		return false;
+
+	if (!fb.outpos_i)
+		outpos.off_end = len;
+	dt->len = len;
+	dt->off_start = outpos.off_start;
+	dt->off_end = outpos.off_end;
+	return true;
+}
+
+static bool zlog_defer_encode(struct zlog_dbuf *db, const char *fmt,
+			      va_list *ap, int saved_errno)
+{
+	struct zlog_dspec ds;
+	const char *p, *s;
+	int width = 0, prec = -1;
+	uintmax_t val;
+	double dval;
+	long double ldval;
+	uint32_t len;
+
+	for (p = strchr(fmt, '%'); p; p = strchr(ds.end, '%')) {
+		/* zlog_defer_print() needs to fit it in spec[] */
+		if (!zlog_dspec_parse(p, &ds) || ds.end - ds.start > 32)
+			return false;
+
+		prec = ds.prec;
+		if (ds.wstar) {
+			width = va_arg(*ap, int);
+			if (!zlog_dbuf_put(db, &width, sizeof(width)))
+				return false;
+		}
+		if (ds.pstar) {
+			prec = va_arg(*ap, int);
+			if (!zlog_dbuf_put(db, &prec, sizeof(prec)))
+				return false;
+		}
+
+		switch (ds.arg) {
+		case ZLOG_DARG_NONE:
+			break;
+		case ZLOG_DARG_DOUBLE:
+			dval = va_arg(*ap, double);
+			if (!zlog_dbuf_put(db, &dval, sizeof(dval)))
+				return false;
+			break;
+		case ZLOG_DARG_LDOUBLE:
+			ldval = va_arg(*ap, long double);
+			if (!zlog_dbuf_put(db, &ldval, sizeof(ldval)))
+				return false;
+			break;
+		case ZLOG_DARG_STRING:
+			s = va_arg(*ap, const char *);
+			if (!s)
+				s = "(null)";
+			len = (prec >= 0) ? strnlen(s, prec) : strlen(s);
+			if (!zlog_dbuf_put(db, &len, sizeof(len)))
+				return false;
+			if ((size_t)(db->end - db->pos) < ZLOG_DALIGN(len + 1))
+				return false;
+			memcpy(db->pos, s, len);
+			db->pos[len] = '\0';
+			db->pos += ZLOG_DALIGN(len + 1);
+			break;
+		case ZLOG_DARG_COPY:
+			s = va_arg(*ap, const char *);
+			len = s ? ds.copysize : 0;
+			if (!zlog_dbuf_put(db, &len, sizeof(len)) ||
+			    !zlog_dbuf_put(db, s, len))
+				return false;
+			break;
+		case ZLOG_DARG_TEXT:
+			if (!zlog_defer_text(db, &ds, width, prec, ap,
+					     saved_errno))
+				return false;
+			break;
+		default:
+			val = zlog_darg_get(ds.arg, ap);
+			if (!zlog_dbuf_put(db, &val, sizeof(val)))
+				return false;
+			break;
+		}
+	}
+	return true;
+}
+
+static ssize_t zlog_bputn(struct fbuf *fb, const char *text, size_t len)
+{
+	size_t ncopy = MIN(len, (size_t)(fb->buf + fb->len - fb->pos));
+
+	memcpy(fb->pos, text, ncopy);
+	fb->pos += ncopy;
+	return len;
+}
+
+/* counterpart to zlog_defer_encode(), on the writer pthread */
+static ssize_t zlog_defer_print(struct fbuf *fb, const char *fmt,
+				const uint8_t *data)
+{
+	struct zlog_dbuf db = { .pos = (uint8_t *)data };
+	const struct zlog_dtext *dt;
+	struct fmt_outpos *outpos;
+	struct zlog_dspec ds;
+	const char *p = fmt, *pct;
+	char spec[256];
+	int width = 0, prec;
+	uintmax_t val;
+	double dval;
+	long double ldval;
+	uint32_t len;
+	ssize_t need = 0;
+
+	while ((pct = strchr(p, '%'))) {
+		need += zlog_bputn(fb, p, pct - p);
+
+		zlog_dspec_parse(pct, &ds);
+		p = ds.end;
+
+		prec = ds.prec;
+		if (ds.wstar)
+			zlog_dbuf_get(&db, &width, sizeof(width));
+		if (ds.pstar)
+			zlog_dbuf_get(&db, &prec, sizeof(prec));
+
+		if (ds.arg == ZLOG_DARG_COPY)
+			zlog_dspec_rest(&ds, spec, sizeof(spec), width, prec);
+		else if (ds.arg != ZLOG_DARG_TEXT)
+			zlog_dspec_build(&ds, spec, sizeof(spec), width, prec);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+		switch (ds.arg) {
+		case ZLOG_DARG_NONE:
+			need += bprintfrr(fb, spec);
+			break;
+		case ZLOG_DARG_DOUBLE:
+			zlog_dbuf_get(&db, &dval, sizeof(dval));
+			need += bprintfrr(fb, spec, dval);
+			break;
+		case ZLOG_DARG_LDOUBLE:
+			zlog_dbuf_get(&db, &ldval, sizeof(ldval));
+			need += bprintfrr(fb, spec, ldval);
+			break;
+		case ZLOG_DARG_STRING:
+			zlog_dbuf_get(&db, &len, sizeof(len));
+			need += bprintfrr(fb, spec, (const char *)db.pos);
+			zlog_dbuf_get(&db, NULL, len + 1);
+			break;
+		case ZLOG_DARG_COPY:
+			zlog_dbuf_get(&db, &len, sizeof(len));
+			need += bprintfrr(fb, spec, len ? db.pos : NULL);
+			zlog_dbuf_get(&db, NULL, len);
+			p += strcspn(p, "%");
+			break;
+		case ZLOG_DARG_TEXT:
+			dt = zlog_dbuf_get(&db, NULL, sizeof(*dt));
+			if (fb->outpos && fb->outpos_i < fb->outpos_n) {
+				outpos = &fb->outpos[fb->outpos_i++];
+				outpos->off_start = fb->pos - fb->buf +
+						    dt->off_start;
+				outpos->off_end = fb->pos - fb->buf +
+						  dt->off_end;
+			}
+			need += zlog_bputn(fb, (const char *)db.pos, dt->len);
+			zlog_dbuf_get(&db, NULL, dt->len);
+			p += strcspn(p, "%");
+			break;
+		default:
+			zlog_dbuf_get(&db, &val, sizeof(val));
+			need += zlog_darg_print(fb, spec, ds.arg, val);
+			break;
+		}
+#pragma GCC diagnostic pop
+	}
+	need += zlog_bputn(fb, p, strlen(p));
+	return need;
+}
+
+static void zlog_defer_kick(void)
+{
+	pthread_mutex_lock(&zlog_defer_mtx);
+	atomic_store_explicit(&zlog_defer_state, ZLOG_DEFER_BUSY,
+			      memory_order_relaxed);
+	pthread_cond_signal(&zlog_defer_wake);
+	pthread_mutex_unlock(&zlog_defer_mtx);
+}
+
+static struct zlog_dring *zlog_dring_new(void)
+{
+	struct zlog_dring *ring;
+
+	ring = XCALLOC(MTYPE_LOG_DEFER, sizeof(*ring));
+	ring->buf = XMALLOC(MTYPE_LOG_DEFER, ZLOG_DEFER_RINGSZ);
+#ifdef CAN_DO_TLS
+	ring->tid = zlog_gettid();
+#else
+	ring->tid = (intmax_t)getpid();
+#endif
+
+	pthread_mutex_lock(&zlog_defer_mtx);
+	zlog_drings_add_tail(&zlog_drings, ring);
+	pthread_mutex_unlock(&zlog_defer_mtx);
+
+	pthread_setspecific(zlog_defer_key, ring);
+	return ring;
+}
+
+/* pthread exit, the writer frees the ring after emptying it.  Without a
+ * writer nobody else would, so write it out and free it here.
+ */
+static void zlog_dring_exit(void *arg)
+{
+	struct zlog_dring *ring = arg;
+
+	if (ring == &zlog_dring_none)
+		return;
+
+	pthread_mutex_lock(&zlog_defer_mtx);
+	while (zlog_defer_stopping)
+		pthread_cond_wait(&zlog_defer_drained, &zlog_defer_mtx);
+	if (zlog_defer_running) {
+		atomic_store_explicit(&ring->dead, true, memory_order_release);
+		atomic_store_explicit(&zlog_defer_state, ZLOG_DEFER_BUSY,
+				      memory_order_relaxed);
+		pthread_cond_signal(&zlog_defer_wake);
+		pthread_mutex_unlock(&zlog_defer_mtx);
+		return;
+	}
+	zlog_dring_drain(ring);
+	zlog_drings_del(&zlog_drings, ring);
+	pthread_mutex_unlock(&zlog_defer_mtx);
+
+	XFREE(MTYPE_LOG_DEFER, ring->buf);
+	XFREE(MTYPE_LOG_DEFER, ring);
+}
+
+/* wait until there are at least space bytes free in the ring */
+static bool zlog_dring_wait(struct zlog_dring *ring, size_t space)
+{
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	bool ret = true;
+
+#define zlog_dring_free(ring)                                                  \
+	(ZLOG_DEFER_RINGSZ -                                                   \
+	 (head - atomic_load_explicit(&(ring)->tail, memory_order_acquire)))
+
+	if (zlog_dring_free(ring) >= space)
+		return true;
+
+	pthread_mutex_lock(&zlog_defer_mtx);
+	while (zlog_dring_free(ring) < space) {
+		if (!zlog_defer_running) {
+			ret = false;
+			break;
+		}
+		pthread_cond_signal(&zlog_defer_wake);
+		pthread_cond_wait(&zlog_defer_drained, &zlog_defer_mtx);
+	}
+	pthread_mutex_unlock(&zlog_defer_mtx);
+
+#undef zlog_dring_free
+	return ret;
+}
+
+/* Write out a pthread's own ring after deferral was turned off under it.
+ * Only safe to drain here once the writer is gone and zlog_set_deferred()
+ * is done with the rings.
+ */
+static void zlog_dring_flush(struct zlog_dring *ring)
+{
+	pthread_mutex_lock(&zlog_defer_mtx);
+	while (zlog_defer_stopping)
+		pthread_cond_wait(&zlog_defer_drained, &zlog_defer_mtx);
+	if (zlog_defer_running)
+		/* turned back on in the meantime, leave it to the writer */
+		pthread_cond_signal(&zlog_defer_wake);
+	else
+		zlog_dring_drain(ring);
+	pthread_mutex_unlock(&zlog_defer_mtx);
+}
+
+static bool vzlog_deferred(const struct xref_logmsg *xref, int prio,
+			   const char *fmt, va_list ap)
+{
+	struct zlog_dring *ring;
+	struct zlog_drec *rec;
+	struct zlog_dbuf db;
+	size_t head, off, skip = 0;
+	unsigned int state;
+	int saved_errno = errno;
+	va_list args;
+	bool ok;
+
+	ring = pthread_getspecific(zlog_defer_key);
+	if (ring == &zlog_dring_none)
+		return false;
+
+	if (!atomic_load_explicit(&zlog_defer_enabled, memory_order_seq_cst)) {
+		/* write out earlier messages first to keep them in order */
+		if (ring)
+			zlog_dring_flush(ring);
+		errno = saved_errno;
+		return false;
+	}
+
+	if ((prio & LOG_PRIMASK) < LOG_INFO) {
+		/* keep the order with this pthread's deferred messages */
+		if (ring)
+			zlog_dring_wait(ring, ZLOG_DEFER_RINGSZ);
+		errno = saved_errno;
+		return false;
+	}
+
+	if (!zlog_wanted(prio))
+		return true;
+	if (!ring)
+		ring = zlog_dring_new();
+
+	/* records don't wrap around the end of the ring */
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	off = head % ZLOG_DEFER_RINGSZ;
+	if (ZLOG_DEFER_RINGSZ - off < ZLOG_DEFER_RECMAX)
+		skip = ZLOG_DEFER_RINGSZ - off;
+
+	if (!zlog_dring_wait(ring, skip + ZLOG_DEFER_RECMAX)) {
+		errno = saved_errno;
+		return false;
+	}
+
+	rec = (struct zlog_drec *)(ring->buf + (off + skip) % ZLOG_DEFER_RINGSZ);
+	db.pos = rec->data;
+	db.end = (uint8_t *)rec + ZLOG_DEFER_RECMAX;
+
+	va_copy(args, ap);
+	ok = zlog_defer_encode(&db, fmt, &args, saved_errno);
+	va_end(args);
+
+	if (!ok) {
+		zlog_dring_wait(ring, ZLOG_DEFER_RINGSZ);
+		errno = saved_errno;
+		return false;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &rec->ts);
+	rec->len = db.pos - (uint8_t *)rec;
+	rec->prio = prio & LOG_PRIMASK;
+	rec->xref = xref;
+	rec->fmt = fmt;
+
+	/* pairs with zlog_defer_run() going idle and then checking the
+	 * rings
+	 */
+	head += skip + rec->len;
+	atomic_store_explicit(&ring->head, head, memory_order_seq_cst);
+
+	/* Pairs with zlog_set_deferred(false) clearing the flag before
+	 * emptying the rings: if it's still set, the record is written out
+	 * there at the latest.  Otherwise the writer may already be gone.
+	 */
+	if (!atomic_load_explicit(&zlog_defer_enabled, memory_order_seq_cst)) {
+		zlog_dring_flush(ring);
+		errno = saved_errno;
+		return true;
+	}
+
+	state = atomic_load_explicit(&zlog_defer_state, memory_order_seq_cst);
+	if (state == ZLOG_DEFER_IDLE ||
+	    (state == ZLOG_DEFER_DELAY &&
+	     head - atomic_load_explicit(&ring->tail, memory_order_relaxed) >
+		     ZLOG_DEFER_RINGSZ / 2))
+		zlog_defer_kick();
+
+	errno = saved_errno;
+	return true;
+}
+
+static void zlog_defer_deliver(struct zlog_msg **msgp, size_t nmsgs)
+{
+	struct zlog_target *zt;
+	size_t i;
+
+	rcu_read_lock();
+	frr_each_safe (zlog_targets, &zlog_targets, zt) {
+		if (!zt->logfn)
+			continue;
+
+		zt->logfn(zt, msgp, nmsgs);
+	}
+	rcu_read_unlock();
+
+	for (i = 0; i < nmsgs; i++)
+		if (msgp[i]->text && msgp[i]->text != msgp[i]->stackbuf)
+			XFREE(MTYPE_LOG_MESSAGE, msgp[i]->text);
+}
+
+/* set up a message for a record from a ring */
+static void zlog_drec_msg(const struct zlog_dring *ring,
+			  const struct zlog_drec *rec, intmax_t pid,
+			  struct zlog_msg *msg, char *textbuf,
+			  size_t textbufsz)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->ts = rec->ts;
+	msg->prio = rec->prio;
+	msg->xref = rec->xref;
+	msg->fmt = rec->fmt;
+	msg->dargs = rec->data;
+	msg->pid = pid;
+	msg->tid = ring->tid;
+	msg->stackbuf = textbuf;
+	msg->stackbufsz = textbufsz;
+}
+
+/* write out messages queued in a ring, returns whether there were any */
+static bool zlog_dring_drain(struct zlog_dring *ring)
+{
+	struct zlog_msg *msgp[TLS_LOG_MAXMSG];
+	const struct zlog_drec *rec;
+	size_t tail, head, off, n;
+	intmax_t pid = (intmax_t)getpid();
+
+	tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	if (tail == head)
+		return false;
+
+	while (tail != head) {
+		for (n = 0; tail != head && n < array_size(msgp);) {
+			off = tail % ZLOG_DEFER_RINGSZ;
+			if (ZLOG_DEFER_RINGSZ - off < ZLOG_DEFER_RECMAX) {
+				tail += ZLOG_DEFER_RINGSZ - off;
+				continue;
+			}
+			rec = (const struct zlog_drec *)(ring->buf + off);
+			tail += rec->len;
+
+			zlog_drec_msg(ring, rec, pid, &zlog_defer_msgs[n],
+				      zlog_defer_textbuf[n],
+				      sizeof(zlog_defer_textbuf[n]));
+			msgp[n] = &zlog_defer_msgs[n];
+			n++;
+		}
+
+		if (n)
+			zlog_defer_deliver(msgp, n);
+		atomic_store_explicit(&ring->tail, tail, memory_order_release);
+	}
+	return true;
+}
+
+/* called with zlog_defer_mtx held, which is dropped while writing out
+ * messages so that logging pthreads don't wait on the log targets
+ */
+static bool zlog_defer_drain_all(void)
+{
+	struct zlog_dring *ring;
+	bool busy = false, dead;
+
+	/* rings are only removed here, others just add theirs at the end */
+	frr_each_safe (zlog_drings, &zlog_drings, ring) {
+		dead = atomic_load_explicit(&ring->dead, memory_order_acquire);
+
+		pthread_mutex_unlock(&zlog_defer_mtx);
+		busy |= zlog_dring_drain(ring);
+		pthread_mutex_lock(&zlog_defer_mtx);
+
+		if (!dead)
+			continue;
+
+		zlog_drings_del(&zlog_drings, ring);
+		XFREE(MTYPE_LOG_DEFER, ring->buf);
+		XFREE(MTYPE_LOG_DEFER, ring);
+	}
+	return busy;
+}
+
+static bool zlog_defer_pending(void)
+{
+	struct zlog_dring *ring;
+
+	frr_each (zlog_drings, &zlog_drings, ring)
+		if (atomic_load_explicit(&ring->dead, memory_order_relaxed) ||
+		    atomic_load_explicit(&ring->head, memory_order_seq_cst) !=
+			    atomic_load_explicit(&ring->tail,
+						 memory_order_relaxed))
+			return true;
+	return false;
+}
+
+static void *zlog_defer_run(void *arg)
+{
+	struct rcu_thread *rcu_thread = arg;
+	struct timespec until;
+
+	rcu_thread_start(rcu_thread);
+	/* only hold RCU while handing messages to the targets */
+	rcu_read_unlock();
+
+	pthread_setspecific(zlog_defer_key, &zlog_dring_none);
+
+	pthread_mutex_lock(&zlog_defer_mtx);
+	while (zlog_defer_running) {
+		atomic_store_explicit(&zlog_defer_state, ZLOG_DEFER_BUSY,
+				      memory_order_relaxed);
+		zlog_defer_drain_all();
+		pthread_cond_broadcast(&zlog_defer_drained);
+
+		atomic_store_explicit(&zlog_defer_state, ZLOG_DEFER_IDLE,
+				      memory_order_seq_cst);
+		/* zlog_defer_running may have been cleared while the lock
+		 * was dropped for draining, the wakeup for that is gone
+		 */
+		if (zlog_defer_running && !zlog_defer_pending())
+			pthread_cond_wait(&zlog_defer_wake, &zlog_defer_mtx);
+		if (!zlog_defer_running)
+			break;
+
+		atomic_store_explicit(&zlog_defer_state, ZLOG_DEFER_DELAY,
+				      memory_order_relaxed);
+		clock_gettime(CLOCK_REALTIME, &until);
+		until.tv_nsec += ZLOG_DEFER_DELAY_MS * 1000000;
+		if (until.tv_nsec >= 1000000000) {
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&zlog_defer_wake, &zlog_defer_mtx,
+				       &until);
+	}
+	zlog_defer_drain_all();
+	pthread_cond_broadcast(&zlog_defer_drained);
+	pthread_mutex_unlock(&zlog_defer_mtx);
+	return NULL;
+}
+
+void zlog_set_deferred(bool set_p)
+{
+	struct rcu_thread *rcu_thread;
+	struct zlog_dring *ring;
+	sigset_t oldsigs, blocksigs;
+	int ret;
+
+	if (set_p == atomic_load_explicit(&zlog_defer_enabled,
+					  memory_order_relaxed))
+		return;
+
+	if (!set_p) {
+		atomic_store_explicit(&zlog_defer_enabled, false,
+				      memory_order_seq_cst);
+
+		pthread_mutex_lock(&zlog_defer_mtx);
+		zlog_defer_running = false;
+		zlog_defer_stopping = true;
+		pthread_cond_signal(&zlog_defer_wake);
+		pthread_mutex_unlock(&zlog_defer_mtx);
+
+		pthread_join(zlog_defer_pthread, NULL);
+
+		/* Pthreads that were already in vzlog_deferred() may have
+		 * added messages after the writer's last look at their ring.
+		 * Those that see the flag cleared wait for this and then
+		 * write out their own ring, cf. zlog_dring_flush().
+		 */
+		atomic_thread_fence(memory_order_seq_cst);
+
+		pthread_mutex_lock(&zlog_defer_mtx);
+		zlog_defer_drain_all();
+		zlog_defer_stopping = false;
+		pthread_cond_broadcast(&zlog_defer_drained);
+
+		/* drop our own ring, the others may be in use */
+		ring = pthread_getspecific(zlog_defer_key);
+		if (ring)
+			zlog_drings_del(&zlog_drings, ring);
+		pthread_mutex_unlock(&zlog_defer_mtx);
+
+		if (ring) {
+			pthread_setspecific(zlog_defer_key, NULL);
+			XFREE(MTYPE_LOG_DEFER, ring->buf);
+			XFREE(MTYPE_LOG_DEFER, ring);
+		}
+		return;
+	}
+
+	/* the writer must never handle signals */
+	sigfillset(&blocksigs);
+	pthread_sigmask(SIG_BLOCK, &blocksigs, &oldsigs);
+
+	pthread_mutex_lock(&zlog_defer_mtx);
+	zlog_defer_running = true;
+	rcu_thread = rcu_thread_prepare();
+	ret = pthread_create(&zlog_defer_pthread, NULL, zlog_defer_run,
+			     rcu_thread);
+	if (ret) {
+		zlog_defer_running = false;
+		rcu_thread_unprepare(rcu_thread);
+	}
+	pthread_mutex_unlock(&zlog_defer_mtx);
+
+	pthread_sigmask(SIG_SETMASK, &oldsigs, NULL);
+
+	if (ret) {
+		zlog_err("failed to start log writer pthread: %s",
+			 strerror(ret));
+		return;
+	}
+	atomic_store_explicit(&zlog_defer_enabled, true, memory_order_relaxed);
+}
+
+bool zlog_get_deferred(void)
+{
+	return atomic_load_explicit(&zlog_defer_enabled, memory_order_relaxed);
+}
+
+/* Crash handler: write out the messages still waiting in the rings, one at
+ * a time to keep off the writer's buffers.  The writer may be writing some
+ * of them out at the same time, which can duplicate a few messages.  If the
+ * ring list is locked, it might be changing, so it is left alone.
+ */
+void zlog_deferred_crash_flush(void)
+{
+	struct zlog_msg msg, *msgp = &msg;
+	char textbuf[ZLOG_DEFER_TEXTSZ];
+	const struct zlog_drec *rec;
+	struct zlog_dring *ring;
+	size_t tail, head, off;
+	intmax_t pid;
+
+	/* the writer crashing on a message would just do so again */
+	if (pthread_getspecific(zlog_defer_key) == &zlog_dring_none)
+		return;
+	if (pthread_mutex_trylock(&zlog_defer_mtx))
+		return;
+
+	pid = (intmax_t)getpid();
+	frr_each (zlog_drings, &zlog_drings, ring) {
+		tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+		head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+		while (tail != head) {
+			off = tail % ZLOG_DEFER_RINGSZ;
+			if (ZLOG_DEFER_RINGSZ - off < ZLOG_DEFER_RECMAX) {
+				tail += ZLOG_DEFER_RINGSZ - off;
+				continue;
+			}
+			rec = (const struct zlog_drec *)(ring->buf + off);
+			tail += rec->len;
+
+			zlog_drec_msg(ring, rec, pid, &msg, textbuf,
+				      sizeof(textbuf));
+			zlog_defer_deliver(&msgp, 1);
+		}
+	}
+	pthread_mutex_unlock(&zlog_defer_mtx);
+}
+
 /* reinject log message received by zlog_recirculate_recv().  As of writing,
  * only used in the ldpd parent process to proxy messages from lde/ldpe
  * subprocesses.
@@ -718,7 +1819,10 @@ void vzlogx(const struct xref_logmsg *xref, int prio,
 	XFREE(MTYPE_LOG_MESSAGE, msg);
 #endif
 
-	if (zlog_tls)
+	if (atomic_load_explicit(&zlog_defer_enabled, memory_order_relaxed) &&
+	    !zlog_default_immediate && vzlog_deferred(xref, prio, fmt, ap))
+		;
+	else if (zlog_tls)
 		vzlog_tls(zlog_tls, xref, prio, fmt, ap);
 	else
 		vzlog_notls(xref, prio, fmt, ap);
@@ -799,10 +1903,27 @@ const struct xref_logmsg *zlog_msg_xref(struct zlog_msg *msg)
 	return msg->xref;
 }
 
+static ssize_t zlog_msg_vbprintfrr(struct zlog_msg *msg, struct fbuf *fb)
+{
+	va_list args;
+	ssize_t ret;
+
+	if (msg->dargs)
+		return zlog_defer_print(fb, msg->fmt, msg->dargs);
+
+	va_copy(args, msg->args);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+	/* format-string checking is done further up the chain */
+	ret = vbprintfrr(fb, msg->fmt, args);
+#pragma GCC diagnostic pop
+	va_end(args);
+	return ret;
+}
+
 const char *zlog_msg_text(struct zlog_msg *msg, size_t *textlen)
 {
 	if (!msg->text) {
-		va_list args;
 		bool do_xid, do_ec;
 		size_t need = 0, hdrlen;
 		struct fbuf fb = {
@@ -831,13 +1952,7 @@ const char *zlog_msg_text(struct zlog_msg *msg, size_t *textlen)
 		fb.outpos_n = array_size(msg->argpos);
 		fb.outpos_i = 0;
 
-		va_copy(args, msg->args);
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat-nonliteral"
-		/* format-string checking is done further up the chain */
-		need += vbprintfrr(&fb, msg->fmt, args);
-#pragma GCC diagnostic pop
-		va_end(args);
+		need += zlog_msg_vbprintfrr(msg, &fb);
 
 		msg->textlen = need;
 		need += bputch(&fb, '\n');
@@ -854,13 +1969,7 @@ const char *zlog_msg_text(struct zlog_msg *msg, size_t *textlen)
 			fb.pos = msg->text + hdrlen;
 			fb.outpos_i = 0;
 
-			va_copy(args, msg->args);
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wformat-nonliteral"
-			/* same as above */
-			vbprintfrr(&fb, msg->fmt, args);
-#pragma GCC diagnostic pop
-			va_end(args);
+			zlog_msg_vbprintfrr(msg, &fb);
 
 			bputch(&fb, '\n');
 		}
@@ -185,8 +185,8 @@ extern void zlog_msg_tsraw(struct zlog_msg *msg, struct timespec *ts);
 extern size_t zlog_msg_ts_3164(struct zlog_msg *msg, struct fbuf *out,
 			       uint32_t flags);
 
-/* currently just returns the current PID/TID since we never write another
- * thread's messages
+/* PID/TID of the pthread that logged the message, which is not the current
+ * one for recirculated and deferred messages
  */
 extern void zlog_msg_pid(struct zlog_msg *msg, intmax_t *pid, intmax_t *tid);
 
@@ -281,6 +281,14 @@ extern void zlog_tls_buffer_fini(void);
 extern void zlog_set_immediate(bool set_p);
 bool zlog_get_immediate_mode(void);
 
+/* Format debug & informational messages on a background pthread instead of
+ * the one logging them.  Cf. "deferred formatting" in zlog.c.
+ */
+extern void zlog_set_deferred(bool set_p);
+extern bool zlog_get_deferred(void);
+/* for the crash handler, writes out deferred messages not logged yet */
+extern void zlog_deferred_crash_flush(void);
+
 extern const char *zlog_priority_str(int priority);
 
 #ifdef __cplusplus
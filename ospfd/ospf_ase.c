@@ -637,6 +637,52 @@ void ospf_ase_calculate_timer_add(struct ospf *ospf)
 			OSPF_ASE_CALC_INTERVAL, &ospf->t_ase_calc);
 }
 
+/* The LSAs in external_asbrs and external_fwds are held by external_lsas. */
+static void ospf_ase_index_add(struct route_table *index, struct in_addr addr,
+			       struct ospf_lsa *lsa)
+{
+	struct route_node *rn;
+	struct prefix_ipv4 p;
+	struct list *lst;
+
+	p.family = AF_INET;
+	p.prefix = addr;
+	p.prefixlen = IPV4_MAX_BITLEN;
+
+	rn = route_node_get(index, (struct prefix *)&p);
+	if ((lst = rn->info) == NULL)
+		rn->info = lst = list_new();
+	else
+		route_unlock_node(rn);
+
+	listnode_add(lst, lsa);
+}
+
+static void ospf_ase_index_del(struct route_table *index, struct in_addr addr,
+			       struct ospf_lsa *lsa)
+{
+	struct route_node *rn;
+	struct prefix_ipv4 p;
+	struct list *lst;
+
+	p.family = AF_INET;
+	p.prefix = addr;
+	p.prefixlen = IPV4_MAX_BITLEN;
+
+	rn = route_node_lookup(index, (struct prefix *)&p);
+	if (!rn)
+		return;
+	route_unlock_node(rn);
+
+	lst = rn->info;
+	listnode_delete(lst, lsa);
+	if (list_isempty(lst)) {
+		list_delete(&lst);
+		rn->info = NULL;
+		route_unlock_node(rn);
+	}
+}
+
 void ospf_ase_register_external_lsa(struct ospf_lsa *lsa, struct ospf *top)
 {
 	struct route_node *rn;
@@ -659,6 +705,12 @@ void ospf_ase_register_external_lsa(struct ospf_lsa *lsa, struct ospf *top)
 	/* We assume that if LSA is deleted from DB
 	   is is also deleted from this RT */
 	listnode_add(lst, ospf_lsa_lock(lsa)); /* external_lsas lst */
+
+	ospf_ase_index_add(top->external_asbrs, lsa->data->adv_router, lsa);
+	if (al->e[0].fwd_addr.s_addr != INADDR_ANY) {
+		ospf_ase_index_add(top->external_fwds, al->e[0].fwd_addr, lsa);
+		top->external_fwd_addrs++;
+	}
 }
 
 void ospf_ase_unregister_external_lsa(struct ospf_lsa *lsa, struct ospf *top)
@@ -681,6 +733,13 @@ void ospf_ase_unregister_external_lsa(struct ospf_lsa *lsa, struct ospf *top)
 		struct listnode *node = listnode_lookup(lst, lsa);
 		/* Unlock lsa only if node is present in the list */
 		if (node) {
+			ospf_ase_index_del(top->external_asbrs,
+					   lsa->data->adv_router, lsa);
+			if (al->e[0].fwd_addr.s_addr != INADDR_ANY) {
+				ospf_ase_index_del(top->external_fwds,
+						   al->e[0].fwd_addr, lsa);
+				top->external_fwd_addrs--;
+			}
 			listnode_delete(lst, lsa);
 			ospf_lsa_unlock(&lsa); /* external_lsas list */
 		}
@@ -706,6 +765,18 @@ void ospf_ase_external_lsas_finish(struct route_table *rt)
 	route_table_finish(rt);
 }
 
+void ospf_ase_external_index_finish(struct route_table *rt)
+{
+	struct route_node *rn;
+	struct list *lst;
+
+	for (rn = route_top(rt); rn; rn = route_next(rn))
+		if ((lst = rn->info) != NULL)
+			list_delete(&lst);
+
+	route_table_finish(rt);
+}
+
 void ospf_ase_incremental_update(struct ospf *ospf, struct ospf_lsa *lsa)
 {
 	struct list *lsas;
@@ -787,3 +858,221 @@ void ospf_ase_incremental_update(struct ospf *ospf, struct ospf_lsa *lsa)
 
 	route_table_finish(tmp_old);
 }
+
+/* Recalculate the external route to a prefix, after its internal route
+ * went away. */
+void ospf_ase_prefix_update(struct ospf *ospf, struct prefix_ipv4 *p)
+{
+	struct route_node *rn;
+	struct list *lsas;
+
+	rn = route_node_lookup(ospf->external_lsas, (struct prefix *)p);
+	if (!rn)
+		return;
+	route_unlock_node(rn);
+
+	lsas = rn->info;
+	if (lsas && listcount(lsas))
+		ospf_ase_incremental_update(ospf, listgetdata(listhead(lsas)));
+}
+
+static void ospf_ase_dirty_set(struct route_table *dirty, struct prefix *p)
+{
+	struct route_node *rn;
+
+	rn = route_node_get(dirty, p);
+	if (rn->info)
+		route_unlock_node(rn);
+	else
+		rn->info = (void *)1;
+}
+
+static void ospf_ase_dirty_add(struct route_table *dirty, struct list *lsas)
+{
+	struct listnode *node;
+	struct ospf_lsa *lsa;
+	struct as_external_lsa *al;
+	struct prefix_ipv4 p;
+
+	for (ALL_LIST_ELEMENTS_RO(lsas, node, lsa)) {
+		al = (struct as_external_lsa *)lsa->data;
+		p.family = AF_INET;
+		p.prefix = lsa->data->id;
+		p.prefixlen = ip_masklen(al->mask);
+		apply_mask_ipv4(&p);
+
+		ospf_ase_dirty_set(dirty, (struct prefix *)&p);
+	}
+}
+
+/* Recalculate the queued prefixes, and free the queue. */
+static unsigned int ospf_ase_dirty_update(struct ospf *ospf,
+					  struct route_table *dirty)
+{
+	struct route_node *rn;
+	unsigned int count = 0;
+
+	for (rn = route_top(dirty); rn; rn = route_next(rn)) {
+		if (!rn->info)
+			continue;
+
+		ospf_ase_prefix_update(ospf, (struct prefix_ipv4 *)&rn->p);
+		rn->info = NULL;
+		route_unlock_node(rn);
+		count++;
+	}
+	route_table_finish(dirty);
+
+	return count;
+}
+
+/* Would external routes through these ASBR routes come out the same? */
+static bool ospf_ase_asbr_route_same(struct ospf_route *or1,
+				     struct ospf_route *or2)
+{
+	struct listnode *n1, *n2;
+	struct ospf_path *op1, *op2;
+
+	if (!or1 || !or2)
+		return or1 == or2;
+
+	if (or1->cost != or2->cost || or1->path_type != or2->path_type
+	    || !IPV4_ADDR_SAME(&or1->u.std.area_id, &or2->u.std.area_id)
+	    || or1->u.std.flags != or2->u.std.flags
+	    || or1->u.std.external_routing != or2->u.std.external_routing
+	    || listcount(or1->paths) != listcount(or2->paths))
+		return false;
+
+	for (n1 = listhead(or1->paths), n2 = listhead(or2->paths); n1 && n2;
+	     n1 = listnextnode_unchecked(n1), n2 = listnextnode_unchecked(n2)) {
+		op1 = listgetdata(n1);
+		op2 = listgetdata(n2);
+
+		if (!IPV4_ADDR_SAME(&op1->nexthop, &op2->nexthop)
+		    || op1->ifindex != op2->ifindex)
+			return false;
+	}
+
+	return true;
+}
+
+/* Does the forwarding address resolve to the same route as before? */
+static bool ospf_ase_fwd_route_same(struct ospf *ospf, struct prefix *fwd)
+{
+	struct route_node *old_rn = NULL, *new_rn;
+	bool same;
+
+	if (ospf->old_table)
+		old_rn = route_node_match(ospf->old_table, fwd);
+	new_rn = route_node_match(ospf->new_table, fwd);
+
+	if (!old_rn || !new_rn)
+		same = old_rn == new_rn;
+	else
+		same = prefix_same(&old_rn->p, &new_rn->p)
+		       && ospf_route_match_same(ospf->old_table,
+						(struct prefix_ipv4 *)&new_rn->p,
+						new_rn->info);
+
+	if (old_rn)
+		route_unlock_node(old_rn);
+	if (new_rn)
+		route_unlock_node(new_rn);
+
+	return same;
+}
+
+/*
+ * Instead of recalculating every external route after SPF, only redo those
+ * whose ASBR or forwarding address is now reached differently, and those
+ * that were hidden by an intra- or inter-area route which went away.  New
+ * intra- and inter-area routes already replaced their external routes in
+ * ospf_route_install().
+ *
+ * Expects old_rtrs/new_rtrs and old_table/new_table to be the results of
+ * the previous and the current SPF run, with the same configuration.
+ */
+void ospf_ase_spf_update(struct ospf *ospf)
+{
+	struct route_table *dirty;
+	struct route_node *rn, *rn2;
+	struct ospf_route *old_or, *new_or;
+	struct timeval start_time;
+	unsigned long ase_time;
+	unsigned int count;
+
+	monotime(&start_time);
+	dirty = route_table_init();
+
+	for (rn = route_top(ospf->external_asbrs); rn; rn = route_next(rn)) {
+		if (!rn->info)
+			continue;
+
+		old_or = ospf_find_asbr_route(ospf, ospf->old_rtrs,
+					      (struct prefix_ipv4 *)&rn->p);
+		new_or = ospf_find_asbr_route(ospf, ospf->new_rtrs,
+					      (struct prefix_ipv4 *)&rn->p);
+		if (!ospf_ase_asbr_route_same(old_or, new_or))
+			ospf_ase_dirty_add(dirty, rn->info);
+	}
+
+	for (rn = route_top(ospf->external_fwds); rn; rn = route_next(rn))
+		if (rn->info && !ospf_ase_fwd_route_same(ospf, &rn->p))
+			ospf_ase_dirty_add(dirty, rn->info);
+
+	if (ospf->old_table)
+		for (rn = route_top(ospf->old_table); rn; rn = route_next(rn)) {
+			if (!rn->info)
+				continue;
+
+			rn2 = route_node_lookup(ospf->new_table, &rn->p);
+			if (rn2) {
+				route_unlock_node(rn2);
+				continue;
+			}
+
+			rn2 = route_node_lookup(ospf->external_lsas, &rn->p);
+			if (rn2) {
+				route_unlock_node(rn2);
+				ospf_ase_dirty_set(dirty, &rn->p);
+			}
+		}
+
+	count = ospf_ase_dirty_update(ospf, dirty);
+
+	ospf->ase_incremental++;
+	ospf->ase_last_prefixes = count;
+	ase_time = monotime_since(&start_time, NULL);
+
+	if (IS_DEBUG_OSPF_EVENT)
+		zlog_debug("SPF: %u external routes recalculated in %lu usecs",
+			   count, ase_time);
+}
+
+/*
+ * After a partial route calculation, redo the external routes whose
+ * forwarding address falls within one of the recalculated prefixes.
+ */
+void ospf_ase_prefixes_update(struct ospf *ospf, struct route_table *prefixes)
+{
+	struct route_table *dirty;
+	struct route_node *rn, *fn;
+
+	dirty = route_table_init();
+
+	for (rn = route_top(prefixes); rn; rn = route_next(rn)) {
+		if (!rn->info)
+			continue;
+
+		fn = route_node_lookup(ospf->external_fwds, &rn->p);
+		if (!fn)
+			fn = route_table_get_next(ospf->external_fwds, &rn->p);
+		for (; fn && prefix_match(&rn->p, &fn->p); fn = route_next(fn))
+			if (fn->info)
+				ospf_ase_dirty_add(dirty, fn->info);
+		if (fn)
+			route_unlock_node(fn);
+	}
+
+	ospf_ase_dirty_update(ospf, dirty);
+}
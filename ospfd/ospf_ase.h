@@ -18,7 +18,12 @@ extern void ospf_ase_calculate_schedule(struct ospf *);
 extern void ospf_ase_calculate_timer_add(struct ospf *);
 
 extern void ospf_ase_external_lsas_finish(struct route_table *);
+extern void ospf_ase_external_index_finish(struct route_table *rt);
 extern void ospf_ase_incremental_update(struct ospf *, struct ospf_lsa *);
+extern void ospf_ase_prefix_update(struct ospf *ospf, struct prefix_ipv4 *p);
+extern void ospf_ase_spf_update(struct ospf *ospf);
+extern void ospf_ase_prefixes_update(struct ospf *ospf,
+				     struct route_table *prefixes);
 extern void ospf_ase_register_external_lsa(struct ospf_lsa *, struct ospf *);
 extern void ospf_ase_unregister_external_lsa(struct ospf_lsa *, struct ospf *);
 
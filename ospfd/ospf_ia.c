@@ -254,14 +254,64 @@ static int process_summary_lsa(struct ospf_area *area, struct route_table *rt,
 	return 0;
 }
 
+/*
+ * Run process() over the summary-LSAs for the given prefixes only.  The
+ * LSDB is keyed by Link State ID, so those are found in the subtree under
+ * each prefix; the ID may carry host bits (RFC2328 Appendix E), the mask
+ * tells which prefix an LSA is for.
+ */
+static void ospf_examine_prefixes(
+	struct ospf_area *area, struct route_table *lsdb_rt,
+	struct route_table *rt, struct route_table *rtrs,
+	struct route_table *prefixes,
+	int (*process)(struct ospf_area *, struct route_table *,
+		       struct route_table *, struct ospf_lsa *))
+{
+	struct prefix_ls lp = { .family = AF_UNSPEC };
+	struct route_node *prn, *rn;
+	struct summary_lsa *sl;
+	struct ospf_lsa *lsa;
+
+	for (prn = route_top(prefixes); prn; prn = route_next(prn)) {
+		if (!prn->info)
+			continue;
+
+		lp.prefixlen = prn->p.prefixlen;
+		lp.id = prn->p.u.prefix4;
+
+		rn = route_table_get_next(lsdb_rt, (struct prefix *)&lp);
+		for (; rn; rn = route_next(rn)) {
+			if (!prefix_match((struct prefix *)&lp, &rn->p)) {
+				route_unlock_node(rn);
+				break;
+			}
+
+			lsa = rn->info;
+			if (!lsa)
+				continue;
+
+			sl = (struct summary_lsa *)lsa->data;
+			if (ip_masklen(sl->mask) == prn->p.prefixlen)
+				process(area, rt, rtrs, lsa);
+		}
+	}
+}
+
 static void ospf_examine_summaries(struct ospf_area *area,
 				   struct route_table *lsdb_rt,
 				   struct route_table *rt,
-				   struct route_table *rtrs)
+				   struct route_table *rtrs,
+				   struct route_table *prefixes)
 {
 	struct ospf_lsa *lsa;
 	struct route_node *rn;
 
+	if (prefixes) {
+		ospf_examine_prefixes(area, lsdb_rt, rt, rtrs, prefixes,
+				      process_summary_lsa);
+		return;
+	}
+
 	LSDB_LOOP (lsdb_rt, rn, lsa)
 		process_summary_lsa(area, rt, rtrs, lsa);
 }
@@ -549,17 +599,30 @@ static int process_transit_summary_lsa(struct ospf_area *area,
 static void ospf_examine_transit_summaries(struct ospf_area *area,
 					   struct route_table *lsdb_rt,
 					   struct route_table *rt,
-					   struct route_table *rtrs)
+					   struct route_table *rtrs,
+					   struct route_table *prefixes)
 {
 	struct ospf_lsa *lsa;
 	struct route_node *rn;
 
+	if (prefixes) {
+		ospf_examine_prefixes(area, lsdb_rt, rt, rtrs, prefixes,
+				      process_transit_summary_lsa);
+		return;
+	}
+
 	LSDB_LOOP (lsdb_rt, rn, lsa)
 		process_transit_summary_lsa(area, rt, rtrs, lsa);
 }
 
-void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
-		     struct route_table *rtrs)
+/*
+ * RFC2328 16.2 and 16.3.  With prefixes, only the routes to those are
+ * calculated, from the summary-LSAs, against the border router routes
+ * already in rtrs; see ospf_prc_schedule().
+ */
+void ospf_ia_routing_prefixes(struct ospf *ospf, struct route_table *rt,
+			      struct route_table *rtrs,
+			      struct route_table *prefixes)
 {
 	struct listnode *node;
 	struct ospf_area *area;
@@ -580,14 +643,16 @@ void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
 						__func__);
 				}
 
-				OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs);
+				OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs,
+							   prefixes);
 
 				for (ALL_LIST_ELEMENTS_RO(ospf->areas, node,
 							  area))
 					if (area != ospf->backbone)
 						if (ospf_area_is_transit(area))
 							OSPF_EXAMINE_TRANSIT_SUMMARIES_ALL(
-								area, rt, rtrs);
+								area, rt, rtrs,
+								prefixes);
 			} else if (IS_DEBUG_OSPF_EVENT)
 				zlog_debug("%s:backbone area NOT found",
 					   __func__);
@@ -607,14 +672,16 @@ void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
 						__func__);
 				}
 
-				OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs);
+				OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs,
+							   prefixes);
 
 				for (ALL_LIST_ELEMENTS_RO(ospf->areas, node,
 							  area))
 					if (area != ospf->backbone)
 						if (ospf_area_is_transit(area))
 							OSPF_EXAMINE_TRANSIT_SUMMARIES_ALL(
-								area, rt, rtrs);
+								area, rt, rtrs,
+								prefixes);
 			} else { /* No active BB connection--consider all areas
 				    */
 				if (IS_DEBUG_OSPF_EVENT)
@@ -623,8 +690,8 @@ void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
 						__func__);
 				for (ALL_LIST_ELEMENTS_RO(ospf->areas, node,
 							  area))
-					OSPF_EXAMINE_SUMMARIES_ALL(area, rt,
-								   rtrs);
+					OSPF_EXAMINE_SUMMARIES_ALL(
+						area, rt, rtrs, prefixes);
 			}
 			break;
 		case OSPF_ABR_SHORTCUT:
@@ -639,7 +706,8 @@ void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
 						"%s: backbone area found, examining BB summaries",
 						__func__);
 				}
-				OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs);
+				OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs,
+							   prefixes);
 			}
 
 			for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area))
@@ -652,7 +720,8 @@ void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
 							 == OSPF_SHORTCUT_ENABLE)
 							&& area->shortcut_capability))))
 						OSPF_EXAMINE_TRANSIT_SUMMARIES_ALL(
-							area, rt, rtrs);
+							area, rt, rtrs,
+							prefixes);
 			break;
 		default:
 			break;
@@ -663,6 +732,12 @@ void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
 				   __func__);
 
 		for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area))
-			OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs);
+			OSPF_EXAMINE_SUMMARIES_ALL(area, rt, rtrs, prefixes);
 	}
 }
+
+void ospf_ia_routing(struct ospf *ospf, struct route_table *rt,
+		     struct route_table *rtrs)
+{
+	ospf_ia_routing_prefixes(ospf, rt, rtrs, NULL);
+}
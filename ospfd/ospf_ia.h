@@ -8,22 +8,28 @@
 #define _ZEBRA_OSPF_IA_H
 
 /* Macros. */
-#define OSPF_EXAMINE_SUMMARIES_ALL(A, N, R)                                    \
+#define OSPF_EXAMINE_SUMMARIES_ALL(A, N, R, P)                                 \
 	{                                                                      \
-		ospf_examine_summaries((A), SUMMARY_LSDB((A)), (N), (R));      \
-		ospf_examine_summaries((A), ASBR_SUMMARY_LSDB((A)), (N), (R)); \
+		ospf_examine_summaries((A), SUMMARY_LSDB((A)), (N), (R), (P)); \
+		if (!(P))                                                      \
+			ospf_examine_summaries((A), ASBR_SUMMARY_LSDB((A)),    \
+					       (N), (R), NULL);                \
 	}
 
-#define OSPF_EXAMINE_TRANSIT_SUMMARIES_ALL(A, N, R)                            \
+#define OSPF_EXAMINE_TRANSIT_SUMMARIES_ALL(A, N, R, P)                         \
 	{                                                                      \
 		ospf_examine_transit_summaries((A), SUMMARY_LSDB((A)), (N),    \
-					       (R));                           \
-		ospf_examine_transit_summaries((A), ASBR_SUMMARY_LSDB((A)),    \
-					       (N), (R));                      \
+					       (R), (P));                      \
+		if (!(P))                                                      \
+			ospf_examine_transit_summaries(                        \
+				(A), ASBR_SUMMARY_LSDB((A)), (N), (R), NULL);  \
 	}
 
 extern void ospf_ia_routing(struct ospf *, struct route_table *,
 			    struct route_table *);
+extern void ospf_ia_routing_prefixes(struct ospf *ospf, struct route_table *rt,
+				     struct route_table *rtrs,
+				     struct route_table *prefixes);
 extern int ospf_area_is_transit(struct ospf_area *);
 
 #endif /* _ZEBRA_OSPF_IA_H */
@@ -281,7 +281,6 @@ struct ospf_interface {
 	struct event *t_wait;		 /* timer */
 	struct event *t_ls_ack_delayed;	 /* timer */
 	struct event *t_ls_ack_direct;	 /* event */
-	struct event *t_ls_upd_event;	 /* event */
 	struct event *t_opaque_lsa_self; /* Type-9 Opaque-LSAs */
 
 	int on_write_q;
@@ -234,6 +234,7 @@ struct ospf_lsa *ospf_lsa_dup(struct ospf_lsa *lsa)
 	UNSET_FLAG(new->flags, OSPF_LSA_DISCARD);
 	new->lock = 1;
 	new->retransmit_counter = 0;
+	new->stat = NULL;
 	new->data = ospf_lsa_data_dup(lsa->data);
 
 	/* kevinm: Clear the refresh_list, otherwise there are going
@@ -3068,6 +3069,10 @@ struct ospf_lsa *ospf_lsa_install(struct ospf *ospf, struct ospf_interface *oi,
 		}
 	}
 
+	/* Changes to prefixes only don't need SPF, see ospf_spf.c */
+	if (rt_recalc && ospf_prc_schedule(ospf, old, lsa))
+		rt_recalc = 0;
+
 	/* discard old LSA from LSDB */
 	if (old != NULL)
 		ospf_discard_from_db(ospf, lsdb, lsa);
@@ -3412,6 +3417,10 @@ static int ospf_lsa_maxage_walker_remover(struct ospf *ospf,
 			case OSPF_AS_NSSA_LSA:
 				ospf_ase_incremental_update(ospf, lsa);
 				break;
+			case OSPF_SUMMARY_LSA:
+				if (ospf_prc_schedule(ospf, lsa, NULL))
+					break;
+				fallthrough;
 			default:
 				ospf_spf_calculate_schedule(ospf,
 							    SPF_FLAG_MAXAGE);
@@ -10,12 +10,36 @@
 #include "table.h"
 #include "memory.h"
 #include "log.h"
+#include "jhash.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_asbr.h"
 #include "ospfd/ospf_lsa.h"
 #include "ospfd/ospf_lsdb.h"
 
+static int ospf_lsdb_hash_cmp(const struct ospf_lsdb_linked_node *a,
+			      const struct ospf_lsdb_linked_node *b)
+{
+	const struct prefix_ls *pa = (const struct prefix_ls *)&a->p;
+	const struct prefix_ls *pb = (const struct prefix_ls *)&b->p;
+	int ret;
+
+	ret = IPV4_ADDR_CMP(&pa->id, &pb->id);
+	if (ret)
+		return ret;
+	return IPV4_ADDR_CMP(&pa->adv_router, &pb->adv_router);
+}
+
+static uint32_t ospf_lsdb_hash_key(const struct ospf_lsdb_linked_node *node)
+{
+	const struct prefix_ls *lp = (const struct prefix_ls *)&node->p;
+
+	return jhash_2words(lp->id.s_addr, lp->adv_router.s_addr, 0);
+}
+
+DECLARE_HASH(ospf_lsdb_hash, struct ospf_lsdb_linked_node, hash_item,
+	     ospf_lsdb_hash_cmp, ospf_lsdb_hash_key);
+
 struct ospf_lsdb *ospf_lsdb_new(void)
 {
 	struct ospf_lsdb *new;
@@ -26,14 +50,6 @@ struct ospf_lsdb *ospf_lsdb_new(void)
 	return new;
 }
 
-void ospf_lsdb_init(struct ospf_lsdb *lsdb)
-{
-	int i;
-
-	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
-		lsdb->type[i].db = route_table_init();
-}
-
 static struct route_node *
 ospf_lsdb_linked_node_create(route_table_delegate_t *delegate,
 			     struct route_table *table)
@@ -61,30 +77,35 @@ static route_table_delegate_t ospf_lsdb_linked_table_delegate = {
 	.destroy_node = ospf_lsdb_linked_node_destroy,
 };
 
-void ospf_lsdb_linked_init(struct ospf_lsdb *lsdb)
+void ospf_lsdb_init(struct ospf_lsdb *lsdb)
 {
 	int i;
 
-	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
+	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++) {
 		lsdb->type[i].db = route_table_init_with_delegate(
 			&ospf_lsdb_linked_table_delegate);
+		ospf_lsdb_hash_init(&lsdb->type[i].hash);
+	}
 }
 
-struct ospf_lsdb_linked_node *ospf_lsdb_linked_lookup(struct ospf_lsdb *lsdb,
-						      struct ospf_lsa *lsa)
+static struct ospf_lsdb_linked_node *
+ospf_lsdb_node_find(struct ospf_lsdb *lsdb, uint8_t type, struct in_addr id,
+		    struct in_addr adv_router)
 {
-	struct ospf_lsdb_linked_node *lsdb_linked_node;
-	struct route_table *table;
-	struct prefix_ls lp;
+	struct ospf_lsdb_linked_node ref;
+	struct prefix_ls *lp = (struct prefix_ls *)&ref.p;
 
-	table = lsdb->type[lsa->data->type].db;
-	ls_prefix_set(&lp, lsa);
-	lsdb_linked_node = (struct ospf_lsdb_linked_node *)
-		route_node_lookup(table, (struct prefix *)&lp);
-	if (lsdb_linked_node)
-		route_unlock_node((struct route_node *)lsdb_linked_node);
+	lp->id = id;
+	lp->adv_router = adv_router;
 
-	return lsdb_linked_node;
+	return ospf_lsdb_hash_find(&lsdb->type[type].hash, &ref);
+}
+
+struct ospf_lsdb_linked_node *ospf_lsdb_linked_lookup(struct ospf_lsdb *lsdb,
+						      struct ospf_lsa *lsa)
+{
+	return ospf_lsdb_node_find(lsdb, lsa->data->type, lsa->data->id,
+				   lsa->data->adv_router);
 }
 
 void ospf_lsdb_free(struct ospf_lsdb *lsdb)
@@ -101,8 +122,10 @@ void ospf_lsdb_cleanup(struct ospf_lsdb *lsdb)
 
 	ospf_lsdb_delete_all(lsdb);
 
-	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++)
+	for (i = OSPF_MIN_LSA; i < OSPF_MAX_LSA; i++) {
+		ospf_lsdb_hash_fini(&lsdb->type[i].hash);
 		route_table_finish(lsdb->type[i].db);
+	}
 }
 
 void ls_prefix_set(struct prefix_ls *lp, struct ospf_lsa *lsa)
@@ -115,8 +138,12 @@ void ls_prefix_set(struct prefix_ls *lp, struct ospf_lsa *lsa)
 	}
 }
 
+/*
+ * Take the LSA out of rn.  When it is about to be replaced, rn stays in the
+ * hash and keeps its lock for the new one.
+ */
 static void ospf_lsdb_delete_entry(struct ospf_lsdb *lsdb,
-				   struct route_node *rn)
+				   struct route_node *rn, bool replace)
 {
 	struct ospf_lsa *lsa = rn->info;
 
@@ -146,7 +173,11 @@ static void ospf_lsdb_delete_entry(struct ospf_lsdb *lsdb,
 		lsa->area->fr_info.indication_lsa_self = NULL;
 
 	rn->info = NULL;
-	route_unlock_node(rn);
+	if (!replace) {
+		ospf_lsdb_hash_del(&lsdb->type[lsa->data->type].hash,
+				   (struct ospf_lsdb_linked_node *)rn);
+		route_unlock_node(rn);
+	}
 #ifdef MONITOR_LSDB_CHANGE
 	if (lsdb->del_lsa_hook != NULL)
 		(*lsdb->del_lsa_hook)(lsa);
@@ -158,24 +189,29 @@ static void ospf_lsdb_delete_entry(struct ospf_lsdb *lsdb,
 /* Add new LSA to lsdb. */
 void ospf_lsdb_add(struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 {
-	struct route_table *table;
+	struct ospf_lsdb_linked_node *node;
 	struct prefix_ls lp;
 	struct route_node *rn;
 
-	table = lsdb->type[lsa->data->type].db;
-	ls_prefix_set(&lp, lsa);
-	rn = route_node_get(table, (struct prefix *)&lp);
+	node = ospf_lsdb_node_find(lsdb, lsa->data->type, lsa->data->id,
+				   lsa->data->adv_router);
+	if (node) {
+		rn = (struct route_node *)node;
 
-	/* nothing to do? */
-	if (rn->info && rn->info == lsa) {
-		route_unlock_node(rn);
-		return;
+		/* nothing to do? */
+		if (rn->info == lsa)
+			return;
+
+		/* purge old entry */
+		ospf_lsdb_delete_entry(lsdb, rn, true);
+	} else {
+		ls_prefix_set(&lp, lsa);
+		rn = route_node_get(lsdb->type[lsa->data->type].db,
+				    (struct prefix *)&lp);
+		node = (struct ospf_lsdb_linked_node *)rn;
+		ospf_lsdb_hash_add(&lsdb->type[lsa->data->type].hash, node);
 	}
 
-	/* purge old entry? */
-	if (rn->info)
-		ospf_lsdb_delete_entry(lsdb, rn);
-
 	if (IS_LSA_SELF(lsa))
 		lsdb->type[lsa->data->type].count_self++;
 	lsdb->type[lsa->data->type].count++;
@@ -197,21 +233,15 @@ void ospf_lsdb_add(struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 
 void ospf_lsdb_delete(struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 {
-	struct route_table *table;
-	struct prefix_ls lp;
 	struct route_node *rn;
 
 	if (!lsdb || !lsa)
 		return;
 
 	assert(lsa->data->type < OSPF_MAX_LSA);
-	table = lsdb->type[lsa->data->type].db;
-	ls_prefix_set(&lp, lsa);
-	if ((rn = route_node_lookup(table, (struct prefix *)&lp))) {
-		if (rn->info == lsa)
-			ospf_lsdb_delete_entry(lsdb, rn);
-		route_unlock_node(rn); /* route_node_lookup */
-	}
+	rn = (struct route_node *)ospf_lsdb_linked_lookup(lsdb, lsa);
+	if (rn && rn->info == lsa)
+		ospf_lsdb_delete_entry(lsdb, rn, false);
 }
 
 void ospf_lsdb_delete_all(struct ospf_lsdb *lsdb)
@@ -224,52 +254,28 @@ void ospf_lsdb_delete_all(struct ospf_lsdb *lsdb)
 		table = lsdb->type[i].db;
 		for (rn = route_top(table); rn; rn = route_next(rn))
 			if (rn->info != NULL)
-				ospf_lsdb_delete_entry(lsdb, rn);
+				ospf_lsdb_delete_entry(lsdb, rn, false);
 	}
 }
 
 struct ospf_lsa *ospf_lsdb_lookup(struct ospf_lsdb *lsdb, struct ospf_lsa *lsa)
 {
-	struct route_table *table;
-	struct prefix_ls lp;
-	struct route_node *rn;
-	struct ospf_lsa *find;
+	struct ospf_lsdb_linked_node *node;
 
-	table = lsdb->type[lsa->data->type].db;
-	ls_prefix_set(&lp, lsa);
-	rn = route_node_lookup(table, (struct prefix *)&lp);
-	if (rn) {
-		find = rn->info;
-		route_unlock_node(rn);
-		return find;
-	}
-	return NULL;
+	node = ospf_lsdb_linked_lookup(lsdb, lsa);
+
+	return node ? node->info : NULL;
 }
 
 struct ospf_lsa *ospf_lsdb_lookup_by_id(struct ospf_lsdb *lsdb, uint8_t type,
 					struct in_addr id,
 					struct in_addr adv_router)
 {
-	struct route_table *table;
-	struct prefix_ls lp;
-	struct route_node *rn;
-	struct ospf_lsa *find;
-
-	table = lsdb->type[type].db;
+	struct ospf_lsdb_linked_node *node;
 
-	memset(&lp, 0, sizeof(lp));
-	lp.family = AF_UNSPEC;
-	lp.prefixlen = 64;
-	lp.id = id;
-	lp.adv_router = adv_router;
+	node = ospf_lsdb_node_find(lsdb, type, id, adv_router);
 
-	rn = route_node_lookup(table, (struct prefix *)&lp);
-	if (rn) {
-		find = rn->info;
-		route_unlock_node(rn);
-		return find;
-	}
-	return NULL;
+	return node ? node->info : NULL;
 }
 
 struct ospf_lsa *ospf_lsdb_lookup_by_id_next(struct ospf_lsdb *lsdb,
@@ -278,25 +284,19 @@ struct ospf_lsa *ospf_lsdb_lookup_by_id_next(struct ospf_lsdb *lsdb,
 					     int first)
 {
 	struct route_table *table;
-	struct prefix_ls lp;
 	struct route_node *rn;
 	struct ospf_lsa *find;
 
 	table = lsdb->type[type].db;
 
-	memset(&lp, 0, sizeof(lp));
-	lp.family = AF_UNSPEC;
-	lp.prefixlen = 64;
-	lp.id = id;
-	lp.adv_router = adv_router;
-
 	if (first)
 		rn = route_top(table);
 	else {
-		if ((rn = route_node_lookup(table, (struct prefix *)&lp))
-		    == NULL)
+		rn = (struct route_node *)ospf_lsdb_node_find(lsdb, type, id,
+							      adv_router);
+		if (rn == NULL)
 			return NULL;
-		rn = route_next(rn);
+		rn = route_next(route_lock_node(rn));
 	}
 
 	for (; rn; rn = route_next(rn))
@@ -9,6 +9,32 @@
 
 #include "prefix.h"
 #include "table.h"
+#include "typesafe.h"
+
+PREDECL_HASH(ospf_lsdb_hash);
+
+/*
+ * LSAs are kept in a route_table per type, keyed by a prefix_ls (see
+ * ls_prefix_set()), which gives the ordered walks of LSDB_LOOP the database
+ * description, "show" output and SNMP rely on.  The route nodes are also
+ * in a hash on the same key, which is what lookups, replacing an LSA and
+ * deleting it go through; only adding a new key walks the table.
+ */
+struct ospf_lsdb_linked_node {
+	/*
+	 * Caution these must be the very first fields
+	 */
+	ROUTE_NODE_FIELDS
+
+	/* Entry in the hash, while the node holds an LSA. */
+	struct ospf_lsdb_hash_item hash_item;
+
+	/*
+	 * List entry on an LSA list, e.g., a neighbor
+	 * retransmission list.
+	 */
+	struct ospf_lsa_list_entry *lsa_list_entry;
+};
 
 /* OSPF LSDB structure. */
 struct ospf_lsdb {
@@ -17,6 +43,7 @@ struct ospf_lsdb {
 		unsigned long count_self;
 		unsigned int checksum;
 		struct route_table *db;
+		struct ospf_lsdb_hash_head hash;
 	} type[OSPF_MAX_LSA];
 	unsigned long total;
 #define MONITOR_LSDB_CHANGE 1 /* XXX */
@@ -46,27 +73,9 @@ struct ospf_lsdb {
 #define AREA_LSDB(A,T)       ((A)->lsdb->type[(T)].db)
 #define AS_LSDB(O,T)         ((O)->lsdb->type[(T)].db)
 
-/*
- * Alternate route node structure for LSDB nodes linked to
- * list elements.
- */
-struct ospf_lsdb_linked_node {
-	/*
-	 * Caution these must be the very first fields
-	 */
-	ROUTE_NODE_FIELDS
-
-	/*
-	 * List entry on an LSA list, e.g., a neighbor
-	 * retransmission list.
-	 */
-	struct ospf_lsa_list_entry *lsa_list_entry;
-};
-
 /* OSPF LSDB related functions. */
 extern struct ospf_lsdb *ospf_lsdb_new(void);
 extern void ospf_lsdb_init(struct ospf_lsdb *);
-extern void ospf_lsdb_linked_init(struct ospf_lsdb *lsdb);
 extern struct ospf_lsdb_linked_node *
 ospf_lsdb_linked_lookup(struct ospf_lsdb *lsdb, struct ospf_lsa *lsa);
 extern void ospf_lsdb_free(struct ospf_lsdb *);
@@ -29,6 +29,7 @@
 #include "routemap.h"
 #include "keychain.h"
 #include "libagentx.h"
+#include "taskpool.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_interface.h"
@@ -80,10 +81,12 @@ struct zebra_privs_t ospfd_privs = {
 	.cap_num_i = 0};
 
 /* OSPFd options. */
+#define OPTION_SPF_THREADS 2000
 const struct option longopts[] = {
 	{"instance", required_argument, NULL, 'n'},
 	{"apiserver", no_argument, NULL, 'a'},
 	{"apiserver_addr", required_argument, NULL, 'l'},
+	{"spf-threads", required_argument, NULL, OPTION_SPF_THREADS},
 	{0}
 };
 
@@ -200,11 +203,14 @@ static void ospf_config_end(void)
 /* OSPFd main routine. */
 int main(int argc, char **argv)
 {
+	int spf_threads = 0;
+
 	frr_preinit(&ospfd_di, argc, argv);
 	frr_opt_add("n:al:", longopts,
 		    "  -n, --instance     Set the instance id\n"
 		    "  -a, --apiserver    Enable OSPF apiserver\n"
-		    "  -l, --apiserver_addr     Set OSPF apiserver bind address\n");
+		    "  -l, --apiserver_addr     Set OSPF apiserver bind address\n"
+		    "      --spf-threads  Number of pthreads for the areas' SPF runs\n");
 
 	while (1) {
 		int opt;
@@ -220,6 +226,11 @@ int main(int argc, char **argv)
 			if (ospf_instance < 1)
 				exit(0);
 			break;
+		case OPTION_SPF_THREADS:
+			spf_threads = atoi(optarg);
+			if (spf_threads < 0)
+				frr_help_exit(1);
+			break;
 		case 0:
 			break;
 #ifdef SUPPORT_OSPF_API
@@ -306,6 +317,11 @@ int main(int argc, char **argv)
 	ospf_error_init();
 
 	frr_config_fork();
+
+	/* pthreads do not survive daemonizing, see frr_config_fork() */
+	if (spf_threads)
+		om->spf_pool = taskpool_new("ospf_spf", spf_threads);
+
 	frr_run(master);
 
 	/* Not reached. */
@@ -81,7 +81,7 @@ struct ospf_neighbor *ospf_nbr_new(struct ospf_interface *oi)
 
 	ospf_lsdb_init(&nbr->db_sum);
 
-	ospf_lsdb_linked_init(&nbr->ls_rxmt);
+	ospf_lsdb_init(&nbr->ls_rxmt);
 	ospf_lsdb_init(&nbr->ls_req);
 	ospf_lsa_list_init(&nbr->ls_rxmt_list);
 
@@ -24,6 +24,7 @@
 #include "vrf.h"
 #include "lib_errors.h"
 #include "plist.h"
+#include "frrsendmmsg.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_network.h"
@@ -249,6 +250,19 @@ static struct ospf_packet *ospf_packet_dup(struct ospf_packet *op)
 	return new;
 }
 
+/* A packet sharing op's data, see stream_clone(). */
+static struct ospf_packet *ospf_packet_clone(struct ospf_packet *op)
+{
+	struct ospf_packet *new;
+
+	new = XCALLOC(MTYPE_OSPF_PACKET, sizeof(struct ospf_packet));
+	new->s = stream_clone(op->s);
+	new->dst = op->dst;
+	new->length = op->length;
+
+	return new;
+}
+
 /* XXX inline */
 static unsigned int ospf_packet_authspace(struct ospf_interface *oi)
 {
@@ -454,18 +468,142 @@ static void ospf_write_frags(int fd, struct ospf_packet *op, struct ip *iph,
 }
 #endif /* WANT_OSPF_WRITE_FRAGMENT */
 
-static void ospf_write(struct event *thread)
-{
-	struct ospf *ospf = EVENT_ARG(thread);
+/*
+ * Packets are handed to the kernel in batches with sendmmsg().  A batch
+ * only holds packets for one socket and with the same send flags.  On
+ * Linux each packet carries its outgoing interface in IP_PKTINFO, so one
+ * batch can go out on any number of interfaces.
+ */
+#define OSPF_WRITE_BATCH 32
+
+struct ospf_write_slot {
 	struct ospf_interface *oi;
 	struct ospf_packet *op;
+	uint8_t type;
+
 	struct sockaddr_in sa_dst;
 	struct ip iph;
-	struct msghdr msg;
 	struct iovec iov[2];
+#ifdef GNU_LINUX
+	union {
+		unsigned char buf[CMSG_SPACE(sizeof(struct in_pktinfo))];
+		struct cmsghdr align;
+	} cmsg;
+#endif
+};
+
+struct ospf_write_batch {
+	int fd;
+	int flags;
+	unsigned int count;
+	struct ospf_write_slot slots[OSPF_WRITE_BATCH];
+	struct mmsghdr msgs[OSPF_WRITE_BATCH];
+};
+
+static void ospf_write_slot_done(struct ospf_write_slot *slot, int error)
+{
+	struct ospf_interface *oi = slot->oi;
+	struct ospf_packet *op = slot->op;
+	struct ip *iph = &slot->iph;
+	uint8_t type = slot->type;
+
+	sockopt_iphdrincl_swab_systoh(iph);
+	if (IS_DEBUG_OSPF_EVENT)
+		zlog_debug(
+			"%s to %pI4, id %d, off %d, len %d, interface %s, mtu %u:",
+			__func__, &iph->ip_dst, iph->ip_id, iph->ip_off,
+			iph->ip_len, oi->ifp->name, oi->ifp->mtu);
+
+	/* sendmsg will return EPERM if firewall is blocking sending.
+	 * This is a normal situation when 'ip nhrp map multicast xxx'
+	 * is being used to send multicast packets to DMVPN peers. In
+	 * that case the original message is blocked with iptables rule
+	 * causing the EPERM result
+	 */
+	if (error && error != EPERM)
+		flog_err(
+			EC_LIB_SOCKET,
+			"*** sendmsg in %s failed to %pI4, id %d, off %d, len %d, interface %s, mtu %u: %s",
+			__func__, &iph->ip_dst, iph->ip_id, iph->ip_off,
+			iph->ip_len, oi->ifp->name, oi->ifp->mtu,
+			safe_strerror(error));
+
+	/* Show debug sending packet. */
+	if (IS_DEBUG_OSPF_PACKET(type - 1, SEND)) {
+		if (IS_DEBUG_OSPF_PACKET(type - 1, DETAIL)) {
+			zlog_debug(
+				"-----------------------------------------------------");
+			stream_set_getp(op->s, 0);
+			ospf_packet_dump(op->s);
+		}
+
+		zlog_debug("%s sent to [%pI4] via [%s].",
+			   lookup_msg(ospf_packet_type_str, type, NULL),
+			   &op->dst, IF_NAME(oi));
+
+		if (IS_DEBUG_OSPF_PACKET(type - 1, DETAIL))
+			zlog_debug(
+				"-----------------------------------------------------");
+	}
+
+	switch (type) {
+	case OSPF_MSG_HELLO:
+		oi->hello_out++;
+		break;
+	case OSPF_MSG_DB_DESC:
+		oi->db_desc_out++;
+		break;
+	case OSPF_MSG_LS_REQ:
+		oi->ls_req_out++;
+		break;
+	case OSPF_MSG_LS_UPD:
+		oi->ls_upd_out++;
+		break;
+	case OSPF_MSG_LS_ACK:
+		oi->ls_ack_out++;
+		break;
+	default:
+		break;
+	}
+
+	ospf_packet_free(op);
+}
+
+static void ospf_write_flush(struct ospf_write_batch *batch)
+{
+	unsigned int done = 0, i;
+	int ret;
+
+	while (done < batch->count) {
+		ret = sendmmsg(batch->fd, &batch->msgs[done],
+			       batch->count - done, batch->flags);
+		if (ret > 0) {
+			for (i = done; i < done + ret; i++)
+				ospf_write_slot_done(&batch->slots[i], 0);
+			done += ret;
+			continue;
+		}
+
+		/* the first packet left failed, the others may still go */
+		ospf_write_slot_done(&batch->slots[done], errno);
+		done++;
+	}
+
+	batch->count = 0;
+}
+
+static void ospf_write(struct event *thread)
+{
+	struct ospf *ospf = EVENT_ARG(thread);
+	struct ospf_interface *oi;
+	struct ospf_packet *op;
+	struct ospf_write_batch batch;
+	struct ospf_write_slot *slot;
+	struct msghdr *msg;
+	struct ip *iph;
 	uint8_t type;
-	int ret, fd;
-	int flags = 0;
+	int fd;
+	int flags;
 	struct listnode *node;
 #ifdef WANT_OSPF_WRITE_FRAGMENT
 	static uint16_t ipid = 0;
@@ -475,8 +613,7 @@ static void ospf_write(struct event *thread)
 	int pkt_count = 0;
 
 #ifdef GNU_LINUX
-	unsigned char cmsgbuf[64] = {};
-	struct cmsghdr *cm = (struct cmsghdr *)cmsgbuf;
+	struct cmsghdr *cm;
 	struct in_pktinfo *pi;
 #endif
 	fd = ospf->fd;
@@ -492,6 +629,8 @@ static void ospf_write(struct event *thread)
 	assert(node);
 	oi = listgetdata(node);
 
+	batch.count = 0;
+
 #ifdef WANT_OSPF_WRITE_FRAGMENT
 	/* seed ipid static with low order bits of time */
 	if (ipid == 0)
@@ -518,9 +657,31 @@ static void ospf_write(struct event *thread)
 		assert(op);
 		assert(op->length >= OSPF_HEADER_SIZE);
 
+		/* Set DONTROUTE flag if dst is unicast. */
+		flags = 0;
+		if (oi->type != OSPF_IFTYPE_VIRTUALLINK)
+			if (!IN_MULTICAST(htonl(op->dst.s_addr)))
+				flags = MSG_DONTROUTE;
+
+		if (batch.count &&
+		    (batch.fd != fd || batch.flags != flags ||
+		     batch.count == OSPF_WRITE_BATCH))
+			ospf_write_flush(&batch);
+
 		if (op->dst.s_addr == htonl(OSPF_ALLSPFROUTERS)
-		    || op->dst.s_addr == htonl(OSPF_ALLDROUTERS))
+		    || op->dst.s_addr == htonl(OSPF_ALLDROUTERS)) {
+#ifndef GNU_LINUX
+			/* IP_MULTICAST_IF would apply to the batch too */
+			ospf_write_flush(&batch);
+#endif
 			ospf_if_ipmulticast(fd, oi->address, oi->ifp->ifindex);
+		}
+
+#ifdef WANT_OSPF_WRITE_FRAGMENT
+		/* fragments are sent right away, keep them in order */
+		if (op->length > maxdatasize)
+			ospf_write_flush(&batch);
+#endif /* WANT_OSPF_WRITE_FRAGMENT */
 
 		/* Rewrite the md5 signature & update the seq */
 		ospf_auth_make(oi, op);
@@ -532,39 +693,44 @@ static void ospf_write(struct event *thread)
 		/* reset get pointer */
 		stream_set_getp(op->s, 0);
 
-		memset(&iph, 0, sizeof(iph));
-		memset(&sa_dst, 0, sizeof(sa_dst));
+		/* The packet is freed once it has been sent. */
+		ospf_fifo_pop(oi->obuf);
+
+		slot = &batch.slots[batch.count];
+		msg = &batch.msgs[batch.count].msg_hdr;
+		iph = &slot->iph;
+		slot->oi = oi;
+		slot->op = op;
+		slot->type = type;
 
-		sa_dst.sin_family = AF_INET;
+		memset(iph, 0, sizeof(*iph));
+		memset(&slot->sa_dst, 0, sizeof(slot->sa_dst));
+
+		slot->sa_dst.sin_family = AF_INET;
 #ifdef HAVE_STRUCT_SOCKADDR_IN_SIN_LEN
-		sa_dst.sin_len = sizeof(sa_dst);
+		slot->sa_dst.sin_len = sizeof(slot->sa_dst);
 #endif /* HAVE_STRUCT_SOCKADDR_IN_SIN_LEN */
-		sa_dst.sin_addr = op->dst;
-		sa_dst.sin_port = htons(0);
-
-		/* Set DONTROUTE flag if dst is unicast. */
-		if (oi->type != OSPF_IFTYPE_VIRTUALLINK)
-			if (!IN_MULTICAST(htonl(op->dst.s_addr)))
-				flags = MSG_DONTROUTE;
+		slot->sa_dst.sin_addr = op->dst;
+		slot->sa_dst.sin_port = htons(0);
 
-		iph.ip_hl = sizeof(struct ip) >> OSPF_WRITE_IPHL_SHIFT;
+		iph->ip_hl = sizeof(struct ip) >> OSPF_WRITE_IPHL_SHIFT;
 		/* it'd be very strange for header to not be 4byte-word aligned
 		 * but.. */
 		if (sizeof(struct ip)
-		    > (unsigned int)(iph.ip_hl << OSPF_WRITE_IPHL_SHIFT))
-			iph.ip_hl++; /* we presume sizeof(struct ip) cant
+		    > (unsigned int)(iph->ip_hl << OSPF_WRITE_IPHL_SHIFT))
+			iph->ip_hl++; /* we presume sizeof(struct ip) cant
 					overflow ip_hl.. */
 
-		iph.ip_v = IPVERSION;
-		iph.ip_tos = IPTOS_PREC_INTERNETCONTROL;
-		iph.ip_len = (iph.ip_hl << OSPF_WRITE_IPHL_SHIFT) + op->length;
+		iph->ip_v = IPVERSION;
+		iph->ip_tos = IPTOS_PREC_INTERNETCONTROL;
+		iph->ip_len = (iph->ip_hl << OSPF_WRITE_IPHL_SHIFT) + op->length;
 
 #if defined(__DragonFly__)
 		/*
 		 * DragonFly's raw socket expects ip_len/ip_off in network byte
 		 * order.
 		 */
-		iph.ip_len = htons(iph.ip_len);
+		iph->ip_len = htons(iph->ip_len);
 #endif
 
 #ifdef WANT_OSPF_WRITE_FRAGMENT
@@ -573,39 +739,41 @@ static void ospf_write(struct event *thread)
 		 * packets
 		 * otherwise, no guarantee ipid will be unique
 		 */
-		iph.ip_id = ++ipid;
+		iph->ip_id = ++ipid;
 #endif /* WANT_OSPF_WRITE_FRAGMENT */
 
-		iph.ip_off = 0;
+		iph->ip_off = 0;
 		if (oi->type == OSPF_IFTYPE_VIRTUALLINK)
-			iph.ip_ttl = OSPF_VL_IP_TTL;
+			iph->ip_ttl = OSPF_VL_IP_TTL;
 		else
-			iph.ip_ttl = OSPF_IP_TTL;
-		iph.ip_p = IPPROTO_OSPFIGP;
-		iph.ip_sum = 0;
-		iph.ip_src.s_addr = oi->address->u.prefix4.s_addr;
-		iph.ip_dst.s_addr = op->dst.s_addr;
-
-		memset(&msg, 0, sizeof(msg));
-		msg.msg_name = (caddr_t)&sa_dst;
-		msg.msg_namelen = sizeof(sa_dst);
-		msg.msg_iov = iov;
-		msg.msg_iovlen = 2;
-
-		iov[0].iov_base = (char *)&iph;
-		iov[0].iov_len = iph.ip_hl << OSPF_WRITE_IPHL_SHIFT;
-		iov[1].iov_base = stream_pnt(op->s);
-		iov[1].iov_len = op->length;
+			iph->ip_ttl = OSPF_IP_TTL;
+		iph->ip_p = IPPROTO_OSPFIGP;
+		iph->ip_sum = 0;
+		iph->ip_src.s_addr = oi->address->u.prefix4.s_addr;
+		iph->ip_dst.s_addr = op->dst.s_addr;
+
+		memset(msg, 0, sizeof(*msg));
+		msg->msg_name = (caddr_t)&slot->sa_dst;
+		msg->msg_namelen = sizeof(slot->sa_dst);
+		msg->msg_iov = slot->iov;
+		msg->msg_iovlen = 2;
+
+		slot->iov[0].iov_base = (char *)iph;
+		slot->iov[0].iov_len = iph->ip_hl << OSPF_WRITE_IPHL_SHIFT;
+		slot->iov[1].iov_base = stream_pnt(op->s);
+		slot->iov[1].iov_len = op->length;
 
 #ifdef GNU_LINUX
-		msg.msg_control = (caddr_t)cm;
+		memset(&slot->cmsg, 0, sizeof(slot->cmsg));
+		cm = &slot->cmsg.align;
+		msg->msg_control = (caddr_t)cm;
 		cm->cmsg_level = SOL_IP;
 		cm->cmsg_type = IP_PKTINFO;
 		cm->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
 		pi = (struct in_pktinfo *)CMSG_DATA(cm);
 		pi->ipi_ifindex = oi->ifp->ifindex;
 
-		msg.msg_controllen = cm->cmsg_len;
+		msg->msg_controllen = cm->cmsg_len;
 #endif
 
 /* Sadly we can not rely on kernels to fragment packets
@@ -615,74 +783,15 @@ static void ospf_write(struct event *thread)
 
 #ifdef WANT_OSPF_WRITE_FRAGMENT
 		if (op->length > maxdatasize)
-			ospf_write_frags(fd, op, &iph, &msg, maxdatasize,
+			ospf_write_frags(fd, op, iph, msg, maxdatasize,
 					 oi->ifp->mtu, flags, type);
 #endif /* WANT_OSPF_WRITE_FRAGMENT */
 
-		/* send final fragment (could be first) */
-		sockopt_iphdrincl_swab_htosys(&iph);
-		ret = sendmsg(fd, &msg, flags);
-		sockopt_iphdrincl_swab_systoh(&iph);
-		if (IS_DEBUG_OSPF_EVENT)
-			zlog_debug(
-				"%s to %pI4, id %d, off %d, len %d, interface %s, mtu %u:",
-				__func__, &iph.ip_dst, iph.ip_id, iph.ip_off,
-				iph.ip_len, oi->ifp->name, oi->ifp->mtu);
-
-		/* sendmsg will return EPERM if firewall is blocking sending.
-		 * This is a normal situation when 'ip nhrp map multicast xxx'
-		 * is being used to send multicast packets to DMVPN peers. In
-		 * that case the original message is blocked with iptables rule
-		 * causing the EPERM result
-		 */
-		if (ret < 0 && errno != EPERM)
-			flog_err(
-				EC_LIB_SOCKET,
-				"*** sendmsg in %s failed to %pI4, id %d, off %d, len %d, interface %s, mtu %u: %s",
-				__func__, &iph.ip_dst, iph.ip_id, iph.ip_off,
-				iph.ip_len, oi->ifp->name, oi->ifp->mtu,
-				safe_strerror(errno));
-
-		/* Show debug sending packet. */
-		if (IS_DEBUG_OSPF_PACKET(type - 1, SEND)) {
-			if (IS_DEBUG_OSPF_PACKET(type - 1, DETAIL)) {
-				zlog_debug(
-					"-----------------------------------------------------");
-				stream_set_getp(op->s, 0);
-				ospf_packet_dump(op->s);
-			}
-
-			zlog_debug("%s sent to [%pI4] via [%s].",
-				   lookup_msg(ospf_packet_type_str, type, NULL),
-				   &op->dst, IF_NAME(oi));
-
-			if (IS_DEBUG_OSPF_PACKET(type - 1, DETAIL))
-				zlog_debug(
-					"-----------------------------------------------------");
-		}
-
-		switch (type) {
-		case OSPF_MSG_HELLO:
-			oi->hello_out++;
-			break;
-		case OSPF_MSG_DB_DESC:
-			oi->db_desc_out++;
-			break;
-		case OSPF_MSG_LS_REQ:
-			oi->ls_req_out++;
-			break;
-		case OSPF_MSG_LS_UPD:
-			oi->ls_upd_out++;
-			break;
-		case OSPF_MSG_LS_ACK:
-			oi->ls_ack_out++;
-			break;
-		default:
-			break;
-		}
-
-		/* Now delete packet from queue. */
-		ospf_packet_delete(oi);
+		/* queue final fragment (could be first) */
+		sockopt_iphdrincl_swab_htosys(iph);
+		batch.fd = fd;
+		batch.flags = flags;
+		batch.count++;
 
 		/* Move this interface to the tail of write_q to
 		       serve everyone in a round robin fashion */
@@ -700,6 +809,8 @@ static void ospf_write(struct event *thread)
 		}
 	}
 
+	ospf_write_flush(&batch);
+
 	/* If packets still remain in queue, call write thread. */
 	if (!list_isempty(ospf->oi_write_q))
 		event_add_write(master, ospf_write, ospf, ospf->fd,
@@ -3778,6 +3889,7 @@ static struct ospf_packet *ospf_ls_upd_packet_new(struct list *update,
 			__func__, &lsa->data->id, ntohs(lsa->data->length),
 			(long int)size);
 		list_delete_node(update, ln);
+		ospf_lsa_unlock(&lsa); /* oi->ls_upd_queue */
 		return NULL;
 	}
 
@@ -3799,21 +3911,26 @@ static struct ospf_packet *ospf_ls_upd_packet_new(struct list *update,
 	return ospf_packet_new(size - sizeof(struct ip));
 }
 
-void ospf_ls_upd_queue_send(struct ospf_interface *oi, struct list *update,
-			    struct in_addr addr, int send_lsupd_now)
+static struct in_addr ospf_ls_upd_dst(struct ospf_interface *oi,
+				      struct in_addr addr)
 {
-	struct ospf_packet *op;
-	uint16_t length = OSPF_HEADER_SIZE;
+	if (oi->type == OSPF_IFTYPE_POINTOPOINT)
+		addr.s_addr = htonl(OSPF_ALLSPFROUTERS);
 
-	if (IS_DEBUG_OSPF_EVENT)
-		zlog_debug("listcount = %d, [%s]dst %pI4", listcount(update),
-			   IF_NAME(oi), &addr);
+	return addr;
+}
 
-	/* Check that we have really something to process */
-	if (listcount(update) == 0)
-		return;
+/* Build one LS Update out of as many LSAs from the head of update as fit. */
+static struct ospf_packet *ospf_ls_upd_packet_make(struct ospf_interface *oi,
+						   struct list *update,
+						   struct in_addr addr)
+{
+	struct ospf_packet *op;
+	uint16_t length = OSPF_HEADER_SIZE;
 
 	op = ospf_ls_upd_packet_new(update, oi);
+	if (!op)
+		return NULL;
 
 	/* Prepare OSPF common header. */
 	ospf_make_header(OSPF_MSG_LS_UPD, oi, op->s);
@@ -3830,10 +3947,27 @@ void ospf_ls_upd_queue_send(struct ospf_interface *oi, struct list *update,
 	op->length = length;
 
 	/* Decide destination address. */
-	if (oi->type == OSPF_IFTYPE_POINTOPOINT)
-		op->dst.s_addr = htonl(OSPF_ALLSPFROUTERS);
-	else
-		op->dst.s_addr = addr.s_addr;
+	op->dst = ospf_ls_upd_dst(oi, addr);
+
+	return op;
+}
+
+void ospf_ls_upd_queue_send(struct ospf_interface *oi, struct list *update,
+			    struct in_addr addr, int send_lsupd_now)
+{
+	struct ospf_packet *op;
+
+	if (IS_DEBUG_OSPF_EVENT)
+		zlog_debug("listcount = %d, [%s]dst %pI4", listcount(update),
+			   IF_NAME(oi), &addr);
+
+	/* Check that we have really something to process */
+	if (listcount(update) == 0)
+		return;
+
+	op = ospf_ls_upd_packet_make(oi, update, addr);
+	if (!op)
+		return;
 
 	/* Add packet to the interface output queue. */
 	ospf_packet_add(oi, op);
@@ -3870,49 +4004,188 @@ void ospf_ls_upd_queue_send(struct ospf_interface *oi, struct list *update,
 	}
 }
 
+/*
+ * Flooding usually puts the same LSAs on several interfaces at once.  If
+ * those are in the same area, have the same MTU and transmit delay and no
+ * authentication, the LS Updates are the same byte for byte: they are only
+ * built for the first interface, the others get clones (see stream_clone()).
+ * The destination is kept in struct ospf_packet, outside the shared data.
+ * Cryptographic authentication is written into the packet by ospf_write()
+ * and simple authentication keys are per interface, so interfaces using
+ * either always build their own.
+ */
+struct ospf_ls_upd_shared {
+	struct ospf_area *area;
+	unsigned int mtu;
+	uint32_t transmit_delay;
+
+	/* LSAs the packets were built from, locked */
+	struct list *lsas;
+	struct list *packets;
+};
+
+static void ospf_ls_upd_shared_free(void *arg)
+{
+	struct ospf_ls_upd_shared *shared = arg;
+	struct ospf_packet *op;
+	struct ospf_lsa *lsa;
+	struct listnode *node;
+
+	for (ALL_LIST_ELEMENTS_RO(shared->lsas, node, lsa))
+		ospf_lsa_unlock(&lsa);
+	list_delete(&shared->lsas);
+	for (ALL_LIST_ELEMENTS_RO(shared->packets, node, op))
+		ospf_packet_free(op);
+	list_delete(&shared->packets);
+	XFREE(MTYPE_TMP, shared);
+}
+
+static bool ospf_ls_upd_shared_match(struct ospf_ls_upd_shared *shared,
+				     struct ospf_interface *oi,
+				     struct list *update)
+{
+	struct listnode *n1, *n2;
+
+	if (shared->area != oi->area || shared->mtu != oi->ifp->mtu ||
+	    shared->transmit_delay != OSPF_IF_PARAM(oi, transmit_delay) ||
+	    listcount(shared->lsas) != listcount(update))
+		return false;
+
+	for (n1 = listhead(shared->lsas), n2 = listhead(update); n1 && n2;
+	     n1 = listnextnode(n1), n2 = listnextnode(n2))
+		if (listgetdata(n1) != listgetdata(n2))
+			return false;
+
+	return true;
+}
+
+static struct ospf_ls_upd_shared *
+ospf_ls_upd_shared_get(struct list *shared_list, struct ospf_interface *oi,
+		       struct list *update, bool *found)
+{
+	struct ospf_ls_upd_shared *shared;
+	struct ospf_lsa *lsa;
+	struct listnode *node;
+
+	*found = false;
+	if (ospf_auth_type(oi) != OSPF_AUTH_NULL)
+		return NULL;
+
+	for (ALL_LIST_ELEMENTS_RO(shared_list, node, shared))
+		if (ospf_ls_upd_shared_match(shared, oi, update)) {
+			*found = true;
+			return shared;
+		}
+
+	shared = XCALLOC(MTYPE_TMP, sizeof(*shared));
+	shared->area = oi->area;
+	shared->mtu = oi->ifp->mtu;
+	shared->transmit_delay = OSPF_IF_PARAM(oi, transmit_delay);
+	shared->lsas = list_new();
+	for (ALL_LIST_ELEMENTS_RO(update, node, lsa))
+		listnode_add(shared->lsas, ospf_lsa_lock(lsa));
+	shared->packets = list_new();
+	listnode_add(shared_list, shared);
+
+	return shared;
+}
+
+/* Turn all of an interface's update list for addr into packets. */
+static void ospf_ls_upd_queue_flush(struct ospf_interface *oi,
+				    struct list *update, struct in_addr addr,
+				    struct list *shared_list)
+{
+	struct ospf_ls_upd_shared *shared;
+	struct ospf_packet *op;
+	struct ospf_lsa *lsa;
+	struct listnode *node, *nnode;
+	bool found;
+
+	if (IS_DEBUG_OSPF_EVENT)
+		zlog_debug("listcount = %d, [%s]dst %pI4", listcount(update),
+			   IF_NAME(oi), &addr);
+
+	shared = ospf_ls_upd_shared_get(shared_list, oi, update, &found);
+	if (found) {
+		for (ALL_LIST_ELEMENTS_RO(shared->packets, node, op)) {
+			op = ospf_packet_clone(op);
+			op->dst = ospf_ls_upd_dst(oi, addr);
+			ospf_packet_add(oi, op);
+		}
+
+		for (ALL_LIST_ELEMENTS(update, node, nnode, lsa)) {
+			list_delete_node(update, node);
+			ospf_lsa_unlock(&lsa); /* oi->ls_upd_queue */
+		}
+	}
+
+	while (listcount(update)) {
+		op = ospf_ls_upd_packet_make(oi, update, addr);
+		if (!op)
+			continue;
+
+		if (shared)
+			listnode_add(shared->packets, ospf_packet_clone(op));
+		ospf_packet_add(oi, op);
+	}
+
+	/* Hook thread to write packet. */
+	if (ospf_fifo_head(oi->obuf))
+		OSPF_ISM_WRITE_ON(oi->ospf);
+}
+
 static void ospf_ls_upd_send_queue_event(struct event *thread)
 {
-	struct ospf_interface *oi = EVENT_ARG(thread);
+	struct ospf *ospf = EVENT_ARG(thread);
+	struct ospf_interface *oi;
 	struct route_node *rn;
 	struct route_node *rnext;
-	struct list *update;
-	char again = 0;
-
-	oi->t_ls_upd_event = NULL;
+	struct listnode *node;
+	struct list *shared_list;
 
 	if (IS_DEBUG_OSPF_EVENT)
 		zlog_debug("%s start", __func__);
 
-	for (rn = route_top(oi->ls_upd_queue); rn; rn = rnext) {
-		rnext = route_next(rn);
+	shared_list = list_new();
+	shared_list->del = ospf_ls_upd_shared_free;
 
-		if (rn->info == NULL)
-			continue;
+	for (ALL_LIST_ELEMENTS_RO(ospf->oiflist, node, oi)) {
+		for (rn = route_top(oi->ls_upd_queue); rn; rn = rnext) {
+			rnext = route_next(rn);
 
-		update = (struct list *)rn->info;
+			if (rn->info == NULL)
+				continue;
 
-		ospf_ls_upd_queue_send(oi, update, rn->p.u.prefix4, 0);
+			ospf_ls_upd_queue_flush(oi, rn->info, rn->p.u.prefix4,
+						shared_list);
 
-		/* list might not be empty. */
-		if (listcount(update) == 0) {
 			list_delete((struct list **)&rn->info);
 			route_unlock_node(rn);
-		} else
-			again = 1;
-	}
-
-	if (again != 0) {
-		if (IS_DEBUG_OSPF_EVENT)
-			zlog_debug(
-				"%s: update lists not cleared, %d nodes to try again, raising new event",
-				__func__, again);
-		oi->t_ls_upd_event = NULL;
-		event_add_event(master, ospf_ls_upd_send_queue_event, oi, 0,
-				&oi->t_ls_upd_event);
+		}
 	}
 
 	if (IS_DEBUG_OSPF_EVENT)
-		zlog_debug("%s stop", __func__);
+		zlog_debug("%s stop, %u distinct updates", __func__,
+			   listcount(shared_list));
+
+	list_delete(&shared_list);
+}
+
+/*
+ * LS Updates aren't built right away but in an event for the whole
+ * instance, so that everything flooded in the meantime, on all interfaces,
+ * gets packed together.  With "timers throttle flood" set, that event waits
+ * a little to gather more.
+ */
+static void ospf_ls_upd_send_schedule(struct ospf *ospf)
+{
+	if (ospf->ls_upd_delay)
+		event_add_timer_msec(master, ospf_ls_upd_send_queue_event,
+				     ospf, ospf->ls_upd_delay,
+				     &ospf->t_ls_upd_event);
+	else
+		event_add_event(master, ospf_ls_upd_send_queue_event, ospf, 0,
+				&ospf->t_ls_upd_event);
 }
 
 void ospf_ls_upd_send(struct ospf_neighbor *nbr, struct list *update, int flag,
@@ -3978,8 +4251,7 @@ void ospf_ls_upd_send(struct ospf_neighbor *nbr, struct list *update, int flag,
 					       rn->p.u.prefix4, 1);
 		}
 	} else
-		event_add_event(master, ospf_ls_upd_send_queue_event, oi, 0,
-				&oi->t_ls_upd_event);
+		ospf_ls_upd_send_schedule(oi->ospf);
 }
 
 static void ospf_ls_ack_send_list(struct ospf_interface *oi,
@@ -18,6 +18,7 @@
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_interface.h"
 #include "ospfd/ospf_asbr.h"
+#include "ospfd/ospf_ase.h"
 #include "ospfd/ospf_lsa.h"
 #include "ospfd/ospf_route.h"
 #include "ospfd/ospf_spf.h"
@@ -347,6 +348,86 @@ void ospf_route_install(struct ospf *ospf, struct route_table *rt)
 		}
 }
 
+/*
+ * Partial route calculation: replace the routes to the given prefixes in
+ * the current routing table by those in rt, which holds nothing else, and
+ * tell zebra about the difference.  Discard routes for active ranges stay,
+ * unless there is an intra-area route now, see ospf_add_discard_route().
+ * Returns the number of prefixes whose route changed.
+ */
+unsigned int ospf_route_install_prefixes(struct ospf *ospf,
+					 struct route_table *rt,
+					 struct route_table *prefixes)
+{
+	struct route_node *prn, *rn, *crn;
+	struct ospf_route *or, *cur;
+	struct prefix_ipv4 *p;
+	unsigned int changed = 0;
+	bool same;
+
+	/* internal routes take precedence */
+	ospf_route_delete_same_ext(ospf, ospf->old_external_route, rt);
+
+	for (prn = route_top(prefixes); prn; prn = route_next(prn)) {
+		if (!prn->info)
+			continue;
+		p = (struct prefix_ipv4 *)&prn->p;
+
+		or = NULL;
+		rn = route_node_lookup(rt, (struct prefix *)p);
+		if (rn) {
+			route_unlock_node(rn);
+			or = rn->info;
+		}
+
+		cur = NULL;
+		crn = route_node_lookup(ospf->new_table, (struct prefix *)p);
+		if (crn) {
+			route_unlock_node(crn);
+			cur = crn->info;
+		}
+
+		if (!or && !cur)
+			continue;
+
+		if (cur && cur->type == OSPF_DESTINATION_DISCARD
+		    && (!or || or->path_type != OSPF_PATH_INTRA_AREA))
+			continue;
+
+		same = or && cur
+		       && ospf_route_match_same(ospf->new_table, p, or);
+		if (!same || or->path_type != cur->path_type
+		    || !IPV4_ADDR_SAME(&or->u.std.area_id, &cur->u.std.area_id))
+			changed++;
+
+		if (!or) {
+			ospf_zebra_delete(ospf, p, cur);
+			ospf_route_free(cur);
+			crn->info = NULL;
+			route_unlock_node(crn);
+
+			/* the external route, if any, counts again */
+			ospf_ase_prefix_update(ospf, p);
+			continue;
+		}
+
+		if (!same)
+			ospf_zebra_add(ospf, p, or);
+
+		if (cur)
+			ospf_route_free(cur);
+		else
+			crn = route_node_get(ospf->new_table,
+					     (struct prefix *)p);
+		crn->info = or;
+
+		rn->info = NULL;
+		route_unlock_node(rn);
+	}
+
+	return changed;
+}
+
 /* RFC2328 16.1. (4). For "router". */
 void ospf_intra_add_router(struct route_table *rt, struct vertex *v,
 			   struct ospf_area *area, bool add_only)
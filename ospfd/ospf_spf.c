@@ -15,6 +15,7 @@
 #include "table.h"
 #include "log.h"
 #include "sockunion.h" /* for inet_ntop () */
+#include "taskpool.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_interface.h"
@@ -42,9 +43,19 @@
 
 static unsigned int spf_reason_flags = 0;
 
-/* dummy vertex to flag "in spftree" */
-static const struct vertex vertex_in_spftree = {};
-#define LSA_SPF_IN_SPFTREE	(struct vertex *)&vertex_in_spftree
+/*
+ * SPF reasons which only change the LSDB; anything else makes the next run
+ * a full one.
+ */
+#define SPF_INCREMENTAL_REASONS                                                \
+	((1 << SPF_FLAG_ROUTER_LSA_INSTALL)                                    \
+	 | (1 << SPF_FLAG_NETWORK_LSA_INSTALL)                                 \
+	 | (1 << SPF_FLAG_SUMMARY_LSA_INSTALL)                                 \
+	 | (1 << SPF_FLAG_ASBR_SUMMARY_LSA_INSTALL) | (1 << SPF_FLAG_MAXAGE))
+
+/* dummy vertex to flag "not on the tree kept from the last run" */
+static const struct vertex vertex_unreached = {};
+#define LSA_SPF_UNREACHED	(struct vertex *)&vertex_unreached
 #define LSA_SPF_NOT_EXPLORED	NULL
 
 static void ospf_clear_spf_reason_flags(void)
@@ -1299,6 +1310,68 @@ static uint16_t get_reverse_distance(struct vertex *v,
 	return distance;
 }
 
+/*
+ * Incremental SPF: V was recalculated and has a link to W, which is on the
+ * tree from the last run, at a distance no longer than W's.  If that gives
+ * W a shorter path or other nexthops, W goes back on the candidate list,
+ * so it and the vertices below it get updated when it comes off again.
+ */
+static void ospf_spf_reopen(struct ospf_area *area, struct vertex *v,
+			    struct vertex *w, struct router_lsa_link *l,
+			    unsigned int distance, int lsa_pos,
+			    struct vertex_pqueue_head *candidate)
+{
+	struct vertex_parent *vp;
+	struct listnode *node, *nnode;
+	struct list *stale;
+	uint32_t old_distance = w->distance;
+	unsigned int nparents;
+	bool changed;
+
+	/*
+	 * What W has from V is calculated again: V's own nexthops may have
+	 * changed in ways W wouldn't just inherit, see the network vertex
+	 * case in ospf_nexthop_calculation().
+	 */
+	stale = list_new();
+	stale->del = (void (*)(void *))vertex_parent_free;
+
+	for (ALL_LIST_ELEMENTS(w->parents, node, nnode, vp)) {
+		listnode_delete(vp->parent->children, w);
+		if (vp->parent == v) {
+			list_delete_node(w->parents, node);
+			listnode_add(stale, vp);
+		}
+	}
+	nparents = listcount(w->parents);
+
+	ospf_nexthop_calculation(area, v, w, l, distance, lsa_pos);
+
+	if (!listcount(w->parents)) {
+		/* no nexthop via V after all: leave things as they were */
+		while ((vp = listnode_head(stale))) {
+			listnode_delete(stale, vp);
+			listnode_add_sort(w->parents, vp);
+		}
+	}
+
+	changed = w->distance < old_distance || listcount(stale)
+		  || listcount(w->parents) != nparents;
+	list_delete(&stale);
+
+	if (changed) {
+		if (IS_DEBUG_OSPF_EVENT)
+			zlog_debug("%s: %pI4 goes back on the candidate list",
+				   __func__, &w->id);
+		UNSET_FLAG(w->flags, OSPF_VERTEX_IN_SPFTREE);
+		vertex_pqueue_add(candidate, w);
+		return;
+	}
+
+	/* nothing new, W stays where it was */
+	ospf_vertex_add_parent(w);
+}
+
 /*
  * RFC2328 16.1 (2).
  * v is on the SPF tree. Examine the links in v's LSA. Update the list of
@@ -1458,9 +1531,19 @@ static void ospf_spf_next(struct vertex *v, struct ospf_area *area,
 		/*
 		 * (c) If vertex W is already on the shortest-path tree, examine
 		 * the next link in the LSA.
+		 *
+		 * Unless an incremental SPF has just recalculated V, which
+		 * may give W, kept from the last run, a path as short as its
+		 * own: see ospf_spf_reopen().
 		 */
-		if (w_lsa->stat == LSA_SPF_IN_SPFTREE) {
-			if (IS_DEBUG_OSPF_EVENT)
+		w = w_lsa->stat;
+		if (w && CHECK_FLAG(w->flags, OSPF_VERTEX_IN_SPFTREE)) {
+			if (CHECK_FLAG(v->flags, OSPF_VERTEX_UPDATED)
+			    && !CHECK_FLAG(w->flags, OSPF_VERTEX_UPDATED)
+			    && distance <= w->distance)
+				ospf_spf_reopen(area, v, w, l, distance,
+						lsa_pos, candidate);
+			else if (IS_DEBUG_OSPF_EVENT)
 				zlog_debug("The LSA is already in SPF");
 			continue;
 		}
@@ -1491,8 +1574,7 @@ static void ospf_spf_next(struct vertex *v, struct ospf_area *area,
 				if (IS_DEBUG_OSPF_EVENT)
 					zlog_debug("Nexthop Calc failed");
 			}
-		} else if (w_lsa->stat != LSA_SPF_IN_SPFTREE) {
-			w = w_lsa->stat;
+		} else {
 			if (w->distance < distance) {
 				continue;
 			}
@@ -1581,9 +1663,47 @@ void ospf_spf_print(struct vty *vty, struct vertex *v, int i)
 		ospf_spf_print(vty, v, i);
 }
 
-/* Second stage of SPF calculation. */
+/* Whether a prefix is queued for partial route calculation. */
+static bool ospf_prc_queued(struct route_table *prefixes,
+			    struct prefix_ipv4 *p)
+{
+	struct route_node *rn;
+
+	rn = route_node_lookup(prefixes, (struct prefix *)p);
+	if (!rn)
+		return false;
+	route_unlock_node(rn);
+
+	return rn->info != NULL;
+}
+
+static void ospf_stub_prefix(struct router_lsa_link *l, struct prefix_ipv4 *p)
+{
+	p->family = AF_INET;
+	p->prefix = l->link_id;
+	p->prefixlen = ip_masklen(l->link_data);
+	apply_mask_ipv4(p);
+}
+
+static bool ospf_stub_wanted(struct router_lsa_link *l,
+			     struct route_table *prefixes)
+{
+	struct prefix_ipv4 p;
+
+	if (!prefixes)
+		return true;
+
+	ospf_stub_prefix(l, &p);
+	return ospf_prc_queued(prefixes, &p);
+}
+
+/*
+ * Second stage of SPF calculation.  With prefixes, only the stub networks
+ * among those are added, see ospf_prc_schedule().
+ */
 static void ospf_spf_process_stubs(struct ospf_area *area, struct vertex *v,
-				   struct route_table *rt, int parent_is_root)
+				   struct route_table *rt, int parent_is_root,
+				   struct route_table *prefixes)
 {
 	struct listnode *cnode, *cnnode;
 	struct vertex *child;
@@ -1620,6 +1740,7 @@ static void ospf_spf_process_stubs(struct ospf_area *area, struct vertex *v,
 
 			/* Don't process TI-LFA protected resources */
 			if (l->m[0].type == LSA_LINK_TYPE_STUB
+			    && ospf_stub_wanted(l, prefixes)
 			    && !ospf_spf_is_protected_resource(area, l, v->lsa))
 				ospf_intra_add_stub(rt, l, v, area,
 						    parent_is_root, lsa_pos);
@@ -1644,7 +1765,8 @@ static void ospf_spf_process_stubs(struct ospf_area *area, struct vertex *v,
 		else if (v->type == OSPF_VERTEX_ROUTER)
 			parent_is_root = 0;
 
-		ospf_spf_process_stubs(area, child, rt, parent_is_root);
+		ospf_spf_process_stubs(area, child, rt, parent_is_root,
+				       prefixes);
 
 		SET_FLAG(child->flags, OSPF_VERTEX_PROCESSED);
 	}
@@ -1744,7 +1866,7 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 	 * part of the tree.
 	 */
 	v = area->spf;
-	v->lsa_p->stat = LSA_SPF_IN_SPFTREE;
+	SET_FLAG(v->flags, OSPF_VERTEX_IN_SPFTREE);
 
 	for (;;) {
 		/* RFC2328 16.1. (2). */
@@ -1756,11 +1878,17 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 			/* No more vertices left. */
 			break;
 
-		v->lsa_p->stat = LSA_SPF_IN_SPFTREE;
+		SET_FLAG(v->flags, OSPF_VERTEX_IN_SPFTREE);
 
 		ospf_vertex_add_parent(v);
 
-		/* RFC2328 16.1. (4). */
+		/*
+		 * RFC2328 16.1. (4).  Without a routing table, this is only
+		 * the tree; ospf_spf_add_routes() does the rest.
+		 */
+		if (!new_table)
+			continue;
+
 		if (v->type != OSPF_VERTEX_ROUTER)
 			ospf_intra_add_transit(new_table, v, area);
 		else {
@@ -1773,8 +1901,16 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 		/* Iterate back to (2), see RFC2328 16.1. (5). */
 	}
 
-	if (IS_DEBUG_OSPF_EVENT) {
+	if (IS_DEBUG_OSPF_EVENT)
 		ospf_spf_dump(area->spf, 0);
+
+	/* Increment SPF Calculation Counter. */
+	area->spf_calculation++;
+
+	if (!new_table)
+		return;
+
+	if (IS_DEBUG_OSPF_EVENT) {
 		ospf_route_table_dump(new_table);
 		if (all_rtrs)
 			ospf_router_route_table_dump(all_rtrs);
@@ -1784,13 +1920,10 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 	 * Second stage of SPF calculation procedure's, add leaves to the tree
 	 * for stub networks.
 	 */
-	ospf_spf_process_stubs(area, area->spf, new_table, 0);
+	ospf_spf_process_stubs(area, area->spf, new_table, 0, NULL);
 
 	ospf_vertex_dump(__func__, area->spf, 0, 1);
 
-	/* Increment SPF Calculation Counter. */
-	area->spf_calculation++;
-
 	monotime(&area->ospf->ts_spf);
 	area->ts_spf = area->ospf->ts_spf;
 
@@ -1799,30 +1932,586 @@ void ospf_spf_calculate(struct ospf_area *area, struct ospf_lsa *root_lsa,
 			   mtype_stats_alloc(MTYPE_OSPF_VERTEX));
 }
 
-void ospf_spf_calculate_area(struct ospf *ospf, struct ospf_area *area,
-			     struct route_table *new_table,
-			     struct route_table *all_rtrs,
-			     struct route_table *new_rtrs)
+/* qsort() wrapper for vertex_cmp() */
+static int vertex_sort_cmp(const void *a, const void *b)
+{
+	return vertex_cmp(*(const struct vertex *const *)a,
+			  *(const struct vertex *const *)b);
+}
+
+/*
+ * Whether a new instance of a router- or network-LSA has the same links to
+ * other vertices as the old one, at the same positions: router-LSAs may
+ * still differ in their stub links, network-LSAs in their mask.
+ */
+static bool ospf_spf_same_topology(const struct lsa_header *old,
+				   const struct lsa_header *new)
+{
+	const struct router_lsa_link *l1, *l2;
+	const uint8_t *p1, *p2, *lim1, *lim2;
+	unsigned int len1, len2;
+
+	p1 = (const uint8_t *)old + OSPF_LSA_HEADER_SIZE + 4;
+	p2 = (const uint8_t *)new + OSPF_LSA_HEADER_SIZE + 4;
+	lim1 = (const uint8_t *)old + ntohs(old->length);
+	lim2 = (const uint8_t *)new + ntohs(new->length);
+
+	if (old->type == OSPF_NETWORK_LSA)
+		return lim1 - p1 == lim2 - p2 && !memcmp(p1, p2, lim1 - p1);
+
+	while (p1 < lim1 && p2 < lim2) {
+		l1 = (const struct router_lsa_link *)p1;
+		l2 = (const struct router_lsa_link *)p2;
+		len1 = OSPF_ROUTER_LSA_LINK_SIZE
+		       + l1->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE;
+		len2 = OSPF_ROUTER_LSA_LINK_SIZE
+		       + l2->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE;
+
+		if (len1 != len2)
+			return false;
+		if ((l1->m[0].type != LSA_LINK_TYPE_STUB
+		     || l2->m[0].type != LSA_LINK_TYPE_STUB)
+		    && memcmp(l1, l2, len1))
+			return false;
+
+		p1 += len1;
+		p2 += len2;
+	}
+
+	return p1 >= lim1 && p2 >= lim2;
+}
+
+/* The LSA a link to V finds in the LSDB now, see ospf_spf_next(). */
+static struct ospf_lsa *ospf_spf_vertex_lsa(struct ospf_area *area,
+					    struct vertex *v)
+{
+	if (v == area->spf)
+		return area->router_lsa_self;
+
+	return ospf_lsa_lookup_by_id(area, v->type, v->id);
+}
+
+/* Move a vertex of the kept tree over to a new instance of its LSA. */
+static void ospf_spf_vertex_set_lsa(struct vertex *v, struct ospf_lsa *lsa)
+{
+	struct ospf_lsa *old = v->lsa_p;
+
+	if (old->stat == v)
+		old->stat = LSA_SPF_NOT_EXPLORED;
+
+	v->lsa_p = ospf_lsa_lock(lsa);
+	v->lsa = lsa->data;
+	lsa->stat = v;
+
+	ospf_lsa_unlock(&old);
+}
+
+/* Free a vertex of the kept tree, along with its hold on the LSA. */
+static void ospf_spf_vertex_release(struct vertex *v)
+{
+	struct ospf_lsa *lsa = v->lsa_p;
+
+	if (lsa->stat == v)
+		lsa->stat = LSA_SPF_NOT_EXPLORED;
+
+	ospf_vertex_free(v);
+	ospf_lsa_unlock(&lsa);
+}
+
+/*
+ * Hold on to the tree for the next run to update.  Its vertices keep their
+ * LSAs around, so they can be compared with the LSDB then; the LSAs it
+ * didn't reach are marked, to tell them apart from LSAs installed later.
+ */
+static void ospf_spf_keep(struct ospf_area *area)
+{
+	struct listnode *node;
+	struct route_node *rn;
+	struct ospf_lsa *lsa;
+	struct vertex *v;
+	int type;
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v))
+		ospf_lsa_lock(v->lsa_p);
+
+	for (type = OSPF_ROUTER_LSA; type <= OSPF_NETWORK_LSA; type++) {
+		LSDB_LOOP (AREA_LSDB(area, type), rn, lsa) {
+			if (lsa->stat == LSA_SPF_NOT_EXPLORED)
+				lsa->stat = LSA_SPF_UNREACHED;
+		}
+	}
+}
+
+/* Drop the tree kept from the last SPF run, if any. */
+void ospf_spf_reset(struct ospf_area *area)
 {
-	ospf_spf_calculate(area, area->router_lsa_self, new_table, all_rtrs,
-			   new_rtrs, false, true);
+	struct listnode *node, *nnode;
+	struct vertex *v;
+
+	if (!area->spf_vertex_list)
+		return;
+
+	for (ALL_LIST_ELEMENTS(area->spf_vertex_list, node, nnode, v)) {
+		list_delete_node(area->spf_vertex_list, node);
+		ospf_spf_vertex_release(v);
+	}
+	list_delete(&area->spf_vertex_list);
+	area->spf = NULL;
+}
+
+/*
+ * Compare the kept tree with the LSDB.  Vertices whose LSA was changed,
+ * flushed or aged out go on changed; LSAs which were only refreshed, or
+ * differ only in what doesn't make edges, replace the vertex' old one.
+ * LSAs installed since the last run go on added.
+ *
+ * Returns false if the root itself changed.
+ */
+static bool ospf_spf_find_changes(struct ospf_area *area,
+				  struct list *changed, struct list *added)
+{
+	struct listnode *node;
+	struct route_node *rn;
+	struct ospf_lsa *lsa, *cur;
+	struct vertex *v;
+	int type;
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v)) {
+		lsa = v->lsa_p;
+		cur = ospf_spf_vertex_lsa(area, v);
+
+		if (cur == lsa && !IS_LSA_MAXAGE(lsa))
+			continue;
+
+		if (cur && !IS_LSA_MAXAGE(cur)
+		    && ospf_spf_same_topology(lsa->data, cur->data)) {
+			ospf_spf_vertex_set_lsa(v, cur);
+			continue;
+		}
+
+		if (v == area->spf)
+			return false;
+
+		listnode_add(changed, v);
+	}
+
+	for (type = OSPF_ROUTER_LSA; type <= OSPF_NETWORK_LSA; type++) {
+		LSDB_LOOP (AREA_LSDB(area, type), rn, lsa) {
+			if (lsa->stat == LSA_SPF_UNREACHED)
+				lsa->stat = LSA_SPF_NOT_EXPLORED;
+			else if (lsa->stat == LSA_SPF_NOT_EXPLORED
+				 && !IS_LSA_MAXAGE(lsa))
+				listnode_add(added, lsa);
+		}
+	}
+
+	return true;
+}
+
+/* Mark V and everything below it, returns how many weren't already. */
+static unsigned int ospf_spf_mark_affected(struct vertex *v)
+{
+	struct listnode *node;
+	struct vertex *child;
+	unsigned int n = 1;
+
+	if (CHECK_FLAG(v->flags, OSPF_VERTEX_AFFECTED))
+		return 0;
+
+	SET_FLAG(v->flags, OSPF_VERTEX_AFFECTED);
+
+	for (ALL_LIST_ELEMENTS_RO(v->children, node, child))
+		n += ospf_spf_mark_affected(child);
+
+	return n;
+}
+
+/*
+ * Take the affected vertices off the tree.  Their LSAs, as far as they're
+ * still in the LSDB, go on seeds: they have to be reached again.
+ */
+static void ospf_spf_remove_affected(struct ospf_area *area,
+				     struct list *seeds)
+{
+	struct listnode *node, *nnode, *pnode;
+	struct vertex_parent *vp;
+	struct ospf_lsa *lsa;
+	struct vertex *v;
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v)) {
+		if (!CHECK_FLAG(v->flags, OSPF_VERTEX_AFFECTED))
+			continue;
+
+		for (ALL_LIST_ELEMENTS_RO(v->parents, pnode, vp))
+			if (!CHECK_FLAG(vp->parent->flags,
+					OSPF_VERTEX_AFFECTED))
+				listnode_delete(vp->parent->children, v);
+
+		lsa = ospf_spf_vertex_lsa(area, v);
+		if (lsa && !IS_LSA_MAXAGE(lsa))
+			listnode_add(seeds, lsa);
+	}
+
+	for (ALL_LIST_ELEMENTS(area->spf_vertex_list, node, nnode, v)) {
+		if (!CHECK_FLAG(v->flags, OSPF_VERTEX_AFFECTED))
+			continue;
+
+		list_delete_node(area->spf_vertex_list, node);
+		ospf_spf_vertex_release(v);
+	}
+}
+
+/* The LSA of the vertex the link at *p leads to, moving p past the link. */
+static struct ospf_lsa *ospf_spf_link_lsa(struct ospf_area *area,
+					  struct lsa_header *lsa, uint8_t **p)
+{
+	struct router_lsa_link *l;
+	struct in_addr *r;
+
+	if (lsa->type == OSPF_NETWORK_LSA) {
+		r = (struct in_addr *)*p;
+		*p += sizeof(struct in_addr);
+		return ospf_lsa_lookup_by_id(area, OSPF_ROUTER_LSA, *r);
+	}
+
+	l = (struct router_lsa_link *)*p;
+	*p += (OSPF_ROUTER_LSA_LINK_SIZE
+	       + (l->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE));
+
+	switch (l->m[0].type) {
+	case LSA_LINK_TYPE_POINTOPOINT:
+	case LSA_LINK_TYPE_VIRTUALLINK:
+		return ospf_lsa_lookup_by_id(area, OSPF_ROUTER_LSA, l->link_id);
+	case LSA_LINK_TYPE_TRANSIT:
+		return ospf_lsa_lookup_by_id(area, OSPF_NETWORK_LSA,
+					     l->link_id);
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Examine the links of the vertices left on the tree which LSA may have a
+ * link from, to put it on the candidate list if they reach it.
+ */
+static void ospf_spf_seed(struct ospf_area *area, struct ospf_lsa *lsa,
+			  struct vertex_pqueue_head *candidate)
+{
+	struct ospf_lsa *w_lsa;
+	struct vertex *w;
+	uint8_t *p, *lim;
+
+	p = ((uint8_t *)lsa->data) + OSPF_LSA_HEADER_SIZE + 4;
+	lim = ((uint8_t *)lsa->data) + ntohs(lsa->data->length);
+
+	while (p < lim) {
+		w_lsa = ospf_spf_link_lsa(area, lsa->data, &p);
+		if (!w_lsa || !(w = w_lsa->stat)
+		    || !CHECK_FLAG(w->flags, OSPF_VERTEX_IN_SPFTREE)
+		    || CHECK_FLAG(w->flags, OSPF_VERTEX_SEED))
+			continue;
+
+		SET_FLAG(w->flags, OSPF_VERTEX_SEED);
+		ospf_spf_next(w, area, candidate);
+	}
+}
+
+/*
+ * V was examined as a seed, then went back on the candidate list.  Drop what
+ * the candidates got from V then, they get it again from V as it is now.
+ */
+static void ospf_spf_unseed(struct ospf_area *area, struct vertex *v)
+{
+	struct vertex_parent *vp;
+	struct listnode *node, *nnode;
+	struct ospf_lsa *w_lsa;
+	struct vertex *w;
+	uint8_t *p, *lim;
+
+	p = ((uint8_t *)v->lsa) + OSPF_LSA_HEADER_SIZE + 4;
+	lim = ((uint8_t *)v->lsa) + ntohs(v->lsa->length);
+
+	while (p < lim) {
+		w_lsa = ospf_spf_link_lsa(area, v->lsa, &p);
+		if (!w_lsa || !(w = w_lsa->stat)
+		    || CHECK_FLAG(w->flags, OSPF_VERTEX_IN_SPFTREE))
+			continue;
+
+		for (ALL_LIST_ELEMENTS(w->parents, node, nnode, vp)) {
+			if (vp->parent != v)
+				continue;
+			list_delete_node(w->parents, node);
+			vertex_parent_free(vp);
+		}
+	}
+}
+
+/*
+ * RFC2328 16.1. (4) for the whole tree, adding the vertices in the order a
+ * full run would take them off the candidate list, then the stub networks.
+ */
+static void ospf_spf_add_routes(struct ospf_area *area,
+				struct route_table *new_table,
+				struct route_table *all_rtrs,
+				struct route_table *new_rtrs)
+{
+	struct vertex **vertices;
+	struct listnode *node;
+	struct vertex *v;
+	unsigned int i, n = 0;
+
+	area->abr_count = 0;
+	area->asbr_count = 0;
+	area->transit = OSPF_TRANSIT_FALSE;
+	area->shortcut_capability = 1;
+
+	vertices = XMALLOC(MTYPE_TMP, listcount(area->spf_vertex_list)
+					      * sizeof(*vertices));
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v)) {
+		UNSET_FLAG(v->flags, OSPF_VERTEX_PROCESSED
+					     | OSPF_VERTEX_UPDATED
+					     | OSPF_VERTEX_SEED);
+
+		if (v->type == OSPF_VERTEX_ROUTER
+		    && IS_ROUTER_LSA_VIRTUAL((struct router_lsa *)v->lsa))
+			area->transit = OSPF_TRANSIT_TRUE;
+
+		if (v != area->spf)
+			vertices[n++] = v;
+	}
+
+	qsort(vertices, n, sizeof(*vertices), vertex_sort_cmp);
+
+	for (i = 0; i < n; i++) {
+		v = vertices[i];
+
+		if (v->type != OSPF_VERTEX_ROUTER)
+			ospf_intra_add_transit(new_table, v, area);
+		else {
+			if (new_rtrs)
+				ospf_intra_add_router(new_rtrs, v, area, false);
+			if (all_rtrs)
+				ospf_intra_add_router(all_rtrs, v, area, true);
+		}
+	}
+
+	XFREE(MTYPE_TMP, vertices);
+
+	ospf_spf_process_stubs(area, area->spf, new_table, 0, NULL);
+}
+
+/*
+ * Incremental SPF: update the tree kept from the last run for what changed
+ * in the LSDB since.  Vertices at or below one whose LSA changed are taken
+ * off and calculated again, the rest of the tree stays as it was; where the
+ * changes give one of those a path at least as short as its own, it goes
+ * through the candidate list again too, see ospf_spf_reopen().  The routing
+ * table entries for the area are still built from the whole tree.
+ *
+ * Returns false if a full run is needed instead.
+ */
+static bool ospf_spf_calculate_incremental(struct ospf *ospf,
+					   struct ospf_area *area)
+{
+	struct vertex_pqueue_head candidate;
+	struct list *changed, *seeds;
+	struct listnode *node;
+	struct ospf_lsa *lsa;
+	struct vertex *v;
+	unsigned int affected = 0, updated = 0;
+	bool done = false;
+
+	if (!area->spf || ospf->spf_full || ospf->ti_lfa_enabled
+	    || listcount(ospf->vlinks))
+		return false;
+
+	changed = list_new();
+	seeds = list_new();
+
+	if (!ospf_spf_find_changes(area, changed, seeds))
+		goto out;
+
+	for (ALL_LIST_ELEMENTS_RO(changed, node, v))
+		affected += ospf_spf_mark_affected(v);
+
+	/* past this, starting from scratch is cheaper */
+	if (affected * 2 > listcount(area->spf_vertex_list))
+		goto out;
+
+	if (IS_DEBUG_OSPF_EVENT)
+		zlog_debug("%s: area %pI4: %u of %u vertices affected, %u new LSAs",
+			   __func__, &area->area_id, affected,
+			   listcount(area->spf_vertex_list),
+			   listcount(seeds));
+
+	ospf_spf_remove_affected(area, seeds);
+
+	/* the rest is current, the LSDB holds on to it until ospf_spf_keep() */
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v)) {
+		lsa = v->lsa_p;
+		ospf_lsa_unlock(&lsa);
+	}
+
+	vertex_pqueue_init(&candidate);
+
+	for (ALL_LIST_ELEMENTS_RO(seeds, node, lsa))
+		ospf_spf_seed(area, lsa, &candidate);
+
+	while ((v = vertex_pqueue_pop(&candidate))) {
+		if (CHECK_FLAG(v->flags, OSPF_VERTEX_SEED))
+			ospf_spf_unseed(area, v);
+
+		SET_FLAG(v->flags,
+			 OSPF_VERTEX_IN_SPFTREE | OSPF_VERTEX_UPDATED);
+
+		ospf_vertex_add_parent(v);
+		ospf_spf_next(v, area, &candidate);
+		updated++;
+	}
+
+	vertex_pqueue_fini(&candidate);
+
+	if (IS_DEBUG_OSPF_EVENT)
+		ospf_spf_dump(area->spf, 0);
+
+	area->spf_calculation++;
+	area->spf_incremental++;
+	area->spf_vertices = listcount(area->spf_vertex_list);
+	area->spf_vertices_updated = updated;
+
+	done = true;
+out:
+	list_delete(&changed);
+	list_delete(&seeds);
+	return done;
+}
+
+/*
+ * The area's shortest-path tree, updated from the one kept from the last
+ * run where that works.  This reads the area's LSDB and interfaces and
+ * writes only the area's tree, see ospf_spf_calculate_areas().
+ */
+static void ospf_spf_calculate_tree(struct ospf *ospf, struct ospf_area *area)
+{
+	if (ospf_spf_calculate_incremental(ospf, area))
+		return;
+
+	ospf_spf_reset(area);
+	ospf_spf_calculate(area, area->router_lsa_self, NULL, NULL, NULL, false,
+			   true);
+	if (area->spf_vertex_list) {
+		area->spf_vertices = listcount(area->spf_vertex_list);
+		area->spf_vertices_updated = area->spf_vertices;
+	}
+}
+
+/* The routes for the area's tree; keeps the tree for the next run. */
+static void ospf_spf_calculate_routes(struct ospf *ospf,
+				      struct ospf_area *area,
+				      struct route_table *new_table,
+				      struct route_table *all_rtrs,
+				      struct route_table *new_rtrs)
+{
+	if (area->spf) {
+		ospf_spf_add_routes(area, new_table, all_rtrs, new_rtrs);
+
+		if (IS_DEBUG_OSPF_EVENT) {
+			ospf_route_table_dump(new_table);
+			if (all_rtrs)
+				ospf_router_route_table_dump(all_rtrs);
+		}
+
+		monotime(&ospf->ts_spf);
+		area->ts_spf = ospf->ts_spf;
+	}
 
 	if (ospf->ti_lfa_enabled)
 		ospf_ti_lfa_compute(area, new_table,
 				    ospf->ti_lfa_protection_type);
 
+	/* keep the tree for the next run to update, see above */
+	if (area->spf && !ospf->ti_lfa_enabled) {
+		ospf_spf_keep(area);
+		return;
+	}
+
 	ospf_spf_cleanup(area->spf, area->spf_vertex_list);
 
 	area->spf = NULL;
 	area->spf_vertex_list = NULL;
 }
 
+void ospf_spf_calculate_area(struct ospf *ospf, struct ospf_area *area,
+			     struct route_table *new_table,
+			     struct route_table *all_rtrs,
+			     struct route_table *new_rtrs)
+{
+	ospf_spf_calculate_tree(ospf, area);
+	ospf_spf_calculate_routes(ospf, area, new_table, all_rtrs, new_rtrs);
+}
+
+static void ospf_spf_tree_work(void *arg)
+{
+	struct ospf_area *area = arg;
+
+	ospf_spf_calculate_tree(area->ospf, area);
+}
+
+/*
+ * With a pool configured for them (--spf-threads), the areas' trees are
+ * calculated in parallel.  They are calculated from the LSDBs as they are;
+ * the main pthread waits for them, so nothing changes those meanwhile.
+ * Adding the routes stays on the main pthread, in the same order as
+ * without.  Virtual links make the backbone's tree depend on the transit
+ * areas' routes and TI-LFA calculates more trees from the routes, so
+ * neither goes parallel.
+ */
+static bool ospf_spf_parallel(struct ospf *ospf)
+{
+	struct ospf_area *area;
+	struct listnode *node;
+	unsigned int roots = 0;
+
+	if (!om->spf_pool || ospf->ti_lfa_enabled || listcount(ospf->vlinks))
+		return false;
+
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area))
+		if (area->router_lsa_self)
+			roots++;
+
+	return roots > 1;
+}
+
+static void ospf_spf_calculate_trees(struct ospf *ospf)
+{
+	struct taskpool_future **futures;
+	struct ospf_area *area;
+	struct listnode *node;
+	unsigned int i = 0;
+
+	futures = XCALLOC(MTYPE_TMP,
+			  listcount(ospf->areas) * sizeof(*futures));
+
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area))
+		futures[i++] = taskpool_submit(om->spf_pool, ospf_spf_tree_work,
+					       area);
+	while (i)
+		taskpool_future_wait(futures[--i]);
+
+	XFREE(MTYPE_TMP, futures);
+}
+
 void ospf_spf_calculate_areas(struct ospf *ospf, struct route_table *new_table,
 			      struct route_table *all_rtrs,
 			      struct route_table *new_rtrs)
 {
 	struct ospf_area *area;
 	struct listnode *node, *nnode;
+	bool parallel = ospf_spf_parallel(ospf);
+
+	if (parallel)
+		ospf_spf_calculate_trees(ospf);
 
 	/* Calculate SPF for each area. */
 	for (ALL_LIST_ELEMENTS(ospf->areas, node, nnode, area)) {
@@ -1831,16 +2520,291 @@ void ospf_spf_calculate_areas(struct ospf *ospf, struct route_table *new_table,
 		if (ospf->backbone && ospf->backbone == area)
 			continue;
 
-		ospf_spf_calculate_area(ospf, area, new_table, all_rtrs,
-					new_rtrs);
+		if (parallel)
+			ospf_spf_calculate_routes(ospf, area, new_table,
+						  all_rtrs, new_rtrs);
+		else
+			ospf_spf_calculate_area(ospf, area, new_table,
+						all_rtrs, new_rtrs);
 	}
 
 	/* SPF for backbone, if required */
-	if (ospf->backbone)
+	if (!ospf->backbone)
+		return;
+
+	if (parallel)
+		ospf_spf_calculate_routes(ospf, ospf->backbone, new_table,
+					  all_rtrs, new_rtrs);
+	else
 		ospf_spf_calculate_area(ospf, ospf->backbone, new_table,
 					all_rtrs, new_rtrs);
 }
 
+/*
+ * Partial route calculation (PRC).  An LSA that only changes prefixes -
+ * the stub links of a router-LSA whose other links stay as they are, or a
+ * summary-LSA - leaves the trees kept from the last SPF run, and the
+ * border router routes calculated from them, as they are.  Only the routes
+ * to those prefixes need calculating again: the trees' stub networks (RFC
+ * 2328 16.1 second stage) and the summary-LSAs (16.2) are examined for them
+ * alone, and the routing table is updated in place.  AS-external-LSAs are
+ * handled per prefix already, see ospf_ase_incremental_update().
+ */
+static bool ospf_prc_possible(struct ospf *ospf)
+{
+	struct listnode *node;
+	struct ospf_area *area;
+
+	if (!ospf->new_table || !ospf->new_rtrs || ospf->t_spf_calc
+	    || ospf->spf_full || ospf->ti_lfa_enabled
+	    || ospf->gr_info.restart_in_progress || listcount(ospf->vlinks))
+		return false;
+
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area))
+		if (area->router_lsa_self && !area->spf)
+			return false;
+
+	return true;
+}
+
+static void ospf_prc_add(struct ospf *ospf, struct prefix_ipv4 *p)
+{
+	struct route_node *rn;
+
+	apply_mask_ipv4(p);
+
+	rn = route_node_get(ospf->prc_prefixes, (struct prefix *)p);
+	if (rn->info)
+		route_unlock_node(rn);
+	else
+		rn->info = (void *)1;
+}
+
+static void ospf_prc_add_summary(struct ospf *ospf, struct ospf_lsa *lsa)
+{
+	struct summary_lsa *sl = (struct summary_lsa *)lsa->data;
+	struct prefix_ipv4 p;
+
+	p.family = AF_INET;
+	p.prefix = sl->header.id;
+	p.prefixlen = ip_masklen(sl->mask);
+	ospf_prc_add(ospf, &p);
+}
+
+/* Queue the stub links that changed, ospf_spf_same_topology() lined up. */
+static void ospf_prc_add_stubs(struct ospf *ospf, struct lsa_header *old,
+			       struct lsa_header *new)
+{
+	struct router_lsa_link *l1, *l2;
+	struct prefix_ipv4 p;
+	uint8_t *p1, *p2, *lim;
+	unsigned int len;
+
+	p1 = (uint8_t *)old + OSPF_LSA_HEADER_SIZE + 4;
+	p2 = (uint8_t *)new + OSPF_LSA_HEADER_SIZE + 4;
+	lim = (uint8_t *)old + ntohs(old->length);
+
+	while (p1 < lim) {
+		l1 = (struct router_lsa_link *)p1;
+		l2 = (struct router_lsa_link *)p2;
+		len = OSPF_ROUTER_LSA_LINK_SIZE
+		      + l1->m[0].tos_count * OSPF_ROUTER_LSA_TOS_SIZE;
+
+		if (memcmp(l1, l2, len)) {
+			ospf_stub_prefix(l1, &p);
+			ospf_prc_add(ospf, &p);
+			ospf_stub_prefix(l2, &p);
+			ospf_prc_add(ospf, &p);
+		}
+
+		p1 += len;
+		p2 += len;
+	}
+}
+
+/* Empty the queue, returns the number of prefixes it held. */
+static unsigned int ospf_prc_reset(struct ospf *ospf)
+{
+	struct route_node *rn;
+	unsigned int count = 0;
+
+	for (rn = route_top(ospf->prc_prefixes); rn; rn = route_next(rn))
+		if (rn->info) {
+			rn->info = NULL;
+			route_unlock_node(rn);
+			count++;
+		}
+
+	return count;
+}
+
+/* RFC2328 16.1 for the queued prefixes, on the area's kept tree. */
+static void ospf_prc_calculate_area(struct ospf_area *area,
+				    struct route_table *rt,
+				    struct route_table *prefixes)
+{
+	struct vertex **vertices;
+	struct network_lsa *nl;
+	struct listnode *node;
+	struct prefix_ipv4 p;
+	struct vertex *v;
+	unsigned int i, n = 0;
+
+	vertices = XMALLOC(MTYPE_TMP, listcount(area->spf_vertex_list)
+					      * sizeof(*vertices));
+
+	for (ALL_LIST_ELEMENTS_RO(area->spf_vertex_list, node, v)) {
+		UNSET_FLAG(v->flags, OSPF_VERTEX_PROCESSED);
+
+		if (v->type != OSPF_VERTEX_NETWORK)
+			continue;
+
+		nl = (struct network_lsa *)v->lsa;
+		p.family = AF_INET;
+		p.prefix = v->id;
+		p.prefixlen = ip_masklen(nl->mask);
+		apply_mask_ipv4(&p);
+
+		if (ospf_prc_queued(prefixes, &p))
+			vertices[n++] = v;
+	}
+
+	/* in the order ospf_spf_add_routes() takes them */
+	qsort(vertices, n, sizeof(*vertices), vertex_sort_cmp);
+
+	for (i = 0; i < n; i++)
+		ospf_intra_add_transit(rt, vertices[i], area);
+
+	XFREE(MTYPE_TMP, vertices);
+
+	ospf_spf_process_stubs(area, area->spf, rt, 0, prefixes);
+}
+
+static void ospf_prc_calculate_worker(struct event *thread)
+{
+	struct ospf *ospf = EVENT_ARG(thread);
+	struct route_table *rt;
+	struct ospf_area *area;
+	struct listnode *node;
+	struct timeval start_time;
+	unsigned long prc_time;
+	unsigned int changed, count;
+
+	ospf->t_prc_calc = NULL;
+
+	if (!ospf_prc_possible(ospf)) {
+		if (IS_DEBUG_OSPF_EVENT)
+			zlog_debug("PRC: not possible anymore, running SPF");
+		ospf_prc_reset(ospf);
+		ospf_spf_calculate_schedule(ospf, SPF_FLAG_ROUTER_LSA_INSTALL);
+		return;
+	}
+
+	monotime(&start_time);
+	rt = route_table_init();
+
+	/* same order as ospf_spf_calculate_areas() */
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area))
+		if (area != ospf->backbone && area->spf)
+			ospf_prc_calculate_area(area, rt, ospf->prc_prefixes);
+	if (ospf->backbone && ospf->backbone->spf)
+		ospf_prc_calculate_area(ospf->backbone, rt,
+					ospf->prc_prefixes);
+
+	ospf_ia_routing_prefixes(ospf, rt, ospf->new_rtrs,
+				 ospf->prc_prefixes);
+	ospf_prune_unreachable_networks(rt);
+
+	changed = ospf_route_install_prefixes(ospf, rt, ospf->prc_prefixes);
+	ospf_route_table_free(rt);
+
+	/* external routes may resolve forwarding addresses over them */
+	if (changed && ospf->external_fwd_addrs)
+		ospf_ase_prefixes_update(ospf, ospf->prc_prefixes);
+
+	count = ospf_prc_reset(ospf);
+
+	if (changed) {
+		if (IS_OSPF_ABR(ospf))
+			ospf_schedule_abr_task(ospf);
+
+		ospf_sr_update_task(ospf);
+	}
+
+	ospf->prc_calculation++;
+	ospf->prc_last_prefixes = count;
+	prc_time = monotime_since(&start_time, NULL);
+
+	if (IS_DEBUG_OSPF_EVENT)
+		zlog_debug("PRC: %u prefixes, %u routes changed in %lu usecs",
+			   count, changed, prc_time);
+}
+
+/*
+ * Called with an LSA about to replace old in the LSDB, or with new NULL
+ * for old aging out.  Returns true if the change is taken care of by PRC,
+ * or needs no calculation at all, false if it needs SPF.
+ */
+bool ospf_prc_schedule(struct ospf *ospf, struct ospf_lsa *old,
+		       struct ospf_lsa *new)
+{
+	struct ospf_lsa *lsa = new ? new : old;
+	struct router_lsa *rl_old, *rl_new;
+
+	if (!ospf || !ospf_prc_possible(ospf))
+		return false;
+
+	switch (lsa->data->type) {
+	case OSPF_ROUTER_LSA:
+		if (!old || !new || IS_LSA_MAXAGE(old) || IS_LSA_MAXAGE(new))
+			return false;
+
+		/* stale self-originated one, see ospf_router_lsa_install() */
+		if (IS_LSA_SELF(new)
+		    && CHECK_FLAG(new->flags, OSPF_LSA_RECEIVED))
+			return false;
+
+		rl_old = (struct router_lsa *)old->data;
+		rl_new = (struct router_lsa *)new->data;
+		if (rl_old->header.options != rl_new->header.options
+		    || rl_old->flags != rl_new->flags
+		    || !ospf_spf_same_topology(old->data, new->data))
+			return false;
+
+		/* not on any tree, still isn't */
+		if (old->stat == LSA_SPF_UNREACHED) {
+			new->stat = LSA_SPF_UNREACHED;
+			return true;
+		}
+
+		/* installed since the last run, SPF needs to place it */
+		if (old->stat == LSA_SPF_NOT_EXPLORED)
+			return false;
+
+		ospf_spf_vertex_set_lsa(old->stat, new);
+		ospf_prc_add_stubs(ospf, old->data, new->data);
+		break;
+	case OSPF_SUMMARY_LSA:
+		if (IS_LSA_SELF(lsa))
+			return false;
+
+		if (old)
+			ospf_prc_add_summary(ospf, old);
+		if (new)
+			ospf_prc_add_summary(ospf, new);
+		break;
+	default:
+		return false;
+	}
+
+	if (IS_DEBUG_OSPF_EVENT)
+		zlog_debug("PRC: %s changed prefixes only", dump_lsa_key(lsa));
+
+	event_add_timer_msec(master, ospf_prc_calculate_worker, ospf,
+			     ospf->spf_delay, &ospf->t_prc_calc);
+	return true;
+}
+
 /* Worker for SPF calculation scheduler. */
 static void ospf_spf_calculate_schedule_worker(struct event *thread)
 {
@@ -1850,6 +2814,7 @@ static void ospf_spf_calculate_schedule_worker(struct event *thread)
 	struct timeval start_time, spf_start_time;
 	unsigned long ia_time, prune_time, rt_time;
 	unsigned long abr_time, total_spf_time, spf_time;
+	bool ase_full;
 	char rbuf[32]; /* reason_buf */
 
 	if (IS_DEBUG_OSPF_EVENT)
@@ -1857,6 +2822,10 @@ static void ospf_spf_calculate_schedule_worker(struct event *thread)
 
 	ospf->t_spf_calc = NULL;
 
+	/* covers whatever was queued for partial calculation */
+	EVENT_OFF(ospf->t_prc_calc);
+	ospf_prc_reset(ospf);
+
 	ospf_vl_unapprove(ospf);
 
 	/* Execute SPF for each area including backbone, see RFC 2328 16.1. */
@@ -1869,6 +2838,7 @@ static void ospf_spf_calculate_schedule_worker(struct event *thread)
 		all_rtrs = route_table_init();
 
 	ospf_spf_calculate_areas(ospf, new_table, all_rtrs, new_rtrs);
+	ospf->spf_full = false;
 	spf_time = monotime_since(&spf_start_time, NULL);
 
 	ospf_vl_shut_unapproved(ospf);
@@ -1891,10 +2861,16 @@ static void ospf_spf_calculate_schedule_worker(struct event *thread)
 	/*
 	 * Calculate AS external routes, see RFC 2328 16.4.
 	 * There is a dedicated routing table for external routes which is not
-	 * handled here directly
+	 * handled here directly.  If only LSAs changed since the last run,
+	 * ospf_ase_spf_update() below redoes just the affected ones.
 	 */
-	ospf_ase_calculate_schedule(ospf);
-	ospf_ase_calculate_timer_add(ospf);
+	ase_full = !ospf->new_rtrs || ospf->ti_lfa_enabled
+		   || ospf->gr_info.finishing_restart
+		   || (spf_reason_flags & ~SPF_INCREMENTAL_REASONS);
+	if (ase_full) {
+		ospf_ase_calculate_schedule(ospf);
+		ospf_ase_calculate_timer_add(ospf);
+	}
 
 	if (IS_DEBUG_OSPF_EVENT)
 		zlog_debug(
@@ -1930,6 +2906,9 @@ static void ospf_spf_calculate_schedule_worker(struct event *thread)
 	ospf->old_rtrs = ospf->new_rtrs;
 	ospf->new_rtrs = new_rtrs;
 
+	if (!ase_full)
+		ospf_ase_spf_update(ospf);
+
 	/* ABRs may require additional changes, see RFC 2328 16.7. */
 	monotime(&start_time);
 	if (IS_OSPF_ABR(ospf)) {
@@ -2002,6 +2981,8 @@ void ospf_spf_calculate_schedule(struct ospf *ospf, ospf_spf_reason_t reason)
 		return;
 
 	ospf_spf_set_reason(reason);
+	if (!(SPF_INCREMENTAL_REASONS & (1 << reason)))
+		ospf->spf_full = true;
 
 	/* SPF calculation timer is already scheduled. */
 	if (ospf->t_spf_calc) {
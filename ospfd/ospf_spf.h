@@ -15,6 +15,11 @@
 
 /* values for vertex->flags */
 #define OSPF_VERTEX_PROCESSED      0x01
+#define OSPF_VERTEX_IN_SPFTREE     0x02
+/* incremental SPF: below a changed vertex, (re)calculated, links examined */
+#define OSPF_VERTEX_AFFECTED       0x04
+#define OSPF_VERTEX_UPDATED        0x08
+#define OSPF_VERTEX_SEED           0x10
 
 /* The "root" is the node running the SPF calculation */
 
@@ -74,6 +79,7 @@ extern void ospf_spf_calculate_areas(struct ospf *ospf,
 				     struct route_table *new_rtrs);
 extern void ospf_rtrs_free(struct route_table *);
 extern void ospf_spf_cleanup(struct vertex *spf, struct list *vertex_list);
+extern void ospf_spf_reset(struct ospf_area *area);
 extern void ospf_spf_copy(struct vertex *vertex, struct list *vertex_list);
 extern void ospf_spf_remove_resource(struct vertex *vertex,
 				     struct list *vertex_list,
@@ -88,5 +94,7 @@ extern int vertex_parent_cmp(void *aa, void *bb);
 
 extern void ospf_spf_print(struct vty *vty, struct vertex *v, int i);
 extern void ospf_restart_spf(struct ospf *ospf);
+extern bool ospf_prc_schedule(struct ospf *ospf, struct ospf_lsa *old,
+			      struct ospf_lsa *new);
 /* void ospf_spf_calculate_timer_add (); */
 #endif /* _QUAGGA_OSPF_SPF_H */
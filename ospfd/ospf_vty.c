@@ -2333,6 +2333,25 @@ DEFPY (ospf_timers_min_ls_interval,
 	return CMD_SUCCESS;
 }
 
+DEFPY (ospf_timers_flood_delay,
+       ospf_timers_flood_delay_cmd,
+       "[no] timers throttle flood ![(0-1000)]$delay",
+       NO_STR
+       "Adjust routing timers\n"
+       "Throttling adaptive timer\n"
+       "LS Update flooding\n"
+       "Delay (msec) gathering LSAs before sending LS Updates\n")
+{
+	VTY_DECLVAR_INSTANCE_CONTEXT(ospf, ospf);
+
+	if (no)
+		ospf->ls_upd_delay = OSPF_LS_UPD_DELAY_DEFAULT;
+	else
+		ospf->ls_upd_delay = delay;
+
+	return CMD_SUCCESS;
+}
+
 DEFUN (ospf_timers_throttle_spf,
        ospf_timers_throttle_spf_cmd,
        "timers throttle spf (0-600000) (0-600000) (0-600000)",
@@ -2881,6 +2900,12 @@ static void show_ip_ospf_area(struct vty *vty, struct ospf_area *area,
 		/* Show SPF calculation times. */
 		json_object_int_add(json_area, "spfExecutedCounter",
 				    area->spf_calculation);
+		json_object_int_add(json_area, "spfIncrementalCounter",
+				    area->spf_incremental);
+		json_object_int_add(json_area, "spfLastVertices",
+				    area->spf_vertices);
+		json_object_int_add(json_area, "spfLastVerticesUpdated",
+				    area->spf_vertices_updated);
 		json_object_int_add(json_area, "lsaNumber", area->lsdb->total);
 		json_object_int_add(
 			json_area, "lsaRouterNumber",
@@ -2935,6 +2960,10 @@ static void show_ip_ospf_area(struct vty *vty, struct ospf_area *area,
 		/* Show SPF calculation times. */
 		vty_out(vty, "   SPF algorithm executed %d times\n",
 			area->spf_calculation);
+		vty_out(vty,
+			"   Incremental SPF runs %u, last run updated %u of %u vertices\n",
+			area->spf_incremental, area->spf_vertices_updated,
+			area->spf_vertices);
 
 		/* Show number of LSA. */
 		vty_out(vty, "   Number of LSA %ld\n", area->lsdb->total);
@@ -3196,6 +3225,26 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 			vty_out(vty, "has not been run\n");
 	}
 
+	if (json) {
+		json_object_int_add(json_vrf, "prcExecutedCounter",
+				    ospf->prc_calculation);
+		json_object_int_add(json_vrf, "prcLastPrefixes",
+				    ospf->prc_last_prefixes);
+	} else
+		vty_out(vty,
+			" Partial route calculation executed %u times, last for %u prefixes\n",
+			ospf->prc_calculation, ospf->prc_last_prefixes);
+
+	if (json) {
+		json_object_int_add(json_vrf, "aseIncrementalCounter",
+				    ospf->ase_incremental);
+		json_object_int_add(json_vrf, "aseLastPrefixes",
+				    ospf->ase_last_prefixes);
+	} else
+		vty_out(vty,
+			" External routes updated incrementally %u times, last for %u prefixes\n",
+			ospf->ase_incremental, ospf->ase_last_prefixes);
+
 	if (json) {
 		if (ospf->t_spf_calc) {
 			long time_store;
@@ -3210,6 +3259,8 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 				    ospf->min_ls_interval);
 		json_object_int_add(json_vrf, "lsaMinArrivalMsecs",
 				    ospf->min_ls_arrival);
+		json_object_int_add(json_vrf, "floodDelayMsecs",
+				    ospf->ls_upd_delay);
 		/* Show write multiplier values */
 		json_object_int_add(json_vrf, "writeMultiplier",
 				    ospf->write_oi_count);
@@ -3236,6 +3287,8 @@ static int show_ip_ospf_common(struct vty *vty, struct ospf *ospf,
 			ospf->min_ls_interval);
 		vty_out(vty, " LSA minimum arrival %d msecs\n",
 			ospf->min_ls_arrival);
+		vty_out(vty, " LS Update flood delay %u msecs\n",
+			ospf->ls_upd_delay);
 
 		/* Show write multiplier values */
 		vty_out(vty, " Write Multiplier set to %d \n",
@@ -12953,6 +13006,8 @@ static int ospf_config_write_one(struct vty *vty, struct ospf *ospf)
 	if (ospf->min_ls_arrival != OSPF_MIN_LS_ARRIVAL)
 		vty_out(vty, " timers lsa min-arrival %d\n",
 			ospf->min_ls_arrival);
+	if (ospf->ls_upd_delay != OSPF_LS_UPD_DELAY_DEFAULT)
+		vty_out(vty, " timers throttle flood %u\n", ospf->ls_upd_delay);
 
 	/* Write multiplier print. */
 	if (ospf->write_oi_count != OSPF_WRITE_INTERFACE_COUNT_DEFAULT)
@@ -13695,6 +13750,7 @@ void ospf_vty_init(void)
 	install_element(OSPF_NODE, &ospf_timers_min_ls_interval_cmd);
 	install_element(OSPF_NODE, &ospf_timers_lsa_min_arrival_cmd);
 	install_element(OSPF_NODE, &ospf_timers_lsa_min_arrival_deprecated_cmd);
+	install_element(OSPF_NODE, &ospf_timers_flood_delay_cmd);
 
 	/* refresh timer commands */
 	install_element(OSPF_NODE, &ospf_refresh_timer_cmd);
@@ -25,6 +25,7 @@
 #include "defaults.h"
 #include "lib_errors.h"
 #include "ldp_sync.h"
+#include "taskpool.h"
 
 #include "ospfd/ospfd.h"
 #include "ospfd/ospf_bfd.h"
@@ -357,6 +358,9 @@ struct ospf *ospf_new_alloc(unsigned short instance, const char *name)
 	new->new_external_route = route_table_init();
 	new->old_external_route = route_table_init();
 	new->external_lsas = route_table_init();
+	new->external_asbrs = route_table_init();
+	new->external_fwds = route_table_init();
+	new->prc_prefixes = route_table_init();
 
 	new->stub_router_startup_time = OSPF_STUB_ROUTER_UNCONFIGURED;
 	new->stub_router_shutdown_time = OSPF_STUB_ROUTER_UNCONFIGURED;
@@ -372,6 +376,7 @@ struct ospf *ospf_new_alloc(unsigned short instance, const char *name)
 	/* LSA timers */
 	new->min_ls_interval = OSPF_MIN_LS_INTERVAL;
 	new->min_ls_arrival = OSPF_MIN_LS_ARRIVAL;
+	new->ls_upd_delay = OSPF_LS_UPD_DELAY_DEFAULT;
 
 	/* SPF timer value init. */
 	new->spf_delay = OSPF_SPF_DELAY_DEFAULT;
@@ -653,6 +658,8 @@ void ospf_terminate(void)
 	zclient_stop(zclient_sync);
 	zclient_free(zclient_sync);
 
+	taskpool_free(&om->spf_pool);
+
 	frr_fini();
 }
 
@@ -814,6 +821,9 @@ static void ospf_finish_final(struct ospf *ospf)
 	if (ospf->external_lsas) {
 		ospf_ase_external_lsas_finish(ospf->external_lsas);
 	}
+	ospf_ase_external_index_finish(ospf->external_asbrs);
+	ospf_ase_external_index_finish(ospf->external_fwds);
+	route_table_finish(ospf->prc_prefixes);
 
 	for (i = ZEBRA_ROUTE_SYSTEM; i <= ZEBRA_ROUTE_MAX; i++) {
 		struct list *ext_list;
@@ -859,8 +869,10 @@ static void ospf_finish_final(struct ospf *ospf)
 	/* Cancel all timers. */
 	EVENT_OFF(ospf->t_read);
 	EVENT_OFF(ospf->t_write);
+	EVENT_OFF(ospf->t_ls_upd_event);
 	EVENT_OFF(ospf->t_spf_calc);
 	EVENT_OFF(ospf->t_ase_calc);
+	EVENT_OFF(ospf->t_prc_calc);
 	EVENT_OFF(ospf->t_maxage);
 	EVENT_OFF(ospf->t_maxage_walker);
 	EVENT_OFF(ospf->t_deferred_shutdown);
@@ -981,6 +993,9 @@ static void ospf_area_free(struct ospf_area *area)
 {
 	ospf_opaque_type10_lsa_term(area);
 
+	/* Free the SPF tree, it holds on to LSAs. */
+	ospf_spf_reset(area);
+
 	/* Free LSDBs. */
 	ospf_area_lsdb_discard_delete(area);
 
@@ -1460,9 +1475,6 @@ void ospf_ls_upd_queue_empty(struct ospf_interface *oi)
 			list_delete(&lst);
 			rn->info = NULL;
 		}
-
-	/* remove update event */
-	EVENT_OFF(oi->t_ls_upd_event);
 }
 
 void ospf_if_update(struct ospf *ospf, struct interface *ifp)
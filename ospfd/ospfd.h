@@ -86,6 +86,9 @@ struct ospf_master {
 	/* Various OSPF global configuration. */
 	uint8_t options;
 #define OSPF_MASTER_SHUTDOWN (1 << 0) /* deferred-shutdown */
+
+	/* Worker pthreads for the areas' SPF runs, see --spf-threads. */
+	struct taskpool *spf_pool;
 };
 
 struct ospf_redist {
@@ -208,6 +211,8 @@ struct ospf {
 	unsigned int min_ls_interval; /* minimum delay between LSAs (in msec) */
 	unsigned int min_ls_arrival;  /* minimum interarrival time between LSAs
 					 (in msec) */
+	unsigned int ls_upd_delay;    /* LS Update gathering delay (in msec) */
+#define OSPF_LS_UPD_DELAY_DEFAULT 0
 
 	/* SPF parameters */
 	unsigned int spf_delay;	/* SPF delay time. */
@@ -215,6 +220,12 @@ struct ospf {
 	unsigned int spf_max_holdtime; /* SPF maximum-holdtime */
 	unsigned int
 		spf_hold_multiplier; /* Adaptive multiplier for hold time */
+	bool spf_full;		     /* next SPF can't be incremental */
+
+	/* Partial route calculation, see ospf_prc_schedule() */
+	struct route_table *prc_prefixes; /* Prefixes to recalculate. */
+	uint32_t prc_calculation;	  /* Partial calculations run. */
+	uint32_t prc_last_prefixes;	  /* ... prefixes in the last one. */
 
 	int default_originate;	/* Default information originate. */
 #define DEFAULT_ORIGINATE_NONE		0
@@ -253,6 +264,13 @@ struct ospf {
 
 	struct route_table *external_lsas; /* Database of external LSAs,
 					      prefix is LSA's adv. network*/
+	unsigned long external_fwd_addrs; /* ... how many of them have a
+					     forwarding address */
+	struct route_table *external_asbrs; /* ... the same LSAs by their
+					       originating ASBR */
+	struct route_table *external_fwds; /* ... and by forwarding address */
+	uint32_t ase_incremental;	    /* Incremental updates after SPF. */
+	uint32_t ase_last_prefixes;	    /* ... prefixes in the last one. */
 
 	/* Time stamps */
 	struct timeval ts_spf;		/* SPF calculation time stamp. */
@@ -270,6 +288,7 @@ struct ospf {
 	struct event *t_distribute_update; /* Distirbute list update timer. */
 	struct event *t_spf_calc;	   /* SPF calculation timer. */
 	struct event *t_ase_calc;	   /* ASE calculation timer. */
+	struct event *t_prc_calc;	   /* Partial route calculation timer. */
 	struct event *t_opaque_lsa_self; /* Type-11 Opaque-LSAs origin event. */
 	struct event *t_sr_update;	 /* Segment Routing update timer */
 
@@ -282,6 +301,7 @@ struct ospf {
 
 	struct event *t_write;
 #define OSPF_WRITE_INTERFACE_COUNT_DEFAULT    20
+	struct event *t_ls_upd_event; /* LS Update send event */
 	struct event *t_default_routemap_timer;
 
 	int write_oi_count; /* Num of packets sent per thread invocation */
@@ -614,6 +634,9 @@ struct ospf_area {
 
 	/* Statistics field. */
 	uint32_t spf_calculation; /* SPF Calculation Count. */
+	uint32_t spf_incremental; /* ... of which incremental. */
+	uint32_t spf_vertices;	  /* Vertices on the last tree. */
+	uint32_t spf_vertices_updated; /* ... calculated in the last run. */
 
 	/* reverse SPF (used for TI-LFA Q spaces) */
 	bool spf_reversed;
@@ -10,15 +10,23 @@
 #include <lib/version.h>
 #include "getopt.h"
 #include "frrevent.h"
+#include "frr_pthread.h"
 #include "vty.h"
 #include "command.h"
 #include "log.h"
 #include "vrf.h"
 #include "yang.h"
+#include "srcdest_table.h"
+#include "taskpool.h"
 
 #include "isisd/isisd.h"
+#include "isisd/isis_adjacency.h"
+#include "isisd/isis_circuit.h"
 #include "isisd/isis_dynhn.h"
+#include "isisd/isis_lfa.h"
+#include "isisd/isis_lsp.h"
 #include "isisd/isis_misc.h"
+#include "isisd/isis_mt.h"
 #include "isisd/isis_route.h"
 #include "isisd/isis_spf.h"
 #include "isisd/isis_spf_private.h"
@@ -176,6 +184,348 @@ static void test_run_rlfa(struct vty *vty, const struct isis_topology *topology,
 	isis_spftree_del(spftree_pc);
 }
 
+static bool test_same_nexthop(const struct isis_nexthop *nh,
+			      const struct isis_nexthop *ref)
+{
+	const struct mpls_label_stack *ls = nh->label_stack;
+	const struct mpls_label_stack *rls = ref->label_stack;
+
+	if (memcmp(nh->sysid, ref->sysid, sizeof(nh->sysid)))
+		return false;
+	if (!ls || !rls)
+		return ls == rls;
+
+	return ls->num_labels == rls->num_labels
+	       && !memcmp(ls->label, rls->label,
+			  ls->num_labels * sizeof(ls->label[0]));
+}
+
+static bool test_same_route(const struct isis_route_info *rinfo,
+			    const struct isis_route_info *ref)
+{
+	struct isis_nexthop *nh, *rnh;
+	struct listnode *node, *rnode;
+	bool found;
+
+	if (rinfo->cost != ref->cost || rinfo->depth != ref->depth
+	    || listcount(rinfo->nexthops) != listcount(ref->nexthops))
+		return false;
+
+	for (ALL_LIST_ELEMENTS_RO(ref->nexthops, rnode, rnh)) {
+		found = false;
+		for (ALL_LIST_ELEMENTS_RO(rinfo->nexthops, node, nh)) {
+			if (test_same_nexthop(nh, rnh)) {
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+/* Does the routing table have the same routes as the reference one? */
+static bool test_same_routes(struct route_table *table,
+			     struct route_table *ref_table)
+{
+	struct route_node *rn, *rrn;
+	const struct prefix *dst_p, *src_p;
+	unsigned int count = 0;
+
+	for (rrn = route_top(ref_table); rrn; rrn = srcdest_route_next(rrn)) {
+		if (!rrn->info)
+			continue;
+		count++;
+
+		srcdest_rnode_prefixes(rrn, &dst_p, &src_p);
+		rn = srcdest_rnode_lookup(table, dst_p,
+					  (const struct prefix_ipv6 *)src_p);
+		if (!rn)
+			return false;
+		route_unlock_node(rn);
+
+		if (!rn->info || !test_same_route(rn->info, rrn->info))
+			return false;
+	}
+
+	for (rn = route_top(table); rn; rn = srcdest_route_next(rn))
+		if (rn->info)
+			count--;
+
+	return count == 0;
+}
+
+/*
+ * Run SPF for the level's IPv4 and IPv6 trees on a task pool, like
+ * isis_run_spf_cb() does with --spf-threads.  The trees must be the same
+ * as those calculated one after the other.
+ */
+static void test_run_spf_parallel(const struct isis_test_node *root,
+				  struct isis_area *area,
+				  struct lspdb_head *lspdb, int level)
+{
+	struct isis_spftree *trees[SPFTREE_DSTSRC], *refs[SPFTREE_DSTSRC];
+	int tree;
+
+	for (tree = SPFTREE_IPV4; tree <= SPFTREE_IPV6; tree++) {
+		refs[tree] = isis_spftree_new(area, lspdb, root->sysid, level,
+					      tree, SPF_TYPE_FORWARD,
+					      F_SPFTREE_NO_ADJACENCIES,
+					      SR_ALGORITHM_SPF);
+		trees[tree] = isis_spftree_new(area, lspdb, root->sysid, level,
+					       tree, SPF_TYPE_FORWARD,
+					       F_SPFTREE_NO_ADJACENCIES,
+					       SR_ALGORITHM_SPF);
+	}
+	isis_run_spf_trees(area, refs, array_size(refs));
+
+	im->spf_pool = taskpool_new("isis_spf", 2);
+	isis_run_spf_trees(area, trees, array_size(trees));
+	taskpool_free(&im->spf_pool);
+
+	for (tree = SPFTREE_IPV4; tree <= SPFTREE_IPV6; tree++) {
+		assert(isis_vertex_queue_count(&trees[tree]->paths)
+		       == isis_vertex_queue_count(&refs[tree]->paths));
+		assert(test_same_routes(trees[tree]->route_table,
+					refs[tree]->route_table));
+		isis_spftree_del(trees[tree]);
+		isis_spftree_del(refs[tree]);
+	}
+}
+
+/*
+ * Give an LSP other TLVs and a new sequence number between two SPF runs,
+ * without dropping what SPF cached for it.  The second run must notice the
+ * cached reachability is stale and use the new TLVs.
+ */
+static void test_run_spf_lsp_change(const struct isis_test_node *root,
+				    struct isis_area *area,
+				    struct lspdb_head *lspdb, int level)
+{
+	struct isis_spftree *spftree;
+	struct isis_vertex *vertex;
+	struct isis_lsp *lsp, *changed = NULL;
+	struct isis_route_info *rinfo;
+	struct isis_tlvs *tlvs;
+	struct route_node *rn;
+	struct prefix_ipv4 p;
+	uint32_t d_N = 0;
+
+	spftree = isis_spftree_new(area, lspdb, root->sysid, level,
+				   SPFTREE_IPV4, SPF_TYPE_FORWARD,
+				   F_SPFTREE_NO_ADJACENCIES, SR_ALGORITHM_SPF);
+	isis_run_spf(spftree);
+
+	/* Any router the root reaches over IPv4 */
+	frr_each (lspdb, lspdb, lsp) {
+		if (LSP_PSEUDO_ID(lsp->hdr.lsp_id) ||
+		    LSP_FRAGMENT(lsp->hdr.lsp_id) ||
+		    !memcmp(lsp->hdr.lsp_id, root->sysid, ISIS_SYS_ID_LEN))
+			continue;
+
+		vertex = isis_find_vertex(&spftree->paths, lsp->hdr.lsp_id,
+					  VTYPE_NONPSEUDO_TE_IS);
+		if (vertex) {
+			changed = lsp;
+			d_N = vertex->d_N;
+			break;
+		}
+	}
+	isis_spftree_del(spftree);
+	if (!changed)
+		return;
+
+	/* SPF kept what it needs of the LSP */
+	assert(changed->spf_views);
+
+	str2prefix_ipv4("203.0.113.0/24", &p);
+	tlvs = isis_copy_tlvs(changed->tlvs);
+	isis_tlvs_add_extended_ip_reach(tlvs, &p, 10, false, NULL);
+	isis_free_tlvs(changed->tlvs);
+	changed->tlvs = tlvs;
+	changed->hdr.seqno++;
+
+	spftree = isis_spftree_new(area, lspdb, root->sysid, level,
+				   SPFTREE_IPV4, SPF_TYPE_FORWARD,
+				   F_SPFTREE_NO_ADJACENCIES, SR_ALGORITHM_SPF);
+	isis_run_spf(spftree);
+
+	rn = srcdest_rnode_lookup(spftree->route_table, (struct prefix *)&p,
+				  NULL);
+	assert(rn && rn->info);
+	route_unlock_node(rn);
+	rinfo = rn->info;
+	assert(rinfo->cost == d_N + 10);
+
+	isis_spftree_del(spftree);
+}
+
+/* Compute the TI-LFA backup routes from scratch */
+static struct isis_spftree *
+test_ti_lfa_compute(const struct isis_test_node *root, struct isis_area *area,
+		    struct lspdb_head *lspdb, int level, int tree,
+		    struct lfa_protected_resource *protected_resource)
+{
+	struct isis_spftree *spftree_self;
+	struct isis_spftree *spftree_reverse;
+	struct isis_spftree *spftree_pc;
+
+	spftree_self = isis_spftree_new(area, lspdb, root->sysid, level, tree,
+					SPF_TYPE_FORWARD,
+					F_SPFTREE_NO_ADJACENCIES,
+					SR_ALGORITHM_SPF);
+	isis_run_spf(spftree_self);
+	spftree_reverse = isis_spf_reverse_run(spftree_self);
+	isis_spf_run_neighbors(spftree_self);
+	spftree_pc = isis_tilfa_compute(area, spftree_self, spftree_reverse,
+					protected_resource);
+
+	isis_spftree_del(spftree_reverse);
+	isis_spftree_del(spftree_pc);
+
+	return spftree_self;
+}
+
+/*
+ * Run SPF and TI-LFA again, the way isis_run_spf_cb() does.  The routes of
+ * the previous run are dropped rather than invalidated, as the nexthops of
+ * unit tests can't be compared with the new ones.
+ */
+static void test_ti_lfa_rerun(struct isis_area *area,
+			      struct isis_spftree *spftree)
+{
+	struct isis_route_table_info *info = spftree->route_table->info;
+
+	route_table_finish(spftree->route_table);
+	isis_route_table_info_free(info);
+	spftree->route_table = srcdest_table_init();
+	spftree->route_table->info =
+		isis_route_table_info_alloc(spftree->algorithm);
+	spftree->route_table->cleanup = isis_route_node_cleanup;
+
+	isis_spf_invalidate_routes(spftree);
+	isis_run_spf(spftree);
+	isis_spf_run_lfa(area, spftree);
+}
+
+/* Compute what the cache was missing, instead of waiting for the event */
+static void test_ti_lfa_run_pending(struct isis_area *area)
+{
+	void (*func)(struct event *e);
+
+	assert(area->t_tilfa_update);
+	func = area->t_tilfa_update->func;
+	EVENT_OFF(area->t_tilfa_update);
+	event_execute(master, func, area, 0, NULL);
+	assert(list_isempty(area->tilfa_pending));
+}
+
+/* Multiply or divide the metrics of the root's IS reachability */
+static void test_root_lsp_metrics(const struct isis_test_node *root,
+				  struct lspdb_head *lspdb, uint16_t mtid,
+				  bool multiply)
+{
+	uint8_t lspid[ISIS_SYS_ID_LEN + 2] = {};
+	struct isis_extended_reach *r;
+	struct isis_item_list *items;
+	struct isis_lsp *lsp;
+
+	memcpy(lspid, root->sysid, ISIS_SYS_ID_LEN);
+	lsp = lsp_search(lspdb, lspid);
+	assert(lsp);
+
+	if (mtid == ISIS_MT_IPV4_UNICAST)
+		items = &lsp->tlvs->extended_reach;
+	else
+		items = isis_lookup_mt_items(&lsp->tlvs->mt_reach, mtid);
+	assert(items);
+
+	for (r = (struct isis_extended_reach *)items->head; r; r = r->next)
+		r->metric = multiply ? r->metric * 2 : r->metric / 2;
+
+	/* a new instance of the LSP, as a regenerated one would be */
+	lsp_inc_seqno(lsp, 0);
+}
+
+/*
+ * TI-LFA through the repair path cache of isis_spf_run_lfa(), protecting a
+ * circuit to the failed neighbor.  The repair paths are computed after the
+ * primary routes first, then replayed while the LSDB doesn't change, and
+ * computed again after an LSP changed.  The backup routes must be the same
+ * as those computed from scratch each time.
+ */
+static void
+test_run_ti_lfa_cache(const struct isis_test_node *root,
+		      struct isis_area *area, struct lspdb_head *lspdb,
+		      int level, int tree,
+		      struct lfa_protected_resource *protected_resource,
+		      struct isis_spftree *spftree_ref)
+{
+	struct isis_circuit circuit = {};
+	struct isis_adjacency adj = {};
+	struct isis_spftree *spftree, *spftree_changed;
+	uint8_t *desig_is;
+
+	circuit.is_type = level;
+	circuit.tilfa_protection[level - 1] = true;
+	circuit.tilfa_node_protection[level - 1] =
+		(protected_resource->type == LFA_NODE_PROTECTION);
+	if (LSP_PSEUDO_ID(protected_resource->adjacency)) {
+		circuit.circ_type = CIRCUIT_T_BROADCAST;
+		desig_is = (level == ISIS_LEVEL1) ? circuit.u.bc.l1_desig_is
+						  : circuit.u.bc.l2_desig_is;
+		memcpy(desig_is, protected_resource->adjacency,
+		       ISIS_SYS_ID_LEN + 1);
+	} else {
+		circuit.circ_type = CIRCUIT_T_P2P;
+		memcpy(adj.sysid, protected_resource->adjacency,
+		       ISIS_SYS_ID_LEN);
+		circuit.u.p2p.neighbor = &adj;
+	}
+	listnode_add(area->circuit_list, &circuit);
+	area->tilfa_protected_links[level - 1]++;
+
+	spftree = isis_spftree_new(area, lspdb, root->sysid, level, tree,
+				   SPF_TYPE_FORWARD, F_SPFTREE_NO_ADJACENCIES,
+				   SR_ALGORITHM_SPF);
+
+	/* Nothing cached yet. */
+	isis_run_spf(spftree);
+	isis_spf_run_lfa(area, spftree);
+	test_ti_lfa_run_pending(area);
+	assert(test_same_routes(spftree->route_table_backup,
+				spftree_ref->route_table_backup));
+
+	/* Unchanged LSDB: replayed from the cache. */
+	test_ti_lfa_rerun(area, spftree);
+	assert(!area->t_tilfa_update);
+	assert(test_same_routes(spftree->route_table_backup,
+				spftree_ref->route_table_backup));
+
+	/* A changed LSP makes the cache stale... */
+	test_root_lsp_metrics(root, lspdb, spftree->mtid, true);
+	test_ti_lfa_rerun(area, spftree);
+	test_ti_lfa_run_pending(area);
+	spftree_changed = test_ti_lfa_compute(root, area, lspdb, level, tree,
+					      protected_resource);
+	assert(test_same_routes(spftree->route_table_backup,
+				spftree_changed->route_table_backup));
+	isis_spftree_del(spftree_changed);
+
+	/* ... and so does changing it back. */
+	test_root_lsp_metrics(root, lspdb, spftree->mtid, false);
+	test_ti_lfa_rerun(area, spftree);
+	test_ti_lfa_run_pending(area);
+	assert(test_same_routes(spftree->route_table_backup,
+				spftree_ref->route_table_backup));
+
+	isis_spftree_del(spftree);
+	area->tilfa_protected_links[level - 1]--;
+	listnode_delete(area->circuit_list, &circuit);
+}
+
 static void test_run_ti_lfa(struct vty *vty,
 			    const struct isis_topology *topology,
 			    const struct isis_test_node *root,
@@ -231,6 +581,10 @@ static void test_run_ti_lfa(struct vty *vty,
 	isis_print_spftree(vty, spftree_pc, NULL);
 	isis_print_routes(vty, spftree_self, NULL, false, true);
 
+	/* Check the same repair paths through the cache. */
+	test_run_ti_lfa_cache(root, area, lspdb, level, tree,
+			      protected_resource, spftree_self);
+
 	/* Cleanup everything. */
 	isis_spftree_del(spftree_self);
 	isis_spftree_del(spftree_reverse);
@@ -339,6 +693,13 @@ static int test_run(struct vty *vty, const struct isis_topology *topology,
 				break;
 			}
 		}
+
+		if (test_type == TEST_SPF) {
+			test_run_spf_parallel(root, area,
+					      &area->lspdb[level - 1], level);
+			test_run_spf_lsp_change(root, area,
+						&area->lspdb[level - 1], level);
+		}
 	}
 
 	/* Cleanup IS-IS area. */
@@ -539,6 +900,7 @@ int main(int argc, char **argv)
 	}
 
 	/* master init. */
+	frr_pthread_init();
 	master = event_master_create(NULL);
 	isis_master_init(master);
 
@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * LSP TX queue tests: bursts, pacing and what happens to the LSPs of a
+ * batched burst that fails to be sent.
+ */
+
+#include <zebra.h>
+
+#include "if.h"
+#include "monotime.h"
+#include "stream.h"
+
+#include "isisd/isisd.h"
+#include "isisd/isis_circuit.h"
+#include "isisd/isis_lsp.h"
+#include "isisd/isis_pdu.h"
+#include "isisd/isis_tx_queue.h"
+
+#include "test_common.h"
+
+#define MAX_LSPS 16
+
+static struct isis_area area;
+static struct interface ifp = { .name = "eth-test" };
+static struct isis_circuit circuit;
+static struct isis_lsp *lsps[MAX_LSPS];
+
+/* What the circuit was asked to send */
+static unsigned int tx_count;
+static unsigned int batch_calls;
+static unsigned int batch_sizes[MAX_LSPS];
+static struct isis_lsp *batch_lsps[4 * MAX_LSPS];
+static unsigned int batch_lsp_count;
+static struct timeval batch_times[MAX_LSPS];
+
+/* Make the next tx_batch() call fail after sending this many PDUs */
+static int fail_rv = ISIS_OK;
+static unsigned int fail_after;
+
+static int test_tx(struct isis_circuit *circuit, int level)
+{
+	tx_count++;
+	return ISIS_OK;
+}
+
+static int test_tx_batch(struct isis_circuit *circuit,
+			 struct isis_tx_pdu *pdus, unsigned int count,
+			 unsigned int *sent)
+{
+	unsigned int i;
+	int rv = ISIS_OK;
+
+	assert(batch_calls < MAX_LSPS);
+	monotime(&batch_times[batch_calls]);
+	batch_sizes[batch_calls++] = count;
+
+	for (i = 0; i < count; i++) {
+		assert(pdus[i].level == ISIS_LEVEL2);
+		batch_lsps[batch_lsp_count++] = pdus[i].lsp;
+	}
+
+	*sent = count;
+	if (fail_rv != ISIS_OK) {
+		*sent = MIN(fail_after, count);
+		rv = fail_rv;
+		fail_rv = ISIS_OK;
+	}
+
+	return rv;
+}
+
+static void setup(int circ_type, uint16_t burst, uint16_t interval)
+{
+	struct isis_tx_queue_stats stats;
+
+	area.lsp_tx_burst = burst;
+	area.lsp_tx_interval = interval;
+	circuit.circ_type = circ_type;
+
+	tx_count = batch_calls = batch_lsp_count = 0;
+
+	if (circuit.tx_queue)
+		isis_tx_queue_free(circuit.tx_queue);
+	circuit.tx_queue = isis_tx_queue_new(&circuit, send_lsp);
+	isis_tx_queue_stats_get(circuit.tx_queue, &stats);
+	assert(!stats.bursts && !stats.lsps_sent);
+}
+
+static void queue_lsps(unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		isis_tx_queue_add(circuit.tx_queue, lsps[i], TX_LSP_NORMAL);
+	assert(isis_tx_queue_len(circuit.tx_queue) == count);
+}
+
+/* Run the event loop until the circuit got that many batches */
+static void run_batches(unsigned int count)
+{
+	struct event thread;
+
+	while (batch_calls < count && event_fetch(master, &thread))
+		event_call(&thread);
+	assert(batch_calls == count);
+}
+
+static int64_t batch_gap(unsigned int i)
+{
+	return monotime_since(&batch_times[i - 1], &batch_times[i]);
+}
+
+static void test_pacing(void)
+{
+	struct isis_tx_queue_stats stats;
+	unsigned int i;
+
+	printf("Sending 10 LSPs in bursts of 4, 20ms apart...\n");
+	setup(CIRCUIT_T_BROADCAST, 4, 20);
+	queue_lsps(10);
+
+	run_batches(3);
+	assert(batch_sizes[0] == 4 && batch_sizes[1] == 4 &&
+	       batch_sizes[2] == 2);
+	assert(batch_gap(1) >= 20 * 1000 && batch_gap(2) >= 20 * 1000);
+	for (i = 0; i < 10; i++)
+		assert(batch_lsps[i] == lsps[i]);
+	assert(tx_count == 0);
+
+	/* Sent on a broadcast circuit, nothing is left to retransmit */
+	assert(isis_tx_queue_len(circuit.tx_queue) == 0);
+
+	isis_tx_queue_stats_get(circuit.tx_queue, &stats);
+	assert(stats.bursts == 3);
+	assert(stats.lsps_sent == 10);
+	assert(stats.burst_max == 4);
+	assert(stats.retransmits == 0);
+	assert(stats.batch_errors == 0);
+}
+
+static void test_temporary_failure(void)
+{
+	struct isis_tx_queue_stats stats;
+
+	printf("Burst failing temporarily after 2 of 4 LSPs...\n");
+	setup(CIRCUIT_T_BROADCAST, 4, 0);
+	queue_lsps(4);
+
+	fail_rv = ISIS_WARNING;
+	fail_after = 2;
+	run_batches(1);
+
+	/* The two LSPs not sent are still queued ... */
+	assert(isis_tx_queue_len(circuit.tx_queue) == 2);
+
+	/* ... and sent again in order, after backing off */
+	run_batches(2);
+	assert(batch_sizes[1] == 2);
+	assert(batch_lsps[4] == lsps[2] && batch_lsps[5] == lsps[3]);
+	assert(batch_gap(1) >= 100 * 1000);
+	assert(isis_tx_queue_len(circuit.tx_queue) == 0);
+
+	isis_tx_queue_stats_get(circuit.tx_queue, &stats);
+	assert(stats.bursts == 2);
+	assert(stats.retransmits == 2);
+	assert(stats.batch_errors == 1);
+}
+
+static void test_permanent_failure(void)
+{
+	struct isis_tx_queue_stats stats;
+
+	printf("Burst failing permanently at the 2nd of 4 LSPs...\n");
+	setup(CIRCUIT_T_BROADCAST, 4, 0);
+	queue_lsps(4);
+
+	fail_rv = ISIS_ERROR;
+	fail_after = 1;
+	run_batches(1);
+
+	/* The failing LSP is given up on, the other two sent again */
+	assert(isis_tx_queue_len(circuit.tx_queue) == 2);
+	run_batches(2);
+	assert(batch_sizes[1] == 2);
+	assert(batch_lsps[4] == lsps[2] && batch_lsps[5] == lsps[3]);
+	assert(isis_tx_queue_len(circuit.tx_queue) == 0);
+
+	isis_tx_queue_stats_get(circuit.tx_queue, &stats);
+	assert(stats.batch_errors == 1);
+}
+
+static void test_p2p(void)
+{
+	struct isis_tx_queue_stats stats;
+	unsigned int i;
+
+	printf("Sending 6 LSPs in bursts of 4 on a P2P circuit...\n");
+	setup(CIRCUIT_T_P2P, 4, 0);
+	queue_lsps(6);
+
+	run_batches(2);
+	assert(batch_sizes[0] == 4 && batch_sizes[1] == 2);
+
+	/* Kept until acknowledged */
+	assert(isis_tx_queue_len(circuit.tx_queue) == 6);
+	for (i = 0; i < 6; i++)
+		isis_tx_queue_del(circuit.tx_queue, lsps[i]);
+	assert(isis_tx_queue_len(circuit.tx_queue) == 0);
+
+	isis_tx_queue_stats_get(circuit.tx_queue, &stats);
+	assert(stats.bursts == 2);
+	assert(stats.lsps_sent == 6);
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t lsp_id[ISIS_SYS_ID_LEN + 2] = {};
+	unsigned int i;
+
+	master = event_master_create(NULL);
+
+	area.area_tag = XSTRDUP(MTYPE_TMP, "test");
+	area.lsp_mtu = 1497;
+	for (i = 0; i < MAX_LSPS; i++) {
+		lsp_id[ISIS_SYS_ID_LEN - 1] = i + 1;
+		lsps[i] = lsp_new(&area, lsp_id, 1200, 1, 0, 0, NULL,
+				  ISIS_LEVEL2);
+	}
+
+	circuit.state = C_STATE_UP;
+	circuit.is_type = IS_LEVEL_2;
+	circuit.upadjcount[ISIS_LEVEL2 - 1] = 1;
+	circuit.area = &area;
+	circuit.interface = &ifp;
+	circuit.snd_stream = stream_new(1500);
+	circuit.tx = test_tx;
+	circuit.tx_batch = test_tx_batch;
+
+	test_pacing();
+	test_temporary_failure();
+	test_permanent_failure();
+	test_p2p();
+
+	isis_tx_queue_free(circuit.tx_queue);
+	stream_free(circuit.snd_stream);
+	event_master_free(master);
+	XFREE(MTYPE_TMP, area.area_tag);
+
+	printf("Done.\n");
+	return 0;
+}
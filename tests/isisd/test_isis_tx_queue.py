@@ -0,0 +1,9 @@
+import frrtest
+
+
+class TestIsisTxQueue(frrtest.TestMultiOut):
+    program = "./test_isis_tx_queue"
+
+
+TestIsisTxQueue.onesimple("Done.")
+TestIsisTxQueue.exit_cleanly()
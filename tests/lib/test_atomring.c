@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Lock-free pointer ring tests.
+ */
+#include <zebra.h>
+
+#include <pthread.h>
+
+#include "atomring.h"
+#include "frratomic.h"
+
+#define NPRODUCERS 4
+#define NITEMS	   200000
+
+static struct atomring *ring;
+static _Atomic bool start;
+
+static void *producer(void *arg)
+{
+	uintptr_t id = (uintptr_t)arg;
+	uintptr_t i;
+
+	while (!atomic_load_explicit(&start, memory_order_acquire))
+		sched_yield();
+
+	/* items encode (producer, sequence) and are never NULL */
+	for (i = 1; i <= NITEMS; i++)
+		while (!atomring_push(ring, (void *)((i << 4) | id)))
+			sched_yield();
+
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t threads[NPRODUCERS];
+	uintptr_t last[NPRODUCERS] = {};
+	void *batch[32];
+	size_t i, n, total = 0;
+	uintptr_t id;
+
+	ring = atomring_new(1000);
+
+	printf("Validating sizing...\n");
+	assert(atomring_size(ring) == 1024);
+	assert(atomring_count(ring) == 0);
+	assert(atomring_pop(ring) == NULL);
+
+	printf("Validating fill and drain...\n");
+	for (i = 1; i <= 1024; i++)
+		assert(atomring_push(ring, (void *)(i << 4)));
+	assert(atomring_count(ring) == 1024);
+	assert(!atomring_push(ring, (void *)(1025 << 4)));
+
+	for (i = 1; i <= 1024; i++)
+		assert(atomring_pop(ring) == (void *)(i << 4));
+	assert(atomring_count(ring) == 0);
+	assert(atomring_pop(ring) == NULL);
+
+	printf("Validating bulk dequeue...\n");
+	for (i = 1; i <= 40; i++)
+		assert(atomring_push(ring, (void *)(i << 4)));
+	assert(atomring_pop_bulk(ring, batch, array_size(batch)) == 32);
+	assert(batch[0] == (void *)(1 << 4) && batch[31] == (void *)(32 << 4));
+	assert(atomring_pop_bulk(ring, batch, array_size(batch)) == 8);
+	assert(batch[7] == (void *)(40 << 4));
+	assert(atomring_pop_bulk(ring, batch, array_size(batch)) == 0);
+
+	printf("Validating per-producer ordering with %d producers...\n",
+	       NPRODUCERS);
+	for (id = 0; id < NPRODUCERS; id++)
+		pthread_create(&threads[id], NULL, producer, (void *)id);
+	atomic_store_explicit(&start, true, memory_order_release);
+
+	while (total < NPRODUCERS * NITEMS) {
+		n = atomring_pop_bulk(ring, batch, array_size(batch));
+		if (!n) {
+			sched_yield();
+			continue;
+		}
+
+		for (i = 0; i < n; i++) {
+			uintptr_t val = (uintptr_t)batch[i];
+
+			id = val & 0xf;
+			assert(id < NPRODUCERS);
+			assert((val >> 4) == last[id] + 1);
+			last[id] = val >> 4;
+		}
+		total += n;
+	}
+
+	for (id = 0; id < NPRODUCERS; id++)
+		pthread_join(threads[id], NULL);
+
+	assert(atomring_count(ring) == 0);
+	assert(atomring_pop(ring) == NULL);
+
+	atomring_del(ring);
+	printf("Done.\n");
+	return 0;
+}
@@ -8,6 +8,7 @@
 #include <time.h>
 
 #include "checksum.h"
+#include "monotime.h"
 #include "network.h"
 #include "prng.h"
 
@@ -446,6 +447,116 @@ static int /* return checksum in low-order 16 bits */
 }
 
 
+static const char *const impl_names[CHECKSUM_IMPL_MAX] = {
+	[CHECKSUM_IMPL_SCALAR] = "scalar",
+	[CHECKSUM_IMPL_SSE2] = "sse2",
+	[CHECKSUM_IMPL_AVX2] = "avx2",
+};
+
+#define IMPL_MAXLEN   60017
+#define IMPL_ALIGNS   32
+#define IMPL_ALLLENS  600
+#define BENCH_LEN     1500
+#define BENCH_ROUNDS  200000
+
+static void impl_compare(enum checksum_impl impl, uint8_t *data, size_t len)
+{
+	uint16_t in_ref, in_impl, fl_ref, fl_impl;
+	uint16_t gen_ref = 0, gen_impl = 0;
+
+	checksum_impl_set(CHECKSUM_IMPL_SCALAR);
+	in_ref = in_cksum(data, len);
+	fl_ref = fletcher_checksum(data, len, FLETCHER_CHECKSUM_VALIDATE);
+
+	assert(checksum_impl_set(impl));
+	in_impl = in_cksum(data, len);
+	fl_impl = fletcher_checksum(data, len, FLETCHER_CHECKSUM_VALIDATE);
+
+	/* these write the checksum into the data, so they go last */
+	if (len >= 2) {
+		gen_impl = fletcher_checksum(data, len, len - 2);
+		checksum_impl_set(CHECKSUM_IMPL_SCALAR);
+		gen_ref = fletcher_checksum(data, len, len - 2);
+	}
+
+	if (in_ref != in_impl || fl_ref != fl_impl || gen_ref != gen_impl) {
+		printf("%s: mismatch at length %zu: in_cksum %04x/%04x, fletcher %04x/%04x, generated %04x/%04x\n",
+		       impl_names[impl], len, in_ref, in_impl, fl_ref, fl_impl,
+		       gen_ref, gen_impl);
+		exit(1);
+	}
+}
+
+/* Compare the SIMD kernels against the scalar ones. */
+static void test_impls(struct prng *prng)
+{
+	uint8_t *buffer = malloc(IMPL_MAXLEN + IMPL_ALIGNS);
+	enum checksum_impl impl, best = checksum_impl_get();
+	size_t len, align;
+
+	for (impl = CHECKSUM_IMPL_SCALAR + 1; impl < CHECKSUM_IMPL_MAX; impl++) {
+		if (!checksum_impl_set(impl)) {
+			printf("%s: not supported, skipping.\n",
+			       impl_names[impl]);
+			continue;
+		}
+		printf("%s: validating against scalar...\n", impl_names[impl]);
+
+		for (len = 0; len < IMPL_MAXLEN + IMPL_ALIGNS; len++)
+			buffer[len] = prng_rand(prng);
+
+		/* every length and alignment over the first few vectors */
+		for (align = 0; align < IMPL_ALIGNS; align++)
+			for (len = 0; len <= IMPL_ALLLENS; len++)
+				impl_compare(impl, buffer + align, len);
+
+		for (len = IMPL_ALLLENS; len <= IMPL_MAXLEN; len += 257)
+			impl_compare(impl, buffer + len % IMPL_ALIGNS, len);
+
+		/* all-ones data gives the largest intermediate sums */
+		memset(buffer, 0xff, IMPL_MAXLEN);
+		for (len = IMPL_MAXLEN - 4 * IMPL_ALIGNS; len <= IMPL_MAXLEN;
+		     len++)
+			impl_compare(impl, buffer, len);
+	}
+
+	checksum_impl_set(best);
+	free(buffer);
+}
+
+static void bench_impls(struct prng *prng)
+{
+	uint8_t buffer[BENCH_LEN];
+	enum checksum_impl impl, best = checksum_impl_get();
+	struct timeval start;
+	unsigned long ns_in, ns_fletcher;
+	unsigned int i;
+
+	for (i = 0; i < BENCH_LEN; i++)
+		buffer[i] = prng_rand(prng);
+
+	for (impl = CHECKSUM_IMPL_SCALAR; impl < CHECKSUM_IMPL_MAX; impl++) {
+		if (!checksum_impl_set(impl))
+			continue;
+
+		monotime(&start);
+		for (i = 0; i < BENCH_ROUNDS; i++)
+			in_cksum(buffer, BENCH_LEN);
+		ns_in = monotime_since(&start, NULL) * 1000 / BENCH_ROUNDS;
+
+		monotime(&start);
+		for (i = 0; i < BENCH_ROUNDS; i++)
+			fletcher_checksum(buffer, BENCH_LEN, BENCH_LEN - 2);
+		ns_fletcher = monotime_since(&start, NULL) * 1000 /
+			      BENCH_ROUNDS;
+
+		printf("%s: %d bytes: in_cksum %lu ns, fletcher_checksum %lu ns\n",
+		       impl_names[impl], BENCH_LEN, ns_in, ns_fletcher);
+	}
+
+	checksum_impl_set(best);
+}
+
 int main(int argc, char **argv)
 {
 /* 60017 65629 702179 */
@@ -456,6 +567,10 @@ int main(int argc, char **argv)
 #define EXERCISESTEP 257
 	struct prng *prng = prng_new(0);
 
+	printf("using %s kernels\n", impl_names[checksum_impl_get()]);
+	test_impls(prng);
+	bench_impls(prng);
+
 	while (1) {
 		uint16_t ospfd, isisd, lib, in_csum, in_csum_res, in_csum_rfc;
 		int i;
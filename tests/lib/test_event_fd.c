@@ -0,0 +1,160 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program to verify that read tasks keep working when their fd is
+ * closed and the fd number reused between loop iterations, for every
+ * available event backend.
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "frrevent.h"
+#include "network.h"
+
+struct event_loop *master;
+
+static int sock[2];
+static struct event *t_read;
+static struct event *t_timeout;
+static unsigned int reads;
+static bool timed_out;
+
+static void sock_open(void)
+{
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sock) < 0) {
+		perror("socketpair");
+		exit(1);
+	}
+	set_nonblocking(sock[0]);
+}
+
+static void sock_close(void)
+{
+	close(sock[0]);
+	close(sock[1]);
+}
+
+/* Replaces the sockets with new ones, using the same fd numbers */
+static void sock_reopen(void)
+{
+	int old[2] = { sock[0], sock[1] };
+	int i;
+
+	sock_close();
+	sock_open();
+
+	for (i = 0; i < 2; i++) {
+		if (sock[i] == old[i])
+			continue;
+		if (dup2(sock[i], old[i]) < 0) {
+			perror("dup2");
+			exit(1);
+		}
+		close(sock[i]);
+		sock[i] = old[i];
+	}
+}
+
+static void sock_poke(void)
+{
+	if (write(sock[1], "x", 1) != 1) {
+		perror("write");
+		exit(1);
+	}
+}
+
+static void sock_read(struct event *thread)
+{
+	char buf[16];
+
+	while (read(sock[0], buf, sizeof(buf)) > 0)
+		;
+	reads++;
+}
+
+/* Closes and reopens its fd, then watches the new one */
+static void sock_read_reopen(struct event *thread)
+{
+	sock_read(thread);
+	sock_reopen();
+	event_add_read(master, sock_read, NULL, sock[0], &t_read);
+}
+
+static void timeout(struct event *thread)
+{
+	timed_out = true;
+}
+
+/* Runs the loop until the read task has run or a second has passed */
+static bool wait_read(void)
+{
+	struct event thread;
+	unsigned int prev = reads;
+
+	timed_out = false;
+	event_add_timer_msec(master, timeout, NULL, 1000, &t_timeout);
+
+	while (reads == prev && !timed_out && event_fetch(master, &thread))
+		event_call(&thread);
+
+	event_cancel(&t_timeout);
+	return reads != prev;
+}
+
+static void run(const char *backend)
+{
+	if (!event_backend_set(backend)) {
+		printf("Backend %s not supported, skipping.\n", backend);
+		return;
+	}
+
+	master = event_master_create(NULL);
+	reads = 0;
+	sock_open();
+
+	/* The fd is reused from the callback of its own read task */
+	event_add_read(master, sock_read_reopen, NULL, sock[0], &t_read);
+	sock_poke();
+	assert(wait_read());
+	sock_poke();
+	assert(wait_read());
+
+	/* ... between loop iterations, after the task ran */
+	sock_reopen();
+	event_add_read(master, sock_read, NULL, sock[0], &t_read);
+	sock_poke();
+	assert(wait_read());
+
+	/* ... after the task was cancelled */
+	event_add_read(master, sock_read, NULL, sock[0], &t_read);
+	event_cancel(&t_read);
+	sock_reopen();
+	event_add_read(master, sock_read, NULL, sock[0], &t_read);
+	sock_poke();
+	assert(wait_read());
+
+	/* ... and nothing is reported for a socket that was not poked */
+	sock_reopen();
+	event_add_read(master, sock_read, NULL, sock[0], &t_read);
+	assert(!wait_read());
+	event_cancel(&t_read);
+
+	sock_close();
+	event_master_free(master);
+
+	printf("%s: reused fds OK.\n", backend);
+}
+
+int main(int argc, char **argv)
+{
+	static const char *const backends[] = { "poll", "epoll" };
+	size_t i;
+
+	for (i = 0; i < array_size(backends); i++)
+		run(backends[i]);
+
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,10 @@
+import frrtest
+
+
+class TestEventFd(frrtest.TestMultiOut):
+    program = "./test_event_fd"
+
+
+TestEventFd.onesimple("poll: reused fds OK.")
+TestEventFd.onesimple("Done.")
+TestEventFd.exit_cleanly()
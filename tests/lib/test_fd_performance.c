@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures the cost of I/O wakeups in the event loop
+ * as the number of watched file descriptors grows, for every available
+ * event backend.
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "frrevent.h"
+#include "network.h"
+#include "prng.h"
+
+#define MAX_PIPES 4000
+#define WAKEUPS 20000
+
+struct event_loop *master;
+
+struct fd_pipe {
+	int fds[2];
+	struct event *t_read;
+	unsigned int reads;
+};
+
+static void pipe_read(struct event *thread)
+{
+	struct fd_pipe *p = EVENT_ARG(thread);
+	char buf[16];
+
+	while (read(p->fds[0], buf, sizeof(buf)) > 0)
+		;
+	p->reads++;
+
+	event_add_read(master, pipe_read, p, p->fds[0], &p->t_read);
+}
+
+static void run(const char *backend, int npipes)
+{
+	struct fd_pipe *pipes;
+	struct prng *prng;
+	struct event thread;
+	struct timeval tv_start, tv_stop;
+	unsigned long t_wakeups, reads = 0;
+	int i;
+
+	if (!event_backend_set(backend)) {
+		printf("Backend %s not supported, skipping.\n", backend);
+		return;
+	}
+
+	master = event_master_create(NULL);
+	prng = prng_new(0);
+	pipes = calloc(npipes, sizeof(*pipes));
+
+	for (i = 0; i < npipes; i++) {
+		if (pipe(pipes[i].fds) < 0) {
+			perror("pipe");
+			exit(1);
+		}
+		set_nonblocking(pipes[i].fds[0]);
+		event_add_read(master, pipe_read, &pipes[i], pipes[i].fds[0],
+			       &pipes[i].t_read);
+	}
+
+	monotime(&tv_start);
+
+	for (i = 0; i < WAKEUPS; i++) {
+		struct fd_pipe *p = &pipes[prng_rand(prng) % npipes];
+
+		if (write(p->fds[1], "x", 1) != 1) {
+			perror("write");
+			exit(1);
+		}
+		if (event_fetch(master, &thread))
+			event_call(&thread);
+	}
+
+	monotime(&tv_stop);
+
+	t_wakeups = 1000 * (tv_stop.tv_sec - tv_start.tv_sec);
+	t_wakeups += (tv_stop.tv_usec - tv_start.tv_usec) / 1000;
+
+	for (i = 0; i < npipes; i++) {
+		reads += pipes[i].reads;
+		event_cancel(&pipes[i].t_read);
+		close(pipes[i].fds[0]);
+		close(pipes[i].fds[1]);
+	}
+	assert(reads == WAKEUPS);
+
+	printf("%s: %d wakeups with %d fds watched took %lu.%03lu seconds.\n",
+	       backend, WAKEUPS, npipes, t_wakeups / 1000, t_wakeups % 1000);
+	fflush(stdout);
+
+	free(pipes);
+	event_master_free(master);
+	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	static const char *const backends[] = { "poll", "epoll" };
+	struct event_loop *probe;
+	int max_pipes, npipes;
+	size_t i;
+
+	/* Stay within the fds an event loop can handle. */
+	probe = event_master_create(NULL);
+	max_pipes = MIN(MAX_PIPES, (probe->fd_limit - 64) / 2);
+	event_master_free(probe);
+
+	for (npipes = 10; npipes <= max_pipes; npipes *= 10)
+		for (i = 0; i < array_size(backends); i++)
+			run(backends[i], npipes);
+
+	if (npipes / 10 != max_pipes)
+		for (i = 0; i < array_size(backends); i++)
+			run(backends[i], max_pipes);
+
+	return 0;
+}
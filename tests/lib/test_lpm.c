@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * LPM index tests: agreement with route_node_match(), lookups from other
+ * pthreads during updates.
+ */
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "frrcu.h"
+#include "lpm.h"
+#include "prng.h"
+#include "table.h"
+
+#define NPREFIXES 20000
+#define NCHECKS	  200000
+#define NREADERS  2
+#define NUPDATES  20000
+
+struct event_loop *master;
+
+struct entry {
+	struct prefix p;
+	bool set;
+};
+
+static struct route_table *table;
+static struct lpm_index *idx;
+static struct entry *entries;
+
+static void random_addr(struct prng *prng, struct in_addr *addr)
+{
+	/* mostly inside 10.0.0.0/8, where the prefixes are */
+	if (prng_rand(prng) % 8)
+		addr->s_addr = htonl(0x0a000000 | (prng_rand(prng) & 0xffffff));
+	else
+		addr->s_addr = prng_rand(prng);
+}
+
+static void random_prefix(struct prng *prng, struct prefix *p)
+{
+	memset(p, 0, sizeof(*p));
+	p->family = AF_INET;
+	p->prefixlen = prng_rand(prng) % (IPV4_MAX_BITLEN + 1);
+	random_addr(prng, &p->u.prefix4);
+	apply_mask(p);
+}
+
+static void entry_set(struct entry *e)
+{
+	struct route_node *rn;
+	struct entry *old;
+
+	rn = route_node_get(table, &e->p);
+	old = rn->info;
+	if (old) {
+		old->set = false;
+		route_unlock_node(rn);
+	}
+	rn->info = e;
+	e->set = true;
+
+	lpm_index_set(idx, &e->p, e);
+}
+
+static void entry_unset(struct entry *e)
+{
+	struct route_node *rn;
+
+	if (!e->set)
+		return;
+
+	rn = route_node_lookup(table, &e->p);
+	assert(rn && rn->info == e);
+	route_unlock_node(rn);
+	rn->info = NULL;
+	route_unlock_node(rn);
+	e->set = false;
+
+	lpm_index_unset(idx, &e->p);
+}
+
+static void check(struct prng *prng)
+{
+	struct route_node *rn;
+	struct in_addr addr;
+	void *expect;
+	unsigned int i;
+
+	for (i = 0; i < NCHECKS; i++) {
+		random_addr(prng, &addr);
+
+		rn = route_node_match_ipv4(table, &addr);
+		expect = rn ? rn->info : NULL;
+		if (rn)
+			route_unlock_node(rn);
+
+		assert(lpm_index_match_ipv4(idx, &addr) == expect);
+	}
+}
+
+static void test_match(void)
+{
+	struct prng *prng = prng_new(0);
+	unsigned int round, i, n;
+
+	printf("Validating lookups against route_node_match()...\n");
+
+	for (i = 0; i < NPREFIXES; i++) {
+		random_prefix(prng, &entries[i].p);
+		entry_set(&entries[i]);
+	}
+	check(prng);
+
+	for (round = 0; round < 4; round++) {
+		for (i = 0; i < NPREFIXES; i++)
+			if (prng_rand(prng) % 2)
+				entry_unset(&entries[i]);
+		check(prng);
+
+		for (i = 0; i < NPREFIXES; i++)
+			if (!entries[i].set && prng_rand(prng) % 2)
+				entry_set(&entries[i]);
+		check(prng);
+	}
+
+	for (i = 0, n = 0; i < NPREFIXES; i++)
+		n += entries[i].set;
+	assert(lpm_index_count(idx) == n);
+
+	for (i = 0; i < NPREFIXES; i++)
+		entry_unset(&entries[i]);
+	assert(lpm_index_count(idx) == 0);
+	check(prng);
+
+	prng_free(prng);
+}
+
+static atomic_bool readers_stop;
+
+static void *reader_run(void *arg)
+{
+	struct frr_pthread *fpt = arg;
+	struct prng *prng = prng_new((uintptr_t)fpt);
+	const struct entry *e;
+	struct prefix_ipv4 p = {
+		.family = AF_INET,
+		.prefixlen = IPV4_MAX_BITLEN,
+	};
+	unsigned long lookups = 0;
+	unsigned int i;
+
+	frr_pthread_set_name(fpt);
+	frr_pthread_notify_running(fpt);
+
+	while (!atomic_load_explicit(&readers_stop, memory_order_relaxed)) {
+		for (i = 0; i < 1000; i++) {
+			random_addr(prng, &p.prefix);
+			e = lpm_index_match_ipv4(idx, &p.prefix);
+			assert(!e || prefix_match(&e->p, (struct prefix *)&p));
+		}
+		lookups += i;
+
+		/* let freed levels and leaves go */
+		rcu_read_unlock();
+		rcu_read_lock();
+	}
+
+	prng_free(prng);
+	return (void *)lookups;
+}
+
+static int reader_stop(struct frr_pthread *fpt, void **res)
+{
+	atomic_store_explicit(&readers_stop, true, memory_order_relaxed);
+	pthread_join(fpt->thread, res);
+	atomic_store_explicit(&fpt->running, false, memory_order_relaxed);
+	return 0;
+}
+
+static void test_concurrent(void)
+{
+	struct frr_pthread_attr attr = {
+		.start = reader_run,
+		.stop = reader_stop,
+	};
+	struct frr_pthread *readers[NREADERS];
+	struct prng *prng = prng_new(1);
+	unsigned long lookups = 0;
+	void *res;
+	unsigned int i;
+
+	printf("Validating lookups from other pthreads during updates...\n");
+
+	for (i = 0; i < NREADERS; i++) {
+		readers[i] = frr_pthread_new(&attr, "lpm reader", "lpmreader");
+		frr_pthread_run(readers[i], NULL);
+		frr_pthread_wait_running(readers[i]);
+	}
+
+	for (i = 0; i < NUPDATES; i++) {
+		struct entry *e = &entries[prng_rand(prng) % NPREFIXES];
+
+		if (e->set)
+			entry_unset(e);
+		else
+			entry_set(e);
+	}
+
+	for (i = 0; i < NREADERS; i++) {
+		frr_pthread_stop(readers[i], &res);
+		lookups += (unsigned long)res;
+		frr_pthread_destroy(readers[i]);
+	}
+	assert(lookups > 0);
+
+	check(prng);
+	for (i = 0; i < NPREFIXES; i++)
+		entry_unset(&entries[i]);
+
+	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	frr_pthread_init();
+
+	table = route_table_init();
+	idx = lpm_index_new();
+	entries = calloc(NPREFIXES, sizeof(*entries));
+
+	test_match();
+	test_concurrent();
+
+	assert(lpm_index_count(idx) == 0);
+	lpm_index_free(&idx);
+	assert(idx == NULL);
+	route_table_finish(table);
+	free(entries);
+
+	frr_pthread_finish();
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,11 @@
+import frrtest
+
+
+class TestLpm(frrtest.TestMultiOut):
+    program = "./test_lpm"
+
+
+TestLpm.onesimple("Validating lookups against route_node_match()...")
+TestLpm.onesimple("Validating lookups from other pthreads during updates...")
+TestLpm.onesimple("Done.")
+TestLpm.exit_cleanly()
@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which compares lpm_index lookups with route_node_match()
+ * on a full-table sized IPv4 table.
+ */
+#include <zebra.h>
+
+#include "lpm.h"
+#include "monotime.h"
+#include "prng.h"
+#include "table.h"
+
+#define PREFIXES 500000
+#define LOOKUPS	 2000000
+
+struct event_loop *master;
+
+/* Times LOOKUPS lookups of random addresses, with the same seed each time */
+static uint64_t bench_lookups(struct route_table *table, struct lpm_index *idx,
+			      unsigned long *ms)
+{
+	struct prng *prng = prng_new(2);
+	struct route_node *rn;
+	struct timeval start;
+	struct in_addr addr;
+	uint64_t sum = 0;
+	unsigned int i;
+
+	monotime(&start);
+	for (i = 0; i < LOOKUPS; i++) {
+		addr.s_addr = htonl(0x01000000 +
+				    prng_rand(prng) % (PREFIXES << 9));
+		if (idx) {
+			sum += (uintptr_t)lpm_index_match_ipv4(idx, &addr);
+			continue;
+		}
+
+		rn = route_node_match_ipv4(table, &addr);
+		if (rn) {
+			sum += (uintptr_t)rn->info;
+			route_unlock_node(rn);
+		}
+	}
+	*ms = monotime_since(&start, NULL) / 1000;
+
+	prng_free(prng);
+	return sum;
+}
+
+int main(int argc, char **argv)
+{
+	struct route_table *table;
+	struct lpm_index *idx;
+	struct route_node *rn;
+	struct prefix *prefixes;
+	unsigned long ms_table, ms_lpm;
+	uint64_t sum_table, sum_lpm;
+	unsigned int i;
+
+	table = route_table_init();
+	idx = lpm_index_new();
+
+	/* a full table's worth of /24s with a covering /21 every 8 */
+	prefixes = calloc(PREFIXES, sizeof(*prefixes));
+	for (i = 0; i < PREFIXES; i++) {
+		prefixes[i].family = AF_INET;
+		prefixes[i].prefixlen = (i % 8) ? 24 : 21;
+		prefixes[i].u.prefix4.s_addr = htonl(0x01000000 + (i << 9));
+		apply_mask(&prefixes[i]);
+
+		rn = route_node_get(table, &prefixes[i]);
+		rn->info = &prefixes[i];
+		lpm_index_set(idx, &prefixes[i], &prefixes[i]);
+	}
+
+	sum_table = bench_lookups(table, NULL, &ms_table);
+	sum_lpm = bench_lookups(table, idx, &ms_lpm);
+	assert(sum_table == sum_lpm);
+
+	printf("route_node_match: %d lookups took %lu.%03lu seconds.\n",
+	       LOOKUPS, ms_table / 1000, ms_table % 1000);
+	printf("lpm_index: %d lookups took %lu.%03lu seconds.\n", LOOKUPS,
+	       ms_lpm / 1000, ms_lpm % 1000);
+
+	for (i = 0; i < PREFIXES; i++) {
+		rn = route_node_lookup(table, &prefixes[i]);
+		rn->info = NULL;
+		route_unlock_node(rn);
+		route_unlock_node(rn);
+		lpm_index_unset(idx, &prefixes[i]);
+	}
+	assert(lpm_index_count(idx) == 0);
+	lpm_index_free(&idx);
+	route_table_finish(table);
+	free(prefixes);
+
+	return 0;
+}
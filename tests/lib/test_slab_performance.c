@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which compares the slab allocator with plain malloc for
+ * small fixed-size objects: allocation speed with one and several
+ * pthreads, and resident memory after building and churning a large table.
+ * Each allocator runs in its own child process so RSS figures are separate.
+ */
+
+#include <zebra.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+#include <sys/wait.h>
+
+#include "memory.h"
+#include "monotime.h"
+#include "prng.h"
+
+DEFINE_MGROUP(TEST_SLAB, "slab test");
+DEFINE_MTYPE_STATIC_SLAB(TEST_SLAB, TEST_NODE, "test node");
+DEFINE_MTYPE_STATIC(TEST_SLAB, TEST_DATA, "test data");
+
+#define NODE_SIZE    72
+#define ROUNDS	     200
+#define BATCH	     10000
+#define MAX_THREADS  4
+#define TABLE_NODES  1000000
+
+struct event_loop *master;
+
+struct worker {
+	pthread_t thread;
+	void **objs;
+	unsigned int seed;
+	/* objects left allocated when done */
+	size_t keep;
+};
+
+/* Allocate and free batches of nodes, in shuffled order. */
+static void *worker_run(void *arg)
+{
+	struct worker *w = arg;
+	struct prng *prng = prng_new(w->seed);
+	unsigned int round, i, j;
+	void *tmp;
+
+	for (round = 0; round < ROUNDS; round++) {
+		for (i = 0; i < BATCH; i++)
+			w->objs[i] = XCALLOC(MTYPE_TEST_NODE, NODE_SIZE);
+		for (i = BATCH - 1; i > 0; i--) {
+			j = prng_rand(prng) % (i + 1);
+			tmp = w->objs[i];
+			w->objs[i] = w->objs[j];
+			w->objs[j] = tmp;
+		}
+		for (i = w->keep; i < BATCH; i++)
+			XFREE(MTYPE_TEST_NODE, w->objs[i]);
+		if (round + 1 < ROUNDS)
+			for (i = 0; i < w->keep; i++)
+				XFREE(MTYPE_TEST_NODE, w->objs[i]);
+	}
+
+	prng_free(prng);
+	return NULL;
+}
+
+static size_t node_count(void)
+{
+	struct memtype_stats stats;
+
+	qmem_stats(MTYPE_TEST_NODE, &stats);
+	return stats.n_alloc;
+}
+
+static void run_threads(const char *name, unsigned int nthreads)
+{
+	struct worker workers[MAX_THREADS];
+	struct timeval start;
+	unsigned long ms;
+	size_t before = node_count(), kept = 0;
+	unsigned int i, j;
+
+	monotime(&start);
+	for (i = 0; i < nthreads; i++) {
+		workers[i].objs = calloc(BATCH, sizeof(void *));
+		workers[i].seed = i;
+		workers[i].keep = 100 * (i + 1);
+		kept += workers[i].keep;
+		assert(!pthread_create(&workers[i].thread, NULL, worker_run,
+				       &workers[i]));
+	}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i].thread, NULL);
+	ms = monotime_since(&start, NULL) / 1000;
+
+	/* workers have exited, their objects must still be counted */
+	assert(node_count() == before + kept);
+
+	/* free on another pthread than the one that allocated */
+	for (i = 0; i < nthreads; i++) {
+		for (j = 0; j < workers[i].keep; j++)
+			XFREE(MTYPE_TEST_NODE, workers[i].objs[j]);
+		free(workers[i].objs);
+	}
+	assert(node_count() == before);
+
+	printf("%s: %u x %d allocations with %u threads took %lu.%03lu seconds.\n",
+	       name, nthreads * ROUNDS, BATCH, nthreads, ms / 1000, ms % 1000);
+}
+
+static unsigned long rss_kb(void)
+{
+	unsigned long size, resident;
+	FILE *fp = fopen("/proc/self/statm", "r");
+
+	if (!fp)
+		return 0;
+	if (fscanf(fp, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	fclose(fp);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/*
+ * Build a table of nodes interleaved with variably sized data, as a
+ * routing daemon does when it learns routes, then drop half the nodes and
+ * all the data and learn more nodes.
+ */
+static void run_table(const char *name)
+{
+	void **nodes = calloc(TABLE_NODES * 2, sizeof(void *));
+	void **data = calloc(TABLE_NODES, sizeof(void *));
+	struct prng *prng = prng_new(0);
+	unsigned long base = rss_kb(), rss;
+	unsigned int i;
+
+	for (i = 0; i < TABLE_NODES; i++) {
+		nodes[i] = XCALLOC(MTYPE_TEST_NODE, NODE_SIZE);
+		data[i] = XMALLOC(MTYPE_TEST_DATA, 16 + prng_rand(prng) % 200);
+	}
+	for (i = 0; i < TABLE_NODES; i++) {
+		XFREE(MTYPE_TEST_DATA, data[i]);
+		if (i % 2)
+			XFREE(MTYPE_TEST_NODE, nodes[i]);
+	}
+	for (i = TABLE_NODES; i < TABLE_NODES * 2; i += 2)
+		nodes[i] = XCALLOC(MTYPE_TEST_NODE, NODE_SIZE);
+	assert(node_count() == TABLE_NODES);
+
+#ifdef __GLIBC__
+	/* only count memory pinned by live objects, not free heap space */
+	malloc_trim(0);
+#endif
+	rss = rss_kb();
+	if (rss)
+		printf("%s: %u nodes after churn take %lu kB of RSS.\n", name,
+		       TABLE_NODES, rss - base);
+
+	for (i = 0; i < TABLE_NODES * 2; i++)
+		XFREE(MTYPE_TEST_NODE, nodes[i]);
+	assert(node_count() == 0);
+
+	prng_free(prng);
+	free(data);
+	free(nodes);
+}
+
+static void run(const char *name, bool slab)
+{
+	pid_t pid;
+	int status;
+
+	fflush(stdout);
+	pid = fork();
+	assert(pid >= 0);
+
+	if (pid == 0) {
+		if (slab && !qmem_slab_enable()) {
+			printf("%s: not supported, skipping.\n", name);
+			exit(0);
+		}
+		run_threads(name, 1);
+		run_threads(name, MAX_THREADS);
+		run_table(name);
+		fflush(stdout);
+		exit(0);
+	}
+
+	assert(waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char **argv)
+{
+	run("malloc", false);
+	run("slab", true);
+	return 0;
+}
@@ -31,6 +31,49 @@ static void print_stream(struct stream *s)
 	stream_set_getp(s, getp);
 }
 
+static void test_clone(void)
+{
+	struct stream *s, *c1, *c2;
+	struct stream_fifo *fifo;
+	unsigned char data[64];
+	int fds[2];
+	ssize_t i, n;
+
+	s = stream_new(16);
+	stream_putl(s, 0x01020304);
+
+	/* clones share the data until one of them is written to */
+	c1 = stream_clone(s);
+	c2 = stream_clone(c1);
+	stream_putc_at(c1, 0, 0xff);
+	stream_putc(c2, 0x05);
+	stream_putw(s, 0x0607);
+
+	print_stream(s);
+	print_stream(c1);
+	print_stream(c2);
+
+	/* written out starting at each stream's getp */
+	stream_forward_getp(c2, 2);
+	fifo = stream_fifo_new();
+	stream_fifo_push(fifo, s);
+	stream_fifo_push(fifo, c1);
+	stream_fifo_push(fifo, c2);
+
+	assert(pipe(fds) == 0);
+	n = stream_fifo_writev(fifo, fds[1]);
+	printfrr("writev: %zd, left: %zu\n", n, stream_fifo_count_safe(fifo));
+
+	n = read(fds[0], data, sizeof(data));
+	for (i = 0; i < n; i++)
+		printfrr("0x%x ", data[i]);
+	printfrr("\n");
+
+	close(fds[0]);
+	close(fds[1]);
+	stream_fifo_free(fifo);
+}
+
 int main(void)
 {
 	struct stream *s;
@@ -53,5 +96,9 @@ int main(void)
 	printfrr("l: 0x%x\n", stream_getl(s));
 	printfrr("q: 0x%" PRIx64 "\n", stream_getq(s));
 
+	stream_free(s);
+
+	test_clone();
+
 	return 0;
 }
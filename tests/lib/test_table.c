@@ -477,6 +477,148 @@ static void test_iter_pause(void)
 	route_table_finish(table);
 }
 
+#define ARENA_PREFIXES 5000
+#define ARENA_LOOKUPS  20000
+
+static uint32_t arena_rand(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* Every eighth prefix is a covering /21. */
+static void arena_prefix(unsigned int i, struct prefix_ipv4 *p)
+{
+	memset(p, 0, sizeof(*p));
+	p->family = AF_INET;
+	p->prefixlen = (i % 8) ? 24 : 21;
+	p->prefix.s_addr = htonl(0x01000000 + (i << 9));
+	apply_mask_ipv4(p);
+}
+
+static struct route_table *arena_build(route_table_delegate_t *delegate)
+{
+	struct route_table *table;
+	struct prefix_ipv4 p;
+	struct route_node *rn;
+	unsigned int i;
+
+	table = route_table_init_with_delegate(delegate);
+	for (i = 0; i < ARENA_PREFIXES; i++) {
+		arena_prefix(i, &p);
+		rn = route_node_get(table, (struct prefix *)&p);
+		rn->info = table;
+	}
+
+	return table;
+}
+
+static uint64_t arena_lookup(struct route_table *table)
+{
+	struct route_node *rn;
+	struct in_addr addr;
+	uint32_t state = 1;
+	uint64_t sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < ARENA_LOOKUPS; i++) {
+		addr.s_addr = htonl(0x01000000 +
+				    arena_rand(&state) % (ARENA_PREFIXES << 9));
+		rn = route_node_match_ipv4(table, &addr);
+		if (rn) {
+			sum += ntohl(rn->p.u.prefix4.s_addr) + rn->p.prefixlen;
+			route_unlock_node(rn);
+		}
+	}
+
+	return sum;
+}
+
+/* Drop every third prefix and add it back, exercising node reuse. */
+static void arena_churn(struct route_table *table)
+{
+	struct prefix_ipv4 p;
+	struct route_node *rn;
+	unsigned int i;
+
+	for (i = 0; i < ARENA_PREFIXES; i += 3) {
+		arena_prefix(i, &p);
+		rn = route_node_lookup(table, (struct prefix *)&p);
+		assert(rn && rn->info == table);
+		rn->info = NULL;
+		route_unlock_node(rn);
+		route_unlock_node(rn);
+	}
+	for (i = 0; i < ARENA_PREFIXES; i += 3) {
+		arena_prefix(i, &p);
+		rn = route_node_get(table, (struct prefix *)&p);
+		assert(!rn->info);
+		rn->info = table;
+	}
+}
+
+static void arena_free(struct route_table *table)
+{
+	struct route_node *rn;
+
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		if (rn->info) {
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
+	assert(route_table_count(table) == 0);
+	route_table_finish(table);
+}
+
+/* Are the tables' nodes the same, in the same order? */
+static void arena_verify_same(struct route_table *table1,
+			      struct route_table *table2)
+{
+	struct route_node *rn1, *rn2;
+
+	rn1 = route_top(table1);
+	rn2 = route_top(table2);
+	while (rn1 && rn2) {
+		assert(!prefix_cmp(&rn1->p, &rn2->p));
+		assert(!rn1->info == !rn2->info);
+		rn1 = route_next(rn1);
+		rn2 = route_next(rn2);
+	}
+	assert(!rn1 && !rn2);
+	assert(route_table_count(table1) == route_table_count(table2));
+}
+
+/*
+ * test_arena
+ *
+ * Build the same table with the default and the arena delegate, and check
+ * that both give the same results.  test_table_performance compares their
+ * speed and memory use.
+ */
+static void test_arena(void)
+{
+	struct route_table *table, *arena;
+
+	printf("\n\nTesting the arena delegate\n");
+
+	table = arena_build(route_table_get_default_delegate());
+	arena = arena_build(route_table_get_arena_delegate());
+	arena_verify_same(table, arena);
+	assert(arena_lookup(table) == arena_lookup(arena));
+
+	arena_churn(table);
+	arena_churn(arena);
+	arena_verify_same(table, arena);
+	assert(arena_lookup(table) == arena_lookup(arena));
+
+	arena_free(table);
+	arena_free(arena);
+
+	printf("Verified arena table\n");
+}
+
 /*
  * run_tests
  */
@@ -485,6 +627,7 @@ static void run_tests(void)
 	test_prefix_iter_cmp();
 	test_get_next();
 	test_iter_pause();
+	test_arena();
 }
 
 /*
@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which compares the default route_table delegate with the
+ * arena one on a full-table sized IPv4 table: insertion, longest-match
+ * lookups and walks, and heap use per node.
+ */
+
+#include <zebra.h>
+
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
+
+#include "monotime.h"
+#include "prefix.h"
+#include "table.h"
+
+#define PREFIXES 500000
+#define LOOKUPS	 2000000
+#define WALKS	 10
+
+struct event_loop *master;
+
+struct bench {
+	const char *name;
+	struct route_table *table;
+	unsigned long ms_insert, ms_lookup, ms_walk;
+	size_t bytes;
+};
+
+static uint32_t bench_rand(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/*
+ * Prefixes are added in ascending order, the way a full table arrives
+ * from a peer; every eighth one is a covering /21.
+ */
+static void bench_prefix(unsigned int i, struct prefix_ipv4 *p)
+{
+	memset(p, 0, sizeof(*p));
+	p->family = AF_INET;
+	p->prefixlen = (i % 8) ? 24 : 21;
+	p->prefix.s_addr = htonl(0x01000000 + (i << 9));
+	apply_mask_ipv4(p);
+}
+
+/* Heap in use, including allocator overhead, if the platform tells. */
+static size_t bench_mem(void)
+{
+#if defined(HAVE_MALLINFO2)
+	struct mallinfo2 minfo = mallinfo2();
+#elif defined(HAVE_MALLINFO)
+	struct mallinfo minfo = mallinfo();
+#endif
+
+#if defined(HAVE_MALLINFO2) || defined(HAVE_MALLINFO)
+	return (size_t)minfo.uordblks + (size_t)minfo.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static void bench_build(struct bench *b, route_table_delegate_t *delegate)
+{
+	struct prefix_ipv4 p;
+	struct route_node *rn;
+	struct timeval start;
+	size_t before = bench_mem();
+	unsigned int i;
+
+	b->table = route_table_init_with_delegate(delegate);
+
+	monotime(&start);
+	for (i = 0; i < PREFIXES; i++) {
+		bench_prefix(i, &p);
+		rn = route_node_get(b->table, (struct prefix *)&p);
+		rn->info = b;
+	}
+	b->ms_insert = monotime_since(&start, NULL) / 1000;
+	b->bytes = bench_mem() - before;
+}
+
+static uint64_t bench_lookup(struct bench *b)
+{
+	struct route_node *rn;
+	struct timeval start;
+	struct in_addr addr;
+	uint32_t state = 1;
+	uint64_t sum = 0;
+	unsigned int i;
+
+	monotime(&start);
+	for (i = 0; i < LOOKUPS; i++) {
+		addr.s_addr = htonl(0x01000000 +
+				    bench_rand(&state) % (PREFIXES << 9));
+		rn = route_node_match_ipv4(b->table, &addr);
+		if (rn) {
+			sum += ntohl(rn->p.u.prefix4.s_addr) + rn->p.prefixlen;
+			route_unlock_node(rn);
+		}
+	}
+	b->ms_lookup = monotime_since(&start, NULL) / 1000;
+
+	return sum;
+}
+
+static uint64_t bench_walk(struct bench *b)
+{
+	struct route_node *rn;
+	struct timeval start;
+	uint64_t sum = 0;
+	unsigned int i;
+
+	monotime(&start);
+	for (i = 0; i < WALKS; i++)
+		for (rn = route_top(b->table); rn; rn = route_next(rn))
+			sum += ntohl(rn->p.u.prefix4.s_addr) + rn->p.prefixlen;
+	b->ms_walk = monotime_since(&start, NULL) / 1000;
+
+	return sum;
+}
+
+static void bench_free(struct bench *b)
+{
+	struct route_node *rn;
+
+	for (rn = route_top(b->table); rn; rn = route_next(rn))
+		if (rn->info) {
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
+	assert(route_table_count(b->table) == 0);
+	route_table_finish(b->table);
+}
+
+int main(int argc, char **argv)
+{
+	struct bench benches[2] = {
+		{ .name = "default" },
+		{ .name = "arena" },
+	};
+	uint64_t lookups[2], walks[2];
+	struct bench *b;
+	int i;
+
+	bench_build(&benches[0], route_table_get_default_delegate());
+	bench_build(&benches[1], route_table_get_arena_delegate());
+
+	for (i = 0; i < 2; i++) {
+		lookups[i] = bench_lookup(&benches[i]);
+		walks[i] = bench_walk(&benches[i]);
+	}
+	assert(lookups[0] == lookups[1]);
+	assert(walks[0] == walks[1]);
+
+	for (i = 0; i < 2; i++) {
+		b = &benches[i];
+		printf("%s: %lu nodes, insert %lu.%03lus, %d lookups %lu.%03lus, %d walks %lu.%03lus",
+		       b->name, route_table_count(b->table), b->ms_insert / 1000,
+		       b->ms_insert % 1000, LOOKUPS, b->ms_lookup / 1000,
+		       b->ms_lookup % 1000, WALKS, b->ms_walk / 1000,
+		       b->ms_walk % 1000);
+		if (b->bytes)
+			printf(", %zu heap bytes per node",
+			       b->bytes / route_table_count(b->table));
+		printf("\n");
+		bench_free(b);
+	}
+
+	return 0;
+}
@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Task pool tests: fork/join, completion events and a small benchmark.
+ */
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "frrcu.h"
+#include "frrevent.h"
+#include "taskpool.h"
+
+#define FIB_N	   27
+#define FIB_CUTOFF 16
+#define NJOBS	   2000
+#define NCHUNKS	   64
+#define CHUNK_WORK 2000000
+
+struct event_loop *master;
+static struct taskpool *pool;
+
+static unsigned long fib_serial(unsigned int n)
+{
+	return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+struct fib {
+	unsigned int n;
+	unsigned long result;
+};
+
+/* Split recursively, waiting on the pool from inside the pool. */
+static void fib_task(void *arg)
+{
+	struct fib *f = arg;
+	struct fib sub = { .n = f->n - 1 };
+	struct taskpool_future *future;
+
+	if (f->n < FIB_CUTOFF) {
+		f->result = fib_serial(f->n);
+		return;
+	}
+
+	future = taskpool_submit(pool, fib_task, &sub);
+	f->n -= 2;
+	fib_task(f);
+	taskpool_future_wait(future);
+	f->result += sub.result;
+}
+
+struct job {
+	unsigned int id;
+	unsigned long result;
+	bool done;
+};
+
+static pthread_t main_thread;
+static unsigned int jobs_done;
+
+static void job_work(void *arg)
+{
+	struct job *job = arg;
+
+	/* tasks run under RCU, same as event loop tasks */
+	rcu_assert_read_locked();
+	assert(!pthread_equal(pthread_self(), main_thread));
+
+	job->result = (unsigned long)job->id * job->id;
+}
+
+static void job_done(struct event *event)
+{
+	struct job *job = EVENT_ARG(event);
+
+	assert(pthread_equal(pthread_self(), main_thread));
+	assert(job->result == (unsigned long)job->id * job->id);
+	assert(!job->done);
+
+	job->done = true;
+	jobs_done++;
+}
+
+static void keepalive(struct event *event)
+{
+}
+
+struct chunk {
+	unsigned int seed;
+	uint64_t result;
+};
+
+static void chunk_work(void *arg)
+{
+	struct chunk *c = arg;
+	uint64_t x = c->seed;
+	unsigned int i;
+
+	for (i = 0; i < CHUNK_WORK; i++)
+		x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+	c->result = x;
+}
+
+static unsigned long run_chunks(unsigned int nthreads, uint64_t *sum)
+{
+	struct taskpool_future *futures[NCHUNKS];
+	struct chunk chunks[NCHUNKS];
+	struct timeval start, stop;
+	unsigned int i;
+
+	pool = taskpool_new("bench", nthreads);
+
+	monotime(&start);
+	for (i = 0; i < NCHUNKS; i++) {
+		chunks[i].seed = i;
+		futures[i] = taskpool_submit(pool, chunk_work, &chunks[i]);
+	}
+	*sum = 0;
+	for (i = 0; i < NCHUNKS; i++) {
+		taskpool_future_wait(futures[i]);
+		*sum += chunks[i].result;
+	}
+	monotime(&stop);
+
+	taskpool_free(&pool);
+	return timeval_elapsed(stop, start) / 1000;
+}
+
+int main(int argc, char **argv)
+{
+	struct fib fib = { .n = FIB_N };
+	struct event *t_keepalive = NULL;
+	struct event thread;
+	struct job *jobs;
+	unsigned long ms_one, ms_all;
+	uint64_t sum_one, sum_all;
+	unsigned int i, nthreads;
+
+	main_thread = pthread_self();
+	frr_pthread_init();
+	master = event_master_create(NULL);
+
+	printf("Validating fork/join...\n");
+	pool = taskpool_new("test", 4);
+	assert(taskpool_threads(pool) == 4);
+	fib_task(&fib);
+	assert(fib.result == fib_serial(FIB_N));
+
+	printf("Validating completion events...\n");
+	jobs = calloc(NJOBS, sizeof(*jobs));
+	for (i = 0; i < NJOBS; i++) {
+		jobs[i].id = i;
+		taskpool_run(pool, job_work, &jobs[i], master, job_done);
+	}
+
+	/* completions are posted from other pthreads; keep the loop alive */
+	event_add_timer(master, keepalive, NULL, 60, &t_keepalive);
+	while (jobs_done < NJOBS && event_fetch(master, &thread))
+		event_call(&thread);
+	event_cancel(&t_keepalive);
+
+	assert(jobs_done == NJOBS);
+	for (i = 0; i < NJOBS; i++)
+		assert(jobs[i].done);
+	free(jobs);
+
+	printf("Validating shutdown with queued work...\n");
+	jobs = calloc(NJOBS, sizeof(*jobs));
+	for (i = 0; i < NJOBS; i++) {
+		jobs[i].id = i;
+		taskpool_run(pool, job_work, &jobs[i], master, keepalive);
+	}
+	taskpool_free(&pool);
+	assert(pool == NULL);
+	for (i = 0; i < NJOBS; i++)
+		assert(jobs[i].result == (unsigned long)i * i);
+	while (event_fetch(master, &thread))
+		event_call(&thread);
+	free(jobs);
+
+	printf("Running benchmark...\n");
+	pool = taskpool_new("probe", 0);
+	nthreads = taskpool_threads(pool);
+	taskpool_free(&pool);
+
+	ms_one = run_chunks(1, &sum_one);
+	ms_all = run_chunks(nthreads, &sum_all);
+	assert(sum_one == sum_all);
+
+	printf("%d chunks with 1 thread took %lu.%03lu seconds.\n", NCHUNKS,
+	       ms_one / 1000, ms_one % 1000);
+	printf("%d chunks with %u threads took %lu.%03lu seconds.\n", NCHUNKS,
+	       nthreads, ms_all / 1000, ms_all % 1000);
+
+	event_master_free(master);
+	frr_pthread_finish();
+	return 0;
+}
@@ -0,0 +1,8 @@
+import frrtest
+
+
+class TestTaskpool(frrtest.TestMultiOut):
+    program = "./test_taskpool"
+
+
+TestTaskpool.exit_cleanly()
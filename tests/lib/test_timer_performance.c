@@ -19,21 +19,45 @@
 
 #define SCHEDULE_TIMERS 1000000
 #define REMOVE_TIMERS    500000
+#define EXPIRE_TIMERS    100000
+#define WAKEUP_TIMERS       100
 
 struct event_loop *master;
 
+static unsigned int expired;
+static struct event *t_tick;
+
 static void dummy_func(struct event *thread)
 {
 }
 
-int main(int argc, char **argv)
+static void expire_func(struct event *thread)
+{
+	struct timeval *due = EVENT_ARG(thread);
+	struct timeval now;
+
+	monotime(&now);
+	assert(timercmp(&now, due, >=));
+	expired++;
+}
+
+/* Wakes the loop up every 10ms, in between the timers being checked */
+static void tick_func(struct event *thread)
+{
+	event_add_timer_msec(master, tick_func, NULL, 10, &t_tick);
+}
+
+static void run(const char *name, bool wheel)
 {
 	struct prng *prng;
 	int i;
 	struct event **timers;
+	struct timeval *due;
+	struct event thread;
 	struct timeval tv_start, tv_lap, tv_stop;
 	unsigned long t_schedule, t_remove;
 
+	event_timer_wheel_set(wheel);
 	master = event_master_create(NULL);
 	prng = prng_new(0);
 	timers = calloc(SCHEDULE_TIMERS, sizeof(*timers));
@@ -73,14 +97,56 @@ int main(int argc, char **argv)
 	t_remove = 1000 * (tv_stop.tv_sec - tv_lap.tv_sec);
 	t_remove += (tv_stop.tv_usec - tv_lap.tv_usec) / 1000;
 
-	printf("Scheduling %d random timers took %lu.%03lu seconds.\n",
-	       SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
-	printf("Removing %d random timers took %lu.%03lu seconds.\n",
+	printf("%s: Scheduling %d random timers took %lu.%03lu seconds.\n",
+	       name, SCHEDULE_TIMERS, t_schedule / 1000, t_schedule % 1000);
+	printf("%s: Removing %d random timers took %lu.%03lu seconds.\n", name,
 	       REMOVE_TIMERS, t_remove / 1000, t_remove % 1000);
 	fflush(stdout);
 
+	for (i = 0; i < SCHEDULE_TIMERS; i++)
+		event_cancel(&timers[i]);
+
+	/* Let a batch of timers run out and check none of them fire early. */
+	due = calloc(EXPIRE_TIMERS, sizeof(*due));
+	expired = 0;
+	for (i = 0; i < EXPIRE_TIMERS; i++) {
+		long interval_msec = 1000 + prng_rand(prng) % 500;
+
+		event_add_timer_msec(master, expire_func, &due[i],
+				     interval_msec, &timers[i]);
+		due[i] = timers[i]->u.sands;
+	}
+	while (expired < EXPIRE_TIMERS && event_fetch(master, &thread))
+		event_call(&thread);
+	assert(expired == EXPIRE_TIMERS);
+
+	/* Same, with the loop waking up before the timers are due. */
+	expired = 0;
+	for (i = 0; i < WAKEUP_TIMERS; i++) {
+		long interval_msec = 1000 + prng_rand(prng) % 500;
+
+		event_add_timer_msec(master, expire_func, &due[i],
+				     interval_msec, &timers[i]);
+		due[i] = timers[i]->u.sands;
+	}
+	event_add_timer_msec(master, tick_func, NULL, 10, &t_tick);
+	monotime(&tv_start);
+	while (expired < WAKEUP_TIMERS &&
+	       monotime_since(&tv_start, NULL) < 3 * 1000 * 1000 &&
+	       event_fetch(master, &thread))
+		event_call(&thread);
+	event_cancel(&t_tick);
+	assert(expired == WAKEUP_TIMERS);
+
+	free(due);
 	free(timers);
 	event_master_free(master);
 	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	run("heap", false);
+	run("wheel", true);
 	return 0;
 }
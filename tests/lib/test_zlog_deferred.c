@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Deferred log formatting tests: output identical to immediate formatting,
+ * per-pthread ordering and writing out pending messages on a crash.
+ */
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "log.h"
+#include "prefix.h"
+
+DEFINE_MTYPE_STATIC(LIB, TEST_ZLOG, "test log target");
+
+#define NTHREADS    4
+#define NTHREADMSGS 20000
+#define MAXCAPTURE  64
+
+struct event_loop *master;
+
+static pthread_mutex_t capture_mtx = PTHREAD_MUTEX_INITIALIZER;
+static bool capture_store;
+static char *captured[MAXCAPTURE];
+static unsigned int n_captured;
+
+static unsigned int thread_next[NTHREADS];
+static bool thread_order_ok = true;
+
+/* holds up the log writer pthread in capture_logfn() */
+static pthread_t main_pthread;
+static pthread_mutex_t block_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t block_cond = PTHREAD_COND_INITIALIZER;
+static atomic_bool block_writer;
+static bool writer_blocked;
+
+static void capture_block(void)
+{
+	if (!atomic_load_explicit(&block_writer, memory_order_acquire) ||
+	    pthread_equal(pthread_self(), main_pthread))
+		return;
+
+	pthread_mutex_lock(&block_mtx);
+	writer_blocked = true;
+	pthread_cond_broadcast(&block_cond);
+	while (atomic_load_explicit(&block_writer, memory_order_acquire))
+		pthread_cond_wait(&block_cond, &block_mtx);
+	pthread_mutex_unlock(&block_mtx);
+}
+
+static void capture_logfn(struct zlog_target *zt, struct zlog_msg *msgs[],
+			  size_t nmsgs)
+{
+	const char *text;
+	size_t i, textlen, hdrlen;
+	unsigned int id, seq;
+
+	capture_block();
+
+	pthread_mutex_lock(&capture_mtx);
+	for (i = 0; i < nmsgs; i++) {
+		if (zlog_msg_prio(msgs[i]) > zt->prio_min)
+			continue;
+
+		text = zlog_msg_text(msgs[i], &textlen);
+		zlog_msg_args(msgs[i], &hdrlen, NULL, NULL);
+		text += hdrlen;
+		textlen -= hdrlen;
+
+		if (sscanf(text, "thread %u message %u", &id, &seq) == 2) {
+			if (id >= NTHREADS || seq != thread_next[id])
+				thread_order_ok = false;
+			else
+				thread_next[id]++;
+			continue;
+		}
+
+		if (capture_store && n_captured < MAXCAPTURE)
+			captured[n_captured++] = strndup(text, textlen);
+	}
+	pthread_mutex_unlock(&capture_mtx);
+}
+
+static void capture_clear(void)
+{
+	while (n_captured)
+		free(captured[--n_captured]);
+}
+
+static void log_messages(void)
+{
+	struct in_addr in4 = { .s_addr = htonl(0xc0000201) };
+	struct prefix p;
+	char buf[16] = "before";
+	char big[1200], huge[3000];
+
+	str2prefix("2001:db8::/32", &p);
+	memset(big, 'x', sizeof(big) - 1);
+	big[sizeof(big) - 1] = '\0';
+	memset(huge, 'y', sizeof(huge) - 1);
+	huge[sizeof(huge) - 1] = '\0';
+
+	zlog_debug("plain message");
+	zlog_debug("%d %5u %-5x| %#o %lld %ju %zu %td %hhd", -1, 2U, 0xabU,
+		   8U, -5LL, (uintmax_t)6, (size_t)7, (ptrdiff_t)-8, 9);
+	zlog_debug("%*d|%-*d|%.*s|%.3s|%-8s|", 6, 42, 6, 42, 3, "abcdef",
+		   "xyzzy", "left");
+	zlog_debug("%pI4 and %pFX, literal after", &in4, &p);
+	zlog_debug("%-16pI4| %pFXh", &in4, &p);
+	zlog_debug("%f %.2e %g %Lf", 1.5, 12345.678, 0.25, (long double)2.5);
+	zlog_debug("%c%c 100%% %p", 'o', 'k', (void *)0x1234);
+	errno = ENOENT;
+	zlog_debug("errno: %m");
+	zlog_info("info %s", big);
+	zlog_debug("too long for the ring: %s", huge);
+	zlog_warn("warning in between %d", 1);
+	zlog_debug("after warning %d", 2);
+
+	/* strings are copied, not referenced */
+	zlog_debug("buffer %s", buf);
+	strlcpy(buf, "after", sizeof(buf));
+}
+
+static void test_format(void)
+{
+	char *expect[MAXCAPTURE];
+	unsigned int n_expect, i;
+
+	printf("Validating deferred message text...\n");
+
+	capture_store = true;
+	log_messages();
+	n_expect = n_captured;
+	memcpy(expect, captured, sizeof(expect));
+	n_captured = 0;
+
+	zlog_set_deferred(true);
+	assert(zlog_get_deferred());
+	log_messages();
+	zlog_set_deferred(false);
+	capture_store = false;
+
+	assert(n_captured == n_expect);
+	for (i = 0; i < n_expect; i++) {
+		if (strcmp(captured[i], expect[i])) {
+			printf("mismatch:\n  %s\n  %s\n", expect[i],
+			       captured[i]);
+			abort();
+		}
+		free(expect[i]);
+	}
+	capture_clear();
+}
+
+static void *thread_run(void *arg)
+{
+	struct frr_pthread *fpt = arg;
+	unsigned int id = (uintptr_t)fpt->data, i;
+
+	frr_pthread_notify_running(fpt);
+
+	for (i = 0; i < NTHREADMSGS; i++)
+		zlog_debug("thread %u message %u", id, i);
+	return NULL;
+}
+
+static int thread_stop(struct frr_pthread *fpt, void **res)
+{
+	pthread_join(fpt->thread, res);
+	atomic_store_explicit(&fpt->running, false, memory_order_relaxed);
+	return 0;
+}
+
+static void test_threads(void)
+{
+	struct frr_pthread_attr attr = {
+		.start = thread_run,
+		.stop = thread_stop,
+	};
+	struct frr_pthread *fpts[NTHREADS];
+	unsigned int i;
+
+	printf("Validating ordering with %u pthreads...\n", NTHREADS);
+
+	zlog_set_deferred(true);
+	for (i = 0; i < NTHREADS; i++) {
+		fpts[i] = frr_pthread_new(&attr, "log test", "logtest");
+		fpts[i]->data = (void *)(uintptr_t)i;
+		frr_pthread_run(fpts[i], NULL);
+	}
+	/* turned off under the pthreads, nothing may get lost or reordered */
+	zlog_set_deferred(false);
+	for (i = 0; i < NTHREADS; i++) {
+		frr_pthread_stop(fpts[i], NULL);
+		frr_pthread_destroy(fpts[i]);
+	}
+
+	assert(thread_order_ok);
+	for (i = 0; i < NTHREADS; i++)
+		assert(thread_next[i] == NTHREADMSGS);
+}
+
+static void test_crash_flush(void)
+{
+	char expect[32];
+	unsigned int i;
+
+	printf("Writing out pending messages on a crash...\n");
+
+	zlog_set_deferred(true);
+
+	/* keep the writer busy writing out the first message */
+	atomic_store_explicit(&block_writer, true, memory_order_release);
+	zlog_debug("blocking the writer");
+	pthread_mutex_lock(&block_mtx);
+	while (!writer_blocked)
+		pthread_cond_wait(&block_cond, &block_mtx);
+	pthread_mutex_unlock(&block_mtx);
+
+	capture_store = true;
+	for (i = 0; i < 4; i++)
+		zlog_debug("pending message %u", i);
+	zlog_deferred_crash_flush();
+	capture_store = false;
+
+	/* the message being written out shows up twice, as documented */
+	assert(n_captured == 5);
+	assert(!strcmp(captured[0], "blocking the writer"));
+	for (i = 0; i < 4; i++) {
+		snprintf(expect, sizeof(expect), "pending message %u", i);
+		assert(!strcmp(captured[i + 1], expect));
+	}
+	capture_clear();
+
+	pthread_mutex_lock(&block_mtx);
+	atomic_store_explicit(&block_writer, false, memory_order_release);
+	pthread_cond_broadcast(&block_cond);
+	pthread_mutex_unlock(&block_mtx);
+
+	zlog_set_deferred(false);
+}
+
+int main(int argc, char **argv)
+{
+	struct zlog_target *zt;
+
+	main_pthread = pthread_self();
+	frr_pthread_init();
+	zlog_aux_init("NONE: ", ZLOG_DISABLED);
+
+	zt = zlog_target_clone(MTYPE_TEST_ZLOG, NULL, sizeof(*zt));
+	zt->prio_min = LOG_DEBUG;
+	zt->logfn = capture_logfn;
+	zlog_target_replace(NULL, zt);
+
+	test_format();
+	test_threads();
+	test_crash_flush();
+
+	zlog_target_free(MTYPE_TEST_ZLOG, zlog_target_replace(zt, NULL));
+	frr_pthread_finish();
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,12 @@
+import frrtest
+
+
+class TestZlogDeferred(frrtest.TestMultiOut):
+    program = "./test_zlog_deferred"
+
+
+TestZlogDeferred.onesimple("Validating deferred message text...")
+TestZlogDeferred.onesimple("Validating ordering with 4 pthreads...")
+TestZlogDeferred.onesimple("Writing out pending messages on a crash...")
+TestZlogDeferred.onesimple("Done.")
+TestZlogDeferred.exit_cleanly()
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which compares the cost of logging on the calling pthread
+ * with immediate and deferred message formatting.
+ */
+#include <zebra.h>
+
+#include "frr_pthread.h"
+#include "log.h"
+
+DEFINE_MTYPE_STATIC(LIB, TEST_ZLOG, "test log target");
+
+#define NBENCH 200000
+
+struct event_loop *master;
+
+static atomic_uint written;
+
+/* formats the text like a real target would, then drops it */
+static void count_logfn(struct zlog_target *zt, struct zlog_msg *msgs[],
+			size_t nmsgs)
+{
+	size_t i, textlen;
+
+	for (i = 0; i < nmsgs; i++)
+		zlog_msg_text(msgs[i], &textlen);
+	atomic_fetch_add_explicit(&written, nmsgs, memory_order_relaxed);
+}
+
+static unsigned long bench_run(void)
+{
+	struct in_addr in4 = { .s_addr = htonl(0xc0000201) };
+	struct timespec start, stop;
+	unsigned int i;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+	for (i = 0; i < NBENCH; i++)
+		zlog_debug("benchmark message %u from %s via %pI4", i,
+			   "somewhere", &in4);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &stop);
+
+	return (stop.tv_sec - start.tv_sec) * 1000000000UL + stop.tv_nsec -
+	       start.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+	struct zlog_target *zt;
+	unsigned long ns_direct, ns_deferred;
+
+	frr_pthread_init();
+	zlog_aux_init("NONE: ", ZLOG_DISABLED);
+
+	zt = zlog_target_clone(MTYPE_TEST_ZLOG, NULL, sizeof(*zt));
+	zt->prio_min = LOG_DEBUG;
+	zt->logfn = count_logfn;
+	zlog_target_replace(NULL, zt);
+
+	ns_direct = bench_run();
+
+	zlog_set_deferred(true);
+	ns_deferred = bench_run();
+	zlog_set_deferred(false);
+
+	assert(atomic_load(&written) == 2 * NBENCH);
+
+	printf("immediate formatting: %lu ns/message on the logging pthread\n",
+	       ns_direct / NBENCH);
+	printf("deferred formatting: %lu ns/message on the logging pthread\n",
+	       ns_deferred / NBENCH);
+
+	zlog_target_free(MTYPE_TEST_ZLOG, zlog_target_replace(zt, NULL));
+	frr_pthread_finish();
+	return 0;
+}
@@ -93,12 +93,11 @@ struct ospf_test_node *test_find_node(struct ospf_topology *topology,
 	return NULL;
 }
 
-static void inject_router_lsa(struct vty *vty, struct ospf *ospf,
+static void inject_router_lsa(struct vty *vty, struct ospf_area *area,
 			      struct ospf_topology *topology,
 			      struct ospf_test_node *root,
 			      struct ospf_test_node *tnode)
 {
-	struct ospf_area *area;
 	struct in_addr router_id;
 	struct in_addr adj_router_id;
 	struct prefix_ipv4 prefix;
@@ -113,7 +112,6 @@ static void inject_router_lsa(struct vty *vty, struct ospf *ospf,
 	struct ospf_test_adj *tadj;
 	bool is_self_lsa = false;
 
-	area = ospf->backbone;
 	inet_aton(tnode->router_id, &router_id);
 
 	if (strncmp(root->router_id, tnode->router_id, 256) == 0)
@@ -236,7 +234,7 @@ int topology_load(struct vty *vty, struct ospf_topology *topology,
 		tnode = &topology->nodes[i];
 
 		/* Inject a router LSA for each node, used for SPF */
-		inject_router_lsa(vty, ospf, topology, root, tnode);
+		inject_router_lsa(vty, ospf->backbone, topology, root, tnode);
 
 		/*
 		 * SR information could also be inected via LSAs, but directly
@@ -247,3 +245,19 @@ int topology_load(struct vty *vty, struct ospf_topology *topology,
 
 	return 0;
 }
+
+void topology_update_node(struct vty *vty, struct ospf_topology *topology,
+			  struct ospf_test_node *root, struct ospf *ospf,
+			  struct ospf_test_node *tnode)
+{
+	/* Replaces the node's router LSA in the LSDB, if there is one */
+	inject_router_lsa(vty, ospf->backbone, topology, root, tnode);
+}
+
+void topology_load_area(struct vty *vty, struct ospf_topology *topology,
+			struct ospf_test_node *root, struct ospf_area *area)
+{
+	for (int i = 0; topology->nodes[i].hostname[0]; i++)
+		inject_router_lsa(vty, area, topology, root,
+				  &topology->nodes[i]);
+}
@@ -28,6 +28,13 @@ extern struct ospf_test_node *test_find_node(struct ospf_topology *topology,
 					     const char *hostname);
 extern int topology_load(struct vty *vty, struct ospf_topology *topology,
 			 struct ospf_test_node *root, struct ospf *ospf);
+extern void topology_update_node(struct vty *vty,
+				 struct ospf_topology *topology,
+				 struct ospf_test_node *root, struct ospf *ospf,
+				 struct ospf_test_node *tnode);
+extern void topology_load_area(struct vty *vty, struct ospf_topology *topology,
+			       struct ospf_test_node *root,
+			       struct ospf_area *area);
 
 /* Global variables. */
 extern struct event_loop *master;
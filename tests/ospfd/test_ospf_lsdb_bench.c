@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Benchmark: flooding AS-external-LSAs into an ospfd LSDB.
+ */
+
+#include <zebra.h>
+
+#include "frrevent.h"
+#include "log.h"
+#include "monotime.h"
+#include "prefix.h"
+#include "table.h"
+
+#include "ospfd/ospfd.h"
+#include "ospfd/ospf_asbr.h"
+#include "ospfd/ospf_lsa.h"
+#include "ospfd/ospf_lsdb.h"
+
+#include "tests/helpers/c/prng.h"
+
+/*
+ * 100k type-5 LSAs from 64 ASBRs, arriving in random order: flooded in,
+ * refreshed (each one replaced by a newer instance) and flushed.  Every
+ * step does what ospf_flood() does per received LSA, a lookup followed by
+ * an add or delete.
+ */
+#define LSAS   100000
+#define ASBRS  64
+#define ROUNDS 3
+
+static struct ospf_lsa *lsas[LSAS];
+static struct ospf_lsa *newer[LSAS];
+static unsigned int order[LSAS];
+
+static struct in_addr lsa_id(unsigned int i)
+{
+	struct in_addr id = { .s_addr = htonl(0x0a000000 + (i << 8)) };
+
+	return id;
+}
+
+static struct in_addr lsa_adv_router(unsigned int i)
+{
+	struct in_addr id = { .s_addr = htonl(0xc0000201 + i % ASBRS) };
+
+	return id;
+}
+
+static struct ospf_lsa *external_lsa(unsigned int i, uint32_t seqnum)
+{
+	struct ospf_lsa *lsa;
+	size_t length = OSPF_LSA_HEADER_SIZE + OSPF_AS_EXTERNAL_LSA_MIN_SIZE;
+
+	lsa = ospf_lsa_new_and_data(length);
+	lsa->data->type = OSPF_AS_EXTERNAL_LSA;
+	lsa->data->id = lsa_id(i);
+	lsa->data->adv_router = lsa_adv_router(i);
+	lsa->data->ls_seqnum = htonl(seqnum);
+	lsa->data->checksum = htons(i);
+	lsa->data->length = htons(length);
+
+	return lsa;
+}
+
+static void print_time(const char *what, int64_t usec)
+{
+	printf("%-40s %6" PRId64 ".%03" PRId64 " ms\n", what, usec / 1000,
+	       usec % 1000);
+}
+
+static int lsa_key_cmp(const struct ospf_lsa *a, const struct ospf_lsa *b)
+{
+	int ret = IPV4_ADDR_CMP(&a->data->id, &b->data->id);
+
+	if (ret)
+		return ret;
+	return IPV4_ADDR_CMP(&a->data->adv_router, &b->data->adv_router);
+}
+
+static void check_order(struct ospf_lsdb *lsdb)
+{
+	struct route_node *rn;
+	struct ospf_lsa *lsa, *prev = NULL;
+	unsigned long count = 0;
+
+	/* LSDB_LOOP is ordered by LS ID, then advertising router ... */
+	LSDB_LOOP (lsdb->type[OSPF_AS_EXTERNAL_LSA].db, rn, lsa) {
+		assert(!prev || lsa_key_cmp(prev, lsa) < 0);
+		assert(ospf_lsdb_lookup(lsdb, lsa) == lsa);
+		prev = lsa;
+		count++;
+	}
+	assert(count == LSAS);
+
+	/* ... and so is walking it with ospf_lsdb_lookup_by_id_next() */
+	count = 0;
+	prev = NULL;
+	lsa = ospf_lsdb_lookup_by_id_next(lsdb, OSPF_AS_EXTERNAL_LSA,
+					  lsa_id(0), lsa_adv_router(0), 1);
+	while (lsa) {
+		assert(!prev || lsa_key_cmp(prev, lsa) < 0);
+		prev = lsa;
+		count++;
+		lsa = ospf_lsdb_lookup_by_id_next(lsdb, OSPF_AS_EXTERNAL_LSA,
+						  lsa->data->id,
+						  lsa->data->adv_router, 0);
+	}
+	assert(count == LSAS);
+}
+
+static void bench_lsdb(void)
+{
+	struct ospf_lsdb *lsdb = ospf_lsdb_new();
+	struct timeval start;
+	unsigned int i, idx;
+
+	monotime(&start);
+	for (i = 0; i < LSAS; i++) {
+		idx = order[i];
+		assert(!ospf_lsdb_lookup(lsdb, lsas[idx]));
+		ospf_lsdb_add(lsdb, lsas[idx]);
+	}
+	print_time("ospf_lsdb flood:", monotime_since(&start, NULL));
+	assert(ospf_lsdb_count(lsdb, OSPF_AS_EXTERNAL_LSA) == LSAS);
+
+	monotime(&start);
+	for (i = 0; i < LSAS; i++) {
+		idx = order[i];
+		assert(ospf_lsdb_lookup(lsdb, lsas[idx]) == lsas[idx]);
+	}
+	print_time("ospf_lsdb lookup:", monotime_since(&start, NULL));
+
+	check_order(lsdb);
+
+	/* newer instances replace the old ones */
+	for (i = 0; i < LSAS; i++)
+		newer[i] = external_lsa(i, ntohl(lsas[i]->data->ls_seqnum) + 1);
+
+	monotime(&start);
+	for (i = 0; i < LSAS; i++) {
+		idx = order[i];
+		assert(ospf_lsdb_lookup(lsdb, newer[idx]) == lsas[idx]);
+		ospf_lsdb_add(lsdb, newer[idx]);
+	}
+	print_time("ospf_lsdb refresh:", monotime_since(&start, NULL));
+	assert(ospf_lsdb_count(lsdb, OSPF_AS_EXTERNAL_LSA) == LSAS);
+
+	for (i = 0; i < LSAS; i++) {
+		ospf_lsa_unlock(&lsas[i]);
+		lsas[i] = newer[i];
+	}
+
+	monotime(&start);
+	for (i = 0; i < LSAS; i++) {
+		idx = order[i];
+		assert(ospf_lsdb_lookup_by_id(lsdb, OSPF_AS_EXTERNAL_LSA,
+					      lsa_id(idx),
+					      lsa_adv_router(idx)) ==
+		       lsas[idx]);
+		ospf_lsdb_delete(lsdb, lsas[idx]);
+	}
+	print_time("ospf_lsdb flush:", monotime_since(&start, NULL));
+	assert(ospf_lsdb_isempty(lsdb));
+
+	ospf_lsdb_free(lsdb);
+}
+
+int main(int argc, char **argv)
+{
+	struct prng *prng = prng_new(0);
+	unsigned int i, j, tmp, round;
+
+	zlog_aux_init("NONE: ", ZLOG_DISABLED);
+
+	for (i = 0; i < LSAS; i++) {
+		lsas[i] = external_lsa(i, OSPF_INITIAL_SEQUENCE_NUMBER);
+		order[i] = i;
+	}
+	for (i = LSAS - 1; i > 0; i--) {
+		j = prng_rand(prng) % (i + 1);
+		tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+
+	printf("%u AS-external-LSAs from %u ASBRs, %u rounds\n", LSAS, ASBRS,
+	       ROUNDS);
+	for (round = 0; round < ROUNDS; round++)
+		bench_lsdb();
+
+	for (i = 0; i < LSAS; i++)
+		ospf_lsa_unlock(&lsas[i]);
+	prng_free(prng);
+
+	return 0;
+}
@@ -0,0 +1,395 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * LS Update tests: which interfaces get clones of the same packets, what
+ * happens to an LSA too big to be sent, and how packets are handed to
+ * sendmmsg() in batches, including when it fails part way.
+ */
+
+#include <zebra.h>
+
+#include "frrsendmmsg.h"
+
+/* ospf_write() sends with test_sendmmsg() */
+#undef sendmmsg
+#define sendmmsg test_sendmmsg
+static int test_sendmmsg(int fd, struct mmsghdr *msgs, unsigned int vlen,
+			 int flags);
+
+#include "ospfd/ospf_packet.c"
+
+#define IFS	  7
+#define MAX_LSAS  64
+#define MAX_CALLS 64
+
+struct test_if {
+	struct interface ifp;
+	struct ospf_if_info info;
+	struct ospf_if_params params;
+	struct prefix address;
+	struct ospf_interface oi;
+};
+
+struct event_loop *master;
+
+static struct ospf ospf;
+static struct ospf_area areas[2];
+static struct test_if ifs[IFS];
+static struct ospf_lsa *lsas[MAX_LSAS];
+static struct in_addr allspf;
+
+/* What sendmmsg() was asked to send */
+static unsigned int calls;
+static unsigned int call_sizes[MAX_CALLS];
+static uint32_t sent_ids[2 * MAX_LSAS];
+static unsigned int sent_count;
+static uint32_t failed_ids[MAX_LSAS];
+static unsigned int failed_count;
+
+/* What the next calls return: how many were sent, or -1 */
+static int script[MAX_CALLS];
+static unsigned int script_len;
+
+/* The LS ID of the first LSA in the LS Update */
+static uint32_t msg_lsa_id(struct mmsghdr *msg)
+{
+	const uint8_t *pkt = msg->msg_hdr.msg_iov[1].iov_base;
+	struct lsa_header lsah;
+
+	memcpy(&lsah, pkt + OSPF_HEADER_SIZE + OSPF_LS_UPD_MIN_SIZE,
+	       sizeof(lsah));
+	return ntohl(lsah.id.s_addr);
+}
+
+static int test_sendmmsg(int fd, struct mmsghdr *msgs, unsigned int vlen,
+			 int flags)
+{
+	struct sockaddr_in *sin;
+	unsigned int i;
+	int rv = vlen;
+
+	assert(fd == ospf.fd);
+	assert(calls < MAX_CALLS);
+	call_sizes[calls] = vlen;
+	if (calls < script_len && script[calls] < (int)vlen)
+		rv = script[calls];
+	calls++;
+
+	/* A batch only has packets with the same send flags */
+	for (i = 0; i < vlen; i++) {
+		sin = msgs[i].msg_hdr.msg_name;
+		assert(!IN_MULTICAST(ntohl(sin->sin_addr.s_addr)) ==
+		       !!(flags & MSG_DONTROUTE));
+	}
+
+	if (rv < 0) {
+		failed_ids[failed_count++] = msg_lsa_id(&msgs[0]);
+		errno = ENOBUFS;
+		return -1;
+	}
+	for (i = 0; i < (unsigned int)rv; i++)
+		sent_ids[sent_count++] = msg_lsa_id(&msgs[i]);
+
+	return rv;
+}
+
+static struct ospf_lsa *lsa_new(uint32_t id, uint16_t length)
+{
+	struct ospf_lsa *lsa;
+
+	lsa = ospf_lsa_new_and_data(length);
+	lsa->data->ls_age = htons(1);
+	lsa->data->type = OSPF_ROUTER_LSA;
+	lsa->data->id.s_addr = htonl(id);
+	lsa->data->adv_router.s_addr = htonl(id);
+	lsa->data->ls_seqnum = htonl(OSPF_INITIAL_SEQUENCE_NUMBER);
+	lsa->data->length = htons(length);
+
+	return lsa;
+}
+
+static void lsas_new(unsigned int count, uint16_t length)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		lsas[i] = lsa_new(i + 1, length);
+}
+
+static void lsas_free(unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		/* nothing else holds on to them anymore */
+		assert(lsas[i]->lock == 1);
+		ospf_lsa_discard(lsas[i]);
+	}
+}
+
+static void setup_if(int i, struct ospf_area *area, unsigned int mtu,
+		     uint32_t transmit_delay, int auth_type)
+{
+	struct test_if *ti = &ifs[i];
+
+	snprintf(ti->ifp.name, sizeof(ti->ifp.name), "eth%d", i);
+	ti->ifp.ifindex = i + 1;
+	ti->ifp.mtu = mtu;
+	ti->ifp.info = &ti->info;
+	ti->info.def_params = &ti->params;
+	ti->params.transmit_delay = transmit_delay;
+	ti->params.auth_type = auth_type;
+	strlcpy((char *)ti->params.auth_simple, "test",
+		sizeof(ti->params.auth_simple));
+
+	str2prefix("10.0.0.1/24", &ti->address);
+	ti->address.u.prefix4.s_addr = htonl(0x0a000001 + (i << 8));
+
+	ti->oi.ifp = &ti->ifp;
+	ti->oi.area = area;
+	ti->oi.ospf = &ospf;
+	ti->oi.type = OSPF_IFTYPE_BROADCAST;
+	ti->oi.state = ISM_DR;
+	ti->oi.address = &ti->address;
+	if (!ti->oi.obuf)
+		ti->oi.obuf = ospf_fifo_new();
+	ti->oi.ls_upd_out = 0;
+}
+
+/* Queue the LSAs for the interface the way ospf_ls_upd_send() does */
+static struct list *update_new(unsigned int first, unsigned int count)
+{
+	struct list *update = list_new();
+	unsigned int i;
+
+	for (i = first; i < first + count; i++)
+		listnode_add(update, ospf_lsa_lock(lsas[i]));
+
+	return update;
+}
+
+static void flush(int i, struct list *update, struct in_addr dst,
+		  struct list *shared_list)
+{
+	ospf_ls_upd_queue_flush(&ifs[i].oi, update, dst, shared_list);
+	assert(listcount(update) == 0);
+	list_delete(&update);
+}
+
+static unsigned int obuf_count(int i)
+{
+	return ifs[i].oi.obuf->count;
+}
+
+/* Are the interfaces' packets clones of each other? */
+static bool obuf_shared(int i, int j)
+{
+	struct ospf_packet *op1 = ospf_fifo_head(ifs[i].oi.obuf);
+	struct ospf_packet *op2 = ospf_fifo_head(ifs[j].oi.obuf);
+
+	if (!op1 || !op2)
+		return false;
+	for (; op1 && op2; op1 = op1->next, op2 = op2->next)
+		if (STREAM_DATA(op1->s) != STREAM_DATA(op2->s))
+			return false;
+
+	return !op1 && !op2;
+}
+
+/* The headers of the interface's first packet */
+static struct ospf_header *obuf_header(int i)
+{
+	return (struct ospf_header *)STREAM_DATA(ifs[i].oi.obuf->head->s);
+}
+
+static struct lsa_header *obuf_lsa(int i)
+{
+	uint8_t *data = STREAM_DATA(ifs[i].oi.obuf->head->s);
+
+	return (struct lsa_header *)(data + OSPF_HEADER_SIZE +
+				     OSPF_LS_UPD_MIN_SIZE);
+}
+
+static void reset(void)
+{
+	int i;
+
+	for (i = 0; i < IFS; i++) {
+		ospf_fifo_flush(ifs[i].oi.obuf);
+		ifs[i].oi.on_write_q = 0;
+	}
+	list_delete_all_node(ospf.oi_write_q);
+	EVENT_OFF(ospf.t_write);
+	calls = sent_count = failed_count = script_len = 0;
+}
+
+static void test_shared(void)
+{
+	struct list *shared_list;
+	int i;
+
+	printf("Sharing LS Updates between interfaces...\n");
+
+	/* 348 byte LSAs: 4 to an LS Update with MTU 1500, 3 with 1400 */
+	lsas_new(10, 348);
+
+	setup_if(0, &areas[0], 1500, 1, OSPF_AUTH_NOTSET);
+	/* the same settings */
+	setup_if(1, &areas[0], 1500, 1, OSPF_AUTH_NOTSET);
+	/* another area */
+	setup_if(2, &areas[1], 1500, 1, OSPF_AUTH_NOTSET);
+	/* another MTU */
+	setup_if(3, &areas[0], 1400, 1, OSPF_AUTH_NOTSET);
+	/* another transmit delay */
+	setup_if(4, &areas[0], 1500, 2, OSPF_AUTH_NOTSET);
+	/* authentication */
+	setup_if(5, &areas[0], 1500, 1, OSPF_AUTH_SIMPLE);
+	/* the same settings, other LSAs */
+	setup_if(6, &areas[0], 1500, 1, OSPF_AUTH_NOTSET);
+
+	shared_list = list_new();
+	shared_list->del = ospf_ls_upd_shared_free;
+	for (i = 0; i < IFS; i++)
+		flush(i, update_new(0, i == 6 ? 9 : 10), allspf, shared_list);
+
+	/* Everyone but eth1 and eth5 got packets of their own */
+	assert(listcount(shared_list) == 5);
+	assert(obuf_shared(0, 1));
+	for (i = 2; i < IFS; i++)
+		assert(!obuf_shared(0, i));
+
+	for (i = 0; i < IFS; i++)
+		assert(obuf_count(i) == (i == 3 ? 4 : 3));
+	assert(ntohs(obuf_lsa(0)->ls_age) == 2);
+	assert(ntohs(obuf_lsa(4)->ls_age) == 3);
+	assert(ntohs(obuf_header(0)->auth_type) == OSPF_AUTH_NULL);
+	assert(ntohs(obuf_header(5)->auth_type) == OSPF_AUTH_SIMPLE);
+	assert(IPV4_ADDR_SAME(&obuf_header(2)->area_id, &areas[1].area_id));
+
+	list_delete(&shared_list);
+	reset();
+	lsas_free(10);
+}
+
+static void test_oversized(void)
+{
+	struct list *shared_list;
+	int i;
+
+	printf("LS Update with an LSA too big to be sent...\n");
+
+	lsas[0] = lsa_new(1, 100);
+	lsas[1] = lsa_new(2, 65500);
+	lsas[2] = lsa_new(3, 100);
+
+	setup_if(0, &areas[0], 1500, 1, OSPF_AUTH_NOTSET);
+	setup_if(1, &areas[0], 1500, 1, OSPF_AUTH_NOTSET);
+
+	/* The big one is dropped, the LSAs around it are still sent */
+	shared_list = list_new();
+	shared_list->del = ospf_ls_upd_shared_free;
+	for (i = 0; i < 2; i++)
+		flush(i, update_new(0, 3), allspf, shared_list);
+
+	for (i = 0; i < 2; i++)
+		assert(obuf_count(i) == 2);
+	assert(obuf_shared(0, 1));
+
+	list_delete(&shared_list);
+	reset();
+	lsas_free(3);
+}
+
+static void test_write(void)
+{
+	struct event thread = { .arg = &ospf };
+	struct list *shared_list;
+	unsigned int i;
+
+	printf("Sending LS Updates in batches, some failing...\n");
+
+	/* 1000 byte LSAs: one to an LS Update */
+	lsas_new(45, 1000);
+
+	/* eth0 sends to a multicast group, eth1 to a neighbor */
+	setup_if(0, &areas[0], 1500, 1, OSPF_AUTH_NOTSET);
+	setup_if(1, &areas[0], 1500, 1, OSPF_AUTH_NOTSET);
+	shared_list = list_new();
+	shared_list->del = ospf_ls_upd_shared_free;
+	flush(0, update_new(0, 40), allspf, shared_list);
+	flush(1, update_new(40, 5), ifs[1].address.u.prefix4, shared_list);
+	list_delete(&shared_list);
+	assert(listcount(ospf.oi_write_q) == 2);
+
+	/*
+	 * The interfaces take turns until eth1's 5 are sent, with other send
+	 * flags each time.  Of the 32 eth0 packets after that, sendmmsg() takes
+	 * 10, fails the next one and then takes the rest.
+	 */
+	for (i = 0; i < 10; i++)
+		script[i] = 1;
+	script[10] = 10;
+	script[11] = -1;
+	script_len = 12;
+
+	EVENT_OFF(ospf.t_write);
+	ospf_write(&thread);
+
+	assert(calls == 14);
+	for (i = 0; i < 10; i++)
+		assert(call_sizes[i] == 1);
+	assert(call_sizes[10] == 32 && call_sizes[11] == 22 &&
+	       call_sizes[12] == 21 && call_sizes[13] == 3);
+	assert(failed_count == 1 && failed_ids[0] == 16);
+
+	/* Everything else was sent, in order */
+	assert(sent_count == 44);
+	for (i = 0; i < 10; i++)
+		assert(sent_ids[i] == (i % 2 ? 41 + i / 2 : 1 + i / 2));
+	for (i = 10; i < 44; i++)
+		assert(sent_ids[i] == (i < 20 ? i - 4 : i - 3));
+
+	assert(ifs[0].oi.ls_upd_out == 40 && ifs[1].oi.ls_upd_out == 5);
+	assert(!obuf_count(0) && !obuf_count(1));
+	assert(list_isempty(ospf.oi_write_q));
+	assert(!ifs[0].oi.on_write_q && !ifs[1].oi.on_write_q);
+
+	reset();
+	lsas_free(45);
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+
+	master = event_master_create(NULL);
+
+	ospf.fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (ospf.fd < 0) {
+		perror("socket");
+		exit(1);
+	}
+	ospf.oi_running = 1;
+	ospf.write_oi_count = 100;
+	ospf.oi_write_q = list_new();
+	ospf.router_id.s_addr = htonl(0x01010101);
+	allspf.s_addr = htonl(OSPF_ALLSPFROUTERS);
+	for (i = 0; i < 2; i++) {
+		areas[i].ospf = &ospf;
+		areas[i].area_id.s_addr = htonl(i);
+		areas[i].auth_type = OSPF_AUTH_NULL;
+	}
+
+	test_shared();
+	test_oversized();
+	test_write();
+
+	for (i = 0; i < IFS; i++)
+		if (ifs[i].oi.obuf)
+			ospf_fifo_free(ifs[i].oi.obuf);
+	list_delete(&ospf.oi_write_q);
+	close(ospf.fd);
+	event_master_free(master);
+
+	printf("Done.\n");
+	return 0;
+}
@@ -0,0 +1,9 @@
+import frrtest
+
+
+class TestOspfPacket(frrtest.TestMultiOut):
+    program = "./test_ospf_packet"
+
+
+TestOspfPacket.onesimple("Done.")
+TestOspfPacket.exit_cleanly()
@@ -10,10 +10,18 @@
 #include "vrf.h"
 #include "table.h"
 #include "mpls.h"
+#include "zclient.h"
+#include "if.h"
+#include "frr_pthread.h"
+#include "taskpool.h"
 
 #include "ospfd/ospfd.h"
+#include "ospfd/ospf_ase.h"
 #include "ospfd/ospf_asbr.h"
+#include "ospfd/ospf_ia.h"
+#include "ospfd/ospf_interface.h"
 #include "ospfd/ospf_lsa.h"
+#include "ospfd/ospf_lsdb.h"
 #include "ospfd/ospf_route.h"
 #include "ospfd/ospf_spf.h"
 #include "ospfd/ospf_ti_lfa.h"
@@ -161,6 +169,753 @@ static int test_run(struct vty *vty, struct ospf_topology *topology,
 	return 0;
 }
 
+/*
+ * Incremental SPF: the topology is changed one LSA at a time, and after each
+ * change the tree kept from the previous run is updated.  The result must be
+ * the same as what a full SPF run calculates from the same LSDB.
+ */
+struct test_interface {
+	struct ospf_interface oi;
+	struct interface ifp;
+	struct connected connected;
+};
+
+struct test_incremental {
+	struct vty *vty;
+	struct ospf_topology topology; /* as changed so far */
+	struct ospf_test_node *root;
+	struct ospf *ospf; /* keeps its tree from one run to the next */
+	struct ospf *ref;  /* always runs a full SPF */
+	struct ospf_test_node *abr;  /* sets the B bit, see test_run_prc() */
+	struct ospf_test_node *asbr; /* sets the E bit, see test_run_ase() */
+};
+
+/*
+ * Unlike the TI-LFA dry runs above, the real SPF run needs the root's
+ * interfaces: one per adjacency, covering its P2P and stub link.
+ */
+static void test_interfaces_set(struct ospf_area *area,
+				struct ospf_test_node *root)
+{
+	struct test_interface *ti;
+	struct ospf_interface *oi;
+	struct listnode *node, *nnode;
+	int i;
+
+	for (ALL_LIST_ELEMENTS(area->oiflist, node, nnode, oi)) {
+		list_delete_node(area->oiflist, node);
+		route_table_finish(oi->nbrs);
+		XFREE(MTYPE_TMP, oi);
+	}
+
+	for (i = 0; root->adjacencies[i].hostname[0]; i++) {
+		ti = XCALLOC(MTYPE_TMP, sizeof(*ti));
+		ti->ifp.ifindex = i + 1;
+		ti->oi.ifp = &ti->ifp;
+		ti->oi.connected = &ti->connected;
+		ti->oi.type = OSPF_IFTYPE_POINTOPOINT;
+		ti->oi.area = area;
+		ti->oi.nbrs = route_table_init();
+		ti->oi.lsa_pos_beg = 2 * i;
+		ti->oi.lsa_pos_end = 2 * i + 2;
+		listnode_add(area->oiflist, &ti->oi);
+	}
+}
+
+/* Apply a change of the node to the LSDBs of both instances */
+static void test_node_update(struct test_incremental *test,
+			     struct ospf_test_node *tnode, bool down)
+{
+	struct ospf *ospfs[] = { test->ospf, test->ref };
+	struct ospf_area *area;
+	struct ospf_lsa *lsa;
+	struct in_addr router_id;
+
+	inet_aton(tnode->router_id, &router_id);
+
+	for (size_t i = 0; i < array_size(ospfs); i++) {
+		area = ospfs[i]->backbone;
+
+		if (down) {
+			lsa = ospf_lsa_lookup_by_id(area, OSPF_ROUTER_LSA,
+						    router_id);
+			ospf_lsdb_delete(area->lsdb, lsa);
+			continue;
+		}
+
+		topology_update_node(test->vty, &test->topology, test->root,
+				     ospfs[i], tnode);
+		if (tnode == test->root)
+			test_interfaces_set(area, tnode);
+
+		lsa = ospf_lsa_lookup_by_id(area, OSPF_ROUTER_LSA, router_id);
+		if (tnode == test->abr)
+			SET_FLAG(((struct router_lsa *)lsa->data)->flags,
+				 ROUTER_LSA_BORDER);
+		if (tnode == test->asbr)
+			SET_FLAG(((struct router_lsa *)lsa->data)->flags,
+				 ROUTER_LSA_EXTERNAL);
+	}
+}
+
+static bool test_same_parents(struct vertex *v, struct vertex *ref)
+{
+	struct listnode *node, *rnode;
+	struct vertex_parent *vp, *rvp;
+	bool found;
+
+	if (listcount(v->parents) != listcount(ref->parents))
+		return false;
+
+	for (ALL_LIST_ELEMENTS_RO(ref->parents, rnode, rvp)) {
+		found = false;
+		for (ALL_LIST_ELEMENTS_RO(v->parents, node, vp)) {
+			if (IPV4_ADDR_SAME(&vp->parent->id, &rvp->parent->id)
+			    && IPV4_ADDR_SAME(&vp->nexthop->router,
+					      &rvp->nexthop->router)) {
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+static bool test_same_tree(struct ospf_area *area, struct ospf_area *ref)
+{
+	struct listnode *node;
+	struct vertex *v, *rv;
+
+	if (listcount(area->spf_vertex_list) != listcount(ref->spf_vertex_list))
+		return false;
+
+	for (ALL_LIST_ELEMENTS_RO(ref->spf_vertex_list, node, rv)) {
+		v = ospf_spf_vertex_find(rv->id, area->spf_vertex_list);
+		if (!v || v->type != rv->type || v->distance != rv->distance
+		    || !test_same_parents(v, rv))
+			return false;
+	}
+
+	return true;
+}
+
+static bool test_same_routes(struct route_table *rt, struct route_table *ref)
+{
+	struct route_node *rn, *rrn;
+	struct ospf_route *or, *ror;
+	struct listnode *node;
+	struct ospf_path *path;
+	unsigned int count = 0;
+
+	for (rrn = route_top(ref); rrn; rrn = route_next(rrn)) {
+		if ((ror = rrn->info) == NULL)
+			continue;
+		count++;
+
+		rn = route_node_lookup(rt, &rrn->p);
+		if (!rn)
+			return false;
+		or = rn->info;
+		route_unlock_node(rn);
+
+		if (!or || or->type != ror->type
+		    || or->path_type != ror->path_type || or->cost != ror->cost
+		    || listcount(or->paths) != listcount(ror->paths))
+			return false;
+		if ((ror->path_type == OSPF_PATH_INTRA_AREA
+		     || ror->path_type == OSPF_PATH_INTER_AREA)
+		    && !IPV4_ADDR_SAME(&or->u.std.area_id,
+				       &ror->u.std.area_id))
+			return false;
+		if (ror->path_type == OSPF_PATH_TYPE2_EXTERNAL
+		    && or->u.ext.type2_cost != ror->u.ext.type2_cost)
+			return false;
+
+		for (ALL_LIST_ELEMENTS_RO(ror->paths, node, path))
+			if (!ospf_path_lookup(or->paths, path))
+				return false;
+	}
+
+	for (rn = route_top(rt); rn; rn = route_next(rn))
+		if (rn->info)
+			count--;
+
+	return count == 0;
+}
+
+/* Run SPF on both instances and compare the results */
+static void test_check(struct test_incremental *test, const char *change)
+{
+	struct ospf_area *area = test->ospf->backbone;
+	struct ospf_area *ref = test->ref->backbone;
+	struct route_table *table, *ref_table;
+	uint32_t incremental = area->spf_incremental;
+
+	table = route_table_init();
+	ospf_spf_calculate_area(test->ospf, area, table, NULL, NULL);
+
+	ref_table = route_table_init();
+	ospf_spf_calculate(ref, ref->router_lsa_self, ref_table, NULL, NULL,
+			   false, true);
+
+	assert(test_same_tree(area, ref));
+	assert(test_same_routes(table, ref_table));
+
+	vty_out(test->vty, "%s: %s SPF, %u of %u vertices calculated\n",
+		change, area->spf_incremental != incremental ? "incremental"
+							     : "full",
+		area->spf_vertices_updated, area->spf_vertices);
+
+	ospf_spf_cleanup(ref->spf, ref->spf_vertex_list);
+	ref->spf = NULL;
+	ref->spf_vertex_list = NULL;
+
+	ospf_route_table_free(table);
+	ospf_route_table_free(ref_table);
+}
+
+/*
+ * Change the metric of each link, take it down and up again.  check() runs
+ * after each change, to compare the results of both instances.
+ */
+static void test_run_changes(struct test_incremental *test,
+			     void (*check)(struct test_incremental *test,
+					   const char *change))
+{
+	struct ospf_test_node *tnode;
+	struct ospf_test_adj *tadj, saved;
+	char change[256];
+	uint32_t metric;
+	int i, j;
+
+	for (i = 0; test->topology.nodes[i].hostname[0]; i++) {
+		tnode = &test->topology.nodes[i];
+
+		for (j = 0; tnode->adjacencies[j].hostname[0]; j++) {
+			tadj = &tnode->adjacencies[j];
+			metric = tadj->metric;
+
+			tadj->metric = metric * 3;
+			test_node_update(test, tnode, false);
+			snprintf(change, sizeof(change), "%s -> %s metric %u",
+				 tnode->hostname, tadj->hostname, tadj->metric);
+			check(test, change);
+
+			tadj->metric = metric;
+			test_node_update(test, tnode, false);
+			snprintf(change, sizeof(change), "%s -> %s metric %u",
+				 tnode->hostname, tadj->hostname, tadj->metric);
+			check(test, change);
+
+			saved = *tadj;
+			memmove(tadj, tadj + 1,
+				(MAX_ADJACENCIES - j) * sizeof(*tadj));
+			test_node_update(test, tnode, false);
+			snprintf(change, sizeof(change), "%s -> %s down",
+				 tnode->hostname, saved.hostname);
+			check(test, change);
+
+			memmove(tadj + 1, tadj,
+				(MAX_ADJACENCIES - j) * sizeof(*tadj));
+			*tadj = saved;
+			test_node_update(test, tnode, false);
+			snprintf(change, sizeof(change), "%s -> %s up",
+				 tnode->hostname, tadj->hostname);
+			check(test, change);
+		}
+	}
+
+	/* Then flush the router LSA of each node, and add it back */
+	for (i = 0; test->topology.nodes[i].hostname[0]; i++) {
+		tnode = &test->topology.nodes[i];
+		if (tnode == test->root)
+			continue;
+
+		test_node_update(test, tnode, true);
+		snprintf(change, sizeof(change), "%s down", tnode->hostname);
+		check(test, change);
+
+		test_node_update(test, tnode, false);
+		snprintf(change, sizeof(change), "%s up", tnode->hostname);
+		check(test, change);
+	}
+}
+
+static int test_run_incremental(struct vty *vty,
+				struct ospf_topology *topology,
+				struct ospf_test_node *root)
+{
+	static struct test_incremental test;
+	int i;
+
+	test.vty = vty;
+	test.topology = *topology;
+	test.root = test_find_node(&test.topology, root->hostname);
+	test.ospf = test_init(test.root);
+	test.ref = test_init(test.root);
+	test.ospf->ti_lfa_enabled = false;
+	test.ref->ti_lfa_enabled = false;
+
+	for (i = 0; test.topology.nodes[i].hostname[0]; i++)
+		test_node_update(&test, &test.topology.nodes[i], false);
+	test_check(&test, "initial");
+
+	test_run_changes(&test, test_check);
+
+	ospf_spf_reset(test.ospf->backbone);
+
+	return 0;
+}
+
+/*
+ * Partial route calculation: changes to prefixes only, the stub links of a
+ * router LSA or a summary LSA, are applied to the routing table calculated
+ * before, without running SPF.  The result must be the same as what a full
+ * route calculation gives for the same LSDB.
+ */
+static void test_routes_full(struct ospf *ospf, struct route_table **rt,
+			     struct route_table **rtrs)
+{
+	/* what ospf_spf_calculate_schedule_worker() does for the routes */
+	*rt = route_table_init();
+	*rtrs = route_table_init();
+	ospf_spf_calculate_areas(ospf, *rt, NULL, *rtrs);
+	ospf_ia_routing(ospf, *rt, *rtrs);
+	ospf_prune_unreachable_networks(*rt);
+	ospf_prune_unreachable_routers(*rtrs);
+}
+
+/* Run a scheduled task now, instead of from its timer */
+static void test_run_task(struct event **task, void *arg)
+{
+	void (*func)(struct event *e);
+
+	assert(*task);
+	func = (*task)->func;
+	EVENT_OFF(*task);
+	event_execute(master, func, arg, 0, NULL);
+}
+
+static void test_prc_check(struct test_incremental *test, const char *change)
+{
+	struct ospf *ospf = test->ospf;
+	struct route_table *ref_table, *ref_rtrs;
+
+	assert(!ospf->t_spf_calc);
+	test_run_task(&ospf->t_prc_calc, ospf);
+	assert(!ospf->t_spf_calc);
+
+	ospf_spf_reset(test->ref->backbone);
+	test_routes_full(test->ref, &ref_table, &ref_rtrs);
+	assert(test_same_routes(ospf->new_table, ref_table));
+
+	vty_out(test->vty, "%s: %u prefixes calculated\n", change,
+		ospf->prc_last_prefixes);
+
+	ospf_route_table_free(ref_table);
+	ospf_rtrs_free(ref_rtrs);
+}
+
+/* Like test_node_update(), for a change PRC takes care of */
+static void test_prc_node_update(struct test_incremental *test,
+				 struct ospf_test_node *tnode)
+{
+	struct ospf_area *area = test->ospf->backbone;
+	struct ospf_lsa *old, *new;
+	struct in_addr router_id;
+
+	inet_aton(tnode->router_id, &router_id);
+
+	old = ospf_lsa_lookup_by_id(area, OSPF_ROUTER_LSA, router_id);
+	ospf_lsa_lock(old);
+	test_node_update(test, tnode, false);
+	new = ospf_lsa_lookup_by_id(area, OSPF_ROUTER_LSA, router_id);
+
+	assert(ospf_prc_schedule(test->ospf, old, new));
+	ospf_lsa_unlock(&old);
+}
+
+/* Originate, change or (with metric 0) flush a summary LSA of the ABR */
+static void test_prc_summary(struct test_incremental *test, const char *prefix,
+			     uint32_t metric)
+{
+	struct ospf *ospfs[] = { test->ospf, test->ref };
+	size_t length = OSPF_LSA_HEADER_SIZE + OSPF_SUMMARY_LSA_MIN_SIZE;
+	struct ospf_area *area;
+	struct ospf_lsa *old, *new = NULL;
+	struct summary_lsa *sl;
+	struct in_addr adv_router;
+	struct prefix_ipv4 p;
+
+	inet_aton(test->abr->router_id, &adv_router);
+	str2prefix_ipv4(prefix, &p);
+
+	for (size_t i = 0; i < array_size(ospfs); i++) {
+		area = ospfs[i]->backbone;
+		old = ospf_lsa_lookup(ospfs[i], area, OSPF_SUMMARY_LSA,
+				      p.prefix, adv_router);
+
+		if (metric) {
+			new = ospf_lsa_new_and_data(length);
+			new->area = area;
+			new->vrf_id = area->ospf->vrf_id;
+
+			sl = (struct summary_lsa *)new->data;
+			sl->header.type = OSPF_SUMMARY_LSA;
+			sl->header.id = p.prefix;
+			sl->header.adv_router = adv_router;
+			sl->header.ls_seqnum =
+				htonl(OSPF_INITIAL_SEQUENCE_NUMBER);
+			sl->header.length = htons(length);
+			masklen2ip(p.prefixlen, &sl->mask);
+			sl->metric[0] = (metric >> 16) & 0xff;
+			sl->metric[1] = (metric >> 8) & 0xff;
+			sl->metric[2] = metric & 0xff;
+		}
+
+		if (ospfs[i] == test->ospf)
+			assert(ospf_prc_schedule(test->ospf, old, new));
+
+		if (new)
+			ospf_lsdb_add(area->lsdb, new);
+		else
+			ospf_lsdb_delete(area->lsdb, old);
+	}
+}
+
+static int test_run_prc(struct vty *vty, struct ospf_topology *topology,
+			struct ospf_test_node *root)
+{
+	static const struct {
+		const char *prefix;
+		uint32_t metric;
+	} summaries[] = {
+		{ "172.16.0.0/16", 10 }, { "172.16.1.0/24", 20 },
+		{ "172.16.0.0/16", 30 }, { "172.16.0.0/16", 0 },
+		{ "172.16.1.0/24", 0 },
+	};
+	static struct test_incremental test;
+	struct ospf_test_node *tnode;
+	struct ospf_test_adj *tadj;
+	struct prefix_ipv4 p;
+	char network[sizeof(tadj->network)];
+	char change[512];
+	int i, j;
+
+	test.vty = vty;
+	test.topology = *topology;
+	test.root = test_find_node(&test.topology, root->hostname);
+	test.ospf = test_init(test.root);
+	test.ref = test_init(test.root);
+	test.ospf->ti_lfa_enabled = false;
+	test.ref->ti_lfa_enabled = false;
+	test.ospf->spf_delay = 0;
+
+	/* The last node originates the summary LSAs */
+	for (i = 0; test.topology.nodes[i + 1].hostname[0]; i++)
+		;
+	test.abr = &test.topology.nodes[i];
+
+	for (i = 0; test.topology.nodes[i].hostname[0]; i++)
+		test_node_update(&test, &test.topology.nodes[i], false);
+	test_routes_full(test.ospf, &test.ospf->new_table,
+			 &test.ospf->new_rtrs);
+
+	/* Make each stub network one bit longer, then change it back */
+	for (i = 0; test.topology.nodes[i].hostname[0]; i++) {
+		tnode = &test.topology.nodes[i];
+
+		for (j = 0; tnode->adjacencies[j].hostname[0]; j++) {
+			tadj = &tnode->adjacencies[j];
+			strlcpy(network, tadj->network, sizeof(network));
+			str2prefix_ipv4(network, &p);
+
+			snprintfrr(tadj->network, sizeof(tadj->network),
+				   "%pI4/%u", &p.prefix, p.prefixlen + 1);
+			test_prc_node_update(&test, tnode);
+			snprintf(change, sizeof(change), "%s stub %s",
+				 tnode->hostname, tadj->network);
+			test_prc_check(&test, change);
+
+			strlcpy(tadj->network, network, sizeof(tadj->network));
+			test_prc_node_update(&test, tnode);
+			snprintf(change, sizeof(change), "%s stub %s",
+				 tnode->hostname, tadj->network);
+			test_prc_check(&test, change);
+		}
+	}
+
+	/* Summary LSAs coming, changing and going */
+	for (i = 0; i < (int)array_size(summaries); i++) {
+		test_prc_summary(&test, summaries[i].prefix,
+				 summaries[i].metric);
+		if (summaries[i].metric)
+			snprintf(change, sizeof(change),
+				 "%s summary %s metric %u",
+				 test.abr->hostname, summaries[i].prefix,
+				 summaries[i].metric);
+		else
+			snprintf(change, sizeof(change), "%s summary %s flushed",
+				 test.abr->hostname, summaries[i].prefix);
+		test_prc_check(&test, change);
+	}
+
+	ospf_route_table_free(test.ospf->new_table);
+	ospf_rtrs_free(test.ospf->new_rtrs);
+	test.ospf->new_table = NULL;
+	test.ospf->new_rtrs = NULL;
+	ospf_spf_reset(test.ospf->backbone);
+	ospf_spf_reset(test.ref->backbone);
+
+	return 0;
+}
+
+/*
+ * External routes after SPF: only those whose ASBR or forwarding address is
+ * now reached differently are recalculated.  The result must be the same as
+ * what the full AS-external calculation gives after a full SPF run.
+ */
+static void test_ase_full(struct ospf *ospf)
+{
+	if (ospf->new_table) {
+		ospf_route_table_free(ospf->new_table);
+		ospf_rtrs_free(ospf->new_rtrs);
+	}
+
+	ospf_spf_reset(ospf->backbone);
+	test_routes_full(ospf, &ospf->new_table, &ospf->new_rtrs);
+
+	ospf_ase_calculate_schedule(ospf);
+	ospf_ase_calculate_timer_add(ospf);
+	test_run_task(&ospf->t_ase_calc, ospf);
+}
+
+static unsigned int test_route_count(struct route_table *rt)
+{
+	struct route_node *rn;
+	unsigned int count = 0;
+
+	for (rn = route_top(rt); rn; rn = route_next(rn))
+		if (rn->info)
+			count++;
+
+	return count;
+}
+
+static void test_ase_check(struct test_incremental *test, const char *change)
+{
+	struct ospf *ospf = test->ospf;
+	uint32_t incremental = ospf->ase_incremental;
+
+	ospf_spf_calculate_schedule(ospf, SPF_FLAG_ROUTER_LSA_INSTALL);
+	test_run_task(&ospf->t_spf_calc, ospf);
+
+	/* without scheduling the full AS-external calculation */
+	assert(!ospf->t_ase_calc);
+	assert(ospf->ase_incremental == incremental + 1);
+
+	test_ase_full(test->ref);
+	assert(test_same_routes(ospf->old_external_route,
+				test->ref->old_external_route));
+
+	vty_out(test->vty, "%s: %u prefixes recalculated, %u external routes\n",
+		change, ospf->ase_last_prefixes,
+		test_route_count(ospf->old_external_route));
+}
+
+/* Originate an AS-external-LSA from the ASBR, in both instances */
+static void test_ase_external(struct test_incremental *test, const char *prefix,
+			      uint32_t metric, bool type2, struct in_addr fwd)
+{
+	struct ospf *ospfs[] = { test->ospf, test->ref };
+	size_t length = OSPF_LSA_HEADER_SIZE + OSPF_AS_EXTERNAL_LSA_MIN_SIZE;
+	struct as_external_lsa *al;
+	struct ospf_lsa *lsa;
+	struct prefix_ipv4 p;
+
+	str2prefix_ipv4(prefix, &p);
+
+	for (size_t i = 0; i < array_size(ospfs); i++) {
+		lsa = ospf_lsa_new_and_data(length);
+		lsa->vrf_id = ospfs[i]->vrf_id;
+
+		al = (struct as_external_lsa *)lsa->data;
+		al->header.type = OSPF_AS_EXTERNAL_LSA;
+		al->header.id = p.prefix;
+		inet_aton(test->asbr->router_id, &al->header.adv_router);
+		al->header.ls_seqnum = htonl(OSPF_INITIAL_SEQUENCE_NUMBER);
+		al->header.length = htons(length);
+		masklen2ip(p.prefixlen, &al->mask);
+		al->e[0].tos = type2 ? 0x80 : 0;
+		al->e[0].metric[0] = (metric >> 16) & 0xff;
+		al->e[0].metric[1] = (metric >> 8) & 0xff;
+		al->e[0].metric[2] = metric & 0xff;
+		al->e[0].fwd_addr = fwd;
+
+		/* what ospf_external_lsa_install() does */
+		ospf_lsdb_add(ospfs[i]->lsdb, lsa);
+		ospf_ase_register_external_lsa(lsa, ospfs[i]);
+	}
+}
+
+static int test_run_ase(struct vty *vty, struct ospf_topology *topology,
+			struct ospf_test_node *root)
+{
+	static struct test_incremental test;
+	struct in_addr any = {}, fwd;
+	struct prefix_ipv4 p;
+	char network[PREFIX2STR_BUFFER];
+	int i;
+
+	test.vty = vty;
+	test.topology = *topology;
+	test.root = test_find_node(&test.topology, root->hostname);
+	test.ospf = test_init(test.root);
+	test.ref = test_init(test.root);
+	test.ospf->ti_lfa_enabled = false;
+	test.ref->ti_lfa_enabled = false;
+
+	/* The last node is the ASBR */
+	for (i = 0; test.topology.nodes[i + 1].hostname[0]; i++)
+		;
+	test.asbr = &test.topology.nodes[i];
+
+	for (i = 0; test.topology.nodes[i].hostname[0]; i++)
+		test_node_update(&test, &test.topology.nodes[i], false);
+
+	/*
+	 * Routes through the ASBR, and through a forwarding address on a link
+	 * of the second node.  The external route to the second node's router
+	 * ID is only used while there is no intra-area route to it.
+	 */
+	str2prefix_ipv4(test.topology.nodes[1].adjacencies[0].network, &p);
+	fwd = p.prefix;
+	snprintf(network, sizeof(network), "%s/32",
+		 test.topology.nodes[1].router_id);
+	test_ase_external(&test, "192.168.0.0/24", 20, true, any);
+	test_ase_external(&test, "192.168.1.0/24", 10, false, any);
+	test_ase_external(&test, "192.168.2.0/24", 5, false, fwd);
+	test_ase_external(&test, network, 20, true, any);
+
+	/* The first SPF run calculates all external routes */
+	ospf_spf_calculate_schedule(test.ospf, SPF_FLAG_ROUTER_LSA_INSTALL);
+	test_run_task(&test.ospf->t_spf_calc, test.ospf);
+	test_run_task(&test.ospf->t_ase_calc, test.ospf);
+
+	test_ase_full(test.ref);
+	assert(test_same_routes(test.ospf->old_external_route,
+				test.ref->old_external_route));
+	vty_out(vty, "initial: %u external routes\n",
+		test_route_count(test.ospf->old_external_route));
+
+	test_run_changes(&test, test_ase_check);
+
+	ospf_spf_reset(test.ospf->backbone);
+	ospf_spf_reset(test.ref->backbone);
+
+	return 0;
+}
+
+/*
+ * Add an area with the topology, its networks renumbered to 10+N.x.x.x so
+ * that no two areas have the same.  The last node is made an ABR, for a
+ * border router route.
+ */
+static void test_parallel_area(struct vty *vty, struct ospf *ospf,
+			       uint32_t area_id, struct ospf_topology *topology,
+			       struct ospf_test_node *root)
+{
+	static struct ospf_topology copy;
+	struct ospf_test_node *tnode;
+	struct ospf_test_adj *tadj;
+	struct ospf_area *area;
+	struct in_addr id;
+	struct ospf_lsa *lsa;
+	struct prefix_ipv4 p;
+	int i, j;
+
+	copy = *topology;
+	for (i = 0; copy.nodes[i].hostname[0]; i++) {
+		tnode = &copy.nodes[i];
+		for (j = 0; tnode->adjacencies[j].hostname[0]; j++) {
+			tadj = &tnode->adjacencies[j];
+			str2prefix_ipv4(tadj->network, &p);
+			p.prefix.s_addr = htonl(ntohl(p.prefix.s_addr)
+						+ (area_id << 24));
+			snprintfrr(tadj->network, sizeof(tadj->network),
+				   "%pI4/%u", &p.prefix, p.prefixlen);
+		}
+	}
+	tnode = test_find_node(&copy, root->hostname);
+
+	id.s_addr = htonl(area_id);
+	area = ospf_area_new(ospf, id);
+	listnode_add_sort(ospf->areas, area);
+	topology_load_area(vty, &copy, tnode, area);
+	test_interfaces_set(area, tnode);
+
+	inet_aton(copy.nodes[i - 1].router_id, &id);
+	lsa = ospf_lsa_lookup_by_id(area, OSPF_ROUTER_LSA, id);
+	SET_FLAG(((struct router_lsa *)lsa->data)->flags, ROUTER_LSA_BORDER);
+}
+
+/*
+ * Parallel SPF: with a task pool (--spf-threads) the areas' trees are
+ * calculated on its pthreads.  The root is in the backbone with the
+ * topology and in an area of its own with each of the test topologies it
+ * is part of.  The routes must be the same as those calculated without the
+ * pool.
+ */
+static int test_run_parallel(struct vty *vty, struct ospf_topology *topology,
+			     struct ospf_test_node *root)
+{
+	struct ospf_topology *topologies[] = { &topo1, &topo2, &topo3, &topo4,
+					       &topo5 };
+	struct route_table *table, *rtrs, *ref_table, *ref_rtrs;
+	struct ospf_test_node *tnode;
+	struct ospf_area *area;
+	struct listnode *node;
+	struct ospf *ospf;
+	unsigned int i;
+
+	ospf = test_init(root);
+	ospf->ti_lfa_enabled = false;
+	topology_load_area(vty, topology, root, ospf->backbone);
+	test_interfaces_set(ospf->backbone, root);
+	for (i = 0; i < array_size(topologies); i++) {
+		tnode = test_find_node(topologies[i], root->hostname);
+		if (tnode && !strcmp(tnode->router_id, root->router_id))
+			test_parallel_area(vty, ospf, i + 1, topologies[i],
+					   tnode);
+	}
+
+	test_routes_full(ospf, &ref_table, &ref_rtrs);
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area))
+		ospf_spf_reset(area);
+
+	om->spf_pool = taskpool_new("ospf_spf", 4);
+	test_routes_full(ospf, &table, &rtrs);
+	taskpool_free(&om->spf_pool);
+
+	assert(test_same_routes(table, ref_table));
+	assert(test_route_count(rtrs) == test_route_count(ref_rtrs));
+	vty_out(vty, "%u areas: %u routes, %u routers\n",
+		listcount(ospf->areas), test_route_count(table),
+		test_route_count(rtrs));
+
+	ospf_route_table_free(table);
+	ospf_route_table_free(ref_table);
+	ospf_rtrs_free(rtrs);
+	ospf_rtrs_free(ref_rtrs);
+	for (ALL_LIST_ELEMENTS_RO(ospf->areas, node, area))
+		ospf_spf_reset(area);
+
+	return 0;
+}
+
 DEFUN(test_ospf, test_ospf_cmd,
       "test ospf topology WORD root HOSTNAME ti-lfa [node-protection] [verbose]",
       "Test mode\n"
@@ -203,6 +958,45 @@ DEFUN(test_ospf, test_ospf_cmd,
 	return test_run(vty, topology, root, protection_type, verbose);
 }
 
+DEFUN(test_ospf_incremental, test_ospf_incremental_cmd,
+      "test ospf topology WORD root HOSTNAME <incremental|prc|ase|parallel>",
+      "Test mode\n"
+      "Choose OSPF for SPF testing\n"
+      "Network topology to choose\n"
+      "Name of the network topology to choose\n"
+      "Root node to choose\n"
+      "Hostname of the root node to choose\n"
+      "Compare incremental SPF with full SPF runs\n"
+      "Compare partial route calculation with full runs\n"
+      "Compare external route updates with full calculations\n"
+      "Compare SPF on a task pool with SPF without\n")
+{
+	struct ospf_topology *topology;
+	struct ospf_test_node *root;
+	int idx = 0;
+
+	topology = test_find_topology(argv[3]->arg);
+	if (!topology) {
+		vty_out(vty, "%% Topology not found\n");
+		return CMD_WARNING;
+	}
+
+	root = test_find_node(topology, argv[5]->arg);
+	if (!root) {
+		vty_out(vty, "%% Root not found\n");
+		return CMD_WARNING;
+	}
+
+	if (argv_find(argv, argc, "prc", &idx))
+		return test_run_prc(vty, topology, root);
+	if (argv_find(argv, argc, "ase", &idx))
+		return test_run_ase(vty, topology, root);
+	if (argv_find(argv, argc, "parallel", &idx))
+		return test_run_parallel(vty, topology, root);
+
+	return test_run_incremental(vty, topology, root);
+}
+
 static void vty_do_exit(int isexit)
 {
 	printf("\nend.\n");
@@ -274,6 +1068,7 @@ int main(int argc, char **argv)
 	}
 
 	/* master init. */
+	frr_pthread_init();
 	master = event_master_create(NULL);
 
 	/* Library inits. */
@@ -287,11 +1082,18 @@ int main(int argc, char **argv)
 
 	/* Install test command. */
 	install_element(VIEW_NODE, &test_ospf_cmd);
+	install_element(VIEW_NODE, &test_ospf_incremental_cmd);
+
+	ospf_master_init(master);
 
 	/* needed for SR DB init */
 	ospf_vty_init();
 	ospf_sr_init();
 
+	/* Routes changed by PRC go to zebra, through a closed zclient */
+	zclient = zclient_new(master, &zclient_options_default, NULL, 0);
+	zclient->sock = -1;
+
 	term_debug_ospf_ti_lfa = 1;
 
 	/* Read input from .in file. */
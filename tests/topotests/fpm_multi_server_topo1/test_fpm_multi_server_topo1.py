@@ -0,0 +1,224 @@
+#!/usr/bin/env python
+# SPDX-License-Identifier: ISC
+
+#
+# test_fpm_multi_server_topo1.py
+#
+
+"""
+test_fpm_multi_server_topo1.py: Testing the FPM module feeding two servers
+
+Both servers must get every route update, and a server that reconnects
+must be sent the full tables again.
+"""
+import ipaddress
+import json
+import os
+import re
+import sys
+from functools import partial
+
+import pytest
+
+# Save the Current Working Directory to find configuration files.
+CWD = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(CWD, "../"))
+
+# pylint: disable=C0413
+# Import topogen and topotest helpers
+from lib import topotest
+from lib.topogen import Topogen, TopoRouter, get_topogen
+
+
+pytestmark = [pytest.mark.fpm, pytest.mark.sharpd]
+
+FPM_LISTENER = "/usr/lib/frr/fpm_listener"
+PORTS = [2620, 2621]
+
+ROUTE_RE = re.compile(r"^(New|Del) route (\S+)/(\d+),")
+
+
+def build_topo(tgen):
+    "Build function"
+
+    # Populate routers
+    tgen.add_router("r1")
+
+    switch = tgen.add_switch("sw1")
+    switch.add_link(tgen.gears["r1"])
+
+
+def listener_output(router, port, run):
+    return "{}/fpm_listener_{}_{}.out".format(router.gearlogdir, port, run)
+
+
+def start_listener(router, port, run):
+    router.cmd(
+        "{} -d -p {} > {} 2>&1".format(
+            FPM_LISTENER, port, listener_output(router, port, run)
+        )
+    )
+
+
+def stop_listener(router, port):
+    router.cmd("pkill -f '{} -d -p {}'".format(FPM_LISTENER, port))
+
+
+def setup_module(module):
+    "Setup topology"
+
+    tgen = Topogen(build_topo, module.__name__)
+    tgen.start_topology()
+
+    router_list = tgen.routers()
+    for rname, router in router_list.items():
+        router.load_config(
+            TopoRouter.RD_ZEBRA,
+            os.path.join(CWD, "{}/zebra.conf".format(rname)),
+            "-M dplane_fpm_nl",
+        )
+        router.load_config(
+            TopoRouter.RD_SHARP, os.path.join(CWD, "{}/sharpd.conf".format(rname))
+        )
+
+    tgen.start_router()
+
+    router = tgen.gears["r1"]
+    for port in PORTS:
+        start_listener(router, port, 1)
+
+
+def teardown_module(_mod):
+    "Teardown the pytest environment"
+
+    tgen = get_topogen()
+
+    router = tgen.gears["r1"]
+    for port in PORTS:
+        stop_listener(router, port)
+
+    # This function tears down the whole topology.
+    tgen.stop_topology()
+
+
+def sharp_prefixes(start, count):
+    first = ipaddress.ip_address(start)
+    return set("{}".format(first + i) for i in range(count))
+
+
+def listener_routes(router, port, run):
+    "Routes a listener holds after applying the messages it got, in order"
+
+    routes = set()
+    with open(listener_output(router, port, run)) as output:
+        for line in output:
+            match = ROUTE_RE.match(line)
+            if not match or match.group(3) != "32":
+                continue
+            if match.group(1) == "New":
+                routes.add(match.group(2))
+            else:
+                routes.discard(match.group(2))
+    return routes
+
+
+def check_listener_routes(router, port, run, expected):
+    routes = listener_routes(router, port, run)
+    missing = expected - routes
+    extra = routes - expected
+    if missing or extra:
+        return "port {}: {} routes missing, {} unexpected routes".format(
+            port, len(missing), len(extra)
+        )
+    return None
+
+
+def check_connections(router, expected):
+    output = json.loads(router.vtysh_cmd("show fpm status json"))
+    conns = {c["port"]: c for c in output.get("connections", [])}
+    for port, state in expected.items():
+        if port not in conns:
+            return "port {} not configured".format(port)
+        for key, value in state.items():
+            if conns[port].get(key) != value:
+                return "port {}: {} is {}".format(port, key, conns[port].get(key))
+    return None
+
+
+def test_fpm_connections():
+    "Test that zebra connects to, and fully syncs, both servers"
+
+    tgen = get_topogen()
+    router = tgen.gears["r1"]
+
+    expected = {port: {"connected": True, "synced": True} for port in PORTS}
+    test_func = partial(check_connections, router, expected)
+    success, result = topotest.run_and_expect(test_func, None, 60, 1)
+    assert success, "FPM servers did not get connected: {}".format(result)
+
+
+def test_fpm_fanout():
+    "Test that route updates reach every server"
+
+    tgen = get_topogen()
+    router = tgen.gears["r1"]
+
+    router.vtysh_cmd("sharp install routes 10.1.0.0 nexthop 192.168.44.33 1000")
+    expected = sharp_prefixes("10.1.0.0", 1000)
+    for port in PORTS:
+        test_func = partial(check_listener_routes, router, port, 1, expected)
+        success, result = topotest.run_and_expect(test_func, None, 60, 1)
+        assert success, "Routes not sent to every server: {}".format(result)
+
+    router.vtysh_cmd("sharp remove routes 10.1.0.0 500")
+    expected = sharp_prefixes("10.1.0.0", 1000) - sharp_prefixes("10.1.0.0", 500)
+    for port in PORTS:
+        test_func = partial(check_listener_routes, router, port, 1, expected)
+        success, result = topotest.run_and_expect(test_func, None, 60, 1)
+        assert success, "Removals not sent to every server: {}".format(result)
+
+
+def test_fpm_reconnect():
+    "Test that a restarted server is sent the full tables"
+
+    tgen = get_topogen()
+    router = tgen.gears["r1"]
+
+    counters = json.loads(router.vtysh_cmd("show fpm counters json"))
+    full_resyncs = counters["full-resyncs"]
+
+    # Restart the second server, changing the tables while it is down
+    stop_listener(router, PORTS[1])
+    test_func = partial(check_connections, router, {PORTS[1]: {"connected": False}})
+    success, result = topotest.run_and_expect(test_func, None, 30, 1)
+    assert success, "FPM server did not get disconnected: {}".format(result)
+
+    router.vtysh_cmd("sharp install routes 10.2.0.0 nexthop 192.168.44.33 1000")
+    router.vtysh_cmd("sharp remove routes 10.1.0.0 1000")
+    expected = sharp_prefixes("10.2.0.0", 1000)
+
+    start_listener(router, PORTS[1], 2)
+    test_func = partial(
+        check_connections, router, {PORTS[1]: {"connected": True, "synced": True}}
+    )
+    success, result = topotest.run_and_expect(test_func, None, 60, 1)
+    assert success, "FPM server did not get reconnected: {}".format(result)
+
+    # The restarted server starts from scratch, the other one kept going
+    test_func = partial(check_listener_routes, router, PORTS[1], 2, expected)
+    success, result = topotest.run_and_expect(test_func, None, 60, 1)
+    assert success, "Restarted server did not get a full sync: {}".format(result)
+
+    test_func = partial(check_listener_routes, router, PORTS[0], 1, expected)
+    success, result = topotest.run_and_expect(test_func, None, 60, 1)
+    assert success, "Connected server missed updates: {}".format(result)
+
+    counters = json.loads(router.vtysh_cmd("show fpm counters json"))
+    assert counters["full-resyncs"] > full_resyncs, "No full resync was counted"
+
+    router.vtysh_cmd("sharp remove routes 10.2.0.0 1000")
+
+
+if __name__ == "__main__":
+    args = ["-s"] + sys.argv[1:]
+    sys.exit(pytest.main(args))
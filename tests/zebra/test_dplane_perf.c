@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test program which measures the rate at which context objects can be
+ * handed through a chain of threaded dataplane providers that do no work,
+ * comparing the mutex-protected list handoff with the lock-free ring
+ * handoff used by zebra_dplane.c.
+ */
+
+#include <zebra.h>
+
+#include <pthread.h>
+
+#include "atomring.h"
+#include "frratomic.h"
+#include "monotime.h"
+#include "typesafe.h"
+
+#define NCONTEXTS 2000000
+#define NSTAGES	  3
+#define RING_SIZE 1024
+#define BATCH	  64
+
+PREDECL_DLIST(ctx_list);
+
+/* stand-in for struct zebra_dplane_ctx */
+struct test_ctx {
+	uint64_t seq;
+	struct ctx_list_item link;
+	char payload[512];
+};
+
+DECLARE_DLIST(ctx_list, struct test_ctx, link);
+
+struct test_queue {
+	/* mutex + list variant */
+	pthread_mutex_t mtx;
+	struct ctx_list_head list;
+
+	/* lock-free variant */
+	struct atomring *ring;
+};
+
+static struct test_queue queues[NSTAGES + 1];
+static bool use_ring;
+static _Atomic bool running;
+
+static void queue_push(struct test_queue *q, struct test_ctx *ctx)
+{
+	if (use_ring) {
+		while (!atomring_push(q->ring, ctx))
+			sched_yield();
+		return;
+	}
+
+	pthread_mutex_lock(&q->mtx);
+	ctx_list_add_tail(&q->list, ctx);
+	pthread_mutex_unlock(&q->mtx);
+}
+
+static size_t queue_pop_bulk(struct test_queue *q, struct test_ctx **ctxs,
+			     size_t max)
+{
+	size_t n = 0;
+
+	if (use_ring)
+		return atomring_pop_bulk(q->ring, (void **)ctxs, max);
+
+	pthread_mutex_lock(&q->mtx);
+	while (n < max && (ctxs[n] = ctx_list_pop(&q->list)) != NULL)
+		n++;
+	pthread_mutex_unlock(&q->mtx);
+
+	return n;
+}
+
+/* A provider that does nothing: pass everything on to the next queue */
+static void *null_provider(void *arg)
+{
+	struct test_queue *in = arg, *out = in + 1;
+	struct test_ctx *ctxs[BATCH];
+	size_t i, n;
+
+	while (atomic_load_explicit(&running, memory_order_acquire)) {
+		n = queue_pop_bulk(in, ctxs, BATCH);
+		if (!n) {
+			sched_yield();
+			continue;
+		}
+
+		for (i = 0; i < n; i++)
+			queue_push(out, ctxs[i]);
+	}
+
+	return NULL;
+}
+
+static void run(const char *desc)
+{
+	pthread_t threads[NSTAGES];
+	struct test_ctx *ctxs, *done[BATCH];
+	struct timeval tv_start, tv_stop;
+	uint64_t sent = 0, received = 0, expect = 0;
+	unsigned long elapsed;
+	size_t i, n;
+
+	ctxs = calloc(RING_SIZE, sizeof(*ctxs));
+
+	for (i = 0; i <= NSTAGES; i++) {
+		pthread_mutex_init(&queues[i].mtx, NULL);
+		ctx_list_init(&queues[i].list);
+		queues[i].ring = atomring_new(RING_SIZE);
+	}
+
+	atomic_store_explicit(&running, true, memory_order_release);
+	for (i = 0; i < NSTAGES; i++)
+		pthread_create(&threads[i], NULL, null_provider, &queues[i]);
+
+	monotime(&tv_start);
+
+	/* keep at most RING_SIZE contexts in flight, like the dplane does
+	 * with its per-cycle work limit.
+	 */
+	for (i = 0; i < RING_SIZE; i++) {
+		ctxs[i].seq = sent++;
+		queue_push(&queues[0], &ctxs[i]);
+	}
+
+	while (received < NCONTEXTS) {
+		n = queue_pop_bulk(&queues[NSTAGES], done, BATCH);
+		if (!n) {
+			sched_yield();
+			continue;
+		}
+
+		for (i = 0; i < n; i++) {
+			assert(done[i]->seq == expect);
+			expect++;
+			received++;
+
+			if (sent < NCONTEXTS) {
+				done[i]->seq = sent++;
+				queue_push(&queues[0], done[i]);
+			}
+		}
+	}
+
+	monotime(&tv_stop);
+
+	atomic_store_explicit(&running, false, memory_order_release);
+	for (i = 0; i < NSTAGES; i++)
+		pthread_join(threads[i], NULL);
+
+	for (i = 0; i <= NSTAGES; i++) {
+		atomring_del(queues[i].ring);
+		ctx_list_fini(&queues[i].list);
+		pthread_mutex_destroy(&queues[i].mtx);
+	}
+	free(ctxs);
+
+	elapsed = 1000 * (tv_stop.tv_sec - tv_start.tv_sec);
+	elapsed += (tv_stop.tv_usec - tv_start.tv_usec) / 1000;
+
+	printf("%s: %d contexts through %d providers took %lu.%03lu seconds (%lu contexts/sec).\n",
+	       desc, NCONTEXTS, NSTAGES, elapsed / 1000, elapsed % 1000,
+	       elapsed ? (unsigned long)(NCONTEXTS * 1000ULL / elapsed) : 0);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+	use_ring = false;
+	run("mutex + list handoff");
+
+	use_ring = true;
+	run("lock-free ring handoff");
+
+	return 0;
+}
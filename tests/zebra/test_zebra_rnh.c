@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Nexthop tracking tests: checks that a tracked nexthop is kept on the
+ * nht list of exactly the route node it resolves over, including the
+ * default route, and is taken off it again when it is freed.
+ */
+
+#include <zebra.h>
+
+#include "memory.h"
+#include "nexthop.h"
+#include "routemap.h"
+#include "table.h"
+
+#include "zebra/zebra_router.h"
+#include "zebra/rib.h"
+#include "zebra/zserv.h"
+#include "zebra/zebra_vrf.h"
+#include "zebra/zebra_nhg.h"
+#include "zebra/zebra_rnh.h"
+#include "zebra/zebra_routemap.h"
+
+/* shim out what zebra_rnh.c needs from the rest of zebra */
+DEFINE_MGROUP(ZEBRA, "zebra");
+DEFINE_MTYPE(ZEBRA, RE, "Route Entry");
+DEFINE_MTYPE_STATIC(ZEBRA, TEST_NHE, "Test nexthop group entry");
+DEFINE_KOOH(zserv_client_close, (struct zserv * client), (client));
+
+unsigned long zebra_debug_nht;
+
+static struct vrf vrf = { .vrf_id = VRF_DEFAULT };
+static struct zebra_vrf zvrf = { .vrf = &vrf };
+
+struct zebra_vrf *zebra_vrf_lookup_by_id(vrf_id_t vrf_id)
+{
+	return &zvrf;
+}
+
+struct nhg_hash_entry *zebra_nhe_copy(const struct nhg_hash_entry *orig,
+				      uint32_t id)
+{
+	struct nhg_hash_entry *nhe;
+
+	nhe = XCALLOC(MTYPE_TEST_NHE, sizeof(*nhe));
+	nexthop_group_copy(&nhe->nhg, &orig->nhg);
+	return nhe;
+}
+
+void zebra_nhg_free(struct nhg_hash_entry *nhe)
+{
+	nexthops_free(nhe->nhg.nexthop);
+	XFREE(MTYPE_TEST_NHE, nhe);
+}
+
+void zebra_rib_route_entry_free(struct route_entry *re)
+{
+	XFREE(MTYPE_RE, re);
+}
+
+route_map_result_t zebra_nht_route_map_check(afi_t afi, int client_proto,
+					     const struct prefix *p,
+					     struct zebra_vrf *zvrf,
+					     struct route_entry *re,
+					     struct nexthop *nexthop)
+{
+	return RMAP_PERMITMATCH;
+}
+
+void zebra_pw_update(struct zebra_pw *pw)
+{
+}
+
+int zserv_send_message(struct zserv *client, struct stream *msg)
+{
+	stream_free(msg);
+	return 0;
+}
+
+int zserv_send_batch(struct zserv *client, struct stream_fifo *fifo)
+{
+	stream_fifo_clean(fifo);
+	return 0;
+}
+
+/* A RIB route with one installed nexthop */
+struct test_route {
+	struct route_node *rn;
+	struct route_entry re;
+	struct nhg_hash_entry nhe;
+};
+
+static struct test_route *route_add(const char *prefix)
+{
+	struct test_route *r = XCALLOC(MTYPE_TMP, sizeof(*r));
+	struct in_addr gw = { .s_addr = htonl(0xc0000201) };
+	struct prefix p;
+	rib_dest_t *dest;
+
+	str2prefix(prefix, &p);
+	r->rn = route_node_get(zvrf.table[AFI_IP][SAFI_UNICAST], &p);
+	dest = rib_dest_from_rnode(r->rn);
+	if (!dest) {
+		dest = XCALLOC(MTYPE_TMP, sizeof(*dest));
+		re_list_init(&dest->routes);
+		rnh_list_init(&dest->nht);
+		dest->rnode = r->rn;
+		r->rn->info = dest;
+	} else
+		route_unlock_node(r->rn);
+
+	r->nhe.nhg.nexthop = nexthop_from_ipv4(&gw, NULL, VRF_DEFAULT);
+	SET_FLAG(r->nhe.nhg.nexthop->flags, NEXTHOP_FLAG_ACTIVE);
+	r->re.type = ZEBRA_ROUTE_STATIC;
+	r->re.nhe = &r->nhe;
+	SET_FLAG(r->re.flags, ZEBRA_FLAG_SELECTED);
+	SET_FLAG(r->re.status, ROUTE_ENTRY_INSTALLED);
+	re_list_add_tail(&dest->routes, &r->re);
+
+	return r;
+}
+
+/* Withdraw a route; like rib_gc_dest() this re-evaluates and frees the
+ * dest unless it is the default route's.
+ */
+static void route_del(struct test_route *r)
+{
+	rib_dest_t *dest = rib_dest_from_rnode(r->rn);
+	struct rnh *rnh;
+
+	re_list_del(&dest->routes, &r->re);
+	nexthops_free(r->nhe.nhg.nexthop);
+
+	frr_each_safe (rnh_list, &dest->nht, rnh)
+		zebra_evaluate_rnh_entry(&zvrf, rnh, 0);
+
+	if (!is_default_prefix(&r->rn->p)) {
+		assert(!rnh_list_count(&dest->nht));
+		rnh_list_fini(&dest->nht);
+		re_list_fini(&dest->routes);
+		XFREE(MTYPE_TMP, dest);
+		r->rn->info = NULL;
+		route_unlock_node(r->rn);
+	}
+	XFREE(MTYPE_TMP, r);
+}
+
+/* Number of nht lists the rnh is on, and whether one of them is rn's */
+static unsigned int rnh_linked(struct rnh *rnh, struct route_node *rn,
+			       bool *on_rn)
+{
+	struct route_node *iter;
+	struct rnh *item;
+	unsigned int count = 0;
+
+	*on_rn = false;
+	for (iter = route_top(zvrf.table[AFI_IP][SAFI_UNICAST]); iter;
+	     iter = route_next(iter)) {
+		rib_dest_t *dest = rib_dest_from_rnode(iter);
+
+		if (!dest)
+			continue;
+		frr_each (rnh_list, &dest->nht, item) {
+			if (item != rnh)
+				continue;
+			count++;
+			if (iter == rn)
+				*on_rn = true;
+		}
+	}
+	return count;
+}
+
+static void assert_linked(struct rnh *rnh, struct test_route *r)
+{
+	bool on_rn;
+
+	assert(rnh_linked(rnh, r->rn, &on_rn) == 1);
+	assert(on_rn);
+	assert(prefix_same(&rnh->resolved_route, &r->rn->p));
+	assert(rnh->state);
+}
+
+/* Track a nexthop the way a pseudowire does */
+static struct rnh *rnh_add(struct zebra_pw *pw, const char *addr)
+{
+	bool exists;
+
+	pw->af = AF_INET;
+	inet_pton(AF_INET, addr, &pw->nexthop.ipv4);
+	zebra_register_rnh_pseudowire(VRF_DEFAULT, pw, &exists);
+	assert(pw->rnh && !exists);
+	return pw->rnh;
+}
+
+static void rnh_del(struct zebra_pw *pw)
+{
+	struct rnh *rnh = pw->rnh;
+	bool on_rn;
+
+	zebra_deregister_rnh_pseudowire(VRF_DEFAULT, pw);
+	assert(rnh_linked(rnh, NULL, &on_rn) == 0);
+}
+
+static void test_default_route(void)
+{
+	struct test_route *dflt, *r8;
+	struct zebra_pw pw = {};
+	struct rnh *rnh;
+	bool on_rn;
+
+	printf("Resolving over a default route added later...\n");
+	zvrf.zebra_rnh_ip_default_route = true;
+
+	/* No default route dest yet: the rnh cannot be put on a list */
+	rnh = rnh_add(&pw, "10.0.0.1");
+	assert(rnh_linked(rnh, NULL, &on_rn) == 0);
+	assert(!rnh->state);
+
+	/* It must end up on the default route's list once it resolves
+	 * over it, although its resolved route (0.0.0.0/0) does not change
+	 */
+	dflt = route_add("0.0.0.0/0");
+	zebra_evaluate_rnh(&zvrf, AFI_IP, 0, &rnh->node->p, SAFI_UNICAST);
+	assert_linked(rnh, dflt);
+
+	/* Moving to a more specific route and back */
+	r8 = route_add("10.0.0.0/8");
+	zebra_evaluate_rnh(&zvrf, AFI_IP, 0, &rnh->node->p, SAFI_UNICAST);
+	assert_linked(rnh, r8);
+	route_del(r8);
+	assert_linked(rnh, dflt);
+
+	rnh_del(&pw);
+
+	printf("Resolving over an existing default route...\n");
+	rnh = rnh_add(&pw, "10.0.0.2");
+	assert_linked(rnh, dflt);
+	rnh_del(&pw);
+
+	printf("Unresolved when default route resolution is off...\n");
+	zvrf.zebra_rnh_ip_default_route = false;
+	rnh = rnh_add(&pw, "10.0.0.3");
+	assert(!rnh->state);
+	/* unresolved rnh's are kept on the default route's list */
+	assert(rnh_linked(rnh, dflt->rn, &on_rn) == 1 && on_rn);
+
+	r8 = route_add("10.0.0.0/8");
+	zebra_evaluate_rnh(&zvrf, AFI_IP, 0, &rnh->node->p, SAFI_UNICAST);
+	assert_linked(rnh, r8);
+	rnh_del(&pw);
+
+	route_del(r8);
+	route_del(dflt);
+}
+
+int main(int argc, char **argv)
+{
+	strlcpy(vrf.name, VRF_DEFAULT_NAME, sizeof(vrf.name));
+	zvrf.table[AFI_IP][SAFI_UNICAST] = route_table_init();
+	zvrf.rnh_table[AFI_IP] = route_table_init();
+
+	test_default_route();
+
+	printf("Done.\n");
+	return 0;
+}
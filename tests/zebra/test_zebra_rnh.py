@@ -0,0 +1,12 @@
+import frrtest
+
+
+class TestZebraRnh(frrtest.TestMultiOut):
+    program = "./test_zebra_rnh"
+
+
+TestZebraRnh.onesimple("Resolving over a default route added later...")
+TestZebraRnh.onesimple("Resolving over an existing default route...")
+TestZebraRnh.onesimple("Unresolved when default route resolution is off...")
+TestZebraRnh.onesimple("Done.")
+TestZebraRnh.exit_cleanly()
@@ -14,6 +14,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <errno.h>
 #include <string.h>
@@ -31,6 +32,7 @@
 #include "lib/ns.h"
 #include "lib/frr_pthread.h"
 #include "lib/termtable.h"
+#include "lib/typesafe.h"
 #include "zebra/debug.h"
 #include "zebra/interface.h"
 #include "zebra/zebra_dplane.h"
@@ -45,6 +47,8 @@
 
 #include "zebra/dplane_fpm_nl_clippy.c"
 
+DEFINE_MTYPE_STATIC(ZEBRA, FPM_LOG, "FPM output log chunk");
+
 #define SOUTHBOUND_DEFAULT_ADDR INADDR_LOOPBACK
 
 /*
@@ -66,21 +70,136 @@
  */
 #define FPM_HEADER_SIZE 4
 
+/* Maximum number of FPM servers we can feed at the same time. */
+#define FPM_NL_MAX_CONNECTIONS 8
+
+/*
+ * Output log sizing: messages not yet written to every connected server
+ * may use up to FPM_LOG_MAX_BYTES.
+ */
+#define FPM_LOG_CHUNK_SIZE (NL_PKT_BUF_SIZE * 8)
+#define FPM_LOG_MAX_BYTES (NL_PKT_BUF_SIZE * 128)
+
+/* Maximum number of messages handed to a single writev() call. */
+#define FPM_WRITE_IOV_MAX 64
+
 static const char *prov_name = "dplane_fpm_nl";
 
-struct fpm_nl_ctx {
+/*
+ * Output log.
+ *
+ * Every encoded message is appended once to the log and written from there
+ * to each of the servers it is meant for, so a route update is encoded
+ * only once no matter how many servers are connected. Messages carry a
+ * sequence number and the mask of connections that should get them: live
+ * updates go to every connection, table walk replays only to the
+ * connections that are being resynchronized.
+ *
+ * Positions in the log are absolute byte offsets which never go backwards;
+ * the log is a list of chunks, each holding whole messages.
+ */
+struct fpm_log_msg {
+	uint64_t seq;
+	/* Length of the FPM framed data following this header. */
+	uint16_t len;
+	/* Connections this message is meant for. */
+	uint8_t mask;
+	uint8_t pad[5];
+
+	uint8_t data[];
+};
+
+#define FPM_LOG_MSG_SIZE(len)                                                  \
+	((sizeof(struct fpm_log_msg) + (len) + 7) & ~(size_t)7)
+
+PREDECL_DLIST(fpm_log_chunks);
+
+struct fpm_log_chunk {
+	struct fpm_log_chunks_item item;
+
+	/* Absolute offset of data[0]. */
+	uint64_t start;
+	/* Amount of data[] in use. */
+	size_t used;
+
+	uint8_t data[FPM_LOG_CHUNK_SIZE];
+};
+
+DECLARE_DLIST(fpm_log_chunks, struct fpm_log_chunk, item);
+
+struct fpm_nl_ctx;
+
+/* One FPM server connection. */
+struct fpm_nl_conn {
+	struct fpm_nl_ctx *fnc;
+	uint8_t idx;
+
 	/* data plane connection. */
+	bool configured;
 	int socket;
-	bool disabled;
 	bool connecting;
-	bool use_nhg;
-	bool use_route_replace;
 	struct sockaddr_storage addr;
 
-	/* data plane buffers. */
+	/* data plane input buffer. */
 	struct stream *ibuf;
-	struct stream *obuf;
-	pthread_mutex_t obuf_mutex;
+
+	/*
+	 * Output log state, protected by the log mutex: the next message to
+	 * be written, how much of it was written already and the sequence
+	 * number of the last message completely written to the socket.
+	 */
+	uint64_t pos;
+	size_t msg_off;
+	uint64_t seq_sent;
+
+	/* Whether this server has been sent a full table walk. */
+	bool synced;
+
+	/* data plane events. */
+	struct event *t_event;
+	struct event *t_connect;
+	struct event *t_read;
+	struct event *t_write;
+
+	/* Statistic counters. */
+	struct {
+		/* Amount of bytes read into ibuf. */
+		_Atomic uint32_t bytes_read;
+		/* Amount of bytes written. */
+		_Atomic uint32_t bytes_sent;
+
+		/* Amount of connection closes. */
+		_Atomic uint32_t connection_closes;
+		/* Amount of connection errors. */
+		_Atomic uint32_t connection_errors;
+	} counters;
+};
+
+struct fpm_nl_ctx {
+	bool use_nhg;
+	bool use_route_replace;
+
+	/* FPM servers. */
+	struct fpm_nl_conn conns[FPM_NL_MAX_CONNECTIONS];
+
+	/* Output log; see struct fpm_log_msg. */
+	pthread_mutex_t log_mutex;
+	struct fpm_log_chunks_head log;
+	uint64_t log_seq;
+	uint64_t log_start;
+	uint64_t log_end;
+
+	/*
+	 * Connection masks, protected by the log mutex:
+	 * - established: connected and writable;
+	 * - walk/walk_pending: getting (or waiting for) a full table walk.
+	 * live_mask is the set of connections live updates are logged for,
+	 * readable without the lock.
+	 */
+	uint32_t established;
+	uint32_t walk_mask;
+	uint32_t walk_pending;
+	_Atomic uint32_t live_mask;
 
 	/*
 	 * data plane context queue:
@@ -93,9 +212,6 @@ struct fpm_nl_ctx {
 	/* data plane events. */
 	struct zebra_dplane_provider *prov;
 	struct frr_pthread *fthread;
-	struct event *t_connect;
-	struct event *t_read;
-	struct event *t_write;
 	struct event *t_event;
 	struct event *t_nhg;
 	struct event *t_dequeue;
@@ -113,20 +229,11 @@ struct fpm_nl_ctx {
 
 	/* Statistic counters. */
 	struct {
-		/* Amount of bytes read into ibuf. */
-		_Atomic uint32_t bytes_read;
-		/* Amount of bytes written from obuf. */
-		_Atomic uint32_t bytes_sent;
-		/* Output buffer current usage. */
+		/* Output log bytes not yet written to every server. */
 		_Atomic uint32_t obuf_bytes;
-		/* Output buffer peak usage. */
+		/* Output log peak usage. */
 		_Atomic uint32_t obuf_peak;
 
-		/* Amount of connection closes. */
-		_Atomic uint32_t connection_closes;
-		/* Amount of connection errors. */
-		_Atomic uint32_t connection_errors;
-
 		/* Amount of user configurations: FNE_RECONNECT. */
 		_Atomic uint32_t user_configures;
 		/* Amount of user disable requests: FNE_DISABLE. */
@@ -139,6 +246,9 @@ struct fpm_nl_ctx {
 
 		/* Amount of buffer full events. */
 		_Atomic uint32_t buffer_full;
+
+		/* Amount of full table walks sent to a server. */
+		_Atomic uint32_t full_resyncs;
 	} counters;
 } *gfnc;
 
@@ -164,19 +274,27 @@ enum fpm_nl_events {
 	FNE_RMAC_FINISHED,
 };
 
-#define FPM_RECONNECT(fnc)                                                     \
-	event_add_event((fnc)->fthread->master, fpm_process_event, (fnc),      \
-			FNE_INTERNAL_RECONNECT, &(fnc)->t_event)
+#define FPM_RECONNECT(conn)                                                    \
+	event_add_event((conn)->fnc->fthread->master, fpm_process_conn_event,  \
+			(conn), FNE_INTERNAL_RECONNECT, &(conn)->t_event)
 
 #define WALK_FINISH(fnc, ev)                                                   \
 	event_add_event((fnc)->fthread->master, fpm_process_event, (fnc),      \
 			(ev), NULL)
 
+#define FPM_CONN_BIT(conn) (1U << (conn)->idx)
+
+#define frr_each_fpm_conn(fnc, conn)                                           \
+	for ((conn) = &(fnc)->conns[0];                                        \
+	     (conn) < &(fnc)->conns[FPM_NL_MAX_CONNECTIONS]; (conn)++)
+
 /*
  * Prototypes.
  */
 static void fpm_process_event(struct event *t);
-static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx);
+static void fpm_process_conn_event(struct event *t);
+static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx,
+			  bool walk);
 static void fpm_lsp_send(struct event *t);
 static void fpm_lsp_reset(struct event *t);
 static void fpm_nhg_send(struct event *t);
@@ -191,28 +309,48 @@ static void fpm_rmac_reset(struct event *t);
  */
 #define FPM_STR "Forwarding Plane Manager configuration\n"
 
-DEFUN(fpm_set_address, fpm_set_address_cmd,
-      "fpm address <A.B.C.D|X:X::X:X> [port (1-65535)]",
-      FPM_STR
-      "FPM remote listening server address\n"
-      "Remote IPv4 FPM server\n"
-      "Remote IPv6 FPM server\n"
-      "FPM remote listening server port\n"
-      "Remote FPM server port\n")
+static const char *fpm_conn_addr2str(const struct fpm_nl_conn *conn, char *buf,
+				     size_t buflen, uint16_t *port)
+{
+	const struct sockaddr_in *sin;
+	const struct sockaddr_in6 *sin6;
+
+	switch (conn->addr.ss_family) {
+	case AF_INET:
+		sin = (const struct sockaddr_in *)&conn->addr;
+		snprintfrr(buf, buflen, "%pI4", &sin->sin_addr);
+		*port = ntohs(sin->sin_port);
+		break;
+	case AF_INET6:
+		sin6 = (const struct sockaddr_in6 *)&conn->addr;
+		snprintfrr(buf, buflen, "%pI6", &sin6->sin6_addr);
+		*port = ntohs(sin6->sin6_port);
+		break;
+	default:
+		strlcpy(buf, "Unknown", buflen);
+		*port = FPM_DEFAULT_PORT;
+		break;
+	}
+
+	return buf;
+}
+
+/*
+ * Parse a CLI address/port into a socket address; returns false if the
+ * address is not valid.
+ */
+static bool fpm_parse_addr(struct sockaddr_storage *ss, const char *addr,
+			   uint16_t port)
 {
 	struct sockaddr_in *sin;
 	struct sockaddr_in6 *sin6;
-	uint16_t port = 0;
 	uint8_t naddr[INET6_BUFSIZ];
 
-	if (argc == 5)
-		port = strtol(argv[4]->arg, NULL, 10);
+	memset(ss, 0, sizeof(*ss));
 
 	/* Handle IPv4 addresses. */
-	if (inet_pton(AF_INET, argv[2]->arg, naddr) == 1) {
-		sin = (struct sockaddr_in *)&gfnc->addr;
-
-		memset(sin, 0, sizeof(*sin));
+	if (inet_pton(AF_INET, addr, naddr) == 1) {
+		sin = (struct sockaddr_in *)ss;
 		sin->sin_family = AF_INET;
 		sin->sin_port =
 			port ? htons(port) : htons(FPM_DEFAULT_PORT);
@@ -220,33 +358,88 @@ DEFUN(fpm_set_address, fpm_set_address_cmd,
 		sin->sin_len = sizeof(*sin);
 #endif /* HAVE_STRUCT_SOCKADDR_SA_LEN */
 		memcpy(&sin->sin_addr, naddr, sizeof(sin->sin_addr));
-
-		goto ask_reconnect;
+		return true;
 	}
 
 	/* Handle IPv6 addresses. */
-	if (inet_pton(AF_INET6, argv[2]->arg, naddr) != 1) {
-		vty_out(vty, "%% Invalid address: %s\n", argv[2]->arg);
-		return CMD_WARNING;
-	}
+	if (inet_pton(AF_INET6, addr, naddr) != 1)
+		return false;
 
-	sin6 = (struct sockaddr_in6 *)&gfnc->addr;
-	memset(sin6, 0, sizeof(*sin6));
+	sin6 = (struct sockaddr_in6 *)ss;
 	sin6->sin6_family = AF_INET6;
 	sin6->sin6_port = port ? htons(port) : htons(FPM_DEFAULT_PORT);
 #ifdef HAVE_STRUCT_SOCKADDR_SA_LEN
 	sin6->sin6_len = sizeof(*sin6);
 #endif /* HAVE_STRUCT_SOCKADDR_SA_LEN */
 	memcpy(&sin6->sin6_addr, naddr, sizeof(sin6->sin6_addr));
+	return true;
+}
 
-ask_reconnect:
-	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
-			FNE_RECONNECT, &gfnc->t_event);
+static struct fpm_nl_conn *fpm_conn_find(struct fpm_nl_ctx *fnc,
+					 const struct sockaddr_storage *ss)
+{
+	struct fpm_nl_conn *conn;
+	size_t len;
+
+	len = ss->ss_family == AF_INET ? sizeof(struct sockaddr_in)
+				       : sizeof(struct sockaddr_in6);
+
+	frr_each_fpm_conn (fnc, conn) {
+		if (!conn->configured)
+			continue;
+		if (memcmp(&conn->addr, ss, len) == 0)
+			return conn;
+	}
+
+	return NULL;
+}
+
+DEFUN(fpm_set_address, fpm_set_address_cmd,
+      "fpm address <A.B.C.D|X:X::X:X> [port (1-65535)]",
+      FPM_STR
+      "FPM remote listening server address\n"
+      "Remote IPv4 FPM server\n"
+      "Remote IPv6 FPM server\n"
+      "FPM remote listening server port\n"
+      "Remote FPM server port\n")
+{
+	struct sockaddr_storage ss;
+	struct fpm_nl_conn *conn;
+	uint16_t port = 0;
+
+	if (argc == 5)
+		port = strtol(argv[4]->arg, NULL, 10);
+
+	if (!fpm_parse_addr(&ss, argv[2]->arg, port)) {
+		vty_out(vty, "%% Invalid address: %s\n", argv[2]->arg);
+		return CMD_WARNING;
+	}
+
+	/* Known server: just ask for a reconnection. */
+	conn = fpm_conn_find(gfnc, &ss);
+	if (conn == NULL) {
+		frr_each_fpm_conn (gfnc, conn) {
+			if (!conn->configured)
+				break;
+		}
+
+		if (conn == &gfnc->conns[FPM_NL_MAX_CONNECTIONS]) {
+			vty_out(vty, "%% Maximum of %d FPM servers reached\n",
+				FPM_NL_MAX_CONNECTIONS);
+			return CMD_WARNING;
+		}
+
+		conn->addr = ss;
+		conn->configured = true;
+	}
+
+	event_add_event(gfnc->fthread->master, fpm_process_conn_event, conn,
+			FNE_RECONNECT, &conn->t_event);
 	return CMD_SUCCESS;
 }
 
 DEFUN(no_fpm_set_address, no_fpm_set_address_cmd,
-      "no fpm address [<A.B.C.D|X:X::X:X> [port <1-65535>]]",
+      "no fpm address [<A.B.C.D|X:X::X:X> [port (1-65535)]]",
       NO_STR
       FPM_STR
       "FPM remote listening server address\n"
@@ -255,8 +448,31 @@ DEFUN(no_fpm_set_address, no_fpm_set_address_cmd,
       "FPM remote listening server port\n"
       "Remote FPM server port\n")
 {
-	event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
-			FNE_DISABLE, &gfnc->t_event);
+	struct sockaddr_storage ss;
+	struct fpm_nl_conn *conn;
+	uint16_t port = 0;
+
+	/* Without an address, disable all servers. */
+	if (argc < 4) {
+		event_add_event(gfnc->fthread->master, fpm_process_event, gfnc,
+				FNE_DISABLE, &gfnc->t_event);
+		return CMD_SUCCESS;
+	}
+
+	if (argc == 6)
+		port = strtol(argv[5]->arg, NULL, 10);
+
+	if (!fpm_parse_addr(&ss, argv[3]->arg, port)) {
+		vty_out(vty, "%% Invalid address: %s\n", argv[3]->arg);
+		return CMD_WARNING;
+	}
+
+	conn = fpm_conn_find(gfnc, &ss);
+	if (conn == NULL)
+		return CMD_SUCCESS;
+
+	event_add_event(gfnc->fthread->master, fpm_process_conn_event, conn,
+			FNE_DISABLE, &conn->t_event);
 	return CMD_SUCCESS;
 }
 
@@ -326,32 +542,34 @@ DEFPY(fpm_show_status,
       "show fpm status [json]$json",
       SHOW_STR FPM_STR "FPM status\n" JSON_STR)
 {
-	struct json_object *j;
-	bool connected;
-	uint16_t port;
-	struct sockaddr_in *sin;
-	struct sockaddr_in6 *sin6;
+	struct json_object *j, *jconns = NULL, *jconn;
+	struct fpm_nl_conn *conn, *first = NULL;
+	bool connected, disabled = true;
+	uint32_t established;
+	uint16_t port = FPM_DEFAULT_PORT;
 	char buf[BUFSIZ];
 
-	connected = gfnc->socket > 0 ? true : false;
+	established = atomic_load_explicit(&gfnc->live_mask,
+					   memory_order_relaxed);
+	frr_each_fpm_conn (gfnc, conn) {
+		if (!conn->configured)
+			continue;
 
-	switch (gfnc->addr.ss_family) {
-	case AF_INET:
-		sin = (struct sockaddr_in *)&gfnc->addr;
-		snprintfrr(buf, sizeof(buf), "%pI4", &sin->sin_addr);
-		port = ntohs(sin->sin_port);
-		break;
-	case AF_INET6:
-		sin6 = (struct sockaddr_in6 *)&gfnc->addr;
-		snprintfrr(buf, sizeof(buf), "%pI6", &sin6->sin6_addr);
-		port = ntohs(sin6->sin6_port);
-		break;
-	default:
-		strlcpy(buf, "Unknown", sizeof(buf));
-		port = FPM_DEFAULT_PORT;
-		break;
+		disabled = false;
+		if (first == NULL)
+			first = conn;
 	}
 
+	connected = false;
+	frr_each_fpm_conn (gfnc, conn)
+		if (conn->configured && conn->socket > 0 && !conn->connecting)
+			connected = true;
+
+	if (first)
+		fpm_conn_addr2str(first, buf, sizeof(buf), &port);
+	else
+		strlcpy(buf, "Unknown", sizeof(buf));
+
 	if (json) {
 		j = json_object_new_object();
 
@@ -359,10 +577,35 @@ DEFPY(fpm_show_status,
 		json_object_boolean_add(j, "useNHG", gfnc->use_nhg);
 		json_object_boolean_add(j, "useRouteReplace",
 					gfnc->use_route_replace);
-		json_object_boolean_add(j, "disabled", gfnc->disabled);
+		json_object_boolean_add(j, "disabled", disabled);
 		json_object_string_add(j, "address", buf);
 		json_object_int_add(j, "port", port);
 
+		frr_each_fpm_conn (gfnc, conn) {
+			if (!conn->configured)
+				continue;
+
+			if (jconns == NULL)
+				jconns = json_object_new_array();
+
+			fpm_conn_addr2str(conn, buf, sizeof(buf), &port);
+			jconn = json_object_new_object();
+			json_object_string_add(jconn, "address", buf);
+			json_object_int_add(jconn, "port", port);
+			json_object_boolean_add(jconn, "connected",
+						conn->socket > 0 &&
+							!conn->connecting);
+			json_object_boolean_add(jconn, "synced", conn->synced);
+			json_object_boolean_add(jconn, "live",
+						!!(established &
+						   FPM_CONN_BIT(conn)));
+			json_object_int_add(jconn, "lastSequence",
+					    conn->seq_sent);
+			json_object_array_add(jconns, jconn);
+		}
+		if (jconns)
+			json_object_object_add(j, "connections", jconns);
+
 		vty_json(vty, j);
 	} else {
 		struct ttable *table = ttable_new(&ttable_styles[TTSTYLE_BLANK]);
@@ -376,8 +619,32 @@ DEFPY(fpm_show_status,
 			       gfnc->use_nhg ? "Yes" : "No");
 		ttable_add_row(table, "Use Route Replace Semantics|%s",
 			       gfnc->use_route_replace ? "Yes" : "No");
-		ttable_add_row(table, "Disabled|%s",
-			       gfnc->disabled ? "Yes" : "No");
+		ttable_add_row(table, "Disabled|%s", disabled ? "Yes" : "No");
+
+		out = ttable_dump(table, "\n");
+		vty_out(vty, "%s\n", out);
+		XFREE(MTYPE_TMP_TTABLE, out);
+
+		ttable_del(table);
+
+		if (first == NULL)
+			return CMD_SUCCESS;
+
+		table = ttable_new(&ttable_styles[TTSTYLE_BLANK]);
+		ttable_add_row(table, "Server|Port|Connected|Synced|Sequence");
+		ttable_rowseps(table, 0, BOTTOM, true, '-');
+		frr_each_fpm_conn (gfnc, conn) {
+			if (!conn->configured)
+				continue;
+
+			fpm_conn_addr2str(conn, buf, sizeof(buf), &port);
+			ttable_add_row(table, "%s|%u|%s|%s|%" PRIu64, buf, port,
+				       conn->socket > 0 && !conn->connecting
+					       ? "Yes"
+					       : "No",
+				       conn->synced ? "Yes" : "No",
+				       conn->seq_sent);
+		}
 
 		out = ttable_dump(table, "\n");
 		vty_out(vty, "%s\n", out);
@@ -389,6 +656,25 @@ DEFPY(fpm_show_status,
 	return CMD_SUCCESS;
 }
 
+/* Sum of a per-connection counter over all servers. */
+static uint32_t fpm_conn_counter_sum(struct fpm_nl_ctx *fnc, size_t offset)
+{
+	struct fpm_nl_conn *conn;
+	_Atomic uint32_t *counter;
+	uint32_t sum = 0;
+
+	frr_each_fpm_conn (fnc, conn) {
+		counter = (_Atomic uint32_t *)((char *)conn + offset);
+		sum += atomic_load_explicit(counter, memory_order_relaxed);
+	}
+
+	return sum;
+}
+
+#define FPM_CONN_COUNTER(fnc, counter)                                         \
+	fpm_conn_counter_sum((fnc),                                            \
+			     offsetof(struct fpm_nl_conn, counters.counter))
+
 DEFUN(fpm_show_counters, fpm_show_counters_cmd,
       "show fpm counters",
       SHOW_STR
@@ -406,12 +692,14 @@ DEFUN(fpm_show_counters, fpm_show_counters_cmd,
 #define SHOW_COUNTER(label, counter) \
 	vty_out(vty, "%28s: %u\n", (label), (counter))
 
-	SHOW_COUNTER("Input bytes", gfnc->counters.bytes_read);
-	SHOW_COUNTER("Output bytes", gfnc->counters.bytes_sent);
+	SHOW_COUNTER("Input bytes", FPM_CONN_COUNTER(gfnc, bytes_read));
+	SHOW_COUNTER("Output bytes", FPM_CONN_COUNTER(gfnc, bytes_sent));
 	SHOW_COUNTER("Output buffer current size", gfnc->counters.obuf_bytes);
 	SHOW_COUNTER("Output buffer peak size", gfnc->counters.obuf_peak);
-	SHOW_COUNTER("Connection closes", gfnc->counters.connection_closes);
-	SHOW_COUNTER("Connection errors", gfnc->counters.connection_errors);
+	SHOW_COUNTER("Connection closes",
+		     FPM_CONN_COUNTER(gfnc, connection_closes));
+	SHOW_COUNTER("Connection errors",
+		     FPM_CONN_COUNTER(gfnc, connection_errors));
 	SHOW_COUNTER("Data plane items processed",
 		     gfnc->counters.dplane_contexts);
 	SHOW_COUNTER("Data plane items enqueued", curr_queue_len);
@@ -420,6 +708,7 @@ DEFUN(fpm_show_counters, fpm_show_counters_cmd,
 	SHOW_COUNTER("Buffer full hits", gfnc->counters.buffer_full);
 	SHOW_COUNTER("User FPM configurations", gfnc->counters.user_configures);
 	SHOW_COUNTER("User FPM disable requests", gfnc->counters.user_disables);
+	SHOW_COUNTER("Full resyncs", gfnc->counters.full_resyncs);
 
 #undef SHOW_COUNTER
 
@@ -442,14 +731,16 @@ DEFUN(fpm_show_counters_json, fpm_show_counters_json_cmd,
 	struct json_object *jo;
 
 	jo = json_object_new_object();
-	json_object_int_add(jo, "bytes-read", gfnc->counters.bytes_read);
-	json_object_int_add(jo, "bytes-sent", gfnc->counters.bytes_sent);
+	json_object_int_add(jo, "bytes-read",
+			    FPM_CONN_COUNTER(gfnc, bytes_read));
+	json_object_int_add(jo, "bytes-sent",
+			    FPM_CONN_COUNTER(gfnc, bytes_sent));
 	json_object_int_add(jo, "obuf-bytes", gfnc->counters.obuf_bytes);
 	json_object_int_add(jo, "obuf-bytes-peak", gfnc->counters.obuf_peak);
 	json_object_int_add(jo, "connection-closes",
-			    gfnc->counters.connection_closes);
+			    FPM_CONN_COUNTER(gfnc, connection_closes));
 	json_object_int_add(jo, "connection-errors",
-			    gfnc->counters.connection_errors);
+			    FPM_CONN_COUNTER(gfnc, connection_errors));
 	json_object_int_add(jo, "data-plane-contexts",
 			    gfnc->counters.dplane_contexts);
 	json_object_int_add(jo, "data-plane-contexts-queue", curr_queue_len);
@@ -459,6 +750,7 @@ DEFUN(fpm_show_counters_json, fpm_show_counters_json_cmd,
 	json_object_int_add(jo, "user-configures",
 			    gfnc->counters.user_configures);
 	json_object_int_add(jo, "user-disables", gfnc->counters.user_disables);
+	json_object_int_add(jo, "full-resyncs", gfnc->counters.full_resyncs);
 	vty_json(vty, jo);
 
 	return CMD_SUCCESS;
@@ -466,37 +758,45 @@ DEFUN(fpm_show_counters_json, fpm_show_counters_json_cmd,
 
 static int fpm_write_config(struct vty *vty)
 {
+	struct fpm_nl_conn *conn;
 	struct sockaddr_in *sin;
 	struct sockaddr_in6 *sin6;
 	int written = 0;
 
-	if (gfnc->disabled)
-		return written;
-
-	switch (gfnc->addr.ss_family) {
-	case AF_INET:
-		written = 1;
-		sin = (struct sockaddr_in *)&gfnc->addr;
-		vty_out(vty, "fpm address %pI4", &sin->sin_addr);
-		if (sin->sin_port != htons(FPM_DEFAULT_PORT))
-			vty_out(vty, " port %d", ntohs(sin->sin_port));
+	frr_each_fpm_conn (gfnc, conn) {
+		if (!conn->configured)
+			continue;
 
-		vty_out(vty, "\n");
-		break;
-	case AF_INET6:
-		written = 1;
-		sin6 = (struct sockaddr_in6 *)&gfnc->addr;
-		vty_out(vty, "fpm address %pI6", &sin6->sin6_addr);
-		if (sin6->sin6_port != htons(FPM_DEFAULT_PORT))
-			vty_out(vty, " port %d", ntohs(sin6->sin6_port));
+		switch (conn->addr.ss_family) {
+		case AF_INET:
+			written = 1;
+			sin = (struct sockaddr_in *)&conn->addr;
+			vty_out(vty, "fpm address %pI4", &sin->sin_addr);
+			if (sin->sin_port != htons(FPM_DEFAULT_PORT))
+				vty_out(vty, " port %d", ntohs(sin->sin_port));
 
-		vty_out(vty, "\n");
-		break;
+			vty_out(vty, "\n");
+			break;
+		case AF_INET6:
+			written = 1;
+			sin6 = (struct sockaddr_in6 *)&conn->addr;
+			vty_out(vty, "fpm address %pI6", &sin6->sin6_addr);
+			if (sin6->sin6_port != htons(FPM_DEFAULT_PORT))
+				vty_out(vty, " port %d",
+					ntohs(sin6->sin6_port));
+
+			vty_out(vty, "\n");
+			break;
 
-	default:
-		break;
+		default:
+			break;
+		}
 	}
 
+	/* Nothing else to write when FPM is disabled. */
+	if (!written)
+		return written;
+
 	if (!gfnc->use_nhg) {
 		vty_out(vty, "no fpm use-next-hop-groups\n");
 		written = 1;
@@ -518,13 +818,254 @@ static struct cmd_node fpm_node = {
 };
 
 /*
- * FPM functions.
+ * Output log functions. Unless noted otherwise, these must be called with
+ * the log mutex held.
  */
-static void fpm_connect(struct event *t);
 
-static void fpm_reconnect(struct fpm_nl_ctx *fnc)
+/* Oldest log position still needed by a connected server. */
+static uint64_t fpm_log_needed_pos(const struct fpm_nl_ctx *fnc)
+{
+	const struct fpm_nl_conn *conn;
+	uint64_t pos = fnc->log_end;
+
+	frr_each_fpm_conn (fnc, conn) {
+		if (!CHECK_FLAG(fnc->established, FPM_CONN_BIT(conn)))
+			continue;
+
+		if (conn->pos < pos)
+			pos = conn->pos;
+	}
+
+	return pos;
+}
+
+static void fpm_log_update_live_mask(struct fpm_nl_ctx *fnc)
+{
+	atomic_store_explicit(&fnc->live_mask, fnc->established,
+			      memory_order_relaxed);
+}
+
+static void fpm_log_update_counters(struct fpm_nl_ctx *fnc)
+{
+	uint32_t obytes, obytes_peak;
+
+	obytes = fnc->log_end - fpm_log_needed_pos(fnc);
+	atomic_store_explicit(&fnc->counters.obuf_bytes, obytes,
+			      memory_order_relaxed);
+
+	obytes_peak = atomic_load_explicit(&fnc->counters.obuf_peak,
+					   memory_order_relaxed);
+	if (obytes_peak < obytes)
+		atomic_store_explicit(&fnc->counters.obuf_peak, obytes,
+				      memory_order_relaxed);
+}
+
+/* Release the log chunks that no connected server needs anymore. */
+static void fpm_log_trim(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_log_chunk *chunk, *next;
+	uint64_t needed;
+
+	needed = fpm_log_needed_pos(fnc);
+
+	while ((chunk = fpm_log_chunks_first(&fnc->log)) != NULL) {
+		/* Always keep the chunk we are appending to. */
+		next = fpm_log_chunks_next(&fnc->log, chunk);
+		if (next == NULL)
+			break;
+
+		/* Still being written to somebody. */
+		if (next->start > needed)
+			break;
+
+		fpm_log_chunks_del(&fnc->log, chunk);
+		XFREE(MTYPE_FPM_LOG, chunk);
+		fnc->log_start = next->start;
+	}
+}
+
+/* Find the chunk holding a log position. */
+static struct fpm_log_chunk *fpm_log_chunk_find(struct fpm_nl_ctx *fnc,
+						uint64_t pos)
+{
+	struct fpm_log_chunk *chunk;
+
+	/* Servers are mostly close to the end of the log. */
+	frr_rev_each (fpm_log_chunks, &fnc->log, chunk) {
+		if (chunk->start <= pos)
+			return chunk;
+	}
+
+	return NULL;
+}
+
+static void fpm_write(struct event *t);
+
+/**
+ * Append a netlink message to the output log.
+ *
+ * @param fnc the netlink FPM context.
+ * @param mask the connections that should get this message.
+ * @param nl_buf the netlink message.
+ * @param nl_buf_len the netlink message length.
+ * @return 0 on success or -1 on not enough space.
+ */
+static int fpm_log_append(struct fpm_nl_ctx *fnc, uint32_t mask,
+			  const uint8_t *nl_buf, size_t nl_buf_len)
+{
+	struct fpm_log_chunk *chunk;
+	struct fpm_log_msg *msg;
+	struct fpm_nl_conn *conn;
+	size_t len = nl_buf_len + FPM_HEADER_SIZE;
+	size_t need = FPM_LOG_MSG_SIZE(len);
+	uint64_t pending;
+	uint16_t msg_len;
+
+	/* Check if we have enough buffer space. */
+	pending = fnc->log_end - fpm_log_needed_pos(fnc);
+	if (pending + need > FPM_LOG_MAX_BYTES) {
+		atomic_fetch_add_explicit(&fnc->counters.buffer_full, 1,
+					  memory_order_relaxed);
+
+		if (IS_ZEBRA_DEBUG_FPM)
+			zlog_debug(
+				"%s: buffer full: wants to write %zu but has %" PRIu64,
+				__func__, need, FPM_LOG_MAX_BYTES - pending);
+
+		return -1;
+	}
+
+	chunk = fpm_log_chunks_last(&fnc->log);
+	if (chunk == NULL || chunk->used + need > sizeof(chunk->data)) {
+		fpm_log_trim(fnc);
+
+		chunk = XCALLOC(MTYPE_FPM_LOG, sizeof(*chunk));
+		chunk->start = fnc->log_end;
+		if (fpm_log_chunks_count(&fnc->log) == 0)
+			fnc->log_start = chunk->start;
+
+		fpm_log_chunks_add_tail(&fnc->log, chunk);
+	}
+
+	msg = (struct fpm_log_msg *)&chunk->data[chunk->used];
+	msg->seq = ++fnc->log_seq;
+	msg->len = len;
+	msg->mask = mask;
+
+	/*
+	 * Fill in the FPM header information.
+	 *
+	 * See FPM_HEADER_SIZE definition for more information.
+	 */
+	msg_len = htons(len);
+	msg->data[0] = 1;
+	msg->data[1] = 1;
+	memcpy(&msg->data[2], &msg_len, sizeof(msg_len));
+
+	/* Write current data. */
+	memcpy(&msg->data[FPM_HEADER_SIZE], nl_buf, nl_buf_len);
+
+	chunk->used += need;
+	fnc->log_end += need;
+
+	fpm_log_update_counters(fnc);
+
+	/* Tell the connections to start writing. */
+	frr_each_fpm_conn (fnc, conn) {
+		if (!CHECK_FLAG(mask & fnc->established, FPM_CONN_BIT(conn)))
+			continue;
+
+		event_add_write(fnc->fthread->master, fpm_write, conn,
+				conn->socket, &conn->t_write);
+	}
+
+	return 0;
+}
+
+/*
+ * Move a server's log position forward by the amount of bytes just
+ * written, skipping messages that are not meant for it.
+ */
+static void fpm_conn_advance(struct fpm_nl_conn *conn, size_t written)
+{
+	struct fpm_nl_ctx *fnc = conn->fnc;
+	struct fpm_log_chunk *chunk;
+	struct fpm_log_msg *msg;
+	size_t left;
+
+	chunk = fpm_log_chunk_find(fnc, conn->pos);
+	while (chunk) {
+		if (conn->pos >= chunk->start + chunk->used) {
+			chunk = fpm_log_chunks_next(&fnc->log, chunk);
+			continue;
+		}
+
+		msg = (struct fpm_log_msg *)&chunk->data[conn->pos -
+							 chunk->start];
+		if (CHECK_FLAG(msg->mask, FPM_CONN_BIT(conn))) {
+			if (written == 0)
+				break;
+
+			left = msg->len - conn->msg_off;
+			if (written < left) {
+				conn->msg_off += written;
+				break;
+			}
+
+			written -= left;
+			conn->msg_off = 0;
+		}
+
+		conn->pos += FPM_LOG_MSG_SIZE(msg->len);
+		conn->seq_sent = msg->seq;
+	}
+}
+
+/*
+ * Table walks: a walk replays all FPM objects to the servers in the walk
+ * mask. Servers that connect while a walk is running wait for the next
+ * one.
+ */
+static void fpm_walk_start(struct fpm_nl_ctx *fnc)
+{
+	if (fnc->walk_mask || !fnc->walk_pending)
+		return;
+
+	fnc->walk_mask = fnc->walk_pending;
+	fnc->walk_pending = 0;
+
+	/*
+	 * Starting with LSPs walk all FPM objects, marking them
+	 * as unsent and then replaying them.
+	 */
+	event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
+			&fnc->t_lspreset);
+}
+
+/* Called in the FPM pthread, without the log mutex. */
+static void fpm_walk_finish(struct fpm_nl_ctx *fnc)
+{
+	struct fpm_nl_conn *conn;
+
+	frr_with_mutex (&fnc->log_mutex) {
+		frr_each_fpm_conn (fnc, conn) {
+			if (!CHECK_FLAG(fnc->walk_mask & fnc->established,
+					FPM_CONN_BIT(conn)))
+				continue;
+
+			conn->synced = true;
+			atomic_fetch_add_explicit(&fnc->counters.full_resyncs,
+						  1, memory_order_relaxed);
+		}
+
+		fnc->walk_mask = 0;
+		fpm_walk_start(fnc);
+	}
+}
+
+/* Stop a running walk; called without the log mutex, which walks take. */
+static void fpm_walk_cancel(struct fpm_nl_ctx *fnc)
 {
-	/* Cancel all zebra threads first. */
 	event_cancel_async(zrouter.master, &fnc->t_lspreset, NULL);
 	event_cancel_async(zrouter.master, &fnc->t_lspwalk, NULL);
 	event_cancel_async(zrouter.master, &fnc->t_nhgreset, NULL);
@@ -533,35 +1074,95 @@ static void fpm_reconnect(struct fpm_nl_ctx *fnc)
 	event_cancel_async(zrouter.master, &fnc->t_ribwalk, NULL);
 	event_cancel_async(zrouter.master, &fnc->t_rmacreset, NULL);
 	event_cancel_async(zrouter.master, &fnc->t_rmacwalk, NULL);
+}
 
-	/*
-	 * Grab the lock to empty the streams (data plane might try to
-	 * enqueue updates while we are closing).
-	 */
-	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
+/*
+ * FPM functions.
+ */
+static void fpm_connect(struct event *t);
+
+/*
+ * A server connection is up: schedule a full table walk for it.
+ *
+ * This is done on every connection, reconnections included. What zebra
+ * wrote to the socket before the connection went down may never have
+ * reached the server, and a server that restarted has no state at all;
+ * the FPM protocol has no way for the server to tell what it applied.
+ */
+static void fpm_conn_established(struct fpm_nl_conn *conn)
+{
+	struct fpm_nl_ctx *fnc = conn->fnc;
+	uint32_t bit = FPM_CONN_BIT(conn);
+
+	frr_with_mutex (&fnc->log_mutex) {
+		SET_FLAG(fnc->established, bit);
+		conn->msg_off = 0;
+		conn->synced = false;
+		conn->pos = fnc->log_end;
+
+		SET_FLAG(fnc->walk_pending, bit);
+		fpm_walk_start(fnc);
+
+		fpm_log_update_live_mask(fnc);
+	}
+}
+
+static void fpm_conn_reset(struct fpm_nl_conn *conn)
+{
+	struct fpm_nl_ctx *fnc = conn->fnc;
+	uint32_t bit = FPM_CONN_BIT(conn);
+	bool walk_stopped = false;
+
+	frr_with_mutex (&fnc->log_mutex) {
+		UNSET_FLAG(fnc->established, bit);
+		UNSET_FLAG(fnc->walk_pending, bit);
+		if (CHECK_FLAG(fnc->walk_mask, bit)) {
+			UNSET_FLAG(fnc->walk_mask, bit);
+			walk_stopped = (fnc->walk_mask == 0);
+		}
+
+		/* It will get a full walk when it comes back. */
+		conn->synced = false;
+		conn->msg_off = 0;
+
+		fpm_log_trim(fnc);
+		fpm_log_update_counters(fnc);
+		fpm_log_update_live_mask(fnc);
+	}
+
+	/* Nobody is waiting for the walk anymore: stop it. */
+	if (walk_stopped) {
+		fpm_walk_cancel(fnc);
+
+		frr_with_mutex (&fnc->log_mutex) {
+			fnc->walk_mask = 0;
+			fpm_walk_start(fnc);
+		}
+	}
 
 	/* Avoid calling close on `-1`. */
-	if (fnc->socket != -1) {
-		close(fnc->socket);
-		fnc->socket = -1;
+	if (conn->socket != -1) {
+		close(conn->socket);
+		conn->socket = -1;
 	}
 
-	stream_reset(fnc->ibuf);
-	stream_reset(fnc->obuf);
-	EVENT_OFF(fnc->t_read);
-	EVENT_OFF(fnc->t_write);
+	stream_reset(conn->ibuf);
+	EVENT_OFF(conn->t_read);
+	EVENT_OFF(conn->t_write);
 
-	/* FPM is disabled, don't attempt to connect. */
-	if (fnc->disabled)
+	/* Server is disabled, don't attempt to connect. */
+	if (!conn->configured) {
+		EVENT_OFF(conn->t_connect);
 		return;
+	}
 
-	event_add_timer(fnc->fthread->master, fpm_connect, fnc, 3,
-			&fnc->t_connect);
+	event_add_timer(fnc->fthread->master, fpm_connect, conn, 3,
+			&conn->t_connect);
 }
 
 static void fpm_read(struct event *t)
 {
-	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
+	struct fpm_nl_conn *conn = EVENT_ARG(t);
 	fpm_msg_hdr_t fpm;
 	ssize_t rv;
 	char buf[65535];
@@ -571,30 +1172,30 @@ static void fpm_read(struct event *t)
 	size_t hdr_available_bytes;
 
 	/* Let's ignore the input at the moment. */
-	rv = stream_read_try(fnc->ibuf, fnc->socket,
-			     STREAM_WRITEABLE(fnc->ibuf));
+	rv = stream_read_try(conn->ibuf, conn->socket,
+			     STREAM_WRITEABLE(conn->ibuf));
 	if (rv == 0) {
-		atomic_fetch_add_explicit(&fnc->counters.connection_closes, 1,
+		atomic_fetch_add_explicit(&conn->counters.connection_closes, 1,
 					  memory_order_relaxed);
 
 		if (IS_ZEBRA_DEBUG_FPM)
 			zlog_debug("%s: connection closed", __func__);
 
-		FPM_RECONNECT(fnc);
+		FPM_RECONNECT(conn);
 		return;
 	}
 	if (rv == -1) {
-		atomic_fetch_add_explicit(&fnc->counters.connection_errors, 1,
+		atomic_fetch_add_explicit(&conn->counters.connection_errors, 1,
 					  memory_order_relaxed);
 		zlog_warn("%s: connection failure: %s", __func__,
 			  strerror(errno));
-		FPM_RECONNECT(fnc);
+		FPM_RECONNECT(conn);
 		return;
 	}
 
 	/* Schedule the next read */
-	event_add_read(fnc->fthread->master, fpm_read, fnc, fnc->socket,
-		       &fnc->t_read);
+	event_add_read(conn->fnc->fthread->master, fpm_read, conn,
+		       conn->socket, &conn->t_read);
 
 	/* We've got an interruption. */
 	if (rv == -2)
@@ -602,28 +1203,28 @@ static void fpm_read(struct event *t)
 
 
 	/* Account all bytes read. */
-	atomic_fetch_add_explicit(&fnc->counters.bytes_read, rv,
+	atomic_fetch_add_explicit(&conn->counters.bytes_read, rv,
 				  memory_order_relaxed);
 
-	available_bytes = STREAM_READABLE(fnc->ibuf);
+	available_bytes = STREAM_READABLE(conn->ibuf);
 	while (available_bytes) {
 		if (available_bytes < (ssize_t)FPM_MSG_HDR_LEN) {
-			stream_pulldown(fnc->ibuf);
+			stream_pulldown(conn->ibuf);
 			return;
 		}
 
-		fpm.version = stream_getc(fnc->ibuf);
-		fpm.msg_type = stream_getc(fnc->ibuf);
-		fpm.msg_len = stream_getw(fnc->ibuf);
+		fpm.version = stream_getc(conn->ibuf);
+		fpm.msg_type = stream_getc(conn->ibuf);
+		fpm.msg_len = stream_getw(conn->ibuf);
 
 		if (fpm.version != FPM_PROTO_VERSION &&
 		    fpm.msg_type != FPM_MSG_TYPE_NETLINK) {
-			stream_reset(fnc->ibuf);
+			stream_reset(conn->ibuf);
 			zlog_warn(
 				"%s: Received version/msg_type %u/%u, expected 1/1",
 				__func__, fpm.version, fpm.msg_type);
 
-			FPM_RECONNECT(fnc);
+			FPM_RECONNECT(conn);
 			return;
 		}
 
@@ -635,7 +1236,7 @@ static void fpm_read(struct event *t)
 			zlog_warn(
 				"%s: Received message length: %u that does not even fill the FPM header",
 				__func__, fpm.msg_len);
-			FPM_RECONNECT(fnc);
+			FPM_RECONNECT(conn);
 			return;
 		}
 
@@ -645,8 +1246,8 @@ static void fpm_read(struct event *t)
 		 * top.
 		 */
 		if (fpm.msg_len > available_bytes) {
-			stream_rewind_getp(fnc->ibuf, FPM_MSG_HDR_LEN);
-			stream_pulldown(fnc->ibuf);
+			stream_rewind_getp(conn->ibuf, FPM_MSG_HDR_LEN);
+			stream_pulldown(conn->ibuf);
 			return;
 		}
 
@@ -656,7 +1257,7 @@ static void fpm_read(struct event *t)
 		 * Place the data from the stream into a buffer
 		 */
 		hdr = (struct nlmsghdr *)buf;
-		stream_get(buf, fnc->ibuf, fpm.msg_len - FPM_MSG_HDR_LEN);
+		stream_get(buf, conn->ibuf, fpm.msg_len - FPM_MSG_HDR_LEN);
 		hdr_available_bytes = fpm.msg_len - FPM_MSG_HDR_LEN;
 		available_bytes -= hdr_available_bytes;
 
@@ -664,7 +1265,7 @@ static void fpm_read(struct event *t)
 			zlog_warn(
 				"%s: Received a inner header length of %u that is greater than the fpm total length of %u",
 				__func__, hdr->nlmsg_len, fpm.msg_len);
-			FPM_RECONNECT(fnc);
+			FPM_RECONNECT(conn);
 		}
 		/* Not enough bytes available. */
 		if (hdr->nlmsg_len > hdr_available_bytes) {
@@ -703,7 +1304,7 @@ static void fpm_read(struct event *t)
 			if (netlink_route_change_read_unicast_internal(
 				    hdr, 0, false, ctx) != 1) {
 				dplane_ctx_fini(&ctx);
-				stream_pulldown(fnc->ibuf);
+				stream_pulldown(conn->ibuf);
 				/*
 				 * Let's continue to read other messages
 				 * Even if we ignore this one.
@@ -719,22 +1320,28 @@ static void fpm_read(struct event *t)
 		}
 	}
 
-	stream_reset(fnc->ibuf);
+	stream_reset(conn->ibuf);
 }
 
 static void fpm_write(struct event *t)
 {
-	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
+	struct fpm_nl_conn *conn = EVENT_ARG(t);
+	struct fpm_nl_ctx *fnc = conn->fnc;
+	struct iovec iov[FPM_WRITE_IOV_MAX];
+	struct fpm_log_chunk *chunk;
+	struct fpm_log_msg *msg;
 	socklen_t statuslen;
 	ssize_t bwritten;
 	int rv, status;
-	size_t btotal;
+	uint64_t pos;
+	size_t off;
+	int iovcnt;
 
-	if (fnc->connecting == true) {
+	if (conn->connecting == true) {
 		status = 0;
 		statuslen = sizeof(status);
 
-		rv = getsockopt(fnc->socket, SOL_SOCKET, SO_ERROR, &status,
+		rv = getsockopt(conn->socket, SOL_SOCKET, SO_ERROR, &status,
 				&statuslen);
 		if (rv == -1 || status != 0) {
 			if (rv != -1)
@@ -745,43 +1352,64 @@ static void fpm_write(struct event *t)
 					  strerror(status));
 
 			atomic_fetch_add_explicit(
-				&fnc->counters.connection_errors, 1,
+				&conn->counters.connection_errors, 1,
 				memory_order_relaxed);
 
-			FPM_RECONNECT(fnc);
+			FPM_RECONNECT(conn);
 			return;
 		}
 
-		fnc->connecting = false;
+		conn->connecting = false;
 
-		/*
-		 * Starting with LSPs walk all FPM objects, marking them
-		 * as unsent and then replaying them.
-		 */
-		event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
-				&fnc->t_lspreset);
+		fpm_conn_established(conn);
 
 		/* Permit receiving messages now. */
-		event_add_read(fnc->fthread->master, fpm_read, fnc, fnc->socket,
-			       &fnc->t_read);
+		event_add_read(fnc->fthread->master, fpm_read, conn,
+			       conn->socket, &conn->t_read);
 	}
 
-	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
+	frr_mutex_lock_autounlock(&fnc->log_mutex);
 
 	while (true) {
-		/* Stream is empty: reset pointers and return. */
-		if (STREAM_READABLE(fnc->obuf) == 0) {
-			stream_reset(fnc->obuf);
-			break;
+		/* Gather the next messages meant for this server. */
+		iovcnt = 0;
+		pos = conn->pos;
+		off = conn->msg_off;
+		chunk = fpm_log_chunk_find(fnc, pos);
+		while (chunk && iovcnt < FPM_WRITE_IOV_MAX) {
+			if (pos >= chunk->start + chunk->used) {
+				chunk = fpm_log_chunks_next(&fnc->log, chunk);
+				continue;
+			}
+
+			msg = (struct fpm_log_msg *)&chunk->data[pos -
+								 chunk->start];
+			pos += FPM_LOG_MSG_SIZE(msg->len);
+
+			if (!CHECK_FLAG(msg->mask, FPM_CONN_BIT(conn))) {
+				/* Nothing gathered yet: just skip it. */
+				if (iovcnt == 0) {
+					conn->pos = pos;
+					conn->seq_sent = msg->seq;
+				}
+				continue;
+			}
+
+			iov[iovcnt].iov_base = msg->data + off;
+			iov[iovcnt].iov_len = msg->len - off;
+			iovcnt++;
+			off = 0;
 		}
 
+		/* Log is empty for this server. */
+		if (iovcnt == 0)
+			break;
+
 		/* Try to write all at once. */
-		btotal = stream_get_endp(fnc->obuf) -
-			stream_get_getp(fnc->obuf);
-		bwritten = write(fnc->socket, stream_pnt(fnc->obuf), btotal);
+		bwritten = writev(conn->socket, iov, iovcnt);
 		if (bwritten == 0) {
 			atomic_fetch_add_explicit(
-				&fnc->counters.connection_closes, 1,
+				&conn->counters.connection_closes, 1,
 				memory_order_relaxed);
 
 			if (IS_ZEBRA_DEBUG_FPM)
@@ -797,56 +1425,54 @@ static void fpm_write(struct event *t)
 				break;
 
 			atomic_fetch_add_explicit(
-				&fnc->counters.connection_errors, 1,
+				&conn->counters.connection_errors, 1,
 				memory_order_relaxed);
 			zlog_warn("%s: connection failure: %s", __func__,
 				  strerror(errno));
 
-			FPM_RECONNECT(fnc);
+			FPM_RECONNECT(conn);
 			return;
 		}
 
 		/* Account all bytes sent. */
-		atomic_fetch_add_explicit(&fnc->counters.bytes_sent, bwritten,
-					  memory_order_relaxed);
-
-		/* Account number of bytes free. */
-		atomic_fetch_sub_explicit(&fnc->counters.obuf_bytes, bwritten,
+		atomic_fetch_add_explicit(&conn->counters.bytes_sent, bwritten,
 					  memory_order_relaxed);
 
-		stream_forward_getp(fnc->obuf, (size_t)bwritten);
+		fpm_conn_advance(conn, (size_t)bwritten);
 	}
 
-	/* Stream is not empty yet, we must schedule more writes. */
-	if (STREAM_READABLE(fnc->obuf)) {
-		stream_pulldown(fnc->obuf);
-		event_add_write(fnc->fthread->master, fpm_write, fnc,
-				fnc->socket, &fnc->t_write);
-		return;
-	}
+	/* Release what every server got already. */
+	fpm_log_trim(fnc);
+	fpm_log_update_counters(fnc);
+
+	/* Log is not empty yet, we must schedule more writes. */
+	if (conn->pos < fnc->log_end)
+		event_add_write(fnc->fthread->master, fpm_write, conn,
+				conn->socket, &conn->t_write);
 }
 
 static void fpm_connect(struct event *t)
 {
-	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
-	struct sockaddr_in *sin = (struct sockaddr_in *)&fnc->addr;
-	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&fnc->addr;
+	struct fpm_nl_conn *conn = EVENT_ARG(t);
+	struct fpm_nl_ctx *fnc = conn->fnc;
+	struct sockaddr_in *sin = (struct sockaddr_in *)&conn->addr;
+	struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)&conn->addr;
 	socklen_t slen;
 	int rv, sock;
 	char addrstr[INET6_ADDRSTRLEN];
 
-	sock = socket(fnc->addr.ss_family, SOCK_STREAM, 0);
+	sock = socket(conn->addr.ss_family, SOCK_STREAM, 0);
 	if (sock == -1) {
 		zlog_err("%s: fpm socket failed: %s", __func__,
 			 strerror(errno));
-		event_add_timer(fnc->fthread->master, fpm_connect, fnc, 3,
-				&fnc->t_connect);
+		event_add_timer(fnc->fthread->master, fpm_connect, conn, 3,
+				&conn->t_connect);
 		return;
 	}
 
 	set_nonblocking(sock);
 
-	if (fnc->addr.ss_family == AF_INET) {
+	if (conn->addr.ss_family == AF_INET) {
 		inet_ntop(AF_INET, &sin->sin_addr, addrstr, sizeof(addrstr));
 		slen = sizeof(*sin);
 	} else {
@@ -858,51 +1484,51 @@ static void fpm_connect(struct event *t)
 		zlog_debug("%s: attempting to connect to %s:%d", __func__,
 			   addrstr, ntohs(sin->sin_port));
 
-	rv = connect(sock, (struct sockaddr *)&fnc->addr, slen);
+	rv = connect(sock, (struct sockaddr *)&conn->addr, slen);
 	if (rv == -1 && errno != EINPROGRESS) {
-		atomic_fetch_add_explicit(&fnc->counters.connection_errors, 1,
+		atomic_fetch_add_explicit(&conn->counters.connection_errors, 1,
 					  memory_order_relaxed);
 		close(sock);
 		zlog_warn("%s: fpm connection failed: %s", __func__,
 			  strerror(errno));
-		event_add_timer(fnc->fthread->master, fpm_connect, fnc, 3,
-				&fnc->t_connect);
+		event_add_timer(fnc->fthread->master, fpm_connect, conn, 3,
+				&conn->t_connect);
 		return;
 	}
 
-	fnc->connecting = (errno == EINPROGRESS);
-	fnc->socket = sock;
-	if (!fnc->connecting)
-		event_add_read(fnc->fthread->master, fpm_read, fnc, sock,
-			       &fnc->t_read);
-	event_add_write(fnc->fthread->master, fpm_write, fnc, sock,
-			&fnc->t_write);
+	conn->connecting = (errno == EINPROGRESS);
+	conn->socket = sock;
+	if (!conn->connecting)
+		event_add_read(fnc->fthread->master, fpm_read, conn, sock,
+			       &conn->t_read);
+	event_add_write(fnc->fthread->master, fpm_write, conn, sock,
+			&conn->t_write);
 
 	/*
-	 * Starting with LSPs walk all FPM objects, marking them
-	 * as unsent and then replaying them.
+	 * Replay the FPM objects to this server.
 	 *
 	 * If we are not connected, then delay the objects reset/send.
 	 */
-	if (!fnc->connecting)
-		event_add_timer(zrouter.master, fpm_lsp_reset, fnc, 0,
-				&fnc->t_lspreset);
+	if (!conn->connecting)
+		fpm_conn_established(conn);
 }
 
 /**
- * Encode data plane operation context into netlink and enqueue it in the FPM
- * output buffer.
+ * Encode data plane operation context into netlink and enqueue it in the
+ * output log.
  *
  * @param fnc the netlink FPM context.
  * @param ctx the data plane operation context data.
+ * @param walk whether this is part of a table walk.
  * @return 0 on success or -1 on not enough space.
  */
-static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
+static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx,
+			  bool walk)
 {
 	uint8_t nl_buf[NL_PKT_BUF_SIZE];
 	size_t nl_buf_len;
 	ssize_t rv;
-	uint64_t obytes, obytes_peak;
+	uint32_t mask;
 	enum dplane_op_e op = dplane_ctx_get_op(ctx);
 
 	/*
@@ -916,8 +1542,6 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 
 	nl_buf_len = 0;
 
-	frr_mutex_lock_autounlock(&fnc->obuf_mutex);
-
 	/*
 	 * If route replace is enabled then directly encode the install which
 	 * is going to use `NLM_F_REPLACE` (instead of delete/add operations).
@@ -1070,49 +1694,23 @@ static int fpm_nl_enqueue(struct fpm_nl_ctx *fnc, struct zebra_dplane_ctx *ctx)
 	/* We must know if someday a message goes beyond 65KiB. */
 	assert((nl_buf_len + FPM_HEADER_SIZE) <= UINT16_MAX);
 
-	/* Check if we have enough buffer space. */
-	if (STREAM_WRITEABLE(fnc->obuf) < (nl_buf_len + FPM_HEADER_SIZE)) {
-		atomic_fetch_add_explicit(&fnc->counters.buffer_full, 1,
-					  memory_order_relaxed);
-
-		if (IS_ZEBRA_DEBUG_FPM)
-			zlog_debug(
-				"%s: buffer full: wants to write %zu but has %zu",
-				__func__, nl_buf_len + FPM_HEADER_SIZE,
-				STREAM_WRITEABLE(fnc->obuf));
-
-		return -1;
-	}
-
 	/*
-	 * Fill in the FPM header information.
-	 *
-	 * See FPM_HEADER_SIZE definition for more information.
+	 * The message is encoded once and shared by all servers: walks only
+	 * go to the servers being walked, everything else goes to all
+	 * connected servers.
 	 */
-	stream_putc(fnc->obuf, 1);
-	stream_putc(fnc->obuf, 1);
-	stream_putw(fnc->obuf, nl_buf_len + FPM_HEADER_SIZE);
+	frr_mutex_lock_autounlock(&fnc->log_mutex);
 
-	/* Write current data. */
-	stream_write(fnc->obuf, nl_buf, (size_t)nl_buf_len);
-
-	/* Account number of bytes waiting to be written. */
-	atomic_fetch_add_explicit(&fnc->counters.obuf_bytes,
-				  nl_buf_len + FPM_HEADER_SIZE,
-				  memory_order_relaxed);
-	obytes = atomic_load_explicit(&fnc->counters.obuf_bytes,
-				      memory_order_relaxed);
-	obytes_peak = atomic_load_explicit(&fnc->counters.obuf_peak,
-					   memory_order_relaxed);
-	if (obytes_peak < obytes)
-		atomic_store_explicit(&fnc->counters.obuf_peak, obytes,
-				      memory_order_relaxed);
+	if (walk)
+		mask = fnc->walk_mask & fnc->established;
+	else
+		mask = fnc->established;
 
-	/* Tell the thread to start writing. */
-	event_add_write(fnc->fthread->master, fpm_write, fnc, fnc->socket,
-			&fnc->t_write);
+	/* Nobody to send this to. */
+	if (mask == 0)
+		return 0;
 
-	return 0;
+	return fpm_log_append(fnc, mask, nl_buf, nl_buf_len);
 }
 
 /*
@@ -1136,7 +1734,7 @@ static int fpm_lsp_send_cb(struct hash_bucket *bucket, void *arg)
 	dplane_ctx_reset(fla->ctx);
 	dplane_ctx_lsp_init(fla->ctx, DPLANE_OP_LSP_INSTALL, lsp);
 
-	if (fpm_nl_enqueue(fla->fnc, fla->ctx) == -1) {
+	if (fpm_nl_enqueue(fla->fnc, fla->ctx, true) == -1) {
 		fla->complete = false;
 		return HASHWALK_ABORT;
 	}
@@ -1194,7 +1792,7 @@ static int fpm_nhg_send_cb(struct hash_bucket *bucket, void *arg)
 	/* Reset ctx to reuse allocated memory, take a snapshot and send it. */
 	dplane_ctx_reset(fna->ctx);
 	dplane_ctx_nexthop_init(fna->ctx, DPLANE_OP_NH_INSTALL, nhe);
-	if (fpm_nl_enqueue(fna->fnc, fna->ctx) == -1) {
+	if (fpm_nl_enqueue(fna->fnc, fna->ctx, true) == -1) {
 		/* Our buffers are full, lets give it some cycles. */
 		fna->complete = false;
 		return HASHWALK_ABORT;
@@ -1263,7 +1861,7 @@ static void fpm_rib_send(struct event *t)
 			dplane_ctx_reset(ctx);
 			dplane_ctx_route_init(ctx, DPLANE_OP_ROUTE_INSTALL, rn,
 					      dest->selected_fib);
-			if (fpm_nl_enqueue(fnc, ctx) == -1) {
+			if (fpm_nl_enqueue(fnc, ctx, true) == -1) {
 				/* Free the temporary allocated context. */
 				dplane_ctx_fini(&ctx);
 
@@ -1324,7 +1922,7 @@ static void fpm_enqueue_rmac_table(struct hash_bucket *bucket, void *arg)
 			zif->brslave_info.br_if, vid, &zrmac->macaddr, vni->vni,
 			zrmac->fwd_info.r_vtep_ip, sticky, 0 /*nhg*/,
 			0 /*update_flags*/);
-	if (fpm_nl_enqueue(fra->fnc, fra->ctx) == -1) {
+	if (fpm_nl_enqueue(fra->fnc, fra->ctx, true) == -1) {
 		event_add_timer(zrouter.master, fpm_rmac_send, fra->fnc, 1,
 				&fra->fnc->t_rmacwalk);
 		fra->complete = false;
@@ -1455,13 +2053,28 @@ static void fpm_rmac_reset(struct event *t)
 static void fpm_process_wedged(struct event *t)
 {
 	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
+	struct fpm_nl_conn *conn, *slowest = NULL;
+
+	/* The server furthest behind is the one holding the log. */
+	frr_with_mutex (&fnc->log_mutex) {
+		frr_each_fpm_conn (fnc, conn) {
+			if (!CHECK_FLAG(fnc->established, FPM_CONN_BIT(conn)))
+				continue;
+
+			if (slowest == NULL || conn->pos < slowest->pos)
+				slowest = conn;
+		}
+	}
+
+	if (slowest == NULL)
+		return;
 
 	zlog_warn("%s: Connection unable to write to peer for over %u seconds, resetting",
 		  __func__, DPLANE_FPM_NL_WEDGIE_TIME);
 
-	atomic_fetch_add_explicit(&fnc->counters.connection_errors, 1,
+	atomic_fetch_add_explicit(&slowest->counters.connection_errors, 1,
 				  memory_order_relaxed);
-	FPM_RECONNECT(fnc);
+	FPM_RECONNECT(slowest);
 }
 
 static void fpm_process_queue(struct event *t)
@@ -1474,12 +2087,15 @@ static void fpm_process_queue(struct event *t)
 	while (true) {
 		size_t writeable_amount;
 
-		frr_with_mutex (&fnc->obuf_mutex) {
-			writeable_amount = STREAM_WRITEABLE(fnc->obuf);
+		frr_with_mutex (&fnc->log_mutex) {
+			writeable_amount = FPM_LOG_MAX_BYTES -
+					   (fnc->log_end -
+					    fpm_log_needed_pos(fnc));
 		}
 
 		/* No space available yet. */
-		if (writeable_amount < NL_PKT_BUF_SIZE) {
+		if (writeable_amount <
+		    FPM_LOG_MSG_SIZE(NL_PKT_BUF_SIZE + FPM_HEADER_SIZE)) {
 			no_bufs = true;
 			break;
 		}
@@ -1494,11 +2110,11 @@ static void fpm_process_queue(struct event *t)
 		/*
 		 * Intentionally ignoring the return value
 		 * as that we are ensuring that we can write to
-		 * the output data in the STREAM_WRITEABLE
+		 * the output log in the writeable_amount
 		 * check above, so we can ignore the return
 		 */
-		if (fnc->socket != -1)
-			(void)fpm_nl_enqueue(fnc, ctx);
+		if (atomic_load_explicit(&fnc->live_mask, memory_order_relaxed))
+			(void)fpm_nl_enqueue(fnc, ctx, false);
 
 		/* Account the processed entries. */
 		processed_contexts++;
@@ -1541,39 +2157,45 @@ static void fpm_process_event(struct event *t)
 {
 	struct fpm_nl_ctx *fnc = EVENT_ARG(t);
 	enum fpm_nl_events event = EVENT_VAL(t);
+	struct fpm_nl_conn *conn;
 
 	switch (event) {
 	case FNE_DISABLE:
 		zlog_info("%s: manual FPM disable event", __func__);
-		fnc->disabled = true;
 		atomic_fetch_add_explicit(&fnc->counters.user_disables, 1,
 					  memory_order_relaxed);
 
-		/* Call reconnect to disable timers and clean up context. */
-		fpm_reconnect(fnc);
-		break;
-
-	case FNE_RECONNECT:
-		zlog_info("%s: manual FPM reconnect event", __func__);
-		fnc->disabled = false;
-		atomic_fetch_add_explicit(&fnc->counters.user_configures, 1,
-					  memory_order_relaxed);
-		fpm_reconnect(fnc);
+		/* Call reset to disable timers and clean up connections. */
+		frr_each_fpm_conn (fnc, conn) {
+			conn->configured = false;
+			fpm_conn_reset(conn);
+		}
 		break;
 
 	case FNE_RESET_COUNTERS:
 		zlog_info("%s: manual FPM counters reset event", __func__);
 		memset(&fnc->counters, 0, sizeof(fnc->counters));
+		frr_each_fpm_conn (fnc, conn)
+			memset(&conn->counters, 0, sizeof(conn->counters));
 		break;
 
 	case FNE_TOGGLE_NHG:
 		zlog_info("%s: toggle next hop groups support", __func__);
 		fnc->use_nhg = !fnc->use_nhg;
-		fpm_reconnect(fnc);
+
+		/* Logged messages use the old format: walk everybody again. */
+		frr_each_fpm_conn (fnc, conn) {
+			frr_with_mutex (&fnc->log_mutex) {
+				conn->synced = false;
+			}
+			if (conn->configured)
+				fpm_conn_reset(conn);
+		}
 		break;
 
+	case FNE_RECONNECT:
 	case FNE_INTERNAL_RECONNECT:
-		fpm_reconnect(fnc);
+		/* Connection events, see fpm_process_conn_event(). */
 		break;
 
 	case FNE_NHG_FINISHED:
@@ -1588,6 +2210,9 @@ static void fpm_process_event(struct event *t)
 	case FNE_RMAC_FINISHED:
 		if (IS_ZEBRA_DEBUG_FPM)
 			zlog_debug("%s: RMAC walk finished", __func__);
+
+		/* That was the last walk: servers are in sync now. */
+		fpm_walk_finish(fnc);
 		break;
 	case FNE_LSP_FINISHED:
 		if (IS_ZEBRA_DEBUG_FPM)
@@ -1596,21 +2221,69 @@ static void fpm_process_event(struct event *t)
 	}
 }
 
+/**
+ * Handles events targeting a single server connection.
+ */
+static void fpm_process_conn_event(struct event *t)
+{
+	struct fpm_nl_conn *conn = EVENT_ARG(t);
+	enum fpm_nl_events event = EVENT_VAL(t);
+	struct fpm_nl_ctx *fnc = conn->fnc;
+
+	switch (event) {
+	case FNE_DISABLE:
+		zlog_info("%s: manual FPM disable event", __func__);
+		conn->configured = false;
+		atomic_fetch_add_explicit(&fnc->counters.user_disables, 1,
+					  memory_order_relaxed);
+
+		/* Call reset to disable timers and clean up connection. */
+		fpm_conn_reset(conn);
+		break;
+
+	case FNE_RECONNECT:
+		zlog_info("%s: manual FPM reconnect event", __func__);
+		atomic_fetch_add_explicit(&fnc->counters.user_configures, 1,
+					  memory_order_relaxed);
+		fpm_conn_reset(conn);
+		break;
+
+	case FNE_INTERNAL_RECONNECT:
+		fpm_conn_reset(conn);
+		break;
+
+	case FNE_RESET_COUNTERS:
+	case FNE_TOGGLE_NHG:
+	case FNE_LSP_FINISHED:
+	case FNE_NHG_FINISHED:
+	case FNE_RIB_FINISHED:
+	case FNE_RMAC_FINISHED:
+		/* Global events, see fpm_process_event(). */
+		break;
+	}
+}
+
 /*
  * Data plane functions.
  */
 static int fpm_nl_start(struct zebra_dplane_provider *prov)
 {
 	struct fpm_nl_ctx *fnc;
+	struct fpm_nl_conn *conn;
+	int i;
 
 	fnc = dplane_provider_get_data(prov);
 	fnc->fthread = frr_pthread_new(NULL, prov_name, prov_name);
 	assert(frr_pthread_run(fnc->fthread, NULL) == 0);
-	fnc->ibuf = stream_new(NL_PKT_BUF_SIZE);
-	fnc->obuf = stream_new(NL_PKT_BUF_SIZE * 128);
-	pthread_mutex_init(&fnc->obuf_mutex, NULL);
-	fnc->socket = -1;
-	fnc->disabled = true;
+	pthread_mutex_init(&fnc->log_mutex, NULL);
+	fpm_log_chunks_init(&fnc->log);
+	for (i = 0; i < FPM_NL_MAX_CONNECTIONS; i++) {
+		conn = &fnc->conns[i];
+		conn->fnc = fnc;
+		conn->idx = i;
+		conn->socket = -1;
+		conn->ibuf = stream_new(NL_PKT_BUF_SIZE);
+	}
 	fnc->prov = prov;
 	dplane_ctx_q_init(&fnc->ctxqueue);
 	pthread_mutex_init(&fnc->ctxqueue_mutex, NULL);
@@ -1624,7 +2297,9 @@ static int fpm_nl_start(struct zebra_dplane_provider *prov)
 
 static int fpm_nl_finish_early(struct fpm_nl_ctx *fnc)
 {
-	/* Disable all events and close socket. */
+	struct fpm_nl_conn *conn;
+
+	/* Disable all events and close sockets. */
 	EVENT_OFF(fnc->t_lspreset);
 	EVENT_OFF(fnc->t_lspwalk);
 	EVENT_OFF(fnc->t_nhgreset);
@@ -1635,13 +2310,17 @@ static int fpm_nl_finish_early(struct fpm_nl_ctx *fnc)
 	EVENT_OFF(fnc->t_rmacwalk);
 	EVENT_OFF(fnc->t_event);
 	EVENT_OFF(fnc->t_nhg);
-	event_cancel_async(fnc->fthread->master, &fnc->t_read, NULL);
-	event_cancel_async(fnc->fthread->master, &fnc->t_write, NULL);
-	event_cancel_async(fnc->fthread->master, &fnc->t_connect, NULL);
-
-	if (fnc->socket != -1) {
-		close(fnc->socket);
-		fnc->socket = -1;
+	frr_each_fpm_conn (fnc, conn) {
+		EVENT_OFF(conn->t_event);
+		event_cancel_async(fnc->fthread->master, &conn->t_read, NULL);
+		event_cancel_async(fnc->fthread->master, &conn->t_write, NULL);
+		event_cancel_async(fnc->fthread->master, &conn->t_connect,
+				   NULL);
+
+		if (conn->socket != -1) {
+			close(conn->socket);
+			conn->socket = -1;
+		}
 	}
 
 	return 0;
@@ -1649,14 +2328,20 @@ static int fpm_nl_finish_early(struct fpm_nl_ctx *fnc)
 
 static int fpm_nl_finish_late(struct fpm_nl_ctx *fnc)
 {
+	struct fpm_log_chunk *chunk;
+	struct fpm_nl_conn *conn;
+
 	/* Stop the running thread. */
 	frr_pthread_stop(fnc->fthread, NULL);
 
 	/* Free all allocated resources. */
-	pthread_mutex_destroy(&fnc->obuf_mutex);
+	while ((chunk = fpm_log_chunks_pop(&fnc->log)) != NULL)
+		XFREE(MTYPE_FPM_LOG, chunk);
+	fpm_log_chunks_fini(&fnc->log);
+	pthread_mutex_destroy(&fnc->log_mutex);
 	pthread_mutex_destroy(&fnc->ctxqueue_mutex);
-	stream_free(fnc->ibuf);
-	stream_free(fnc->obuf);
+	frr_each_fpm_conn (fnc, conn)
+		stream_free(conn->ibuf);
 	free(gfnc);
 	gfnc = NULL;
 
@@ -1708,10 +2393,11 @@ static int fpm_nl_process(struct zebra_dplane_provider *prov)
 			break;
 
 		/*
-		 * Skip all notifications if not connected, we'll walk the RIB
-		 * anyway.
+		 * Skip all notifications if live_mask has no established
+		 * server, one that connects later gets a full table walk.
 		 */
-		if (fnc->socket != -1 && fnc->connecting == false) {
+		if (atomic_load_explicit(&fnc->live_mask,
+					 memory_order_relaxed)) {
 			enum dplane_op_e op = dplane_ctx_get_op(ctx);
 
 			/*
@@ -768,10 +768,11 @@ int main(int argc, char **argv)
 	pid_t daemon;
 	int r;
 	bool fork_daemon = false;
+	int port = FPM_DEFAULT_PORT;
 
 	memset(glob, 0, sizeof(*glob));
 
-	while ((r = getopt(argc, argv, "rdv")) != -1) {
+	while ((r = getopt(argc, argv, "rdvp:")) != -1) {
 		switch (r) {
 		case 'r':
 			glob->reflect = true;
@@ -782,9 +783,15 @@ int main(int argc, char **argv)
 		case 'v':
 			glob->dump_hex = true;
 			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
 		}
 	}
 
+	/* Keep the output usable while it is redirected to a file. */
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
 	if (fork_daemon) {
 		daemon = fork();
 
@@ -792,7 +799,7 @@ int main(int argc, char **argv)
 			exit(0);
 	}
 
-	if (!create_listen_sock(FPM_DEFAULT_PORT, &glob->server_sock))
+	if (!create_listen_sock(port, &glob->server_sock))
 		exit(1);
 
 	/*
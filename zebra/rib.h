@@ -31,7 +31,7 @@ DECLARE_MGROUP(ZEBRA);
 
 DECLARE_MTYPE(RE);
 
-PREDECL_LIST(rnh_list);
+PREDECL_DLIST(rnh_list);
 
 /* Nexthop structure. */
 struct rnh {
@@ -40,6 +40,8 @@ struct rnh {
 #define ZEBRA_NHT_CONNECTED 0x1
 #define ZEBRA_NHT_DELETED 0x2
 #define ZEBRA_NHT_RESOLVE_VIA_DEFAULT 0x4
+/* On the nht list of the route node matching resolved_route */
+#define ZEBRA_NHT_LINKED 0x8
 
 	/* VRF identifier. */
 	vrf_id_t vrf_id;
@@ -222,7 +224,10 @@ typedef struct rib_dest_t_ {
 	 * depending on this route node.
 	 * After route processing is returned from
 	 * the data plane we will run evaluate_rnh
-	 * on these prefixes.
+	 * on these prefixes.  This is a doubly linked
+	 * list since a single IGP route can have many
+	 * thousands of tracked nexthops resolving over it,
+	 * and rnh's are removed from it whenever they move.
 	 */
 	struct rnh_list_head nht;
 
@@ -233,7 +238,7 @@ typedef struct rib_dest_t_ {
 
 } rib_dest_t;
 
-DECLARE_LIST(rnh_list, struct rnh, rnh_list_item);
+DECLARE_DLIST(rnh_list, struct rnh, rnh_list_item);
 DECLARE_LIST(re_list, struct route_entry, next);
 
 #define RIB_ROUTE_QUEUED(x)	(1 << (x))
@@ -1752,6 +1752,7 @@ static bool zapi_read_nexthops(struct zserv *client, struct prefix *p,
 	struct nhg_backup_info *bnhg = NULL;
 	uint16_t i;
 	struct nexthop *last_nh = NULL;
+	struct nexthop *ng_tail = NULL;
 	bool same_weight = true;
 	uint64_t max_weight = 0;
 	uint64_t tmp;
@@ -1910,9 +1911,18 @@ static bool zapi_read_nexthops(struct zserv *client, struct prefix *p,
 			 * has sent the list sorted, and the zapi client api
 			 * attempts to enforce that, so this should be
 			 * inexpensive - but it is necessary to support shared
-			 * nexthop-groups.
+			 * nexthop-groups. Track the tail here, so that
+			 * appending in-order nexthops doesn't walk the whole
+			 * list each time.
 			 */
-			nexthop_group_add_sorted(ng, nexthop);
+			if (ng_tail && nexthop_cmp(ng_tail, nexthop) < 0) {
+				NEXTHOP_APPEND(ng_tail, nexthop);
+				ng_tail = nexthop;
+			} else {
+				nexthop_group_add_sorted(ng, nexthop);
+				if (nexthop->next == NULL)
+					ng_tail = nexthop;
+			}
 		}
 		if (bnhg) {
 			/* Note that the order of the backup nexthops is
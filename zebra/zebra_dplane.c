@@ -12,9 +12,11 @@
 
 #include "lib/libfrr.h"
 #include "lib/debug.h"
+#include "lib/atomring.h"
 #include "lib/frratomic.h"
 #include "lib/frr_pthread.h"
 #include "lib/memory.h"
+#include "lib/nexthop_group_private.h"
 #include "lib/zebra.h"
 #include "zebra/netconf_netlink.h"
 #include "zebra/zebra_router.h"
@@ -30,6 +32,7 @@
 
 /* Memory types */
 DEFINE_MTYPE_STATIC(ZEBRA, DP_CTX, "Zebra DPlane Ctx");
+DEFINE_MTYPE_STATIC(ZEBRA, DP_POOL, "Zebra DPlane Pool Cache");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_INTF, "Zebra DPlane Intf");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_PROV, "Zebra DPlane Provider");
 DEFINE_MTYPE_STATIC(ZEBRA, DP_NETFILTER, "Zebra Netfilter Internal Object");
@@ -62,6 +65,9 @@ const uint32_t DPLANE_DEFAULT_MAX_QUEUED = 200;
 /* Default value for new work per cycle */
 const uint32_t DPLANE_DEFAULT_NEW_WORK = 100;
 
+/* Size of the lock-free rings used for a threaded provider's queues */
+#define DPLANE_PROV_RING_SIZE 1024
+
 /* Validation check macro for context blocks */
 /* #define DPLANE_DEBUG 1 */
 
@@ -465,6 +471,23 @@ DECLARE_DLIST(dplane_intf_extra_list, struct dplane_intf_extra, dlink);
 /* List for dplane plugins/providers */
 PREDECL_DLIST(dplane_prov_list);
 
+/*
+ * One of a provider's context queues.  Threaded providers hand contexts
+ * between the dplane pthread and their own pthread(s) through a lock-free
+ * ring; the list, protected by the provider mutex, only takes the overflow
+ * once the ring is full.  While anything is on the overflow list, producers
+ * keep appending to the list until it has been drained, so ordering is
+ * preserved.  Non-threaded providers have no ring and only use the list.
+ */
+struct dplane_prov_queue {
+	struct atomring *ring;
+
+	struct dplane_ctx_list_head list;
+
+	/* Length of 'list', readable without the provider mutex */
+	_Atomic uint32_t list_len;
+};
+
 /*
  * Registration block for one dataplane provider.
  */
@@ -500,12 +523,12 @@ struct zebra_dplane_provider {
 	_Atomic uint32_t dp_error_counter;
 
 	/* Queue of contexts inbound to the provider */
-	struct dplane_ctx_list_head dp_ctx_in_list;
+	struct dplane_prov_queue dp_in_q;
 
 	/* Queue of completed contexts outbound from the provider back
 	 * towards the dataplane module.
 	 */
-	struct dplane_ctx_list_head dp_ctx_out_list;
+	struct dplane_prov_queue dp_out_q;
 
 	/* Embedded list linkage for provider objects */
 	struct dplane_prov_list_item dp_link;
@@ -675,6 +698,10 @@ neigh_update_internal(enum dplane_op_e op, const struct interface *ifp,
 		      const void *link, int link_family,
 		      const struct ipaddr *ip, vni_t vni, uint32_t flags,
 		      uint16_t state, uint32_t update_flags, int protocol);
+static void dplane_prov_queue_init(struct zebra_dplane_provider *prov,
+				   struct dplane_prov_queue *q);
+static void dplane_prov_queue_fini(struct dplane_prov_queue *q);
+static uint32_t dplane_prov_queue_count(const struct dplane_prov_queue *q);
 
 /*
  * Public APIs
@@ -693,18 +720,339 @@ struct event_loop *dplane_get_thread_master(void)
 }
 
 /*
- * Allocate a dataplane update context
+ * Pools of free context and nexthop objects.
+ *
+ * Route updates allocate a large context and copies of the route's
+ * nexthops, and free them again once the results have been processed.
+ * Rather than handing that memory back to the allocator, freed objects are
+ * kept in a small per-pthread cache; when a cache runs empty or overflows,
+ * a batch of objects is moved from or to a shared list under the pool's
+ * mutex. Both levels are bounded, so memory use stays flat under sustained
+ * churn. Contexts are typically allocated in the zebra main pthread and
+ * freed in the dplane pthread (or vice versa), and the shared list is what
+ * lets objects flow back to the allocating pthread.
  */
-struct zebra_dplane_ctx *dplane_ctx_alloc(void)
+struct dplane_pool_item {
+	struct dplane_pool_item *next;
+};
+
+struct dplane_pool_cache {
+	struct dplane_pool_cache *next;
+
+	struct dplane_pool_item *items;
+	uint32_t count;
+};
+
+struct dplane_pool {
+	const char *name;
+
+	/* Limits for the per-pthread caches and for the shared list */
+	uint32_t cache_max;
+	uint32_t shared_max;
+
+	void *(*alloc)(void);
+	void (*free)(void *obj);
+
+	pthread_mutex_t mutex;
+	struct dplane_pool_item *shared;
+	_Atomic uint32_t shared_count;
+
+	/* All per-pthread caches, so they can be released at shutdown */
+	struct dplane_pool_cache *caches;
+
+	_Atomic bool enabled;
+
+	/* Counters */
+	_Atomic uint64_t allocs;
+	_Atomic uint64_t reused;
+	_Atomic uint64_t frees;
+	_Atomic uint64_t released;
+	_Atomic uint64_t pooled;
+};
+
+enum dplane_pool_id {
+	DPLANE_POOL_CTX = 0,
+	DPLANE_POOL_NEXTHOP,
+	DPLANE_POOL_MAX,
+};
+
+static void *dplane_pool_ctx_alloc(void)
+{
+	return XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
+}
+
+static void dplane_pool_ctx_free(void *obj)
+{
+	XFREE(MTYPE_DP_CTX, obj);
+}
+
+static void *dplane_pool_nh_alloc(void)
+{
+	return nexthop_new();
+}
+
+static void dplane_pool_nh_free(void *obj)
+{
+	nexthop_free(obj);
+}
+
+static struct dplane_pool dplane_pools[DPLANE_POOL_MAX] = {
+	[DPLANE_POOL_CTX] = {
+		.name = "Contexts",
+		.cache_max = 256,
+		.shared_max = 4096,
+		.alloc = dplane_pool_ctx_alloc,
+		.free = dplane_pool_ctx_free,
+		.mutex = PTHREAD_MUTEX_INITIALIZER,
+		.enabled = true,
+	},
+	[DPLANE_POOL_NEXTHOP] = {
+		.name = "Nexthops",
+		.cache_max = 1024,
+		.shared_max = 16384,
+		.alloc = dplane_pool_nh_alloc,
+		.free = dplane_pool_nh_free,
+		.mutex = PTHREAD_MUTEX_INITIALIZER,
+		.enabled = true,
+	},
+};
+
+#ifndef thread_local
+#define thread_local __thread
+#endif
+
+static thread_local struct dplane_pool_cache *dplane_pool_tls[DPLANE_POOL_MAX];
+
+static struct dplane_pool_cache *dplane_pool_get_cache(enum dplane_pool_id id)
 {
-	struct zebra_dplane_ctx *p;
+	struct dplane_pool *pool = &dplane_pools[id];
+	struct dplane_pool_cache *cache = dplane_pool_tls[id];
+
+	if (cache)
+		return cache;
+
+	cache = XCALLOC(MTYPE_DP_POOL, sizeof(*cache));
+
+	frr_with_mutex (&pool->mutex) {
+		cache->next = pool->caches;
+		pool->caches = cache;
+	}
+
+	dplane_pool_tls[id] = cache;
+	return cache;
+}
+
+/*
+ * Get an object from a pool; the object is zeroed, as if it had just been
+ * allocated.
+ */
+static void *dplane_pool_get(enum dplane_pool_id id, size_t size)
+{
+	struct dplane_pool *pool = &dplane_pools[id];
+	struct dplane_pool_cache *cache;
+	struct dplane_pool_item *item;
+	uint32_t batch;
+
+	atomic_fetch_add_explicit(&pool->allocs, 1, memory_order_relaxed);
+
+	if (!atomic_load_explicit(&pool->enabled, memory_order_relaxed))
+		return pool->alloc();
+
+	cache = dplane_pool_get_cache(id);
+
+	/* Refill an empty cache with a batch from the shared list */
+	if (cache->items == NULL &&
+	    atomic_load_explicit(&pool->shared_count, memory_order_relaxed)) {
+		frr_with_mutex (&pool->mutex) {
+			batch = 0;
+			while (pool->shared && batch < pool->cache_max / 2) {
+				item = pool->shared;
+				pool->shared = item->next;
+				item->next = cache->items;
+				cache->items = item;
+				batch++;
+			}
+			atomic_fetch_sub_explicit(&pool->shared_count, batch,
+						  memory_order_relaxed);
+			cache->count = batch;
+		}
+	}
+
+	item = cache->items;
+	if (item == NULL)
+		return pool->alloc();
+
+	cache->items = item->next;
+	cache->count--;
+
+	atomic_fetch_add_explicit(&pool->reused, 1, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&pool->pooled, 1, memory_order_relaxed);
+
+	memset(item, 0, size);
+	return item;
+}
+
+/*
+ * Return an object to a pool. Any internal allocations must have been
+ * released already.
+ */
+static void dplane_pool_put(enum dplane_pool_id id, void *obj)
+{
+	struct dplane_pool *pool = &dplane_pools[id];
+	struct dplane_pool_cache *cache;
+	struct dplane_pool_item *item = obj, *spill = NULL;
+	uint32_t batch = 0;
+
+	atomic_fetch_add_explicit(&pool->frees, 1, memory_order_relaxed);
+
+	if (!atomic_load_explicit(&pool->enabled, memory_order_relaxed)) {
+		atomic_fetch_add_explicit(&pool->released, 1,
+					  memory_order_relaxed);
+		pool->free(obj);
+		return;
+	}
+
+	cache = dplane_pool_get_cache(id);
 
-	/* TODO -- just alloc'ing memory, but would like to maintain
-	 * a pool
+	item->next = cache->items;
+	cache->items = item;
+	cache->count++;
+	atomic_fetch_add_explicit(&pool->pooled, 1, memory_order_relaxed);
+
+	if (cache->count <= pool->cache_max)
+		return;
+
+	/* Cache is full: move half of it to the shared list, and release
+	 * whatever doesn't fit there.
 	 */
-	p = XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
+	frr_with_mutex (&pool->mutex) {
+		while (cache->count > pool->cache_max / 2) {
+			item = cache->items;
+			cache->items = item->next;
+			cache->count--;
+
+			if (atomic_load_explicit(&pool->shared_count,
+						 memory_order_relaxed) <
+			    pool->shared_max) {
+				item->next = pool->shared;
+				pool->shared = item;
+				atomic_fetch_add_explicit(
+					&pool->shared_count, 1,
+					memory_order_relaxed);
+			} else {
+				item->next = spill;
+				spill = item;
+				batch++;
+			}
+		}
+	}
+
+	if (batch == 0)
+		return;
+
+	atomic_fetch_sub_explicit(&pool->pooled, batch, memory_order_relaxed);
+	atomic_fetch_add_explicit(&pool->released, batch,
+				  memory_order_relaxed);
+
+	while ((item = spill) != NULL) {
+		spill = item->next;
+		pool->free(item);
+	}
+}
+
+/*
+ * Release all pooled objects; called at shutdown, after the dplane pthread
+ * has stopped. Objects returned later are simply freed.
+ */
+static void dplane_pool_fini(enum dplane_pool_id id)
+{
+	struct dplane_pool *pool = &dplane_pools[id];
+	struct dplane_pool_cache *cache;
+	struct dplane_pool_item *item;
+
+	atomic_store_explicit(&pool->enabled, false, memory_order_relaxed);
+
+	frr_with_mutex (&pool->mutex) {
+		while ((cache = pool->caches) != NULL) {
+			pool->caches = cache->next;
+
+			while ((item = cache->items) != NULL) {
+				cache->items = item->next;
+				pool->free(item);
+			}
+			XFREE(MTYPE_DP_POOL, cache);
+		}
+
+		while ((item = pool->shared) != NULL) {
+			pool->shared = item->next;
+			pool->free(item);
+		}
+		atomic_store_explicit(&pool->shared_count, 0,
+				      memory_order_relaxed);
+	}
+
+	dplane_pool_tls[id] = NULL;
+	atomic_store_explicit(&pool->pooled, 0, memory_order_relaxed);
+}
+
+/*
+ * Nexthop copies held by contexts come from the nexthop pool. These mirror
+ * nexthop_dup(), copy_nexthops() and nexthops_free() from lib.
+ */
+static struct nexthop *dplane_nexthop_dup(const struct nexthop *nexthop,
+					  struct nexthop *rparent);
+
+static void dplane_copy_nexthops(struct nexthop **tnh, const struct nexthop *nh,
+				 struct nexthop *rparent)
+{
+	const struct nexthop *nh1;
 
-	return p;
+	for (nh1 = nh; nh1; nh1 = nh1->next)
+		_nexthop_add(tnh, dplane_nexthop_dup(nh1, rparent));
+}
+
+static struct nexthop *dplane_nexthop_dup(const struct nexthop *nexthop,
+					  struct nexthop *rparent)
+{
+	struct nexthop *new;
+
+	new = dplane_pool_get(DPLANE_POOL_NEXTHOP, sizeof(*new));
+
+	/* Same default as nexthop_new() */
+	new->weight = 1;
+
+	nexthop_copy_no_recurse(new, nexthop, rparent);
+
+	if (CHECK_FLAG(new->flags, NEXTHOP_FLAG_RECURSIVE))
+		dplane_copy_nexthops(&new->resolved, nexthop->resolved, new);
+
+	return new;
+}
+
+static void dplane_nexthops_free(struct nexthop *nexthop)
+{
+	struct nexthop *nh, *next;
+
+	for (nh = nexthop; nh; nh = next) {
+		next = nh->next;
+
+		nexthop_del_labels(nh);
+		nexthop_del_srv6_seg6local(nh);
+		nexthop_del_srv6_seg6(nh);
+		if (nh->resolved)
+			dplane_nexthops_free(nh->resolved);
+
+		dplane_pool_put(DPLANE_POOL_NEXTHOP, nh);
+	}
+}
+
+/*
+ * Allocate a dataplane update context
+ */
+struct zebra_dplane_ctx *dplane_ctx_alloc(void)
+{
+	return dplane_pool_get(DPLANE_POOL_CTX,
+			       sizeof(struct zebra_dplane_ctx));
 }
 
 /* Enable system route notifications */
@@ -735,7 +1083,7 @@ static void dplane_ctx_free_internal(struct zebra_dplane_ctx *ctx)
 		/* Free allocated nexthops */
 		if (ctx->u.rinfo.zd_ng.nexthop) {
 			/* This deals with recursive nexthops too */
-			nexthops_free(ctx->u.rinfo.zd_ng.nexthop);
+			dplane_nexthops_free(ctx->u.rinfo.zd_ng.nexthop);
 
 			ctx->u.rinfo.zd_ng.nexthop = NULL;
 		}
@@ -743,21 +1091,22 @@ static void dplane_ctx_free_internal(struct zebra_dplane_ctx *ctx)
 		/* Free backup info also (if present) */
 		if (ctx->u.rinfo.backup_ng.nexthop) {
 			/* This deals with recursive nexthops too */
-			nexthops_free(ctx->u.rinfo.backup_ng.nexthop);
+			dplane_nexthops_free(ctx->u.rinfo.backup_ng.nexthop);
 
 			ctx->u.rinfo.backup_ng.nexthop = NULL;
 		}
 
 		if (ctx->u.rinfo.zd_old_ng.nexthop) {
 			/* This deals with recursive nexthops too */
-			nexthops_free(ctx->u.rinfo.zd_old_ng.nexthop);
+			dplane_nexthops_free(ctx->u.rinfo.zd_old_ng.nexthop);
 
 			ctx->u.rinfo.zd_old_ng.nexthop = NULL;
 		}
 
 		if (ctx->u.rinfo.old_backup_ng.nexthop) {
 			/* This deals with recursive nexthops too */
-			nexthops_free(ctx->u.rinfo.old_backup_ng.nexthop);
+			dplane_nexthops_free(
+				ctx->u.rinfo.old_backup_ng.nexthop);
 
 			ctx->u.rinfo.old_backup_ng.nexthop = NULL;
 		}
@@ -774,7 +1123,7 @@ static void dplane_ctx_free_internal(struct zebra_dplane_ctx *ctx)
 	case DPLANE_OP_NH_DELETE: {
 		if (ctx->u.rinfo.nhe.ng.nexthop) {
 			/* This deals with recursive nexthops too */
-			nexthops_free(ctx->u.rinfo.nhe.ng.nexthop);
+			dplane_nexthops_free(ctx->u.rinfo.nhe.ng.nexthop);
 
 			ctx->u.rinfo.nhe.ng.nexthop = NULL;
 		}
@@ -817,17 +1166,17 @@ static void dplane_ctx_free_internal(struct zebra_dplane_ctx *ctx)
 		/* Free allocated nexthops */
 		if (ctx->u.pw.fib_nhg.nexthop) {
 			/* This deals with recursive nexthops too */
-			nexthops_free(ctx->u.pw.fib_nhg.nexthop);
+			dplane_nexthops_free(ctx->u.pw.fib_nhg.nexthop);
 
 			ctx->u.pw.fib_nhg.nexthop = NULL;
 		}
 		if (ctx->u.pw.primary_nhg.nexthop) {
-			nexthops_free(ctx->u.pw.primary_nhg.nexthop);
+			dplane_nexthops_free(ctx->u.pw.primary_nhg.nexthop);
 
 			ctx->u.pw.primary_nhg.nexthop = NULL;
 		}
 		if (ctx->u.pw.backup_nhg.nexthop) {
-			nexthops_free(ctx->u.pw.backup_nhg.nexthop);
+			dplane_nexthops_free(ctx->u.pw.backup_nhg.nexthop);
 
 			ctx->u.pw.backup_nhg.nexthop = NULL;
 		}
@@ -905,7 +1254,7 @@ static void dplane_ctx_free_internal(struct zebra_dplane_ctx *ctx)
 }
 
 /*
- * Free a dataplane results context.
+ * Free a dataplane results context, returning it to the context pool.
  */
 static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 {
@@ -914,16 +1263,13 @@ static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 
 	DPLANE_CTX_VALID(*pctx);
 
-	/* TODO -- just freeing memory, but would like to maintain
-	 * a pool
-	 */
-
 	/* Some internal allocations may need to be freed, depending on
 	 * the type of info captured in the ctx.
 	 */
 	dplane_ctx_free_internal(*pctx);
 
-	XFREE(MTYPE_DP_CTX, *pctx);
+	dplane_pool_put(DPLANE_POOL_CTX, *pctx);
+	*pctx = NULL;
 }
 
 /*
@@ -941,7 +1287,6 @@ void dplane_ctx_reset(struct zebra_dplane_ctx *ctx)
  */
 void dplane_ctx_fini(struct zebra_dplane_ctx **pctx)
 {
-	/* TODO -- maintain pool; for now, just free */
 	dplane_ctx_free(pctx);
 }
 
@@ -2136,7 +2481,7 @@ void dplane_ctx_set_nexthops(struct zebra_dplane_ctx *ctx, struct nexthop *nh)
 	DPLANE_CTX_VALID(ctx);
 
 	if (ctx->u.rinfo.zd_ng.nexthop) {
-		nexthops_free(ctx->u.rinfo.zd_ng.nexthop);
+		dplane_nexthops_free(ctx->u.rinfo.zd_ng.nexthop);
 		ctx->u.rinfo.zd_ng.nexthop = NULL;
 	}
 	nexthop_group_copy_nh_sorted(&(ctx->u.rinfo.zd_ng), nh);
@@ -2154,7 +2499,7 @@ void dplane_ctx_set_backup_nhg(struct zebra_dplane_ctx *ctx,
 	DPLANE_CTX_VALID(ctx);
 
 	if (ctx->u.rinfo.backup_ng.nexthop) {
-		nexthops_free(ctx->u.rinfo.backup_ng.nexthop);
+		dplane_nexthops_free(ctx->u.rinfo.backup_ng.nexthop);
 		ctx->u.rinfo.backup_ng.nexthop = NULL;
 	}
 
@@ -2162,7 +2507,7 @@ void dplane_ctx_set_backup_nhg(struct zebra_dplane_ctx *ctx,
 
 	/* Be careful to preserve the order of the backup list */
 	for (nh = nhg->nexthop; nh; nh = nh->next) {
-		nexthop = nexthop_dup(nh, NULL);
+		nexthop = dplane_nexthop_dup(nh, NULL);
 
 		if (last_nh)
 			NEXTHOP_APPEND(last_nh, nexthop);
@@ -3447,14 +3792,15 @@ int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx, enum dplane_op_e op,
 		return ret;
 
 	/* Copy nexthops; recursive info is included too */
-	copy_nexthops(&(ctx->u.rinfo.zd_ng.nexthop),
-		      re->nhe->nhg.nexthop, NULL);
+	dplane_copy_nexthops(&(ctx->u.rinfo.zd_ng.nexthop),
+			     re->nhe->nhg.nexthop, NULL);
 	ctx->u.rinfo.zd_nhg_id = re->nhe->id;
 
 	/* Copy backup nexthop info, if present */
 	if (re->nhe->backup_info && re->nhe->backup_info->nhe) {
-		copy_nexthops(&(ctx->u.rinfo.backup_ng.nexthop),
-			      re->nhe->backup_info->nhe->nhg.nexthop, NULL);
+		dplane_copy_nexthops(&(ctx->u.rinfo.backup_ng.nexthop),
+				     re->nhe->backup_info->nhe->nhg.nexthop,
+				     NULL);
 	}
 
 	/*
@@ -3930,7 +4276,7 @@ static int dplane_ctx_pw_init(struct zebra_dplane_ctx *ctx,
 				    || nh->nh_label == NULL)
 					continue;
 
-				newnh = nexthop_dup(nh, NULL);
+				newnh = dplane_nexthop_dup(nh, NULL);
 
 				if (last_nh)
 					NEXTHOP_APPEND(last_nh, newnh);
@@ -3950,7 +4296,7 @@ static int dplane_ctx_pw_init(struct zebra_dplane_ctx *ctx,
 				    || nh->nh_label == NULL)
 					continue;
 
-				newnh = nexthop_dup(nh, NULL);
+				newnh = dplane_nexthop_dup(nh, NULL);
 
 				if (last_nh)
 					NEXTHOP_APPEND(last_nh, newnh);
@@ -3962,15 +4308,15 @@ static int dplane_ctx_pw_init(struct zebra_dplane_ctx *ctx,
 
 		/* Copy primary nexthops; recursive info is included too */
 		assert(re->nhe != NULL); /* SA warning */
-		copy_nexthops(&(ctx->u.pw.primary_nhg.nexthop),
-			      re->nhe->nhg.nexthop, NULL);
+		dplane_copy_nexthops(&(ctx->u.pw.primary_nhg.nexthop),
+				     re->nhe->nhg.nexthop, NULL);
 		ctx->u.pw.nhg_id = re->nhe->id;
 
 		/* Copy backup nexthop info, if present */
 		if (re->nhe->backup_info && re->nhe->backup_info->nhe) {
-			copy_nexthops(&(ctx->u.pw.backup_nhg.nexthop),
-				      re->nhe->backup_info->nhe->nhg.nexthop,
-				      NULL);
+			dplane_copy_nexthops(
+				&(ctx->u.pw.backup_nhg.nexthop),
+				re->nhe->backup_info->nhe->nhg.nexthop, NULL);
 		}
 	}
 	route_unlock_node(rn);
@@ -4260,8 +4606,8 @@ dplane_route_update_internal(struct route_node *rn,
 			/* For bsd, capture previous re's nexthops too, sigh.
 			 * We'll need these to do per-nexthop deletes.
 			 */
-			copy_nexthops(&(ctx->u.rinfo.zd_old_ng.nexthop),
-				      old_re->nhe->nhg.nexthop, NULL);
+			dplane_copy_nexthops(&(ctx->u.rinfo.zd_old_ng.nexthop),
+					     old_re->nhe->nhg.nexthop, NULL);
 
 			if (zebra_nhg_get_backup_nhg(old_re->nhe) != NULL) {
 				struct nexthop_group *nhg;
@@ -4271,7 +4617,8 @@ dplane_route_update_internal(struct route_node *rn,
 				nh = &(ctx->u.rinfo.old_backup_ng.nexthop);
 
 				if (nhg->nexthop)
-					copy_nexthops(nh, nhg->nexthop, NULL);
+					dplane_copy_nexthops(nh, nhg->nexthop,
+							     NULL);
 			}
 #endif	/* !HAVE_NETLINK */
 		}
@@ -4646,19 +4993,19 @@ dplane_route_notif_update(struct route_node *rn,
 	if (op == DPLANE_OP_ROUTE_UPDATE ||
 	    op == DPLANE_OP_ROUTE_INSTALL) {
 
-		nexthops_free(new_ctx->u.rinfo.zd_ng.nexthop);
+		dplane_nexthops_free(new_ctx->u.rinfo.zd_ng.nexthop);
 		new_ctx->u.rinfo.zd_ng.nexthop = NULL;
 
 		nhg = rib_get_fib_nhg(re);
 		if (nhg && nhg->nexthop)
-			copy_nexthops(&(new_ctx->u.rinfo.zd_ng.nexthop),
-				      nhg->nexthop, NULL);
+			dplane_copy_nexthops(&(new_ctx->u.rinfo.zd_ng.nexthop),
+					     nhg->nexthop, NULL);
 
 		/* Check for installed backup nexthops also */
 		nhg = rib_get_fib_backup_nhg(re);
 		if (nhg && nhg->nexthop) {
-			copy_nexthops(&(new_ctx->u.rinfo.zd_ng.nexthop),
-				      nhg->nexthop, NULL);
+			dplane_copy_nexthops(&(new_ctx->u.rinfo.zd_ng.nexthop),
+					     nhg->nexthop, NULL);
 		}
 
 		for (ALL_NEXTHOPS(new_ctx->u.rinfo.zd_ng, nexthop))
@@ -5973,6 +6320,48 @@ dplane_srv6_encap_srcaddr_set(const struct in6_addr *addr, ns_id_t ns_id)
 	return result;
 }
 
+/*
+ * Show the context and nexthop pool counters
+ */
+static void dplane_pool_show(struct vty *vty, bool detailed)
+{
+	struct dplane_pool *pool;
+	uint64_t allocs, reused, released, pooled;
+	int i;
+
+	for (i = 0; i < DPLANE_POOL_MAX; i++) {
+		pool = &dplane_pools[i];
+
+		allocs = atomic_load_explicit(&pool->allocs,
+					      memory_order_relaxed);
+		reused = atomic_load_explicit(&pool->reused,
+					      memory_order_relaxed);
+		released = atomic_load_explicit(&pool->released,
+						memory_order_relaxed);
+		pooled = atomic_load_explicit(&pool->pooled,
+					      memory_order_relaxed);
+
+		vty_out(vty, "%s pool allocs:      %" PRIu64 "\n", pool->name,
+			allocs);
+		vty_out(vty, "%s pool reused:      %" PRIu64 "\n", pool->name,
+			reused);
+		vty_out(vty, "%s pool free:        %" PRIu64 "\n", pool->name,
+			pooled);
+
+		if (!detailed)
+			continue;
+
+		vty_out(vty, "%s pool returned:    %" PRIu64 "\n", pool->name,
+			atomic_load_explicit(&pool->frees,
+					     memory_order_relaxed));
+		vty_out(vty, "%s pool released:    %" PRIu64 "\n", pool->name,
+			released);
+		vty_out(vty, "%s pool shared free: %u\n", pool->name,
+			atomic_load_explicit(&pool->shared_count,
+					     memory_order_relaxed));
+	}
+}
+
 /*
  * Handler for 'show dplane'
  */
@@ -6104,6 +6493,9 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 				    memory_order_relaxed);
 	vty_out(vty, "GRE set updates:       %"PRIu64"\n", incoming);
 	vty_out(vty, "GRE set errors:        %"PRIu64"\n", errs);
+
+	dplane_pool_show(vty, detailed);
+
 	return CMD_SUCCESS;
 }
 
@@ -6125,10 +6517,8 @@ int dplane_show_provs_helper(struct vty *vty, bool detailed)
 
 	/* Show counters, useful info from each registered provider */
 	while (prov) {
-		dplane_provider_lock(prov);
-		in_q = dplane_ctx_queue_count(&prov->dp_ctx_in_list);
-		out_q = dplane_ctx_queue_count(&prov->dp_ctx_out_list);
-		dplane_provider_unlock(prov);
+		in_q = dplane_prov_queue_count(&prov->dp_in_q);
+		out_q = dplane_prov_queue_count(&prov->dp_out_q);
 
 		in = atomic_load_explicit(&prov->dp_in_counter,
 					  memory_order_relaxed);
@@ -6201,8 +6591,6 @@ int dplane_provider_register(const char *name,
 	p = XCALLOC(MTYPE_DP_PROV, sizeof(struct zebra_dplane_provider));
 
 	pthread_mutex_init(&(p->dp_mutex), NULL);
-	dplane_ctx_list_init(&p->dp_ctx_in_list);
-	dplane_ctx_list_init(&p->dp_ctx_out_list);
 
 	p->dp_flags = flags;
 	p->dp_priority = prio;
@@ -6211,6 +6599,9 @@ int dplane_provider_register(const char *name,
 	p->dp_fini = fini_fp;
 	p->dp_data = data;
 
+	dplane_prov_queue_init(p, &p->dp_in_q);
+	dplane_prov_queue_init(p, &p->dp_out_q);
+
 	/* Lock - the dplane pthread may be running */
 	DPLANE_LOCK();
 
@@ -6285,75 +6676,219 @@ void dplane_provider_unlock(struct zebra_dplane_provider *prov)
 }
 
 /*
- * Dequeue and maintain associated counter
+ * Provider queue helpers.  These take the provider mutex themselves, and
+ * only when the overflow list has to be used.
  */
-struct zebra_dplane_ctx *dplane_provider_dequeue_in_ctx(
-	struct zebra_dplane_provider *prov)
+static void dplane_prov_queue_init(struct zebra_dplane_provider *prov,
+				   struct dplane_prov_queue *q)
 {
-	struct zebra_dplane_ctx *ctx = NULL;
+	dplane_ctx_list_init(&q->list);
+	atomic_store_explicit(&q->list_len, 0, memory_order_relaxed);
+
+	if (dplane_provider_is_threaded(prov))
+		q->ring = atomring_new(DPLANE_PROV_RING_SIZE);
+}
+
+static void dplane_prov_queue_fini(struct dplane_prov_queue *q)
+{
+	struct zebra_dplane_ctx *ctx;
+
+	if (q->ring) {
+		while ((ctx = atomring_pop(q->ring)) != NULL)
+			dplane_ctx_free(&ctx);
+
+		atomring_del(q->ring);
+		q->ring = NULL;
+	}
+
+	while ((ctx = dplane_ctx_list_pop(&q->list)) != NULL)
+		dplane_ctx_free(&ctx);
+
+	atomic_store_explicit(&q->list_len, 0, memory_order_relaxed);
+}
+
+/* Current queue length; may be slightly stale for a threaded provider */
+static uint32_t dplane_prov_queue_count(const struct dplane_prov_queue *q)
+{
+	uint32_t count;
+
+	count = atomic_load_explicit(&q->list_len, memory_order_relaxed);
+	if (q->ring)
+		count += atomring_count(q->ring);
+
+	return count;
+}
+
+static void dplane_prov_queue_enqueue(struct zebra_dplane_provider *prov,
+				      struct dplane_prov_queue *q,
+				      struct zebra_dplane_ctx *ctx)
+{
+	if (q->ring &&
+	    atomic_load_explicit(&q->list_len, memory_order_acquire) == 0 &&
+	    atomring_push(q->ring, ctx))
+		return;
+
+	dplane_provider_lock(prov);
+
+	dplane_ctx_list_add_tail(&q->list, ctx);
+	atomic_store_explicit(&q->list_len, dplane_ctx_queue_count(&q->list),
+			      memory_order_release);
+
+	dplane_provider_unlock(prov);
+}
+
+static void dplane_prov_queue_enqueue_list(struct zebra_dplane_provider *prov,
+					   struct dplane_prov_queue *q,
+					   struct dplane_ctx_list_head *listp)
+{
+	struct zebra_dplane_ctx *ctx;
+
+	if (q->ring &&
+	    atomic_load_explicit(&q->list_len, memory_order_acquire) == 0) {
+		while ((ctx = dplane_ctx_list_first(listp)) != NULL) {
+			if (!atomring_push(q->ring, ctx))
+				break;
+
+			dplane_ctx_list_del(listp, ctx);
+		}
+	}
+
+	if (dplane_ctx_queue_count(listp) == 0)
+		return;
 
 	dplane_provider_lock(prov);
 
-	ctx = dplane_ctx_list_pop(&(prov->dp_ctx_in_list));
+	while ((ctx = dplane_ctx_list_pop(listp)) != NULL)
+		dplane_ctx_list_add_tail(&q->list, ctx);
+	atomic_store_explicit(&q->list_len, dplane_ctx_queue_count(&q->list),
+			      memory_order_release);
+
+	dplane_provider_unlock(prov);
+}
+
+static struct zebra_dplane_ctx *
+dplane_prov_queue_dequeue(struct zebra_dplane_provider *prov,
+			  struct dplane_prov_queue *q)
+{
+	struct zebra_dplane_ctx *ctx;
+
+	/* The ring only ever holds contexts older than those on the
+	 * overflow list, so drain it first.
+	 */
+	if (q->ring) {
+		ctx = atomring_pop(q->ring);
+		if (ctx)
+			return ctx;
+
+		if (atomic_load_explicit(&q->list_len,
+					 memory_order_acquire) == 0)
+			return NULL;
+	}
+
+	dplane_provider_lock(prov);
+
+	ctx = dplane_ctx_list_pop(&q->list);
+	atomic_store_explicit(&q->list_len, dplane_ctx_queue_count(&q->list),
+			      memory_order_release);
 
 	dplane_provider_unlock(prov);
 
 	return ctx;
 }
 
-/*
- * Dequeue work to a list, return count
- */
-int dplane_provider_dequeue_in_list(struct zebra_dplane_provider *prov,
-				    struct dplane_ctx_list_head *listp)
+static int dplane_prov_queue_dequeue_list(struct zebra_dplane_provider *prov,
+					  struct dplane_prov_queue *q,
+					  struct dplane_ctx_list_head *listp,
+					  int limit)
 {
-	int limit, ret;
+	void *batch[64];
+	size_t i, want, got;
+	int count = 0;
 	struct zebra_dplane_ctx *ctx;
 
-	limit = zdplane_info.dg_updates_per_cycle;
+	if (q->ring) {
+		while (count < limit) {
+			want = MIN(array_size(batch), (size_t)(limit - count));
+			got = atomring_pop_bulk(q->ring, batch, want);
+
+			for (i = 0; i < got; i++)
+				dplane_ctx_list_add_tail(listp, batch[i]);
+
+			count += got;
+			if (got < want)
+				break;
+		}
+
+		if (count >= limit ||
+		    atomic_load_explicit(&q->list_len,
+					 memory_order_acquire) == 0)
+			return count;
+	}
 
 	dplane_provider_lock(prov);
 
-	for (ret = 0; ret < limit; ret++) {
-		ctx = dplane_ctx_list_pop(&(prov->dp_ctx_in_list));
-		if (ctx)
-			dplane_ctx_list_add_tail(listp, ctx);
-		else
+	while (count < limit) {
+		ctx = dplane_ctx_list_pop(&q->list);
+		if (ctx == NULL)
 			break;
+
+		dplane_ctx_list_add_tail(listp, ctx);
+		count++;
 	}
+	atomic_store_explicit(&q->list_len, dplane_ctx_queue_count(&q->list),
+			      memory_order_release);
 
 	dplane_provider_unlock(prov);
 
-	return ret;
+	return count;
 }
 
-uint32_t dplane_provider_out_ctx_queue_len(struct zebra_dplane_provider *prov)
+/*
+ * Dequeue and maintain associated counter
+ */
+struct zebra_dplane_ctx *dplane_provider_dequeue_in_ctx(
+	struct zebra_dplane_provider *prov)
 {
-	return atomic_load_explicit(&(prov->dp_out_counter),
-				    memory_order_relaxed);
+	return dplane_prov_queue_dequeue(prov, &prov->dp_in_q);
 }
 
 /*
- * Enqueue and maintain associated counter
+ * Dequeue work to a list, return count
  */
-void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
-				     struct zebra_dplane_ctx *ctx)
+int dplane_provider_dequeue_in_list(struct zebra_dplane_provider *prov,
+				    struct dplane_ctx_list_head *listp)
 {
-	uint64_t curr, high;
+	return dplane_prov_queue_dequeue_list(prov, &prov->dp_in_q, listp,
+					      zdplane_info.dg_updates_per_cycle);
+}
 
-	dplane_provider_lock(prov);
+uint32_t dplane_provider_out_ctx_queue_len(struct zebra_dplane_provider *prov)
+{
+	return atomic_load_explicit(&(prov->dp_out_counter),
+				    memory_order_relaxed);
+}
 
-	dplane_ctx_list_add_tail(&(prov->dp_ctx_out_list), ctx);
+/* Maintain out-queue high-water mark */
+static void dplane_provider_update_out_max(struct zebra_dplane_provider *prov)
+{
+	uint32_t curr, high;
 
-	/* Maintain out-queue counters */
-	curr = dplane_ctx_queue_count(&prov->dp_ctx_out_list);
-	high = atomic_load_explicit(&prov->dp_out_max,
-				    memory_order_relaxed);
+	curr = dplane_prov_queue_count(&prov->dp_out_q);
+	high = atomic_load_explicit(&prov->dp_out_max, memory_order_relaxed);
 	if (curr > high)
 		atomic_store_explicit(&prov->dp_out_max, curr,
 				      memory_order_relaxed);
+}
 
-	dplane_provider_unlock(prov);
+/*
+ * Enqueue and maintain associated counter
+ */
+void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
+				     struct zebra_dplane_ctx *ctx)
+{
+	dplane_prov_queue_enqueue(prov, &prov->dp_out_q, ctx);
+
+	dplane_provider_update_out_max(prov);
 
 	atomic_fetch_add_explicit(&(prov->dp_out_counter), 1,
 				  memory_order_relaxed);
@@ -6362,13 +6897,26 @@ void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
 static struct zebra_dplane_ctx *
 dplane_provider_dequeue_out_ctx(struct zebra_dplane_provider *prov)
 {
-	struct zebra_dplane_ctx *ctx;
+	return dplane_prov_queue_dequeue(prov, &prov->dp_out_q);
+}
 
-	ctx = dplane_ctx_list_pop(&(prov->dp_ctx_out_list));
-	if (!ctx)
-		return NULL;
+/*
+ * Enqueue a list of completed contexts, maintain associated counter
+ */
+void dplane_provider_enqueue_out_list(struct zebra_dplane_provider *prov,
+				      struct dplane_ctx_list_head *listp)
+{
+	uint32_t count = dplane_ctx_queue_count(listp);
 
-	return ctx;
+	if (count == 0)
+		return;
+
+	dplane_prov_queue_enqueue_list(prov, &prov->dp_out_q, listp);
+
+	dplane_provider_update_out_max(prov);
+
+	atomic_fetch_add_explicit(&(prov->dp_out_counter), count,
+				  memory_order_relaxed);
 }
 
 /*
@@ -7223,24 +7771,15 @@ static bool dplane_work_pending(void)
 		return true;
 
 	while (prov) {
-
-		dplane_provider_lock(prov);
-
-		ctx = dplane_ctx_list_first(&(prov->dp_ctx_in_list));
-		if (ctx == NULL)
-			ctx = dplane_ctx_list_first(&(prov->dp_ctx_out_list));
-
-		dplane_provider_unlock(prov);
-
-		if (ctx != NULL)
+		if (dplane_prov_queue_count(&prov->dp_in_q) > 0 ||
+		    dplane_prov_queue_count(&prov->dp_out_q) > 0) {
+			ret = true;
 			break;
+		}
 
 		prov = dplane_prov_list_next(&zdplane_info.dg_providers, prov);
 	}
 
-	if (ctx != NULL)
-		ret = true;
-
 	return ret;
 }
 
@@ -7347,8 +7886,8 @@ static void dplane_thread_loop(struct event *event)
 	/* Locate initial registered provider */
 	prov = dplane_prov_list_first(&zdplane_info.dg_providers);
 
-	curr = dplane_ctx_queue_count(&prov->dp_ctx_in_list);
-	out_curr = dplane_ctx_queue_count(&prov->dp_ctx_out_list);
+	curr = dplane_prov_queue_count(&prov->dp_in_q);
+	out_curr = dplane_prov_queue_count(&prov->dp_out_q);
 
 	if (curr >= (uint64_t)limit) {
 		if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
@@ -7385,7 +7924,7 @@ static void dplane_thread_loop(struct event *event)
 	/*
 	 * If there is anything still on the two input queues reschedule
 	 */
-	if (dplane_ctx_queue_count(&prov->dp_ctx_in_list) > 0 ||
+	if (dplane_prov_queue_count(&prov->dp_in_q) > 0 ||
 	    dplane_ctx_queue_count(&zdplane_info.dg_update_list) > 0)
 		reschedule = true;
 
@@ -7435,22 +7974,18 @@ static void dplane_thread_loop(struct event *event)
 		}
 
 		/* Enqueue new work to the provider */
-		dplane_provider_lock(prov);
-
-		while ((ctx = dplane_ctx_list_pop(&work_list)) != NULL)
-			dplane_ctx_list_add_tail(&(prov->dp_ctx_in_list), ctx);
+		dplane_prov_queue_enqueue_list(prov, &prov->dp_in_q,
+					       &work_list);
 
 		atomic_fetch_add_explicit(&prov->dp_in_counter, counter,
 					  memory_order_relaxed);
-		curr = dplane_ctx_queue_count(&prov->dp_ctx_in_list);
+		curr = dplane_prov_queue_count(&prov->dp_in_q);
 		high = atomic_load_explicit(&prov->dp_in_max,
 					    memory_order_relaxed);
 		if (curr > high)
 			atomic_store_explicit(&prov->dp_in_max, curr,
 					      memory_order_relaxed);
 
-		dplane_provider_unlock(prov);
-
 		/* Reset the temp list (though the 'concat' may have done this
 		 * already), and the counter
 		 */
@@ -7471,16 +8006,13 @@ static void dplane_thread_loop(struct event *event)
 		next_prov = dplane_prov_list_next(&zdplane_info.dg_providers,
 						  prov);
 		if (next_prov) {
-			curr = dplane_ctx_queue_count(
-				&next_prov->dp_ctx_in_list);
-			out_curr = dplane_ctx_queue_count(
-				&next_prov->dp_ctx_out_list);
+			curr = dplane_prov_queue_count(&next_prov->dp_in_q);
+			out_curr = dplane_prov_queue_count(
+				&next_prov->dp_out_q);
 		} else
 			out_curr = curr = 0;
 
 		/* Dequeue completed work from the provider */
-		dplane_provider_lock(prov);
-
 		if (curr >= (uint64_t)limit) {
 			if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
 				zlog_debug("%s: Next Provider(%s) Input queue is %" PRIu64
@@ -7502,15 +8034,8 @@ static void dplane_thread_loop(struct event *event)
 			 * in or out queue without going over
 			 */
 			tlimit = limit - MAX(curr, out_curr);
-			while (counter < tlimit) {
-				ctx = dplane_provider_dequeue_out_ctx(prov);
-				if (ctx) {
-					dplane_ctx_list_add_tail(&work_list,
-								 ctx);
-					counter++;
-				} else
-					break;
-			}
+			counter = dplane_prov_queue_dequeue_list(
+				prov, &prov->dp_out_q, &work_list, tlimit);
 		}
 
 		/*
@@ -7518,12 +8043,10 @@ static void dplane_thread_loop(struct event *event)
 		 * input or output queus of the current provider
 		 * if so then we know we need to reschedule.
 		 */
-		if (dplane_ctx_queue_count(&prov->dp_ctx_in_list) > 0 ||
-		    dplane_ctx_queue_count(&prov->dp_ctx_out_list) > 0)
+		if (dplane_prov_queue_count(&prov->dp_in_q) > 0 ||
+		    dplane_prov_queue_count(&prov->dp_out_q) > 0)
 			reschedule = true;
 
-		dplane_provider_unlock(prov);
-
 		if (counter >= limit)
 			reschedule = true;
 
@@ -7608,6 +8131,8 @@ void zebra_dplane_shutdown(void)
 	dp = dplane_prov_list_first(&zdplane_info.dg_providers);
 	while (dp) {
 		dplane_prov_list_del(&zdplane_info.dg_providers, dp);
+		dplane_prov_queue_fini(&dp->dp_in_q);
+		dplane_prov_queue_fini(&dp->dp_out_q);
 		XFREE(MTYPE_DP_PROV, dp);
 
 		dp = dplane_prov_list_first(&zdplane_info.dg_providers);
@@ -7624,6 +8149,10 @@ void zebra_dplane_shutdown(void)
 		}
 	}
 	DPLANE_UNLOCK();
+
+	/* Release pooled contexts and nexthops */
+	dplane_pool_fini(DPLANE_POOL_CTX);
+	dplane_pool_fini(DPLANE_POOL_NEXTHOP);
 }
 
 /*
@@ -1186,7 +1186,9 @@ void *dplane_provider_get_data(const struct zebra_dplane_provider *prov);
 bool dplane_provider_is_threaded(const struct zebra_dplane_provider *prov);
 
 /* Lock/unlock a provider's mutex - iff the provider was registered with
- * the THREADED flag.
+ * the THREADED flag.  The provider's own queues do not need this lock:
+ * for THREADED providers, they are lock-free rings, and the enqueue and
+ * dequeue apis below can be used from any pthread.
  */
 void dplane_provider_lock(struct zebra_dplane_provider *prov);
 void dplane_provider_unlock(struct zebra_dplane_provider *prov);
@@ -1217,6 +1219,12 @@ uint32_t dplane_provider_out_ctx_queue_len(struct zebra_dplane_provider *prov);
 void dplane_provider_enqueue_out_ctx(struct zebra_dplane_provider *prov,
 				     struct zebra_dplane_ctx *ctx);
 
+/* Enqueue a list of completed work, maintain associated counter and
+ * locking; the list is left empty.
+ */
+void dplane_provider_enqueue_out_list(struct zebra_dplane_provider *prov,
+				      struct dplane_ctx_list_head *listp);
+
 /* Enqueue a context directly to zebra main. */
 void dplane_provider_enqueue_to_zebra(struct zebra_dplane_ctx *ctx);
 
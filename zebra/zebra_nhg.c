@@ -33,6 +33,7 @@
 DEFINE_MTYPE_STATIC(ZEBRA, NHG, "Nexthop Group Entry");
 DEFINE_MTYPE_STATIC(ZEBRA, NHG_CONNECTED, "Nexthop Group Connected");
 DEFINE_MTYPE_STATIC(ZEBRA, NHG_CTX, "Nexthop Group Context");
+DEFINE_MTYPE_STATIC(ZEBRA, NHG_NH_INDEX, "Nexthop Group Nexthop Index");
 
 /* Map backup nexthop indices between two nhes */
 struct backup_nh_map_s {
@@ -438,6 +439,9 @@ static void *zebra_nhg_hash_alloc(void *arg)
 
 	nhe = zebra_nhe_copy(copy, copy->id);
 
+	/* The new entry hashes exactly like the lookup object */
+	nhe->hash_key = copy->hash_key;
+
 	/* Mark duplicate nexthops in a group at creation time. */
 	nexthop_group_mark_duplicates(&(nhe->nhg));
 
@@ -466,9 +470,8 @@ static void *zebra_nhg_hash_alloc(void *arg)
 	return nhe;
 }
 
-uint32_t zebra_nhg_hash_key(const void *arg)
+static uint32_t zebra_nhg_hash_key_calc(const struct nhg_hash_entry *nhe)
 {
-	const struct nhg_hash_entry *nhe = arg;
 	uint32_t key = 0x5a351234;
 	uint32_t primary = 0;
 	uint32_t backup = 0;
@@ -484,6 +487,19 @@ uint32_t zebra_nhg_hash_key(const void *arg)
 	return key;
 }
 
+uint32_t zebra_nhg_hash_key(const void *arg)
+{
+	const struct nhg_hash_entry *nhe = arg;
+
+	/* Use the key computed when the entry was looked up, if any: hashing
+	 * walks every nexthop, which adds up for large ECMP groups.
+	 */
+	if (nhe->hash_key)
+		return nhe->hash_key;
+
+	return zebra_nhg_hash_key_calc(nhe);
+}
+
 uint32_t zebra_nhg_id_key(const void *arg)
 {
 	const struct nhg_hash_entry *nhe = arg;
@@ -702,10 +718,17 @@ static bool zebra_nhe_find(struct nhg_hash_entry **nhe, /* return value */
 	struct nexthop *nh = NULL;
 
 
+	lookup->hash_key = 0;
+
 	if (lookup->id)
 		(*nhe) = zebra_nhg_lookup_id(lookup->id);
-	else
+	else {
+		/* Hash the lookup object once, for both the lookup and the
+		 * insert below.
+		 */
+		lookup->hash_key = zebra_nhg_hash_key_calc(lookup);
 		(*nhe) = hash_lookup(zrouter.nhgs, lookup);
+	}
 
 	if (IS_ZEBRA_DEBUG_NHG_DETAIL)
 		zlog_debug("%s: id %u, lookup %p, vrf %d, type %d, depends %p%s => Found %p(%pNG)",
@@ -3165,6 +3188,92 @@ backups_done:
 	return curr_active;
 }
 
+/*
+ * Sorted index of the resolved nexthops of an nhe, used to find the nexthop
+ * (and so the weight) that corresponds to each singleton depend when
+ * building a grp array. Without it, that search is a list walk per depend,
+ * which is quadratic in the size of the group.
+ */
+struct nhe2grp_nh {
+	const struct nexthop *nh;
+	uint32_t pos;
+};
+
+struct nhe2grp_index {
+	struct nhe2grp_nh *nhs;
+	uint32_t count;
+	struct nhe2grp_nh buf[16];
+};
+
+static int nhe2grp_nh_cmp(const void *a, const void *b)
+{
+	const struct nhe2grp_nh *n1 = a, *n2 = b;
+	int ret;
+
+	ret = nexthop_cmp_no_weight(n1->nh, n2->nh);
+	if (ret)
+		return ret;
+
+	/* Keep list order among equal nexthops */
+	return numcmp(n1->pos, n2->pos);
+}
+
+static void nhe2grp_index_init(struct nhe2grp_index *idx,
+			       const struct nhg_hash_entry *nhe)
+{
+	struct nexthop *nexthop;
+	uint32_t count = 0;
+
+	for (ALL_NEXTHOPS(nhe->nhg, nexthop))
+		if (!CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE))
+			count++;
+
+	if (count <= array_size(idx->buf))
+		idx->nhs = idx->buf;
+	else
+		idx->nhs = XCALLOC(MTYPE_NHG_NH_INDEX,
+				   count * sizeof(*idx->nhs));
+
+	idx->count = 0;
+	for (ALL_NEXTHOPS(nhe->nhg, nexthop)) {
+		if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE))
+			continue;
+
+		idx->nhs[idx->count].nh = nexthop;
+		idx->nhs[idx->count].pos = idx->count;
+		idx->count++;
+	}
+
+	qsort(idx->nhs, idx->count, sizeof(*idx->nhs), nhe2grp_nh_cmp);
+}
+
+static void nhe2grp_index_fini(struct nhe2grp_index *idx)
+{
+	if (idx->nhs != idx->buf)
+		XFREE(MTYPE_NHG_NH_INDEX, idx->nhs);
+}
+
+/* Find the first nexthop, in list order, that matches 'nh' ignoring weight */
+static const struct nexthop *nhe2grp_index_find(const struct nhe2grp_index *idx,
+						const struct nexthop *nh)
+{
+	uint32_t lo = 0, hi = idx->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+
+		if (nexthop_cmp_no_weight(idx->nhs[mid].nh, nh) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < idx->count && nexthop_cmp_no_weight(idx->nhs[lo].nh, nh) == 0)
+		return idx->nhs[lo].nh;
+
+	return NULL;
+}
+
 /* Recursively construct a grp array of fully resolved IDs.
  *
  * This function allows us to account for groups within groups,
@@ -3180,11 +3289,13 @@ backups_done:
  */
 static uint16_t zebra_nhg_nhe2grp_internal(struct nh_grp *grp, uint16_t curr_index,
 					   struct nhg_hash_entry *nhe,
-					   struct nhg_hash_entry *original, int max_num)
+					   struct nhg_hash_entry *original,
+					   const struct nhe2grp_index *idx,
+					   int max_num)
 {
 	struct nhg_connected *rb_node_dep = NULL;
 	struct nhg_hash_entry *depend = NULL;
-	struct nexthop *nexthop;
+	const struct nexthop *nexthop;
 	uint16_t i = curr_index;
 
 	frr_each(nhg_connected_tree, &nhe->nhg_depends, rb_node_dep) {
@@ -3210,12 +3321,23 @@ static uint16_t zebra_nhg_nhe2grp_internal(struct nh_grp *grp, uint16_t curr_ind
 		}
 
 		if (!zebra_nhg_depends_is_empty(depend)) {
-			/* This is a group within a group */
+			struct nhe2grp_index nhe_idx;
+
+			/* This is a group within a group; weights come
+			 * from this level's nexthops.
+			 */
+			if (nhe == original) {
+				i = zebra_nhg_nhe2grp_internal(grp, i, depend,
+							       nhe, idx,
+							       max_num);
+				continue;
+			}
+
+			nhe2grp_index_init(&nhe_idx, nhe);
 			i = zebra_nhg_nhe2grp_internal(grp, i, depend, nhe,
-						       max_num);
+						       &nhe_idx, max_num);
+			nhe2grp_index_fini(&nhe_idx);
 		} else {
-			bool found;
-
 			if (!CHECK_FLAG(depend->flags, NEXTHOP_GROUP_VALID)) {
 				if (IS_ZEBRA_DEBUG_RIB_DETAILED
 				    || IS_ZEBRA_DEBUG_NHG)
@@ -3264,21 +3386,8 @@ static uint16_t zebra_nhg_nhe2grp_internal(struct nh_grp *grp, uint16_t curr_ind
 			 * nexthop associated with this and set the weight
 			 * appropriately
 			 */
-			found = false;
-			for (ALL_NEXTHOPS_PTR(&original->nhg, nexthop)) {
-				if (CHECK_FLAG(nexthop->flags,
-					       NEXTHOP_FLAG_RECURSIVE))
-					continue;
-
-				if (nexthop_cmp_no_weight(depend->nhg.nexthop,
-							  nexthop) != 0)
-					continue;
-
-				found = true;
-				break;
-			}
-
-			if (!found) {
+			nexthop = nhe2grp_index_find(idx, depend->nhg.nexthop);
+			if (!nexthop) {
 				if (IS_ZEBRA_DEBUG_RIB_DETAILED ||
 				    IS_ZEBRA_DEBUG_NHG)
 					zlog_debug("%s: Nexthop ID (%u) unable to find nexthop in Nexthop Gropu Entry, something is terribly wrong",
@@ -3308,8 +3417,17 @@ done:
 /* Convert a nhe into a group array */
 uint16_t zebra_nhg_nhe2grp(struct nh_grp *grp, struct nhg_hash_entry *nhe, int max_num)
 {
+	struct nhe2grp_index idx;
+	uint16_t count;
+
+	nhe2grp_index_init(&idx, nhe);
+
 	/* Call into the recursive function */
-	return zebra_nhg_nhe2grp_internal(grp, 0, nhe, nhe, max_num);
+	count = zebra_nhg_nhe2grp_internal(grp, 0, nhe, nhe, &idx, max_num);
+
+	nhe2grp_index_fini(&idx);
+
+	return count;
 }
 
 void zebra_nhg_install_kernel(struct nhg_hash_entry *nhe, uint8_t type)
@@ -35,6 +35,9 @@ struct nhg_hash_entry {
 	afi_t afi;
 	vrf_id_t vrf_id;
 
+	/* Cached zebra_nhg_hash_key() value, 0 if not computed */
+	uint32_t hash_key;
+
 	/* Time since last update */
 	time_t uptime;
 
@@ -440,9 +440,9 @@ static int dispatch_opq_messages(struct stream_fifo *msg_fifo)
 								  client));
 
 			} else {
-				/* Copy message if more clients */
+				/* Share message if more clients */
 				if (client->next)
-					dup = stream_dup(msg);
+					dup = stream_clone(msg);
 			}
 
 			if (IS_ZEBRA_DEBUG_SEND && IS_ZEBRA_DEBUG_DETAIL)
@@ -1226,23 +1226,15 @@ static void zebra_ptm_send_bfdd(struct stream *msg)
 {
 	struct listnode *node;
 	struct zserv *client;
-	struct stream *msgc;
-
-	/* Create copy for replication. */
-	msgc = stream_dup(msg);
 
-	/* Send message to all running BFDd daemons. */
+	/* Send message to all running BFDd daemons, sharing the data. */
 	for (ALL_LIST_ELEMENTS_RO(zrouter.client_list, node, client)) {
 		if (client->proto != ZEBRA_ROUTE_BFD)
 			continue;
 
-		zserv_send_message(client, msg);
-
-		/* Allocate more messages. */
-		msg = stream_dup(msgc);
+		zserv_send_message(client, stream_clone(msg));
 	}
 
-	stream_free(msgc);
 	stream_free(msg);
 }
 
@@ -1250,23 +1242,15 @@ static void zebra_ptm_send_clients(struct stream *msg)
 {
 	struct listnode *node;
 	struct zserv *client;
-	struct stream *msgc;
-
-	/* Create copy for replication. */
-	msgc = stream_dup(msg);
 
-	/* Send message to all running client daemons. */
+	/* Send message to all running client daemons, sharing the data. */
 	for (ALL_LIST_ELEMENTS_RO(zrouter.client_list, node, client)) {
 		if (!IS_BFD_ENABLED_PROTOCOL(client->proto))
 			continue;
 
-		zserv_send_message(client, msg);
-
-		/* Allocate more messages. */
-		msg = stream_dup(msgc);
+		zserv_send_message(client, stream_clone(msg));
 	}
 
-	stream_free(msgc);
 	stream_free(msg);
 }
 
@@ -808,7 +808,7 @@ void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq,
 	 * there is nothing to do on this node currently,
 	 * so the function would walk the parent pointers, until the
 	 * 1.1.1.0/24 node is hit with the 1.1.1.2 rnh.  This function
-	 * would then call zebra_evaluate_rnh() which would then
+	 * would then call zebra_evaluate_rnh_entry() which would then
 	 * do a LPM and match on the 1.1.1.2/32 node.  This function
 	 * would then pull the 1.1.1.2 rnh off the 1.1.1.0/24 node
 	 * and place it on the 1.1.1.1/32 node and notify the upper
@@ -840,13 +840,14 @@ void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq,
 	 * and move them to a more specific node.  Also vice-versa as a
 	 * more specific node is removed.
 	 *
-	 * Long term the rnh code might be improved some as the rnh's
-	 * are stored as a list.  This might be transformed to a better
-	 * data structure.  This has not proven to be necessary yet as
-	 * that we have not seen any particular case where a rn is
-	 * storing more than a couple rnh's.  If we find a case
-	 * where this matters something might need to be done.
+	 * The rnh's are stored as a doubly linked list, since an
+	 * IGP route can have many thousands of BGP nexthops resolving
+	 * over it and each of those is unlinked in constant time when
+	 * it moves.  Each rnh on the list is evaluated directly, there is
+	 * no need to look it up in the rnh table again, and the resulting
+	 * client notifications are sent as one batch per client.
 	 */
+	zebra_rnh_batch_begin();
 	while (rn) {
 		if (IS_ZEBRA_DEBUG_NHT_DETAILED)
 			zlog_debug(
@@ -875,7 +876,6 @@ void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq,
 		frr_each_safe(rnh_list, &dest->nht, rnh) {
 			struct zebra_vrf *zvrf =
 				zebra_vrf_lookup_by_id(rnh->vrf_id);
-			struct prefix *p = &rnh->node->p;
 
 			if (IS_ZEBRA_DEBUG_NHT_DETAILED)
 				zlog_debug(
@@ -903,14 +903,14 @@ void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq,
 			}
 
 			rnh->seqno = seq;
-			zebra_evaluate_rnh(zvrf, family2afi(p->family), 0, p,
-					   rnh->safi);
+			zebra_evaluate_rnh_entry(zvrf, rnh, 0);
 		}
 
 		rn = rn->parent;
 		if (rn)
 			dest = rib_dest_from_rnode(rn);
 	}
+	zebra_rnh_batch_end();
 }
 
 /*
@@ -4927,6 +4927,9 @@ static void rib_process_dplane_results(struct event *thread)
 
 	/* Dequeue a list of completed updates with one lock/unlock cycle */
 
+	/* Nexthop tracking updates caused by this run go out as one batch */
+	zebra_rnh_batch_begin();
+
 	do {
 		dplane_ctx_q_init(&ctxlist);
 
@@ -5081,6 +5084,8 @@ static void rib_process_dplane_results(struct event *thread)
 
 	} while (1);
 
+	zebra_rnh_batch_end();
+
 #ifdef HAVE_SCRIPTING
 	if (fs)
 		frrscript_delete(fs);
@@ -36,12 +36,35 @@
 #include "zebra/zebra_errors.h"
 
 DEFINE_MTYPE_STATIC(ZEBRA, RNH, "Nexthop tracking object");
+DEFINE_MTYPE_STATIC(ZEBRA, RNH_BATCH, "Nexthop tracking update batch");
 
 /* UI controls whether to notify about changes that only involve backup
  * nexthops. Default is to notify all changes.
  */
 static bool rnh_hide_backups;
 
+/*
+ * Nexthop update batching.  A single route change can cause a large
+ * number of tracked nexthops to be re-evaluated, e.g. an IGP route that
+ * thousands of BGP nexthops resolve over.  While a batch is open the
+ * resulting ZEBRA_NEXTHOP_UPDATE messages are collected per client and
+ * handed to the client's output queue in one go when the outermost batch
+ * is closed, instead of taking the obuf lock and waking the client
+ * pthread once per message.
+ */
+struct rnh_batch_client {
+	struct zserv *client;
+	struct stream_fifo fifo;
+};
+
+static struct {
+	/* Nesting depth of zebra_rnh_batch_begin() calls */
+	unsigned int depth;
+
+	/* List of struct rnh_batch_client with pending updates */
+	struct list *clients;
+} rnh_batch;
+
 static void free_state(vrf_id_t vrf_id, struct route_entry *re,
 		       struct route_node *rn);
 static void copy_state(struct rnh *rnh, const struct route_entry *re,
@@ -56,6 +79,93 @@ void zebra_rnh_init(void)
 	hook_register(zserv_client_close, zebra_client_cleanup_rnh);
 }
 
+/*
+ * Open a nexthop update batch; batches may be nested, updates are only
+ * sent when the outermost batch is closed.
+ */
+void zebra_rnh_batch_begin(void)
+{
+	rnh_batch.depth++;
+}
+
+void zebra_rnh_batch_end(void)
+{
+	struct rnh_batch_client *rbc;
+	struct listnode *node, *nnode;
+
+	assert(rnh_batch.depth > 0);
+	if (--rnh_batch.depth > 0)
+		return;
+
+	if (!rnh_batch.clients)
+		return;
+
+	for (ALL_LIST_ELEMENTS(rnh_batch.clients, node, nnode, rbc)) {
+		if (IS_ZEBRA_DEBUG_NHT_DETAILED)
+			zlog_debug("%s: sending %zu nexthop updates to %s",
+				   __func__, stream_fifo_count_safe(&rbc->fifo),
+				   zebra_route_string(rbc->client->proto));
+
+		zserv_send_batch(rbc->client, &rbc->fifo);
+		stream_fifo_deinit(&rbc->fifo);
+		list_delete_node(rnh_batch.clients, node);
+		XFREE(MTYPE_RNH_BATCH, rbc);
+	}
+}
+
+/*
+ * Hand a nexthop update to a client, or queue it on the open batch.
+ */
+static int zebra_rnh_send_message(struct zserv *client, struct stream *s)
+{
+	struct rnh_batch_client *rbc = NULL, *iter;
+	struct listnode *node;
+
+	if (!rnh_batch.depth)
+		return zserv_send_message(client, s);
+
+	if (!rnh_batch.clients)
+		rnh_batch.clients = list_new();
+
+	for (ALL_LIST_ELEMENTS_RO(rnh_batch.clients, node, iter)) {
+		if (iter->client == client) {
+			rbc = iter;
+			break;
+		}
+	}
+
+	if (!rbc) {
+		rbc = XCALLOC(MTYPE_RNH_BATCH, sizeof(*rbc));
+		rbc->client = client;
+		stream_fifo_init(&rbc->fifo);
+		listnode_add(rnh_batch.clients, rbc);
+	}
+
+	stream_fifo_push(&rbc->fifo, s);
+	return 0;
+}
+
+/*
+ * Drop any batched updates for a client that is going away.
+ */
+static void zebra_rnh_batch_client_drop(struct zserv *client)
+{
+	struct rnh_batch_client *rbc;
+	struct listnode *node, *nnode;
+
+	if (!rnh_batch.clients)
+		return;
+
+	for (ALL_LIST_ELEMENTS(rnh_batch.clients, node, nnode, rbc)) {
+		if (rbc->client != client)
+			continue;
+
+		stream_fifo_deinit(&rbc->fifo);
+		list_delete_node(rnh_batch.clients, node);
+		XFREE(MTYPE_RNH_BATCH, rbc);
+	}
+}
+
 static inline struct route_table *get_rnh_table(vrf_id_t vrfid, afi_t afi,
 						safi_t safi)
 {
@@ -80,7 +190,7 @@ static void zebra_rnh_remove_from_routing_table(struct rnh *rnh)
 	struct route_node *rn;
 	rib_dest_t *dest;
 
-	if (!table)
+	if (!CHECK_FLAG(rnh->flags, ZEBRA_NHT_LINKED) || !table)
 		return;
 
 	rn = route_node_match(table, &rnh->resolved_route);
@@ -94,6 +204,7 @@ static void zebra_rnh_remove_from_routing_table(struct rnh *rnh)
 
 	dest = rib_dest_from_rnode(rn);
 	rnh_list_del(&dest->nht, rnh);
+	UNSET_FLAG(rnh->flags, ZEBRA_NHT_LINKED);
 	route_unlock_node(rn);
 }
 
@@ -115,6 +226,7 @@ static void zebra_rnh_store_in_routing_table(struct rnh *rnh)
 
 	dest = rib_dest_from_rnode(rn);
 	rnh_list_add_tail(&dest->nht, rnh);
+	SET_FLAG(rnh->flags, ZEBRA_NHT_LINKED);
 	route_unlock_node(rn);
 }
 
@@ -202,29 +314,11 @@ struct rnh *zebra_lookup_rnh(struct prefix *p, vrf_id_t vrfid, safi_t safi)
 
 void zebra_free_rnh(struct rnh *rnh)
 {
-	struct zebra_vrf *zvrf;
-	struct route_table *table;
-
 	zebra_rnh_remove_from_routing_table(rnh);
 	rnh->flags |= ZEBRA_NHT_DELETED;
 	list_delete(&rnh->client_list);
 	list_delete(&rnh->zebra_pseudowire_list);
 
-	zvrf = zebra_vrf_lookup_by_id(rnh->vrf_id);
-	table = zvrf->table[family2afi(rnh->resolved_route.family)][rnh->safi];
-
-	if (table) {
-		struct route_node *rern;
-
-		rern = route_node_match(table, &rnh->resolved_route);
-		if (rern) {
-			rib_dest_t *dest;
-
-			dest = rib_dest_from_rnode(rern);
-			rnh_list_del(&dest->nht, rnh);
-			route_unlock_node(rern);
-		}
-	}
 	free_state(rnh->vrf_id, rnh->state, rnh->node);
 	XFREE(MTYPE_RNH, rnh);
 }
@@ -658,13 +752,22 @@ static void zebra_rnh_eval_nexthop_entry(struct zebra_vrf *zvrf, afi_t afi,
 					 struct route_entry *re)
 {
 	int state_changed = 0;
+	bool moved;
 
 	/* If we're resolving over a different route, resolution has changed or
 	 * the resolving route has some change (e.g., metric), there is a state
 	 * change.
+	 *
+	 * The rnh only has to be moved to a different route node's nht list
+	 * when the resolving route changes, or when it is not on any list
+	 * yet: a new rnh starts out with 0.0.0.0/0 or ::/0 as its resolved
+	 * route, and may not have found a route node to link to.  This keeps
+	 * re-evaluation of the (common) unchanged case free of extra table
+	 * lookups.
 	 */
-	zebra_rnh_remove_from_routing_table(rnh);
-	if (!prefix_same(&rnh->resolved_route, prn ? &prn->p : NULL)) {
+	moved = !prefix_same(&rnh->resolved_route, prn ? &prn->p : NULL);
+	if (moved || !CHECK_FLAG(rnh->flags, ZEBRA_NHT_LINKED)) {
+		zebra_rnh_remove_from_routing_table(rnh);
 		if (prn)
 			prefix_copy(&rnh->resolved_route, &prn->p);
 		else {
@@ -677,14 +780,13 @@ static void zebra_rnh_eval_nexthop_entry(struct zebra_vrf *zvrf, afi_t afi,
 			memset(&rnh->resolved_route, 0, sizeof(struct prefix));
 			rnh->resolved_route.family = family;
 		}
+		zebra_rnh_store_in_routing_table(rnh);
+	}
 
-		copy_state(rnh, re, nrn);
-		state_changed = 1;
-	} else if (compare_state(re, rnh->state)) {
+	if (moved || compare_state(re, rnh->state)) {
 		copy_state(rnh, re, nrn);
 		state_changed = 1;
 	}
-	zebra_rnh_store_in_routing_table(rnh);
 
 	if (state_changed || force) {
 		/* NOTE: Use the "copy" of resolving route stored in 'rnh' i.e.,
@@ -766,6 +868,8 @@ void zebra_evaluate_rnh(struct zebra_vrf *zvrf, afi_t afi, int force,
 	if (!rnh_table) // unexpected
 		return;
 
+	zebra_rnh_batch_begin();
+
 	if (p) {
 		/* Evaluating a specific entry, make sure it exists. */
 		nrn = route_node_lookup(rnh_table, p);
@@ -789,6 +893,22 @@ void zebra_evaluate_rnh(struct zebra_vrf *zvrf, afi_t afi, int force,
 			nrn = route_next(nrn); /* this will also unlock nrn */
 		}
 	}
+
+	zebra_rnh_batch_end();
+}
+
+/*
+ * Evaluate a single tracked entry that is already known to the caller,
+ * e.g. one found via the nht list of the route node it resolves over.
+ * This saves the rnh table lookup zebra_evaluate_rnh() has to do.
+ */
+void zebra_evaluate_rnh_entry(struct zebra_vrf *zvrf, struct rnh *rnh,
+			      int force)
+{
+	if (!rnh->node || CHECK_FLAG(rnh->flags, ZEBRA_NHT_DELETED))
+		return;
+
+	zebra_rnh_evaluate_entry(zvrf, rnh->afi, force, rnh->node);
 }
 
 void zebra_print_rnh_table(vrf_id_t vrfid, afi_t afi, safi_t safi,
@@ -1250,7 +1370,7 @@ int zebra_send_rnh_update(struct rnh *rnh, struct zserv *client,
 	stream_putw_at(s, 0, stream_get_endp(s));
 
 	client->nh_last_upd_time = monotime(NULL);
-	return zserv_send_message(client, s);
+	return zebra_rnh_send_message(client, s);
 
 failure:
 
@@ -1455,6 +1575,8 @@ static int zebra_client_cleanup_rnh(struct zserv *client)
 	struct vrf *vrf;
 	struct zebra_vrf *zvrf;
 
+	zebra_rnh_batch_client_drop(client);
+
 	RB_FOREACH (vrf, vrf_id_head, &vrfs_by_id) {
 		zvrf = vrf->info;
 		if (zvrf) {
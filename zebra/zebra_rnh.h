@@ -30,6 +30,12 @@ extern void zebra_deregister_rnh_pseudowire(vrf_id_t, struct zebra_pw *);
 extern void zebra_remove_rnh_client(struct rnh *rnh, struct zserv *client);
 extern void zebra_evaluate_rnh(struct zebra_vrf *zvrf, afi_t afi, int force,
 			       const struct prefix *p, safi_t safi);
+extern void zebra_evaluate_rnh_entry(struct zebra_vrf *zvrf, struct rnh *rnh,
+				     int force);
+
+/* Collect nexthop updates to clients and send them in one batch */
+extern void zebra_rnh_batch_begin(void);
+extern void zebra_rnh_batch_end(void);
 extern void zebra_print_rnh_table(vrf_id_t vrfid, afi_t afi, safi_t safi,
 				  struct vty *vty, const struct prefix *p,
 				  json_object *json);
@@ -133,8 +133,11 @@ struct route_table *zebra_router_get_table(struct zebra_vrf *zvrf,
 	zrt->afi = afi;
 	zrt->safi = safi;
 	zrt->ns_id = zvrf->zns->ns_id;
-	zrt->table =
-		(afi == AFI_IP6) ? srcdest_table_init() : route_table_init();
+	if (afi == AFI_IP6)
+		zrt->table = srcdest_table_init();
+	else
+		zrt->table = route_table_init_with_delegate(
+			route_table_get_arena_delegate());
 
 	info = XCALLOC(MTYPE_RIB_TABLE_INFO, sizeof(*info));
 	info->zvrf = zvrf;
@@ -20,7 +20,6 @@
 #include <time.h>                 /* for NULL, tm, gmtime, time_t */
 #include <unistd.h>               /* for close, unlink, ssize_t */
 
-#include "lib/buffer.h"           /* for BUFFER_EMPTY, BUFFER_ERROR, BUFFE... */
 #include "lib/command.h"          /* for vty, install_element, CMD_SUCCESS... */
 #include "lib/hook.h"             /* for DEFINE_HOOK, DEFINE_KOOH, hook_call */
 #include "lib/linklist.h"         /* for ALL_LIST_ELEMENTS_RO, ALL_LIST_EL... */
@@ -199,79 +198,51 @@ static void zserv_client_fail(struct zserv *client)
 /*
  * Write all pending messages to client socket.
  *
- * This function first attempts to flush any buffered data. If unsuccessful,
- * the function reschedules itself and returns. If successful, it pops all
- * available messages from the output queue and continues to write data
- * directly to the socket until the socket would block. If the socket never
- * blocks and all data is written, the function returns without rescheduling
- * itself. If the socket ends up throwing EWOULDBLOCK, the remaining data is
- * buffered and the function reschedules itself.
+ * This function pops all available messages from the output queue, behind
+ * anything left over from the last run, and writes them straight out of
+ * their streams with writev() until the socket would block. If all data is
+ * written, the function returns without rescheduling itself. If the socket
+ * ends up throwing EWOULDBLOCK, the remaining messages stay on the write
+ * fifo and the function reschedules itself.
  *
- * The utility of the buffer is that it allows us to vastly reduce lock
- * contention by allowing us to pop *all* messages off the output queue at once
- * instead of locking and unlocking each time we want to pop a single message
- * off the queue. The same thing could arguably be accomplished faster by
- * allowing the main thread to write directly into the buffer instead of
- * enqueuing packets onto an intermediary queue, but the intermediary queue
- * allows us to expose information about input and output queues to the user in
- * terms of number of packets rather than size of data.
+ * Popping *all* messages off the output queue at once vastly reduces lock
+ * contention compared to locking and unlocking for each message. The
+ * intermediary queue allows us to expose information about input and output
+ * queues to the user in terms of number of packets rather than size of data.
+ * Since messages are written from the stream they were queued in, a message
+ * sent to many clients as stream_clone()s is never copied.
  */
 static void zserv_write(struct event *thread)
 {
 	struct zserv *client = EVENT_ARG(thread);
 	struct stream *msg;
 	uint32_t wcmd = 0;
-	struct stream_fifo *cache;
 	uint64_t time_now = monotime(NULL);
-
-	/* If we have any data pending, try to flush it first */
-	switch (buffer_flush_all(client->wb, client->sock)) {
-	case BUFFER_ERROR:
-		goto zwrite_fail;
-	case BUFFER_PENDING:
-		frr_with_mutex (&client->stats_mtx) {
-			client->last_write_time = time_now;
-		}
-		zserv_client_event(client, ZSERV_CLIENT_WRITE);
-		return;
-	case BUFFER_EMPTY:
-		break;
-	}
-
-	cache = stream_fifo_new();
+	bool queued = false;
 
 	frr_with_mutex (&client->obuf_mtx) {
-		while (stream_fifo_head(client->obuf_fifo))
-			stream_fifo_push(cache,
-					 stream_fifo_pop(client->obuf_fifo));
-	}
-
-	if (cache->tail) {
-		msg = cache->tail;
-		stream_set_getp(msg, 0);
-		wcmd = stream_getw_from(msg, ZAPI_HEADER_CMD_LOCATION);
-	}
-
-	while (stream_fifo_head(cache)) {
-		msg = stream_fifo_pop(cache);
-		buffer_put(client->wb, STREAM_DATA(msg), stream_get_endp(msg));
-		stream_free(msg);
+		while ((msg = stream_fifo_pop(client->obuf_fifo))) {
+			/* the whole message goes out, whatever was read */
+			stream_set_getp(msg, 0);
+			stream_fifo_push(client->wfifo, msg);
+			queued = true;
+		}
 	}
 
-	stream_fifo_free(cache);
+	if (queued)
+		wcmd = stream_getw_from(client->wfifo->tail,
+					ZAPI_HEADER_CMD_LOCATION);
 
-	/* If we have any data pending, try to flush it first */
-	switch (buffer_flush_all(client->wb, client->sock)) {
-	case BUFFER_ERROR:
+	if (stream_fifo_writev(client->wfifo, client->sock) == -1)
 		goto zwrite_fail;
-	case BUFFER_PENDING:
+
+	/* The socket would block, continue when it's writable again */
+	if (stream_fifo_head(client->wfifo)) {
 		frr_with_mutex (&client->stats_mtx) {
 			client->last_write_time = time_now;
 		}
 		zserv_client_event(client, ZSERV_CLIENT_WRITE);
 		return;
-	case BUFFER_EMPTY:
-		break;
 	}
 
 	frr_with_mutex (&client->stats_mtx) {
@@ -655,8 +626,8 @@ static void zserv_client_free(struct zserv *client)
 		stream_fifo_free(client->ibuf_fifo);
 	if (client->obuf_fifo)
 		stream_fifo_free(client->obuf_fifo);
-	if (client->wb)
-		buffer_free(client->wb);
+	if (client->wfifo)
+		stream_fifo_free(client->wfifo);
 
 	/* Free buffer mutexes */
 	pthread_mutex_destroy(&client->stats_mtx);
@@ -788,7 +759,7 @@ static struct zserv *zserv_client_create(int sock)
 	pthread_mutex_init(&client->ibuf_mtx, NULL);
 	pthread_mutex_init(&client->obuf_mtx, NULL);
 	pthread_mutex_init(&client->stats_mtx, NULL);
-	client->wb = buffer_new(0);
+	client->wfifo = stream_fifo_new();
 	TAILQ_INIT(&(client->gr_info_queue));
 
 	/* Initialize flags */
@@ -96,8 +96,8 @@ struct zserv {
 	struct stream *ibuf_work;
 	struct stream *obuf_work;
 
-	/* Buffer of data waiting to be written to client. */
-	struct buffer *wb;
+	/* Messages being written to the client, private to the I/O pthread */
+	struct stream_fifo *wfifo;
 
 	/* Threads for read/write. */
 	struct event *t_read;